@@ -0,0 +1,932 @@
+/*
+ * ClawLobstars — Memory Store Benchmark
+ * Concurrent stress/throughput: 1 → 32 threads against a sharded store,
+ * then batched versus single-key store/retrieve on one thread, hot-key
+ * tracking cost, writers running under a background snapshot scan, a
+ * full store churning through keys under each eviction policy, and a
+ * configurable workload reporting latency percentiles (optionally as JSON)
+ *
+ * Usage: bench_memory [--suite all|workload] [--keys N] [--values MIN-MAX]
+ *                     [--value-dist uniform|log] [--writes PCT] [--queries PCT]
+ *                     [--ttl PCT] [--ttl-sec N] [--zipf S] [--threads N]
+ *                     [--prune-ms N] [--ms N] [--json PATH|-]
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <pthread.h>
+#include "../src/include/cls_framework.h"
+#include "../src/core/cls_hist.h"
+
+#define BENCH_POOL_SIZE     (256u << 20)
+#define BENCH_KEYS          (1u << 18)
+#define BENCH_MAX_THREADS   32
+#define BENCH_BATCH         32
+#ifndef BENCH_RUN_MS
+#define BENCH_RUN_MS        500
+#endif
+#define BENCH_VALUE_MAX     65536
+#define BENCH_HIST_BITS     4       /* 16 sub-buckets per power of two */
+#define BENCH_HIST_BUCKETS  (61u << BENCH_HIST_BITS)
+
+/* Values carry their own checksum so torn or stale-freed reads show up */
+typedef struct {
+    uint64_t    key_id;
+    uint64_t    version;
+    uint64_t    check;
+    uint8_t     fill[40];
+} bench_value_t;
+
+typedef struct {
+    cls_memory_ctx_t   *mem;
+    uint32_t            id;
+    uint32_t            write_pct;
+    volatile int       *stop;
+    uint64_t            ops;
+    uint64_t            corrupt;
+} bench_worker_t;
+
+static uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t bench_rng(uint64_t *s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+static void bench_key(char *buf, size_t n, uint64_t id) {
+    snprintf(buf, n, "bench:%llu", (unsigned long long)id);
+}
+
+static void bench_fill(bench_value_t *v, uint64_t id, uint64_t version) {
+    v->key_id = id;
+    v->version = version;
+    v->check = (id * 0x9E3779B97F4A7C15ULL) ^ version;
+    memset(v->fill, (int)(version & 0xFF), sizeof(v->fill));
+}
+
+static bool bench_valid(const bench_value_t *v, uint64_t id) {
+    if (v->key_id != id) return false;
+    if (v->check != ((id * 0x9E3779B97F4A7C15ULL) ^ v->version)) return false;
+    for (size_t i = 0; i < sizeof(v->fill); i++)
+        if (v->fill[i] != (uint8_t)(v->version & 0xFF)) return false;
+    return true;
+}
+
+static void *bench_worker(void *arg) {
+    bench_worker_t *w = (bench_worker_t *)arg;
+    uint64_t seed = 0x2545F4914F6CDD1DULL ^ ((uint64_t)(w->id + 1) << 32);
+    char key[64];
+    bench_value_t v;
+
+    while (!__atomic_load_n(w->stop, __ATOMIC_ACQUIRE)) {
+        for (int batch = 0; batch < 256; batch++) {
+            uint64_t r = bench_rng(&seed);
+            uint64_t id = r % BENCH_KEYS;
+            bench_key(key, sizeof(key), id);
+
+            if ((r >> 40) % 100 < w->write_pct) {
+                bench_fill(&v, id, r >> 20);
+                cls_memory_store(w->mem, key, &v, sizeof(v));
+            } else {
+                size_t len = sizeof(v);
+                if (cls_memory_retrieve(w->mem, key, &v, &len) == CLS_OK &&
+                    (len != sizeof(v) || !bench_valid(&v, id)))
+                    w->corrupt++;
+            }
+            w->ops++;
+        }
+    }
+    return NULL;
+}
+
+/* Run one thread count; returns ops/s or 0 on failure */
+static double bench_run(cls_memory_ctx_t *mem, uint32_t threads, uint32_t write_pct,
+                        uint64_t *corrupt) {
+    pthread_t tid[BENCH_MAX_THREADS];
+    bench_worker_t workers[BENCH_MAX_THREADS];
+    volatile int stop = 0;
+
+    for (uint32_t i = 0; i < threads; i++) {
+        workers[i].mem = mem;
+        workers[i].id = i;
+        workers[i].write_pct = write_pct;
+        workers[i].stop = &stop;
+        workers[i].ops = 0;
+        workers[i].corrupt = 0;
+    }
+
+    uint64_t t0 = bench_now_ns();
+    for (uint32_t i = 0; i < threads; i++) {
+        if (pthread_create(&tid[i], NULL, bench_worker, &workers[i]) != 0)
+            return 0;
+    }
+
+    struct timespec run = { BENCH_RUN_MS / 1000, (BENCH_RUN_MS % 1000) * 1000000L };
+    nanosleep(&run, NULL);
+    __atomic_store_n(&stop, 1, __ATOMIC_RELEASE);
+
+    uint64_t ops = 0;
+    for (uint32_t i = 0; i < threads; i++) {
+        pthread_join(tid[i], NULL);
+        ops += workers[i].ops;
+        *corrupt += workers[i].corrupt;
+    }
+    uint64_t elapsed = bench_now_ns() - t0;
+
+    return (double)ops * 1e9 / (double)elapsed;
+}
+
+static int bench_threads(void) {
+    static const uint32_t counts[] = { 1, 2, 4, 8, 16, 32 };
+    static const uint32_t mixes[] = { 0, 10, 50 };
+
+    cls_memory_config_t cfg = CLS_MEMORY_CONFIG_DEFAULT;
+    cfg.pool_size = BENCH_POOL_SIZE;
+    cfg.shard_count = 64;
+    cfg.concurrent = true;
+
+    cls_memory_ctx_t mem;
+    if (cls_memory_init_ex(&mem, &cfg) != CLS_OK) {
+        fprintf(stderr, "bench: memory init failed\n");
+        return 1;
+    }
+
+    char key[64];
+    bench_value_t v;
+    for (uint64_t id = 0; id < BENCH_KEYS; id++) {
+        bench_key(key, sizeof(key), id);
+        bench_fill(&v, id, 0);
+        cls_memory_store(&mem, key, &v, sizeof(v));
+    }
+
+    printf("  %u keys, %u shards, %d ms per run\n\n", BENCH_KEYS, mem.shard_count, BENCH_RUN_MS);
+    printf("  %-8s %-8s %14s %10s\n", "writes", "threads", "ops/s", "scaling");
+
+    uint64_t corrupt = 0;
+    for (size_t m = 0; m < sizeof(mixes) / sizeof(mixes[0]); m++) {
+        double base = 0;
+        for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+            double rate = bench_run(&mem, counts[c], mixes[m], &corrupt);
+            if (c == 0) base = rate;
+            printf("  %6u%%  %-8u %14.0f %9.2fx\n", mixes[m], counts[c], rate,
+                   base > 0 ? rate / base : 0.0);
+        }
+        printf("\n");
+    }
+
+    uint32_t entries = 0;
+    cls_memory_stats(&mem, NULL, NULL, &entries);
+    printf("  entries=%u hits=%u misses=%u corrupt=%llu\n",
+           entries, mem.hit_count, mem.miss_count, (unsigned long long)corrupt);
+
+    cls_memory_destroy(&mem);
+    return corrupt == 0 && entries == BENCH_KEYS ? 0 : 1;
+}
+
+/* ---- Batched vs single-key ---- */
+
+/* Ops/s for one pass over every key in random batches of BENCH_BATCH;
+ * `batched` routes each batch through one store/retrieve_batch call */
+static double bench_batch_pass(cls_memory_ctx_t *mem, bool store, bool batched,
+                               uint64_t *corrupt) {
+    static char keys[BENCH_BATCH][64];
+    static bench_value_t vals[BENCH_BATCH];
+    cls_mem_batch_item_t items[BENCH_BATCH];
+    uint64_t ids[BENCH_BATCH];
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+
+    uint64_t t0 = bench_now_ns();
+    for (uint32_t n = 0; n < BENCH_KEYS; n += BENCH_BATCH) {
+        for (uint32_t i = 0; i < BENCH_BATCH; i++) {
+            ids[i] = bench_rng(&seed) % BENCH_KEYS;
+            bench_key(keys[i], sizeof(keys[i]), ids[i]);
+            if (store) bench_fill(&vals[i], ids[i], n + 1);
+            items[i].key = keys[i];
+            items[i].data = &vals[i];
+            items[i].len = sizeof(vals[i]);
+            items[i].ttl_sec = 0;
+        }
+
+        if (batched) {
+            if (store) cls_memory_store_batch(mem, items, BENCH_BATCH);
+            else cls_memory_retrieve_batch(mem, items, BENCH_BATCH);
+        } else {
+            for (uint32_t i = 0; i < BENCH_BATCH; i++) {
+                items[i].status = store ?
+                    cls_memory_store(mem, keys[i], &vals[i], sizeof(vals[i])) :
+                    cls_memory_retrieve(mem, keys[i], &vals[i], &items[i].len);
+            }
+        }
+
+        for (uint32_t i = 0; i < BENCH_BATCH && !store; i++) {
+            if (items[i].status == CLS_OK &&
+                (items[i].len != sizeof(vals[i]) || !bench_valid(&vals[i], ids[i])))
+                (*corrupt)++;
+        }
+    }
+    uint64_t elapsed = bench_now_ns() - t0;
+
+    return (double)BENCH_KEYS * 1e9 / (double)elapsed;
+}
+
+static int bench_batches(void) {
+    cls_memory_config_t cfg = CLS_MEMORY_CONFIG_DEFAULT;
+    cfg.pool_size = BENCH_POOL_SIZE;
+    cfg.shard_count = 64;
+    cfg.concurrent = true;
+
+    cls_memory_ctx_t mem;
+    if (cls_memory_init_ex(&mem, &cfg) != CLS_OK) {
+        fprintf(stderr, "bench: memory init failed\n");
+        return 1;
+    }
+
+    char key[64];
+    bench_value_t v;
+    for (uint64_t id = 0; id < BENCH_KEYS; id++) {
+        bench_key(key, sizeof(key), id);
+        bench_fill(&v, id, 0);
+        cls_memory_store(&mem, key, &v, sizeof(v));
+    }
+
+    uint64_t corrupt = 0;
+    printf("  batches of %u, 1 thread\n\n", BENCH_BATCH);
+    printf("  %-10s %14s %14s %10s\n", "op", "single ops/s", "batch ops/s", "speedup");
+    for (int op = 0; op < 2; op++) {
+        bool store = op == 0;
+        double single = bench_batch_pass(&mem, store, false, &corrupt);
+        double batch = bench_batch_pass(&mem, store, true, &corrupt);
+        printf("  %-10s %14.0f %14.0f %9.2fx\n", store ? "store" : "retrieve",
+               single, batch, single > 0 ? batch / single : 0.0);
+    }
+    printf("\n  corrupt=%llu\n", (unsigned long long)corrupt);
+
+    cls_memory_destroy(&mem);
+    return corrupt == 0 ? 0 : 1;
+}
+
+/* ---- Hot-key tracking ---- */
+
+/* Mixed-load throughput with the tracker off and at two sample rates */
+static int bench_hot(void) {
+    static const uint32_t samples[] = { 0, 64, 1 };
+    static const uint32_t counts[] = { 1, 8 };
+
+    printf("  10%% writes, %u keys\n\n", BENCH_KEYS);
+    printf("  %-10s %-8s %14s %10s\n", "sample", "threads", "ops/s", "vs off");
+
+    uint64_t corrupt = 0;
+    double base[2] = { 0, 0 };
+    for (size_t s = 0; s < sizeof(samples) / sizeof(samples[0]); s++) {
+        cls_memory_config_t cfg = CLS_MEMORY_CONFIG_DEFAULT;
+        cfg.pool_size = BENCH_POOL_SIZE;
+        cfg.shard_count = 64;
+        cfg.concurrent = true;
+        cfg.hot_sample = samples[s];
+
+        cls_memory_ctx_t mem;
+        if (cls_memory_init_ex(&mem, &cfg) != CLS_OK) {
+            fprintf(stderr, "bench: memory init failed\n");
+            return 1;
+        }
+
+        char key[64];
+        bench_value_t v;
+        for (uint64_t id = 0; id < BENCH_KEYS; id++) {
+            bench_key(key, sizeof(key), id);
+            bench_fill(&v, id, 0);
+            cls_memory_store(&mem, key, &v, sizeof(v));
+        }
+
+        for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+            double rate = bench_run(&mem, counts[c], 10, &corrupt);
+            if (s == 0) base[c] = rate;
+            if (samples[s] == 0) printf("  %-10s", "off");
+            else printf("  1/%-8u", samples[s]);
+            printf(" %-8u %14.0f %9.2fx\n", counts[c], rate, base[c] > 0 ? rate / base[c] : 0.0);
+        }
+        cls_memory_destroy(&mem);
+    }
+    printf("\n  corrupt=%llu\n", (unsigned long long)corrupt);
+    return corrupt == 0 ? 0 : 1;
+}
+
+/* ---- Snapshots ---- */
+
+typedef struct {
+    cls_memory_ctx_t   *mem;
+    volatile int       *stop;
+    uint64_t            scans;
+    uint64_t            short_scans;    /* Saw other than BENCH_KEYS entries */
+    uint64_t            corrupt;
+} bench_scanner_t;
+
+/* Scan the whole store over and over; no key is ever deleted, so every
+ * view must return each key exactly once */
+static void *bench_scanner(void *arg) {
+    bench_scanner_t *sc = (bench_scanner_t *)arg;
+    cls_mem_snapshot_t *snap = (cls_mem_snapshot_t *)malloc(sizeof(cls_mem_snapshot_t));
+    if (!snap) return NULL;
+
+    while (!__atomic_load_n(sc->stop, __ATOMIC_ACQUIRE)) {
+        if (cls_memory_snapshot_begin(sc->mem, snap) != CLS_OK) break;
+
+        uint64_t seen = 0;
+        while (cls_memory_snapshot_next(snap) == CLS_OK) {
+            for (uint32_t i = 0; i < snap->count; i++) {
+                const bench_value_t *v = (const bench_value_t *)snap->entries[i].data;
+                if (snap->entries[i].data_len != sizeof(*v) || !bench_valid(v, v->key_id))
+                    sc->corrupt++;
+            }
+            seen += snap->count;
+        }
+        cls_memory_snapshot_end(snap);
+
+        if (seen != BENCH_KEYS) sc->short_scans++;
+        sc->scans++;
+    }
+    free(snap);
+    return NULL;
+}
+
+/* Mixed-load throughput alone and with a thread scanning snapshots */
+static int bench_snapshot(void) {
+    static const uint32_t counts[] = { 1, 8 };
+
+    printf("  50%% writes, %u keys\n\n", BENCH_KEYS);
+    printf("  %-10s %-8s %14s %10s %8s\n", "scanner", "threads", "ops/s", "vs off", "scans");
+
+    cls_memory_config_t cfg = CLS_MEMORY_CONFIG_DEFAULT;
+    cfg.pool_size = BENCH_POOL_SIZE;
+    cfg.shard_count = 64;
+    cfg.concurrent = true;
+
+    cls_memory_ctx_t mem;
+    if (cls_memory_init_ex(&mem, &cfg) != CLS_OK) {
+        fprintf(stderr, "bench: memory init failed\n");
+        return 1;
+    }
+
+    char key[64];
+    bench_value_t v;
+    for (uint64_t id = 0; id < BENCH_KEYS; id++) {
+        bench_key(key, sizeof(key), id);
+        bench_fill(&v, id, 0);
+        cls_memory_store(&mem, key, &v, sizeof(v));
+    }
+
+    uint64_t corrupt = 0, short_scans = 0;
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        double base = 0;
+        for (int with = 0; with < 2; with++) {
+            volatile int stop = 0;
+            bench_scanner_t sc = { &mem, &stop, 0, 0, 0 };
+            pthread_t tid;
+            if (with && pthread_create(&tid, NULL, bench_scanner, &sc) != 0) {
+                cls_memory_destroy(&mem);
+                return 1;
+            }
+
+            double rate = bench_run(&mem, counts[c], 50, &corrupt);
+            if (with) {
+                __atomic_store_n(&stop, 1, __ATOMIC_RELEASE);
+                pthread_join(tid, NULL);
+                corrupt += sc.corrupt;
+                short_scans += sc.short_scans;
+            } else {
+                base = rate;
+            }
+            printf("  %-10s %-8u %14.0f %9.2fx %8llu\n", with ? "on" : "off", counts[c], rate,
+                   base > 0 ? rate / base : 0.0, (unsigned long long)sc.scans);
+        }
+    }
+
+    cls_memory_destroy(&mem);
+    printf("\n  corrupt=%llu short_scans=%llu\n", (unsigned long long)corrupt,
+           (unsigned long long)short_scans);
+    return corrupt == 0 && short_scans == 0 ? 0 : 1;
+}
+
+/* ---- Configurable workload ---- */
+
+typedef enum {
+    BENCH_OP_STORE = 0,
+    BENCH_OP_RETRIEVE,
+    BENCH_OP_QUERY,
+    BENCH_OP_PRUNE,
+    BENCH_OP_COUNT
+} bench_op_t;
+
+static const char *const bench_op_names[BENCH_OP_COUNT] = {
+    "store", "retrieve", "query", "prune"
+};
+
+typedef struct {
+    bool            workload_only;
+    uint32_t        keys;
+    uint32_t        value_min;
+    uint32_t        value_max;
+    bool            value_log;      /* Log-uniform sizes: small values dominate */
+    uint32_t        write_pct;
+    uint32_t        query_pct;
+    uint32_t        ttl_pct;        /* Stores given a TTL */
+    uint32_t        ttl_sec;
+    double          zipf;           /* 0 = uniform keys */
+    uint32_t        threads;
+    uint32_t        prune_ms;
+    uint32_t        run_ms;
+    const char     *json;           /* NULL = none, "-" = stdout */
+} bench_opts_t;
+
+/* Log-linear latency histogram, bucketed by cls_hist.h (about 6%
+ * resolution) */
+typedef struct {
+    uint64_t    buckets[BENCH_HIST_BUCKETS];
+    uint64_t    count;
+    uint64_t    total_ns;
+    uint64_t    max_ns;
+} bench_hist_t;
+
+static void bench_hist_add(bench_hist_t *h, uint64_t ns) {
+    h->buckets[cls_hist_index(ns, BENCH_HIST_BITS, BENCH_HIST_BUCKETS)]++;
+    h->count++;
+    h->total_ns += ns;
+    if (ns > h->max_ns) h->max_ns = ns;
+}
+
+static void bench_hist_merge(bench_hist_t *into, const bench_hist_t *h) {
+    for (uint32_t i = 0; i < BENCH_HIST_BUCKETS; i++)
+        into->buckets[i] += h->buckets[i];
+    into->count += h->count;
+    into->total_ns += h->total_ns;
+    if (h->max_ns > into->max_ns) into->max_ns = h->max_ns;
+}
+
+/* permille: 500 = p50, 999 = p99.9 */
+static uint64_t bench_hist_pct(const bench_hist_t *h, uint32_t permille) {
+    return cls_hist_pct(h->buckets, BENCH_HIST_BUCKETS, BENCH_HIST_BITS,
+                        h->count, h->max_ns, permille);
+}
+
+typedef struct {
+    const bench_opts_t *opts;
+    cls_memory_ctx_t   *mem;
+    double             *cdf;            /* Zipf rank CDF; NULL = uniform */
+    uint32_t           *perm;           /* Rank to key id, so hot keys spread over shards */
+} bench_load_t;
+
+typedef struct {
+    const bench_load_t *load;
+    uint32_t            id;
+    volatile int       *stop;
+    bench_hist_t        hist[BENCH_OP_COUNT];
+    uint64_t            corrupt;
+} bench_load_worker_t;
+
+static double bench_unit(uint64_t *seed) {
+    return (double)(bench_rng(seed) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static uint32_t bench_pick_key(const bench_load_t *load, uint64_t *seed) {
+    if (!load->cdf) return (uint32_t)(bench_rng(seed) % load->opts->keys);
+
+    double u = bench_unit(seed);
+    uint32_t lo = 0, hi = load->opts->keys - 1;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (load->cdf[mid] < u) lo = mid + 1;
+        else hi = mid;
+    }
+    return load->perm[lo];
+}
+
+static uint32_t bench_pick_size(const bench_opts_t *o, uint64_t *seed) {
+    if (o->value_min == o->value_max) return o->value_min;
+    if (!o->value_log)
+        return o->value_min + (uint32_t)(bench_rng(seed) % (o->value_max - o->value_min + 1));
+    double span = log((double)o->value_max / (double)o->value_min);
+    return CLS_MIN(o->value_max, (uint32_t)((double)o->value_min * exp(bench_unit(seed) * span)));
+}
+
+/* Variable-size values: key id and length up front, then a pattern
+ * seeded by both, so a torn or mismatched read shows up */
+static void bench_fill_var(uint8_t *buf, uint32_t id, uint32_t len) {
+    memcpy(buf, &id, sizeof(id));
+    memcpy(buf + 4, &len, sizeof(len));
+    for (uint32_t i = 8; i < len; i++)
+        buf[i] = (uint8_t)(id * 31 + len + i);
+}
+
+static bool bench_valid_var(const uint8_t *buf, size_t len, uint32_t id) {
+    uint32_t got_id, got_len;
+    if (len < 8) return false;
+    memcpy(&got_id, buf, sizeof(got_id));
+    memcpy(&got_len, buf + 4, sizeof(got_len));
+    if (got_id != id || got_len != len) return false;
+    for (uint32_t i = 8; i < len; i++)
+        if (buf[i] != (uint8_t)(id * 31 + got_len + i)) return false;
+    return true;
+}
+
+static void *bench_load_worker(void *arg) {
+    bench_load_worker_t *w = (bench_load_worker_t *)arg;
+    const bench_opts_t *o = w->load->opts;
+    cls_memory_ctx_t *mem = w->load->mem;
+    uint64_t seed = 0xD1B54A32D192ED03ULL ^ ((uint64_t)(w->id + 1) << 32);
+    uint8_t *buf = (uint8_t *)malloc(BENCH_VALUE_MAX);
+    cls_result_set_t *results = (cls_result_set_t *)malloc(sizeof(cls_result_set_t));
+    char key[64], pattern[72];
+    if (!buf || !results) {
+        free(buf);
+        free(results);
+        return NULL;
+    }
+
+    while (!__atomic_load_n(w->stop, __ATOMIC_ACQUIRE)) {
+        for (int batch = 0; batch < 64; batch++) {
+            uint32_t id = bench_pick_key(w->load, &seed);
+            uint32_t roll = (uint32_t)(bench_rng(&seed) % 100);
+            bench_key(key, sizeof(key), id);
+
+            uint64_t t0;
+            if (roll < o->query_pct) {
+                snprintf(pattern, sizeof(pattern), "%s*", key);
+                cls_query_t q = { pattern, 0, 0, 16 };
+                t0 = bench_now_ns();
+                cls_memory_query(mem, &q, results);
+                cls_memory_query_release(mem, results);
+                bench_hist_add(&w->hist[BENCH_OP_QUERY], bench_now_ns() - t0);
+            } else if (roll < o->query_pct + o->write_pct) {
+                uint32_t len = bench_pick_size(o, &seed);
+                uint32_t ttl = bench_rng(&seed) % 100 < o->ttl_pct ? o->ttl_sec : 0;
+                bench_fill_var(buf, id, len);
+                t0 = bench_now_ns();
+                cls_memory_store_ttl(mem, key, buf, len, ttl);
+                bench_hist_add(&w->hist[BENCH_OP_STORE], bench_now_ns() - t0);
+            } else {
+                size_t len = BENCH_VALUE_MAX;
+                t0 = bench_now_ns();
+                cls_status_t rc = cls_memory_retrieve(mem, key, buf, &len);
+                bench_hist_add(&w->hist[BENCH_OP_RETRIEVE], bench_now_ns() - t0);
+                if (rc == CLS_OK && !bench_valid_var(buf, len, id))
+                    w->corrupt++;
+            }
+        }
+    }
+    free(results);
+    free(buf);
+    return NULL;
+}
+
+/* Background maintenance: prune every prune_ms, timing each call */
+static void *bench_pruner(void *arg) {
+    bench_load_worker_t *w = (bench_load_worker_t *)arg;
+    uint32_t ms = w->load->opts->prune_ms;
+    struct timespec nap = { ms / 1000, (long)(ms % 1000) * 1000000L };
+
+    while (!__atomic_load_n(w->stop, __ATOMIC_ACQUIRE)) {
+        nanosleep(&nap, NULL);
+        uint64_t t0 = bench_now_ns();
+        cls_memory_prune(w->load->mem);
+        bench_hist_add(&w->hist[BENCH_OP_PRUNE], bench_now_ns() - t0);
+    }
+    return NULL;
+}
+
+/* Zipf(s) rank CDF over the key space plus a shuffled rank-to-id map */
+static bool bench_zipf_init(bench_load_t *load) {
+    uint32_t n = load->opts->keys;
+    load->cdf = (double *)malloc(n * sizeof(double));
+    load->perm = (uint32_t *)malloc(n * sizeof(uint32_t));
+    if (!load->cdf || !load->perm) return false;
+
+    double sum = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        sum += 1.0 / pow((double)(i + 1), load->opts->zipf);
+        load->cdf[i] = sum;
+    }
+    for (uint32_t i = 0; i < n; i++) load->cdf[i] /= sum;
+    load->cdf[n - 1] = 1.0;
+
+    uint64_t seed = 0x853C49E6748FEA9BULL;
+    for (uint32_t i = 0; i < n; i++) load->perm[i] = i;
+    for (uint32_t i = n - 1; i > 0; i--) {
+        uint32_t j = (uint32_t)(bench_rng(&seed) % (i + 1));
+        uint32_t t = load->perm[i];
+        load->perm[i] = load->perm[j];
+        load->perm[j] = t;
+    }
+    return true;
+}
+
+static void bench_json(const bench_opts_t *o, const bench_hist_t *hist, double secs,
+                       uint64_t corrupt, uint32_t entries) {
+    FILE *f = strcmp(o->json, "-") == 0 ? stdout : fopen(o->json, "w");
+    if (!f) {
+        fprintf(stderr, "bench: cannot write %s\n", o->json);
+        return;
+    }
+
+    fprintf(f, "{\n  \"config\": {\"keys\": %u, \"value_min\": %u, \"value_max\": %u, "
+               "\"value_dist\": \"%s\", \"write_pct\": %u, \"query_pct\": %u, "
+               "\"ttl_pct\": %u, \"ttl_sec\": %u, \"zipf\": %.3f, \"threads\": %u, "
+               "\"prune_ms\": %u, \"run_ms\": %u},\n",
+            o->keys, o->value_min, o->value_max, o->value_log ? "log" : "uniform",
+            o->write_pct, o->query_pct, o->ttl_pct, o->ttl_sec, o->zipf, o->threads,
+            o->prune_ms, o->run_ms);
+    fprintf(f, "  \"ops\": {\n");
+    for (int op = 0; op < BENCH_OP_COUNT; op++) {
+        const bench_hist_t *h = &hist[op];
+        fprintf(f, "    \"%s\": {\"count\": %llu, \"ops_per_sec\": %.0f, \"mean_ns\": %.0f, "
+                   "\"p50_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu, \"max_ns\": %llu}%s\n",
+                bench_op_names[op], (unsigned long long)h->count, (double)h->count / secs,
+                h->count ? (double)h->total_ns / (double)h->count : 0.0,
+                (unsigned long long)bench_hist_pct(h, 500),
+                (unsigned long long)bench_hist_pct(h, 990),
+                (unsigned long long)bench_hist_pct(h, 999),
+                (unsigned long long)h->max_ns, op + 1 < BENCH_OP_COUNT ? "," : "");
+    }
+    fprintf(f, "  },\n  \"entries\": %u,\n  \"corrupt\": %llu\n}\n",
+            entries, (unsigned long long)corrupt);
+    if (f != stdout) fclose(f);
+}
+
+static int bench_workload(const bench_opts_t *o) {
+    cls_memory_config_t cfg = CLS_MEMORY_CONFIG_DEFAULT;
+    size_t need = (size_t)o->keys * (o->value_max + 192) * 2;
+    cfg.pool_size = CLS_MAX(need, (size_t)64 << 20);
+    cfg.shard_count = 64;
+    cfg.concurrent = true;
+
+    cls_memory_ctx_t mem;
+    if (cls_memory_init_ex(&mem, &cfg) != CLS_OK) {
+        fprintf(stderr, "bench: memory init failed\n");
+        return 1;
+    }
+
+    bench_load_t load = { o, &mem, NULL, NULL };
+    bench_load_worker_t *workers =
+        (bench_load_worker_t *)calloc(o->threads + 1, sizeof(bench_load_worker_t));
+    if (!workers || (o->zipf > 0 && !bench_zipf_init(&load))) {
+        fprintf(stderr, "bench: out of memory\n");
+        free(workers);
+        free(load.cdf);
+        free(load.perm);
+        cls_memory_destroy(&mem);
+        return 1;
+    }
+
+    char key[64];
+    uint8_t *buf = (uint8_t *)malloc(BENCH_VALUE_MAX);
+    uint64_t seed = 0xA0761D6478BD642FULL;
+    for (uint32_t id = 0; buf && id < o->keys; id++) {
+        uint32_t len = bench_pick_size(o, &seed);
+        bench_key(key, sizeof(key), id);
+        bench_fill_var(buf, id, len);
+        cls_memory_store(&mem, key, buf, len);
+    }
+    free(buf);
+
+    printf("  %u keys, %u-%u byte values (%s), %u%% writes, %u%% queries, "
+           "%u%% TTL %us, zipf %.2f\n",
+           o->keys, o->value_min, o->value_max, o->value_log ? "log" : "uniform",
+           o->write_pct, o->query_pct, o->ttl_pct, o->ttl_sec, o->zipf);
+    printf("  %u threads, prune every %u ms, %u ms run\n\n", o->threads, o->prune_ms, o->run_ms);
+
+    volatile int stop = 0;
+    pthread_t tid[BENCH_MAX_THREADS + 1];
+    uint32_t started = 0;
+    for (uint32_t i = 0; i <= o->threads; i++) {
+        workers[i].load = &load;
+        workers[i].id = i;
+        workers[i].stop = &stop;
+    }
+
+    uint64_t t0 = bench_now_ns();
+    for (; started <= o->threads; started++) {
+        void *(*fn)(void *) = started < o->threads ? bench_load_worker : bench_pruner;
+        if (pthread_create(&tid[started], NULL, fn, &workers[started]) != 0) break;
+    }
+    struct timespec run = { o->run_ms / 1000, (long)(o->run_ms % 1000) * 1000000L };
+    nanosleep(&run, NULL);
+    __atomic_store_n(&stop, 1, __ATOMIC_RELEASE);
+
+    bench_hist_t *hist = (bench_hist_t *)calloc(BENCH_OP_COUNT, sizeof(bench_hist_t));
+    uint64_t corrupt = 0;
+    for (uint32_t i = 0; i < started; i++) {
+        pthread_join(tid[i], NULL);
+        corrupt += workers[i].corrupt;
+        for (int op = 0; hist && op < BENCH_OP_COUNT; op++)
+            bench_hist_merge(&hist[op], &workers[i].hist[op]);
+    }
+    double secs = (double)(bench_now_ns() - t0) / 1e9;
+
+    uint32_t entries = 0;
+    cls_memory_stats(&mem, NULL, NULL, &entries);
+    int rc = started == o->threads + 1 && hist && corrupt == 0 ? 0 : 1;
+    if (hist) {
+        printf("  %-10s %12s %12s %10s %10s %10s %10s\n",
+               "op", "count", "ops/s", "p50 ns", "p99 ns", "p999 ns", "max ns");
+        for (int op = 0; op < BENCH_OP_COUNT; op++) {
+            const bench_hist_t *h = &hist[op];
+            printf("  %-10s %12llu %12.0f %10llu %10llu %10llu %10llu\n", bench_op_names[op],
+                   (unsigned long long)h->count, (double)h->count / secs,
+                   (unsigned long long)bench_hist_pct(h, 500),
+                   (unsigned long long)bench_hist_pct(h, 990),
+                   (unsigned long long)bench_hist_pct(h, 999),
+                   (unsigned long long)h->max_ns);
+        }
+        printf("\n  entries=%u corrupt=%llu\n", entries, (unsigned long long)corrupt);
+        if (o->json) bench_json(o, hist, secs, corrupt, entries);
+    }
+
+    free(hist);
+    free(workers);
+    free(load.cdf);
+    free(load.perm);
+    cls_memory_destroy(&mem);
+    return rc;
+}
+
+/* ---- Eviction churn ---- */
+
+#define BENCH_CHURN_POOL    (8u << 20)
+#define BENCH_CHURN_KEYS    50000u
+#define BENCH_CHURN_OPS     200000u
+
+/* Far more distinct keys than a small pool holds, under each policy: a
+ * full store has to keep taking new keys by evicting, never fail them */
+static int bench_churn(void) {
+    static const cls_mem_evict_t policies[] = {
+        CLS_MEM_EVICT_CLOCK, CLS_MEM_EVICT_LRU, CLS_MEM_EVICT_TINYLFU
+    };
+    static const char *const names[] = { "clock", "lru", "tinylfu" };
+    static const uint32_t value_max[] = { 3000, 20000 };
+
+    printf("  %u MB pool, %u keys, %u stores, 1 in 4 ops a checked read\n\n",
+           BENCH_CHURN_POOL >> 20, BENCH_CHURN_KEYS, BENCH_CHURN_OPS);
+    printf("  %-8s %-10s %10s %10s %10s %10s\n",
+           "policy", "values", "failed", "evictions", "entries", "corrupt");
+
+    uint8_t *buf = (uint8_t *)malloc(BENCH_VALUE_MAX);
+    if (!buf) return 1;
+
+    int rc = 0;
+    for (size_t p = 0; p < sizeof(policies) / sizeof(policies[0]); p++) {
+        for (size_t v = 0; v < sizeof(value_max) / sizeof(value_max[0]); v++) {
+            cls_memory_config_t cfg = CLS_MEMORY_CONFIG_DEFAULT;
+            cfg.pool_size = BENCH_CHURN_POOL;
+            cfg.evict = policies[p];
+
+            cls_memory_ctx_t mem;
+            if (cls_memory_init_ex(&mem, &cfg) != CLS_OK) {
+                fprintf(stderr, "bench: memory init failed\n");
+                free(buf);
+                return 1;
+            }
+
+            char key[64];
+            uint64_t seed = 0x9E3779B97F4A7C15ULL;
+            uint64_t failed = 0, corrupt = 0;
+            for (uint32_t n = 0; n < BENCH_CHURN_OPS; n++) {
+                uint32_t id = (uint32_t)(bench_rng(&seed) % BENCH_CHURN_KEYS);
+                bench_key(key, sizeof(key), id);
+
+                size_t len = BENCH_VALUE_MAX;
+                if ((n & 3) == 3 && cls_memory_retrieve(&mem, key, buf, &len) == CLS_OK &&
+                    !bench_valid_var(buf, len, id))
+                    corrupt++;
+
+                uint32_t size = 8 + (uint32_t)(bench_rng(&seed) % (value_max[v] - 7));
+                bench_fill_var(buf, id, size);
+                if (cls_memory_store(&mem, key, buf, size) != CLS_OK)
+                    failed++;
+            }
+
+            cls_memory_stats_t st;
+            uint32_t entries = 0;
+            cls_memory_stats_ex(&mem, &st);
+            cls_memory_stats(&mem, NULL, NULL, &entries);
+            printf("  %-8s 8-%-8u %10llu %10llu %10u %10llu\n", names[p], value_max[v],
+                   (unsigned long long)failed, (unsigned long long)st.evictions, entries,
+                   (unsigned long long)corrupt);
+            if (failed || corrupt) rc = 1;
+            cls_memory_destroy(&mem);
+        }
+    }
+
+    free(buf);
+    return rc;
+}
+
+static int bench_usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [--suite all|workload] [--keys N] [--values MIN-MAX]\n"
+            "          [--value-dist uniform|log] [--writes PCT] [--queries PCT]\n"
+            "          [--ttl PCT] [--ttl-sec N] [--zipf S] [--threads N]\n"
+            "          [--prune-ms N] [--ms N] [--json PATH|-]\n", prog);
+    return 2;
+}
+
+/* Returns false on an unknown option or an out-of-range value */
+static bool bench_parse(int argc, char **argv, bench_opts_t *o) {
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        if (i + 1 >= argc) return false;
+        const char *val = argv[++i];
+        char *end = NULL;
+        unsigned long n = strtoul(val, &end, 10);
+
+        if (strcmp(opt, "--suite") == 0) {
+            if (strcmp(val, "workload") != 0 && strcmp(val, "all") != 0) return false;
+            o->workload_only = strcmp(val, "workload") == 0;
+            continue;
+        } else if (strcmp(opt, "--value-dist") == 0) {
+            if (strcmp(val, "log") != 0 && strcmp(val, "uniform") != 0) return false;
+            o->value_log = strcmp(val, "log") == 0;
+            continue;
+        } else if (strcmp(opt, "--json") == 0) {
+            o->json = val;
+            continue;
+        } else if (strcmp(opt, "--zipf") == 0) {
+            o->zipf = strtod(val, &end);
+            if (*end || o->zipf < 0 || o->zipf > 4) return false;
+            continue;
+        } else if (strcmp(opt, "--values") == 0) {
+            o->value_min = (uint32_t)n;
+            o->value_max = *end == '-' ? (uint32_t)strtoul(end + 1, &end, 10) : (uint32_t)n;
+        } else if (strcmp(opt, "--keys") == 0) {
+            o->keys = (uint32_t)n;
+        } else if (strcmp(opt, "--writes") == 0) {
+            o->write_pct = (uint32_t)n;
+        } else if (strcmp(opt, "--queries") == 0) {
+            o->query_pct = (uint32_t)n;
+        } else if (strcmp(opt, "--ttl") == 0) {
+            o->ttl_pct = (uint32_t)n;
+        } else if (strcmp(opt, "--ttl-sec") == 0) {
+            o->ttl_sec = (uint32_t)n;
+        } else if (strcmp(opt, "--threads") == 0) {
+            o->threads = (uint32_t)n;
+        } else if (strcmp(opt, "--prune-ms") == 0) {
+            o->prune_ms = (uint32_t)n;
+        } else if (strcmp(opt, "--ms") == 0) {
+            o->run_ms = (uint32_t)n;
+        } else {
+            return false;
+        }
+        if (*end != '\0' || end == val) return false;
+    }
+
+    return o->keys > 0 && o->keys <= (1u << 24) &&
+           o->value_min >= 8 && o->value_min <= o->value_max && o->value_max <= BENCH_VALUE_MAX &&
+           o->write_pct + o->query_pct <= 100 && o->ttl_pct <= 100 && o->ttl_sec > 0 &&
+           o->threads > 0 && o->threads <= BENCH_MAX_THREADS &&
+           o->prune_ms > 0 && o->run_ms > 0;
+}
+
+int main(int argc, char **argv) {
+    bench_opts_t opts = {
+        .workload_only = false,
+        .keys       = 1u << 16,
+        .value_min  = 16,
+        .value_max  = 256,
+        .value_log  = false,
+        .write_pct  = 10,
+        .query_pct  = 1,
+        .ttl_pct    = 10,
+        .ttl_sec    = 1,
+        .zipf       = 0.99,
+        .threads    = 4,
+        .prune_ms   = 10,
+        .run_ms     = 2000,
+        .json       = NULL
+    };
+    if (!bench_parse(argc, argv, &opts)) return bench_usage(argv[0]);
+
+    printf("\n  ClawLobstars memory benchmark\n");
+    printf("  =============================\n\n");
+    int rc = 0;
+    if (!opts.workload_only) {
+        rc |= bench_threads();
+        printf("\n");
+        rc |= bench_batches();
+        printf("\n");
+        rc |= bench_hot();
+        printf("\n");
+        rc |= bench_snapshot();
+        printf("\n");
+        rc |= bench_churn();
+        printf("\n");
+    }
+    return bench_workload(&opts) | rc;
+}
@@ -0,0 +1,648 @@
+/*
+ * ClawLobstars — Agent Self-Checks
+ * Drives the agent loop and pipeline through their documented behaviour
+ * and exits non-zero on the first broken expectation in each check:
+ * fixed-rate skip and catch-up accounting, each feed overflow policy,
+ * a frame's path through inference, planning and action, phase
+ * histogram percentiles, the work-stealing runtime's rate, exclusivity
+ * and miss accounting, and a checkpoint/restore round trip, plus the
+ * memory store's undersized-pool guards
+ *
+ * Usage: check_agent
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "../src/include/cls_framework.h"
+#include "../src/memory/cls_mem_internal.h"
+
+static int check_failures;
+
+/* Each check keeps rc and an out: label that releases whatever it set
+ * up, so one failure does not leak agents or files into the next */
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        check_failures++; \
+        rc = 1; \
+        goto out; \
+    } \
+} while (0)
+
+static void check_sleep_ms(uint32_t ms) {
+    struct timespec ts = { (time_t)(ms / 1000), (long)(ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+/* agent must be zeroed or destroyed, so cls_agent_destroy is safe on
+ * it whether or not init got far */
+static cls_status_t check_agent_init(cls_agent_t *agent) {
+    cls_config_t cfg = CLS_CONFIG_DEFAULT;
+    cfg.agent_name = "check";
+    cfg.memory_size = 1u << 20;
+    cfg.log_level = CLS_LOG_NONE;
+    return cls_agent_init(agent, &cfg);
+}
+
+/* ---- Fixed-rate loop ---- */
+
+#define CHECK_RUN_HZ        100     /* 10 ms period */
+#define CHECK_RUN_STEPS     8
+#define CHECK_RUN_STALL_MS  35      /* Step 2 overruns by 2.5 periods */
+
+static cls_status_t check_run_tick(cls_agent_t *agent, void *ctx) {
+    (void)ctx;
+    if (agent->run_stats.steps == 1) check_sleep_ms(CHECK_RUN_STALL_MS);
+    return CLS_OK;
+}
+
+static int check_run_one(cls_agent_overrun_t overrun, uint32_t max_catchup,
+                         cls_agent_run_stats_t *st) {
+    cls_agent_t agent;
+    int rc = 0;
+    memset(&agent, 0, sizeof(agent));
+    memset(st, 0, sizeof(*st));
+    CHECK(CLS_IS_OK(check_agent_init(&agent)));
+
+    cls_agent_run_opts_t opts = {
+        .hz = CHECK_RUN_HZ,
+        .overrun = overrun,
+        .max_catchup = max_catchup,
+        .max_steps = CHECK_RUN_STEPS,
+        .on_tick = check_run_tick
+    };
+    CHECK(CLS_IS_OK(cls_agent_run(&agent, &opts)));
+    cls_agent_run_stats(&agent, st);
+
+    uint64_t jitter_samples = 0;
+    for (uint32_t i = 0; i < CLS_AGENT_JITTER_BUCKETS; i++)
+        jitter_samples += st->jitter_hist[i];
+    CHECK(st->steps == CHECK_RUN_STEPS);
+    CHECK(jitter_samples == st->steps);
+    CHECK(st->period_ns == 1000000000ULL / CHECK_RUN_HZ);
+    CHECK(st->overruns >= 1);
+out:
+    cls_agent_destroy(&agent);
+    return rc;
+}
+
+static int check_run(void) {
+    cls_agent_run_stats_t st;
+    int rc = 0;
+
+    /* Skip: the missed releases are dropped, the step stays on the grid */
+    CHECK(check_run_one(CLS_AGENT_OVERRUN_SKIP, 0, &st) == 0);
+    CHECK(st.skipped >= 3);
+
+    /* Catch-up without a limit: every release runs, none skipped */
+    CHECK(check_run_one(CLS_AGENT_OVERRUN_CATCHUP, 0, &st) == 0);
+    CHECK(st.skipped == 0);
+
+    /* Catch-up limited to 2 periods: 2.5 behind falls back to skipping */
+    CHECK(check_run_one(CLS_AGENT_OVERRUN_CATCHUP, 2, &st) == 0);
+    CHECK(st.skipped >= 3);
+out:
+    return rc;
+}
+
+/* ---- Feed queue ---- */
+
+#define CHECK_FEED_DEPTH    4
+
+/* Fed frames must name a registered sensor; with no read callback it is
+ * never polled */
+static cls_status_t check_feed_sensor(cls_agent_t *agent) {
+    cls_sensor_t sensor = { .id = 1, .type = CLS_SENSOR_GENERIC, .name = "fed", .active = true };
+    return cls_perception_register(agent->perception, &sensor);
+}
+
+static cls_status_t check_feed_one(cls_agent_t *agent, uint64_t ts) {
+    static const uint32_t payload = 1;
+    cls_frame_t frame = {
+        .sensor_id = 1,
+        .timestamp_us = ts,
+        .payload_len = sizeof(payload),
+        .payload = &payload
+    };
+    return cls_agent_feed(agent, &frame);
+}
+
+/* Whether frame ts has been perceived into memory */
+static bool check_feed_seen(cls_agent_t *agent, uint64_t ts) {
+    char key[64];
+    cls_percept_t percept;
+    size_t len = sizeof(percept);
+    snprintf(key, sizeof(key), "percept:1:%llu", (unsigned long long)ts);
+    return CLS_IS_OK(cls_memory_retrieve(agent->memory, key, &percept, &len));
+}
+
+static cls_status_t check_feed_setup(cls_agent_t *agent, cls_agent_feed_overflow_t overflow) {
+    cls_agent_feed_config_t cfg = CLS_AGENT_FEED_CONFIG_DEFAULT;
+    cfg.depth = CHECK_FEED_DEPTH;
+    cfg.overflow = overflow;
+    CLS_CHECK(check_agent_init(agent));
+    CLS_CHECK(check_feed_sensor(agent));
+    return cls_agent_feed_configure(agent, &cfg);
+}
+
+static int check_feed_drop_newest(void) {
+    cls_agent_t agent;
+    cls_agent_feed_stats_t st;
+    int rc = 0;
+    memset(&agent, 0, sizeof(agent));
+    CHECK(CLS_IS_OK(check_feed_setup(&agent, CLS_AGENT_FEED_DROP_NEWEST)));
+
+    for (uint64_t ts = 0; ts < CHECK_FEED_DEPTH; ts++)
+        CHECK(CLS_IS_OK(check_feed_one(&agent, ts)));
+    CHECK(check_feed_one(&agent, CHECK_FEED_DEPTH) == CLS_ERR_OVERFLOW);
+    CHECK(CLS_IS_OK(cls_agent_feed_stats(&agent, &st)));
+    CHECK(st.enqueued == CHECK_FEED_DEPTH && st.dropped == 1 && st.queued == CHECK_FEED_DEPTH);
+
+    /* Frames are perceived by the step that drains them, not by feed */
+    CHECK(!check_feed_seen(&agent, 0));
+    CHECK(CLS_IS_OK(cls_agent_step(&agent)));
+    CHECK(check_feed_seen(&agent, 0) && check_feed_seen(&agent, CHECK_FEED_DEPTH - 1));
+    CHECK(!check_feed_seen(&agent, CHECK_FEED_DEPTH));
+    CHECK(CLS_IS_OK(cls_agent_feed_stats(&agent, &st)));
+    CHECK(st.drained == CHECK_FEED_DEPTH && st.queued == 0);
+out:
+    cls_agent_destroy(&agent);
+    return rc;
+}
+
+static int check_feed_drop_oldest(void) {
+    cls_agent_t agent;
+    cls_agent_feed_stats_t st;
+    int rc = 0;
+    memset(&agent, 0, sizeof(agent));
+    CHECK(CLS_IS_OK(check_feed_setup(&agent, CLS_AGENT_FEED_DROP_OLDEST)));
+
+    for (uint64_t ts = 0; ts < CHECK_FEED_DEPTH + 2; ts++)
+        CHECK(CLS_IS_OK(check_feed_one(&agent, ts)));
+    CHECK(CLS_IS_OK(cls_agent_feed_stats(&agent, &st)));
+    CHECK(st.enqueued == CHECK_FEED_DEPTH + 2 && st.dropped == 2 && st.queued == CHECK_FEED_DEPTH);
+
+    CHECK(CLS_IS_OK(cls_agent_step(&agent)));
+    CHECK(!check_feed_seen(&agent, 0) && !check_feed_seen(&agent, 1));
+    CHECK(check_feed_seen(&agent, 2) && check_feed_seen(&agent, CHECK_FEED_DEPTH + 1));
+out:
+    cls_agent_destroy(&agent);
+    return rc;
+}
+
+typedef struct {
+    cls_agent_t    *agent;
+    uint64_t        ts;
+    cls_status_t    status;
+} check_feeder_t;
+
+static void *check_feeder(void *arg) {
+    check_feeder_t *f = (check_feeder_t *)arg;
+    f->status = check_feed_one(f->agent, f->ts);
+    return NULL;
+}
+
+static int check_feed_block(void) {
+    cls_agent_t agent;
+    cls_agent_feed_stats_t st;
+    pthread_t thread;
+    bool feeding = false;
+    int rc = 0;
+    memset(&agent, 0, sizeof(agent));
+    CHECK(CLS_IS_OK(check_feed_setup(&agent, CLS_AGENT_FEED_BLOCK)));
+
+    for (uint64_t ts = 0; ts < CHECK_FEED_DEPTH; ts++)
+        CHECK(CLS_IS_OK(check_feed_one(&agent, ts)));
+
+    /* A feeder on a full queue sleeps until a step drains a slot */
+    check_feeder_t f = { &agent, CHECK_FEED_DEPTH, CLS_ERR_INVALID };
+    CHECK(pthread_create(&thread, NULL, check_feeder, &f) == 0);
+    feeding = true;
+    check_sleep_ms(50);
+    CHECK(CLS_IS_OK(cls_agent_feed_stats(&agent, &st)));
+    CHECK(st.waits == 1 && st.enqueued == CHECK_FEED_DEPTH);
+    CHECK(CLS_IS_OK(cls_agent_step(&agent)));
+    pthread_join(thread, NULL);
+    feeding = false;
+    CHECK(CLS_IS_OK(f.status));
+    CHECK(CLS_IS_OK(cls_agent_feed_stats(&agent, &st)));
+    CHECK(st.enqueued == CHECK_FEED_DEPTH + 1 && st.dropped == 0);
+
+    /* ... or until shutdown, which turns it away */
+    for (uint64_t ts = 1; ts < CHECK_FEED_DEPTH; ts++)
+        CHECK(CLS_IS_OK(check_feed_one(&agent, CHECK_FEED_DEPTH + ts)));
+    f.ts = 2 * CHECK_FEED_DEPTH;
+    f.status = CLS_ERR_INVALID;
+    CHECK(pthread_create(&thread, NULL, check_feeder, &f) == 0);
+    feeding = true;
+    check_sleep_ms(50);
+    cls_agent_shutdown(&agent);
+    pthread_join(thread, NULL);
+    feeding = false;
+    CHECK(f.status == CLS_ERR_STATE);
+out:
+    /* A feeder still parked is woken by shutdown before the queue goes */
+    if (feeding) {
+        cls_agent_shutdown(&agent);
+        pthread_join(thread, NULL);
+    }
+    cls_agent_destroy(&agent);
+    return rc;
+}
+
+/* Unknown sensors are refused at feed, or at drain once unregistered */
+static int check_feed_reject(void) {
+    cls_agent_t agent;
+    cls_agent_feed_stats_t st;
+    cls_agent_stage_stats_t drain;
+    cls_frame_t stray = { .sensor_id = 2, .timestamp_us = 0 };
+    int rc = 0;
+    memset(&agent, 0, sizeof(agent));
+    CHECK(CLS_IS_OK(check_feed_setup(&agent, CLS_AGENT_FEED_DROP_NEWEST)));
+
+    CHECK(cls_agent_feed(&agent, &stray) == CLS_ERR_NOT_FOUND);
+    CHECK(CLS_IS_OK(check_feed_one(&agent, 0)));
+    CHECK(CLS_IS_OK(cls_perception_unregister(agent.perception, 1)));
+    CHECK(CLS_IS_OK(cls_agent_step(&agent)));
+    CHECK(!check_feed_seen(&agent, 0));
+
+    CHECK(CLS_IS_OK(cls_agent_feed_stats(&agent, &st)));
+    CHECK(st.enqueued == 1 && st.drained == 1 && st.rejected == 2 && st.queued == 0);
+    CHECK(CLS_IS_OK(cls_agent_stage_stats(&agent, CLS_AGENT_STAGE_DRAIN, &drain)));
+    CHECK(drain.items == 1 && drain.failed == 1);
+out:
+    cls_agent_destroy(&agent);
+    return rc;
+}
+
+/* ---- Pipeline ---- */
+
+static uint32_t check_acted;
+
+static cls_status_t check_pipe_act(uint32_t action_id, const void *params, size_t len) {
+    (void)action_id; (void)params; (void)len;
+    check_acted++;
+    return CLS_OK;
+}
+
+/* An empty payload is classified an anomaly, which the default rule model
+ * scores above its threshold into action 1 */
+static cls_status_t check_pipe_anomaly(cls_agent_t *agent, uint64_t ts) {
+    cls_frame_t frame = { .sensor_id = 1, .timestamp_us = ts };
+    return cls_agent_feed(agent, &frame);
+}
+
+static int check_pipe(void) {
+    cls_agent_t agent;
+    cls_decision_t decision;
+    cls_agent_stage_stats_t infer, plan, act;
+    cls_action_handler_t handler = { .action_id = 1, .name = "check", .execute_fn = check_pipe_act };
+    int rc = 0;
+    memset(&agent, 0, sizeof(agent));
+    check_acted = 0;
+    CHECK(CLS_IS_OK(check_agent_init(&agent)));
+    CHECK(CLS_IS_OK(check_feed_sensor(&agent)));
+    CHECK(CLS_IS_OK(cls_action_register(agent.action, &handler)));
+
+    /* One anomaly: one decision, one task, one handler call, plan complete */
+    CHECK(CLS_IS_OK(check_pipe_anomaly(&agent, 1)));
+    CHECK(CLS_IS_OK(cls_agent_step(&agent)));
+    CHECK(CLS_IS_OK(cls_agent_get_decision(&agent, &decision)));
+    CHECK(decision.action_id == 1);
+    CHECK(CLS_IS_OK(cls_agent_stage_stats(&agent, CLS_AGENT_STAGE_INFER, &infer)));
+    CHECK(CLS_IS_OK(cls_agent_stage_stats(&agent, CLS_AGENT_STAGE_PLAN, &plan)));
+    CHECK(CLS_IS_OK(cls_agent_stage_stats(&agent, CLS_AGENT_STAGE_ACT, &act)));
+    CHECK(infer.items == 1 && infer.failed == 0);
+    CHECK(plan.items == 1 && act.items == 1);
+    CHECK(check_acted == 1);
+    CHECK(agent.planner->plans_completed == 1 && agent.actions_unhandled == 0);
+
+    /* Without a handler the task is skipped, not failed: the plan still
+     * completes and the skip is counted */
+    CHECK(CLS_IS_OK(cls_action_unregister(agent.action, 1)));
+    CHECK(CLS_IS_OK(check_pipe_anomaly(&agent, 2)));
+    CHECK(CLS_IS_OK(cls_agent_step(&agent)));
+    CHECK(CLS_IS_OK(cls_agent_stage_stats(&agent, CLS_AGENT_STAGE_ACT, &act)));
+    CHECK(act.items == 1 && check_acted == 1);
+    CHECK(agent.planner->plans_completed == 2 && agent.planner->plans_failed == 0);
+    CHECK(agent.actions_unhandled == 1);
+out:
+    cls_agent_destroy(&agent);
+    return rc;
+}
+
+/* ---- Phase histograms ---- */
+
+#define CHECK_HIST_STEPS    100
+#define CHECK_HIST_SLOW     3       /* Slow polls, enough to own p99 */
+#define CHECK_HIST_FAST_MS  2
+#define CHECK_HIST_SLOW_MS  30
+
+/* A sensor whose read takes a set time, so the poll phase does too */
+static cls_status_t check_hist_read(void *ctx, void *buf, size_t *len) {
+    check_sleep_ms(*(const uint32_t *)ctx);
+    memset(buf, 0, 4);
+    *len = 4;
+    return CLS_OK;
+}
+
+static int check_hist(void) {
+    cls_agent_t agent;
+    cls_agent_latency_t lat;
+    uint32_t read_ms = CHECK_HIST_FAST_MS;
+    int rc = 0;
+    memset(&agent, 0, sizeof(agent));
+    CHECK(CLS_IS_OK(check_agent_init(&agent)));
+
+    cls_sensor_t sensor = {
+        .id = 1, .type = CLS_SENSOR_GENERIC, .name = "timed",
+        .read_fn = check_hist_read, .user_ctx = &read_ms, .active = true
+    };
+    CHECK(CLS_IS_OK(cls_perception_register(agent.perception, &sensor)));
+
+    /* Built with CLS_AGENT_PHASE_HIST=0: nothing to check */
+    if (cls_agent_phase_latency(&agent, CLS_AGENT_STAGE_POLL, &lat) == CLS_ERR_STATE)
+        goto out;
+
+    for (uint32_t i = 0; i < CHECK_HIST_STEPS; i++) {
+        read_ms = i < CHECK_HIST_STEPS - CHECK_HIST_SLOW ? CHECK_HIST_FAST_MS : CHECK_HIST_SLOW_MS;
+        CHECK(CLS_IS_OK(cls_agent_step(&agent)));
+    }
+
+    /* Buckets are within ~12%, so allow that below each sleep */
+    CHECK(CLS_IS_OK(cls_agent_phase_latency(&agent, CLS_AGENT_STAGE_POLL, &lat)));
+    CHECK(lat.count == CHECK_HIST_STEPS);
+    CHECK(lat.p50_ns >= CHECK_HIST_FAST_MS * 880000ULL);
+    CHECK(lat.p50_ns < CHECK_HIST_SLOW_MS * 500000ULL);
+    CHECK(lat.p99_ns >= CHECK_HIST_SLOW_MS * 880000ULL);
+    CHECK(lat.p99_ns <= lat.max_ns && lat.max_ns >= CHECK_HIST_SLOW_MS * 1000000ULL);
+    CHECK(lat.max_ns == agent.stages[CLS_AGENT_STAGE_POLL].max_ns);
+
+    cls_agent_phase_reset(&agent);
+    CHECK(CLS_IS_OK(cls_agent_phase_latency(&agent, CLS_AGENT_STAGE_POLL, &lat)));
+    CHECK(lat.count == 0 && lat.p50_ns == 0 && lat.max_ns == 0);
+out:
+    cls_agent_destroy(&agent);
+    return rc;
+}
+
+/* ---- Runtime ---- */
+
+#define CHECK_RT_AGENTS     6
+#define CHECK_RT_WORKERS    2
+#define CHECK_RT_HZ         100     /* 10 ms period */
+#define CHECK_RT_WINDOW_MS  300
+#define CHECK_RT_READ_MS    1
+#define CHECK_RT_STALL_MS   35      /* One step overruns by 2.5 periods */
+#define CHECK_RT_RELEASES   (CHECK_RT_WINDOW_MS * CHECK_RT_HZ / 1000 + 1)
+
+typedef struct {
+    uint32_t    in_step;
+    uint32_t    overlaps;
+    uint32_t    reads;
+    uint32_t    stall_at;       /* Read that stalls, 0 = none */
+} check_rt_agent_t;
+
+/* The runtime has no tick callback, but the poll phase runs inside the
+ * step, so a sensor read counts steps of its agent in progress */
+static cls_status_t check_rt_read(void *ctx, void *buf, size_t *len) {
+    check_rt_agent_t *a = (check_rt_agent_t *)ctx;
+    if (__atomic_fetch_add(&a->in_step, 1, __ATOMIC_ACQ_REL) != 0)
+        __atomic_fetch_add(&a->overlaps, 1, __ATOMIC_RELAXED);
+    uint32_t n = __atomic_add_fetch(&a->reads, 1, __ATOMIC_RELAXED);
+    check_sleep_ms(n == a->stall_at ? CHECK_RT_STALL_MS : CHECK_RT_READ_MS);
+    __atomic_fetch_sub(&a->in_step, 1, __ATOMIC_ACQ_REL);
+    memset(buf, 0, 4);
+    *len = 4;
+    return CLS_OK;
+}
+
+static int check_runtime(void) {
+    static cls_agent_t agents[CHECK_RT_AGENTS];
+    static check_rt_agent_t ctx[CHECK_RT_AGENTS];
+    cls_runtime_t rt;
+    cls_runtime_config_t rcfg = CLS_RUNTIME_CONFIG_DEFAULT;
+    cls_runtime_stats_t st;
+    cls_runtime_slot_t slot;
+    uint64_t steps = 0;
+    int rc = 0;
+    memset(agents, 0, sizeof(agents));
+    memset(ctx, 0, sizeof(ctx));
+    memset(&rt, 0, sizeof(rt));
+
+    rcfg.max_agents = CHECK_RT_AGENTS;
+    rcfg.workers = CHECK_RT_WORKERS;
+    CHECK(CLS_IS_OK(cls_runtime_init(&rt, &rcfg)));
+    ctx[0].stall_at = 3;
+    for (uint32_t i = 0; i < CHECK_RT_AGENTS; i++) {
+        cls_config_t cfg = CLS_CONFIG_DEFAULT;
+        cfg.agent_name = "check";
+        cfg.memory_size = 1u << 20;
+        cfg.log_level = CLS_LOG_NONE;
+        cfg.inference_hz = CHECK_RT_HZ;
+        CHECK(CLS_IS_OK(cls_agent_init(&agents[i], &cfg)));
+        cls_sensor_t sensor = {
+            .id = 1, .type = CLS_SENSOR_GENERIC, .name = "in-step",
+            .read_fn = check_rt_read, .user_ctx = &ctx[i], .active = true
+        };
+        CHECK(CLS_IS_OK(cls_perception_register(agents[i].perception, &sensor)));
+        CHECK(CLS_IS_OK(cls_runtime_add(&rt, &agents[i])));
+    }
+
+    CHECK(CLS_IS_OK(cls_runtime_start(&rt)));
+    check_sleep_ms(CHECK_RT_WINDOW_MS);
+    CHECK(CLS_IS_OK(cls_runtime_stop(&rt)));
+
+    /* Every step takes one release, and a skip drops one, so together
+     * they cannot pass the releases in the window; a loaded machine may
+     * fall behind, but not by half */
+    for (uint32_t i = 0; i < CHECK_RT_AGENTS; i++) {
+        CHECK(CLS_IS_OK(cls_runtime_agent_stats(&rt, &agents[i], &slot)));
+        CHECK(ctx[i].overlaps == 0);
+        CHECK(slot.steps == ctx[i].reads && slot.steps_failed == 0);
+        CHECK(slot.steps >= CHECK_RT_RELEASES / 2);
+        CHECK(slot.steps + slot.skipped <= CHECK_RT_RELEASES + 1);
+        steps += slot.steps;
+    }
+
+    /* The stalled step ends past the next release and 2 periods late */
+    CHECK(CLS_IS_OK(cls_runtime_agent_stats(&rt, &agents[0], &slot)));
+    CHECK(slot.deadline_misses >= 1 && slot.skipped >= 2);
+    CHECK(slot.max_lag_ns < CHECK_RT_STALL_MS * 1000000ULL);
+
+    CHECK(CLS_IS_OK(cls_runtime_stats(&rt, &st)));
+    CHECK(st.agents == CHECK_RT_AGENTS && st.workers == CHECK_RT_WORKERS);
+    CHECK(st.steps == steps);
+    CHECK(st.deadline_misses >= slot.deadline_misses && st.skipped >= slot.skipped);
+    CHECK(st.lag_p50_ns > 0 && st.lag_p50_ns <= st.lag_p99_ns);
+    CHECK(st.lag_p99_ns <= st.lag_max_ns && st.lag_avg_ns <= st.lag_max_ns);
+out:
+    cls_runtime_destroy(&rt);
+    for (uint32_t i = 0; i < CHECK_RT_AGENTS; i++)
+        cls_agent_destroy(&agents[i]);
+    return rc;
+}
+
+/* ---- Checkpoint image ---- */
+
+#define CHECK_IMG_KEYS      64
+#define CHECK_IMG_WEIGHTS   1024
+
+/* Copy src to dst, flipping one byte at off (from the end if negative) */
+static bool check_img_damage(const char *src, const char *dst, long off) {
+    FILE *in = fopen(src, "rb");
+    FILE *out = fopen(dst, "wb");
+    bool ok = in && out;
+    long len = 0;
+    int c;
+    if (ok) {
+        fseek(in, 0, SEEK_END);
+        len = ftell(in);
+        rewind(in);
+        if (off < 0) off += len;
+        for (long i = 0; (c = fgetc(in)) != EOF; i++)
+            fputc(i == off ? c ^ 0xFF : c, out);
+    }
+    if (in) fclose(in);
+    if (out) fclose(out);
+    return ok && off >= 0 && off < len;
+}
+
+static int check_img(void) {
+    cls_agent_t agent, back;
+    char path[64], bad[72];
+    float weights[CHECK_IMG_WEIGHTS];
+    int rc = 0;
+    memset(&agent, 0, sizeof(agent));
+    memset(&back, 0, sizeof(back));
+    snprintf(path, sizeof(path), "/tmp/check_agent.%ld.img", (long)getpid());
+    snprintf(bad, sizeof(bad), "%s.bad", path);
+
+    CHECK(CLS_IS_OK(check_agent_init(&agent)));
+    for (uint32_t i = 0; i < CHECK_IMG_WEIGHTS; i++) weights[i] = (float)i * 0.5f;
+    CHECK(CLS_IS_OK(cls_cognitive_load_model(agent.cognitive, weights, sizeof(weights))));
+    for (uint32_t i = 0; i < CHECK_IMG_KEYS; i++) {
+        char key[32];
+        snprintf(key, sizeof(key), "img:%u", i);
+        CHECK(CLS_IS_OK(cls_memory_store(agent.memory, key, &i, sizeof(i))));
+    }
+    for (uint32_t i = 0; i < 3; i++) CHECK(CLS_IS_OK(cls_agent_step(&agent)));
+
+    CHECK(CLS_IS_OK(cls_agent_checkpoint(&agent, path)));
+    CHECK(CLS_IS_OK(cls_agent_image_verify(path)));
+
+    /* Round trip: counters, memory and the mapped weights come back */
+    CHECK(CLS_IS_OK(cls_agent_restore(&back, path)));
+    CHECK(back.cycle_count == agent.cycle_count && back.id == agent.id);
+    CHECK(back.cognitive->model_size == sizeof(weights));
+    CHECK(memcmp(back.cognitive->model_data, weights, sizeof(weights)) == 0);
+    for (uint32_t i = 0; i < CHECK_IMG_KEYS; i++) {
+        char key[32];
+        uint32_t v = ~0u;
+        size_t len = sizeof(v);
+        snprintf(key, sizeof(key), "img:%u", i);
+        CHECK(CLS_IS_OK(cls_memory_retrieve(back.memory, key, &v, &len)) && v == i);
+    }
+    cls_agent_destroy(&back);
+
+    /* Damage in a parsed section (the first, after the header page) or the
+     * header fails restore; damage in the mapped memory pool at the end
+     * of the file is left to cls_agent_image_verify */
+    CHECK(check_img_damage(path, bad, 4096 + 8));
+    CHECK(cls_agent_image_verify(bad) == CLS_ERR_NOT_FOUND);
+    CHECK(cls_agent_restore(&back, bad) == CLS_ERR_NOT_FOUND);
+    CHECK(check_img_damage(path, bad, 8));
+    CHECK(cls_agent_restore(&back, bad) == CLS_ERR_NOT_FOUND);
+    CHECK(check_img_damage(path, bad, -64));
+    CHECK(cls_agent_image_verify(bad) == CLS_ERR_NOT_FOUND);
+    unlink(path);
+    CHECK(cls_agent_restore(&back, path) == CLS_ERR_NOT_FOUND);
+out:
+    unlink(bad);
+    unlink(path);
+    cls_agent_destroy(&back);
+    cls_agent_destroy(&agent);
+    return rc;
+}
+
+/* ---- Memory pool sizes ---- */
+
+/* Pools under the arena's minimum page count are refused, not rounded */
+static int check_mem_pool(void) {
+    static const size_t small[] = { 0, 1000, CLS_MEMORY_MIN_POOL - 1 };
+    cls_memory_ctx_t mem;
+    int rc = 0;
+    memset(&mem, 0, sizeof(mem));
+
+    for (size_t i = 0; i < sizeof(small) / sizeof(small[0]); i++)
+        CHECK(cls_memory_init(&mem, small[i]) == CLS_ERR_INVALID);
+    CHECK(CLS_IS_OK(cls_memory_init(&mem, CLS_MEMORY_MIN_POOL)));
+    cls_memory_destroy(&mem);
+out:
+    return rc;
+}
+
+/* Namespace shares and the arena under them must also refuse sizes too
+ * small for the minimum page count, rather than format past the end */
+static int check_mem_shares(void) {
+    cls_memory_ctx_t mem;
+    cls_mem_ns_config_t ns = { .prefix = "ns:", .pool_size = CLS_MEMORY_MIN_POOL - 4096 };
+    cls_memory_config_t cfg = CLS_MEMORY_CONFIG_DEFAULT;
+    static uint8_t tiny[64];
+    int rc = 0;
+    memset(&mem, 0, sizeof(mem));
+    cfg.pool_size = 1u << 20;
+    cfg.namespaces = &ns;
+    cfg.ns_count = 1;
+
+    CHECK(cls_memory_init_ex(&mem, &cfg) == CLS_ERR_INVALID);
+    ns.pool_size = cfg.pool_size - (CLS_MEMORY_MIN_POOL - 4096);
+    CHECK(cls_memory_init_ex(&mem, &cfg) == CLS_ERR_INVALID);
+    ns.pool_size = CLS_MEMORY_MIN_POOL;
+    CHECK(CLS_IS_OK(cls_memory_init_ex(&mem, &cfg)));
+    cls_memory_destroy(&mem);
+
+    CHECK(cls_arena_format(tiny, sizeof(tiny) / 4) == CLS_ERR_INVALID);
+out:
+    return rc;
+}
+
+typedef struct {
+    const char *name;
+    int (*fn)(void);
+} check_case_t;
+
+static const check_case_t check_cases[] = {
+    { "run: skip and catch-up accounting", check_run },
+    { "feed: drop-newest, visible after step", check_feed_drop_newest },
+    { "feed: drop-oldest", check_feed_drop_oldest },
+    { "feed: block parks until drain/shutdown", check_feed_block },
+    { "feed: unknown sensor rejected", check_feed_reject },
+    { "pipeline: anomaly -> decision -> action", check_pipe },
+    { "phase: poll p50/p99/max", check_hist },
+    { "runtime: 6 agents on 2 workers", check_runtime },
+    { "image: round trip, damaged image", check_img },
+    { "memory: pool size boundary", check_mem_pool },
+    { "memory: undersized namespace/arena", check_mem_shares },
+};
+
+int main(void) {
+    printf("\n  ClawLobstars agent self-checks\n");
+    printf("  ==============================\n\n");
+
+    uint32_t cases = sizeof(check_cases) / sizeof(check_cases[0]);
+    uint32_t failed = 0;
+    for (uint32_t i = 0; i < cases; i++) {
+        int rc = check_cases[i].fn();
+        failed += rc ? 1 : 0;
+        printf("  %-40s %s\n", check_cases[i].name, rc ? "FAIL" : "ok");
+    }
+
+    printf("\n  %u checks, %u failed\n\n", cases, failed);
+    return check_failures ? 1 : 0;
+}
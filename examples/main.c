@@ -7,7 +7,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <unistd.h>
 #include "../src/include/cls_framework.h"
 
 static void my_logger(cls_log_level_t level, const char *module, const char *msg) {
@@ -43,6 +42,14 @@ static void on_msg(const cls_msg_t *msg, void *ctx) {
     (void)ctx;
     printf("    >> COMM: type=0x%02X from=%u\n", msg->msg_type, msg->src_agent);
 }
+typedef struct { cls_resource_mgr_t *res; cls_training_t *tr; cls_comm_bus_t *comm; } demo_tick_t;
+static cls_status_t demo_tick(cls_agent_t *agent, void *ctx) {
+    demo_tick_t *t = (demo_tick_t*)ctx; (void)agent;
+    cls_resource_update(t->res);
+    cls_training_step(t->tr);
+    cls_comm_process(t->comm, 16);
+    return CLS_OK;
+}
 
 int main(void) {
     printf("\n  \033[32m╔══════════════════════════════════════════════════╗\033[0m\n");
@@ -239,15 +246,15 @@ int main(void) {
 
     /* 13. INTEGRATION LOOP */
     printf("  \033[33m[13/13]\033[0m INTEGRATED AGENT LOOP\n");
-    for (int i=0;i<5;i++) {
-        cls_agent_step(&agent);
-        cls_resource_update(&res);
-        cls_training_step(&tr);
-        cls_comm_process(&comm, 16);
-        usleep(10000);
-    }
+    demo_tick_t tick={&res,&tr,&comm};
+    cls_agent_run_opts_t run={.hz=100,.max_steps=5,.overrun=CLS_AGENT_OVERRUN_SKIP,
+        .on_tick=demo_tick,.tick_ctx=&tick};
+    cls_agent_run(&agent, &run);
     uint64_t cyc,up; cls_agent_stats(&agent, &cyc, &up);
-    printf("    ✓ %llu cycles | %llu µs uptime\n", (unsigned long long)cyc, (unsigned long long)up);
+    cls_agent_run_stats_t rs; cls_agent_run_stats(&agent, &rs);
+    printf("    ✓ %llu cycles | %llu µs uptime | %llu overruns | max jitter %llu µs\n",
+        (unsigned long long)cyc, (unsigned long long)up,
+        (unsigned long long)rs.overruns, (unsigned long long)(rs.jitter_max_ns/1000));
 
     /* SUMMARY */
     printf("\n  \033[32m╔══════════════════════════════════════════════════╗\033[0m\n");
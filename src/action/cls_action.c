@@ -70,6 +70,10 @@ static cls_action_handler_t *find_handler(cls_action_exec_t *exec, uint32_t acti
     return NULL;
 }
 
+bool cls_action_handles(const cls_action_exec_t *exec, uint32_t action_id) {
+    return find_handler((cls_action_exec_t *)exec, action_id) != NULL;
+}
+
 static void record_action(cls_action_exec_t *exec, const cls_action_record_t *rec) {
     uint32_t idx = exec->history_count % exec->max_history;
     exec->history[idx] = *rec;
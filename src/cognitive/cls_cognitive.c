@@ -31,6 +31,14 @@ cls_status_t cls_cognitive_init(cls_cognitive_t *cog, cls_model_type_t model_typ
     return CLS_OK;
 }
 
+static void cls_cognitive_drop_model(cls_cognitive_t *cog) {
+    if (cog->model_data && cog->model_owned)
+        free(cog->model_data);
+    cog->model_data = NULL;
+    cog->model_size = 0;
+    cog->model_owned = false;
+}
+
 cls_status_t cls_cognitive_load_model(cls_cognitive_t *cog, const void *data, size_t len) {
     if (!cog || !data || len == 0)
         return CLS_ERR_INVALID;
@@ -40,11 +48,24 @@ cls_status_t cls_cognitive_load_model(cls_cognitive_t *cog, const void *data, si
 
     memcpy(model, data, len);
 
-    if (cog->model_data)
-        free(cog->model_data);
+    cls_cognitive_drop_model(cog);
 
     cog->model_data = model;
     cog->model_size = len;
+    cog->model_owned = true;
+    cog->is_trained = true;
+
+    return CLS_OK;
+}
+
+cls_status_t cls_cognitive_attach_model(cls_cognitive_t *cog, void *data, size_t len) {
+    if (!cog || !data || len == 0)
+        return CLS_ERR_INVALID;
+
+    cls_cognitive_drop_model(cog);
+
+    cog->model_data = data;
+    cog->model_size = len;
     cog->is_trained = true;
 
     return CLS_OK;
@@ -229,11 +250,7 @@ void cls_cognitive_get_metrics(const cls_cognitive_t *cog, cls_model_metrics_t *
 cls_status_t cls_cognitive_reset(cls_cognitive_t *cog) {
     if (!cog) return CLS_ERR_INVALID;
 
-    if (cog->model_data) {
-        free(cog->model_data);
-        cog->model_data = NULL;
-    }
-    cog->model_size = 0;
+    cls_cognitive_drop_model(cog);
     cog->is_trained = false;
     memset(&cog->metrics, 0, sizeof(cls_model_metrics_t));
 
@@ -246,9 +263,5 @@ void cls_cognitive_set_threshold(cls_cognitive_t *cog, float threshold) {
 
 void cls_cognitive_destroy(cls_cognitive_t *cog) {
     if (!cog) return;
-    if (cog->model_data) {
-        free(cog->model_data);
-        cog->model_data = NULL;
-    }
-    cog->model_size = 0;
+    cls_cognitive_drop_model(cog);
 }
@@ -3,22 +3,117 @@
  * Main agent lifecycle management
  */
 
+#define _DEFAULT_SOURCE
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "../include/cls_framework.h"
+#include "cls_hist.h"
 
 /* ============================================================
  * Internal Helpers
  * ============================================================ */
 
+#define CLS_AGENT_RING_MIN          64      /* Percept/decision ring slots at least */
+#define CLS_AGENT_FEATURES          2       /* Confidence, severity */
+#define CLS_AGENT_MAX_PLANS         4
+#define CLS_AGENT_MAX_GOALS         16
+#define CLS_AGENT_MAX_HANDLERS      32
+#define CLS_AGENT_MAX_HISTORY       256
+
+/* Per-phase latency histograms; build with -DCLS_AGENT_PHASE_HIST=0 to
+ * leave them out of the step. They live in the pipe, so the public
+ * agent layout does not depend on it */
+#ifndef CLS_AGENT_PHASE_HIST
+#define CLS_AGENT_PHASE_HIST        1
+#endif
+
+#define CLS_AGENT_HIST_BITS         3       /* 8 buckets per power of two, ~12% */
+#define CLS_AGENT_HIST_BUCKETS      272     /* Up to 2^36 ns (~68 s) */
+
+/* A queued percept owns the features inference reads from it */
+typedef struct {
+    cls_percept_t   percept;
+    float           features[CLS_AGENT_FEATURES];
+} cls_agent_slot_t;
+
+/* Log-linear histogram, bucketed by cls_hist.h */
+typedef struct {
+    uint64_t        buckets[CLS_AGENT_HIST_BUCKETS];
+    uint64_t        count;
+    uint64_t        max_ns;
+} cls_agent_hist_t;
+
+/* Rings use free-running head/tail counters over power-of-two arrays;
+ * head - tail is the fill level */
+struct cls_agent_pipe {
+    cls_agent_slot_t   *percepts;
+    uint32_t            percept_head;
+    uint32_t            percept_tail;
+    cls_decision_t     *decisions;
+    uint32_t            decision_head;
+    uint32_t            decision_tail;
+    uint32_t            mask;           /* Slots - 1, both rings */
+    cls_percept_t      *polled;         /* One per sensor */
+    uint32_t            polled_max;
+    cls_plan_t          plan;           /* Rebuilt each step, one task per slot */
+#if CLS_AGENT_PHASE_HIST
+    cls_agent_hist_t    phase_hist[CLS_AGENT_STAGE_COUNT];
+#endif
+};
+
+/* Vyukov-style bounded queue: a slot's seq equals the enqueue position
+ * that may fill it, and position + 1 once it holds a frame. Producers
+ * claim positions by CAS on head; the step (and drop-oldest producers)
+ * claim by CAS on tail and hand the slot back with seq = pos + slots.
+ * Blocking producers that find it full park on wake; a drain that
+ * released slots broadcasts it only when parked says someone is there. */
+typedef struct {
+    uint64_t            seq;
+    cls_frame_t         frame;          /* payload points into the pool */
+} cls_feed_cell_t;
+
+struct cls_agent_feedq {
+    uint64_t            head;
+    uint8_t             pad0[56];
+    uint64_t            tail;
+    uint8_t             pad1[56];
+    cls_feed_cell_t    *cells;
+    uint8_t            *pool;           /* payload_max bytes per cell */
+    uint32_t            mask;
+    uint32_t            payload_max;
+    uint32_t            drain_batch;
+    cls_agent_feed_overflow_t overflow;
+    uint64_t            enqueued;
+    uint64_t            drained;
+    uint64_t            dropped;
+    uint64_t            rejected;
+    uint64_t            waits;
+    uint32_t            parked;         /* Producers waiting on wake */
+    pthread_mutex_t     park_lock;
+    pthread_cond_t      wake;
+};
+
 static uint64_t cls_agent_time_us(void) {
     struct timespec ts;
     clock_gettime(CLOCK_MONOTONIC, &ts);
     return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
 }
 
+static uint64_t cls_agent_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
 static void cls_default_log(cls_log_level_t level, const char *module, const char *msg) {
     static const char *level_str[] = {
         "TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL"
@@ -36,13 +131,370 @@ static void cls_agent_log(cls_agent_t *agent, cls_log_level_t level,
         cls_default_log(level, module, msg);
 }
 
+/* ---- Pipeline ---- */
+
+static void cls_pipe_free(cls_agent_pipe_t *pipe) {
+    if (!pipe) return;
+    free(pipe->percepts);
+    free(pipe->decisions);
+    free(pipe->polled);
+    free(pipe->plan.tasks);
+    free(pipe);
+}
+
+static cls_agent_pipe_t *cls_pipe_create(uint32_t max_sensors) {
+    cls_agent_pipe_t *pipe = (cls_agent_pipe_t *)calloc(1, sizeof(cls_agent_pipe_t));
+    if (!pipe) return NULL;
+
+    uint32_t slots = CLS_AGENT_RING_MIN;
+    while (slots < max_sensors * 2) slots <<= 1;
+
+    pipe->mask = slots - 1;
+    pipe->percepts = (cls_agent_slot_t *)calloc(slots, sizeof(cls_agent_slot_t));
+    pipe->decisions = (cls_decision_t *)calloc(slots, sizeof(cls_decision_t));
+    pipe->polled = (cls_percept_t *)calloc(max_sensors, sizeof(cls_percept_t));
+    pipe->polled_max = max_sensors;
+    pipe->plan.tasks = (cls_task_t *)calloc(slots, sizeof(cls_task_t));
+    pipe->plan.max_tasks = slots;
+
+    if (!pipe->percepts || !pipe->decisions || !pipe->polled || !pipe->plan.tasks) {
+        cls_pipe_free(pipe);
+        return NULL;
+    }
+    return pipe;
+}
+
+/* Queue a percept for inference; a full ring drops its oldest entry */
+static void cls_pipe_push_percept(cls_agent_t *agent, const cls_percept_t *percept) {
+    cls_agent_pipe_t *pipe = agent->pipe;
+    if (pipe->percept_head - pipe->percept_tail > pipe->mask) {
+        pipe->percept_tail++;
+        agent->percepts_dropped++;
+    }
+
+    cls_agent_slot_t *slot = &pipe->percepts[pipe->percept_head & pipe->mask];
+    slot->percept = *percept;
+    slot->features[0] = percept->confidence;
+    slot->features[1] = (float)percept->classification / (float)CLS_EVENT_CRITICAL;
+    slot->percept.features = slot->features;
+    slot->percept.feature_count = CLS_AGENT_FEATURES;
+    pipe->percept_head++;
+}
+
+/* ---- Ingestion queue ---- */
+
+static void cls_feedq_free(cls_agent_feedq_t *q) {
+    if (!q) return;
+    pthread_cond_destroy(&q->wake);
+    pthread_mutex_destroy(&q->park_lock);
+    free(q->cells);
+    free(q->pool);
+    free(q);
+}
+
+static cls_agent_feedq_t *cls_feedq_create(const cls_agent_feed_config_t *cfg) {
+    cls_agent_feedq_t *q = (cls_agent_feedq_t *)calloc(1, sizeof(cls_agent_feedq_t));
+    if (!q) return NULL;
+    pthread_mutex_init(&q->park_lock, NULL);
+    pthread_cond_init(&q->wake, NULL);
+
+    uint32_t slots = 2;
+    while (slots < cfg->depth) slots <<= 1;
+
+    q->cells = (cls_feed_cell_t *)calloc(slots, sizeof(cls_feed_cell_t));
+    q->pool = (uint8_t *)malloc((size_t)slots * CLS_MAX(cfg->payload_max, 1u));
+    if (!q->cells || !q->pool) {
+        cls_feedq_free(q);
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < slots; i++) q->cells[i].seq = i;
+    q->mask = slots - 1;
+    q->payload_max = cfg->payload_max;
+    q->drain_batch = cfg->drain_batch ? cfg->drain_batch : slots;
+    q->overflow = cfg->overflow;
+    return q;
+}
+
+/* Claim the oldest frame; false when none is ready */
+static bool cls_feedq_claim(cls_agent_feedq_t *q, uint64_t *out_pos) {
+    uint64_t pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+    for (;;) {
+        cls_feed_cell_t *cell = &q->cells[pos & q->mask];
+        int64_t dif = (int64_t)(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - (pos + 1));
+        if (dif < 0) return false;
+        if (dif > 0) {
+            pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+            continue;
+        }
+        if (__atomic_compare_exchange_n(&q->tail, &pos, pos + 1, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            *out_pos = pos;
+            return true;
+        }
+    }
+}
+
+static void cls_feedq_release(cls_agent_feedq_t *q, uint64_t pos) {
+    __atomic_store_n(&q->cells[pos & q->mask].seq, pos + q->mask + 1, __ATOMIC_RELEASE);
+}
+
+/* Wake parked producers. The fence pairs with the one in cls_feedq_park:
+ * either the producer sees the released slots or this sees it parked */
+static void cls_feedq_wake(cls_agent_feedq_t *q) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&q->parked, __ATOMIC_RELAXED) == 0) return;
+    pthread_mutex_lock(&q->park_lock);
+    pthread_cond_broadcast(&q->wake);
+    pthread_mutex_unlock(&q->park_lock);
+}
+
+/* Copy one frame in; CLS_ERR_OVERFLOW when full */
+static cls_status_t cls_feedq_push(cls_agent_feedq_t *q, const cls_frame_t *frame) {
+    uint64_t pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+    cls_feed_cell_t *cell;
+    for (;;) {
+        cell = &q->cells[pos & q->mask];
+        int64_t dif = (int64_t)(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - pos);
+        if (dif < 0) return CLS_ERR_OVERFLOW;
+        if (dif > 0) {
+            pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+            continue;
+        }
+        if (__atomic_compare_exchange_n(&q->head, &pos, pos + 1, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            break;
+    }
+
+    uint8_t *buf = q->pool + (size_t)(pos & q->mask) * CLS_MAX(q->payload_max, 1u);
+    cell->frame = *frame;
+    if (frame->payload_len > 0) memcpy(buf, frame->payload, frame->payload_len);
+    cell->frame.payload = frame->payload_len > 0 ? buf : NULL;
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+    return CLS_OK;
+}
+
+/* Push, or sleep until a drain or shutdown wakes the queue. Returns
+ * CLS_OK once the frame is in, CLS_ERR_OVERFLOW to go round again */
+static cls_status_t cls_feedq_park(cls_agent_feedq_t *q, const cls_frame_t *frame,
+                                   const bool *shutting_down) {
+    pthread_mutex_lock(&q->park_lock);
+    __atomic_fetch_add(&q->parked, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    cls_status_t status = cls_feedq_push(q, frame);
+    if (CLS_IS_ERR(status) && !__atomic_load_n(shutting_down, __ATOMIC_ACQUIRE))
+        pthread_cond_wait(&q->wake, &q->park_lock);
+    __atomic_fetch_sub(&q->parked, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&q->park_lock);
+    return status;
+}
+
+/* Perceive one frame, file it in memory and queue it for inference */
+static cls_status_t cls_agent_ingest(cls_agent_t *agent, const cls_frame_t *frame) {
+    /* Its sensor may have been unregistered since the frame was fed */
+    if (!cls_perception_get_sensor(agent->perception, frame->sensor_id))
+        return CLS_ERR_NOT_FOUND;
+
+    cls_percept_t percept = {0};
+    cls_status_t status = cls_perception_process(agent->perception, frame, &percept);
+    if (CLS_IS_ERR(status)) return status;
+
+    /* Store perception result in memory under percept:<sensor>:<time> */
+    cls_mem_key_builder_t kb;
+    cls_mem_key_t key;
+    cls_mem_key_begin(&kb);
+    cls_mem_key_add(&kb, "percept:");
+    cls_mem_key_add_u64(&kb, frame->sensor_id);
+    cls_mem_key_add(&kb, ":");
+    cls_mem_key_add_u64(&kb, frame->timestamp_us);
+
+    if (CLS_IS_OK(cls_mem_key_end(&kb, &key)))
+        cls_memory_store_key(agent->memory, &key, &percept, sizeof(percept), 300);
+
+    cls_pipe_push_percept(agent, &percept);
+
+    /* Notify event handler if anomaly detected */
+    if (percept.classification >= CLS_EVENT_ANOMALY && agent->event_fn) {
+        agent->event_fn(percept.classification, &percept, sizeof(percept));
+    }
+    return CLS_OK;
+}
+
+static void cls_stage_done(cls_agent_t *agent, cls_agent_stage_t stage,
+                           uint64_t start_ns, uint64_t items) {
+    cls_agent_stage_stats_t *st = &agent->stages[stage];
+    uint64_t ns = cls_agent_time_ns() - start_ns;
+    st->runs++;
+    st->items += items;
+    st->total_ns += ns;
+    st->last_ns = ns;
+    if (ns > st->max_ns) st->max_ns = ns;
+
+#if CLS_AGENT_PHASE_HIST
+    cls_agent_hist_t *h = &agent->pipe->phase_hist[stage];
+    h->buckets[cls_hist_index(ns, CLS_AGENT_HIST_BITS, CLS_AGENT_HIST_BUCKETS)]++;
+    h->count++;
+    if (ns > h->max_ns) h->max_ns = ns;
+#endif
+}
+
+static void cls_stage_poll(cls_agent_t *agent) {
+    cls_agent_pipe_t *pipe = agent->pipe;
+    uint64_t start = cls_agent_time_ns();
+    uint32_t count = 0;
+
+    cls_status_t status = cls_perception_poll_into(agent->perception, pipe->polled,
+                                                   pipe->polled_max, &count);
+    if (CLS_IS_ERR(status) && status != CLS_ERR_NOT_FOUND) {
+        cls_agent_log(agent, CLS_LOG_WARN, "PERCEPTION", "Sensor poll returned error");
+    }
+    for (uint32_t i = 0; i < count; i++)
+        cls_pipe_push_percept(agent, &pipe->polled[i]);
+
+    cls_stage_done(agent, CLS_AGENT_STAGE_POLL, start, count);
+}
+
+/* Frames are perceived in place, then their slots handed back. Only as
+ * many as the percept ring has room for are taken, so the rest wait in
+ * the queue under its overflow policy instead of being overwritten.
+ * A frame perception refuses is counted, not retried. */
+static void cls_stage_drain(cls_agent_t *agent) {
+    cls_agent_feedq_t *q = agent->feedq;
+    cls_agent_pipe_t *pipe = agent->pipe;
+    uint64_t start = cls_agent_time_ns();
+    uint32_t room = pipe->mask + 1 - (pipe->percept_head - pipe->percept_tail);
+    uint32_t limit = CLS_MIN(q->drain_batch, room);
+    uint32_t drained = 0, rejected = 0;
+    uint64_t pos;
+
+    while (drained < limit && cls_feedq_claim(q, &pos)) {
+        if (CLS_IS_ERR(cls_agent_ingest(agent, &q->cells[pos & q->mask].frame)))
+            rejected++;
+        cls_feedq_release(q, pos);
+        drained++;
+    }
+    __atomic_fetch_add(&q->drained, drained, __ATOMIC_RELAXED);
+    if (rejected > 0) __atomic_fetch_add(&q->rejected, rejected, __ATOMIC_RELAXED);
+    if (drained > 0) cls_feedq_wake(q);
+
+    agent->stages[CLS_AGENT_STAGE_DRAIN].failed += rejected;
+
+    cls_stage_done(agent, CLS_AGENT_STAGE_DRAIN, start, drained);
+}
+
+static void cls_stage_prune(cls_agent_t *agent) {
+    uint64_t start = cls_agent_time_ns();
+    uint32_t pruned = cls_memory_prune(agent->memory);
+    if (pruned > 0) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "Pruned %u expired entries", pruned);
+        cls_agent_log(agent, CLS_LOG_DEBUG, "MEMORY", buf);
+    }
+    cls_stage_done(agent, CLS_AGENT_STAGE_PRUNE, start, pruned);
+}
+
+/* Every queued percept becomes one decision; one whose inference fails
+ * is still consumed, and counted in the stage's failed items */
+static void cls_stage_infer(cls_agent_t *agent) {
+    cls_agent_pipe_t *pipe = agent->pipe;
+    uint64_t start = cls_agent_time_ns();
+    uint32_t inferred = 0, failed = 0;
+
+    while (pipe->percept_tail != pipe->percept_head &&
+           pipe->decision_head - pipe->decision_tail <= pipe->mask) {
+        const cls_percept_t *percept = &pipe->percepts[pipe->percept_tail & pipe->mask].percept;
+        cls_input_t input = {
+            .features = percept->features,
+            .feature_count = percept->feature_count,
+            .timestamp_us = percept->timestamp_us,
+            .context_id = percept->sensor_id
+        };
+
+        cls_decision_t *decision = &pipe->decisions[pipe->decision_head & pipe->mask];
+        pipe->percept_tail++;
+        if (CLS_IS_ERR(cls_cognitive_infer(agent->cognitive, &input, decision))) {
+            failed++;
+            continue;
+        }
+        agent->last_decision = *decision;
+        pipe->decision_head++;
+        inferred++;
+    }
+
+    agent->stages[CLS_AGENT_STAGE_INFER].failed += failed;
+    cls_stage_done(agent, CLS_AGENT_STAGE_INFER, start, inferred);
+}
+
+/* Turn the queued decisions into this step's plan, one ring run at a time */
+static void cls_stage_plan(cls_agent_t *agent) {
+    cls_agent_pipe_t *pipe = agent->pipe;
+    uint64_t start = cls_agent_time_ns();
+
+    cls_planner_reset_plan(agent->planner, &pipe->plan);
+    while (pipe->decision_tail != pipe->decision_head) {
+        uint32_t at = pipe->decision_tail & pipe->mask;
+        uint32_t run = CLS_MIN(pipe->decision_head - pipe->decision_tail, pipe->mask + 1 - at);
+        uint32_t used = cls_planner_fill(agent->planner, &pipe->plan, &pipe->decisions[at], run);
+        pipe->decision_tail += used;
+        if (used < run) break;
+    }
+
+    cls_stage_done(agent, CLS_AGENT_STAGE_PLAN, start, pipe->plan.task_count);
+}
+
+/* Run the plan's tasks in dependency and priority order */
+static void cls_stage_act(cls_agent_t *agent) {
+    cls_agent_pipe_t *pipe = agent->pipe;
+    cls_plan_t *plan = &pipe->plan;
+    uint64_t start = cls_agent_time_ns();
+    uint32_t executed = 0;
+    cls_task_t *task;
+
+    while (CLS_IS_OK(cls_plan_next_task(plan, &task))) {
+        if (!cls_action_handles(agent->action, task->action_id)) {
+            cls_plan_complete_task(plan, task->task_id, true);
+            agent->actions_unhandled++;
+            continue;
+        }
+        cls_action_record_t record;
+        cls_status_t status = cls_action_execute_task(agent->action, task, &record);
+        cls_plan_complete_task(plan, task->task_id, CLS_IS_OK(status));
+        executed++;
+    }
+
+    cls_planner_finish_plan(agent->planner, plan);
+
+    cls_stage_done(agent, CLS_AGENT_STAGE_ACT, start, executed);
+}
+
+/* ---- Fixed-rate loop ---- */
+
+/* Sleep to spin_ns before the release, then spin the rest */
+static void cls_run_wait(uint64_t release_ns, uint64_t spin_ns) {
+    if (release_ns > spin_ns) {
+        uint64_t wake = release_ns - spin_ns;
+        struct timespec ts = { (time_t)(wake / 1000000000ULL), (long)(wake % 1000000000ULL) };
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) { }
+    }
+    while (spin_ns > 0 && cls_agent_time_ns() < release_ns) { }
+}
+
+static void cls_run_jitter(cls_agent_run_stats_t *st, uint64_t ns) {
+    uint64_t us = ns / 1000;
+    uint32_t bucket = us ? 64u - (uint32_t)__builtin_clzll(us) : 0;
+    st->jitter_hist[CLS_MIN(bucket, CLS_AGENT_JITTER_BUCKETS - 1)]++;
+    st->jitter_total_ns += ns;
+    if (ns > st->jitter_max_ns) st->jitter_max_ns = ns;
+}
+
 /* ============================================================
  * API Implementation
  * ============================================================ */
 
-cls_status_t cls_agent_init(cls_agent_t *agent, const cls_config_t *cfg) {
-    if (!agent || !cfg)
-        return CLS_ERR_INVALID;
+/* Bring up an agent; with image_fd set, memory is mapped from that
+ * section of a checkpoint image instead of starting empty */
+static cls_status_t cls_agent_setup(cls_agent_t *agent, const cls_config_t *cfg,
+                                    int image_fd, uint64_t mem_off, uint64_t mem_len) {
 
     memset(agent, 0, sizeof(cls_agent_t));
     agent->config = *cfg;
@@ -60,7 +512,15 @@ cls_status_t cls_agent_init(cls_agent_t *agent, const cls_config_t *cfg) {
         return CLS_ERR_NOMEM;
     }
 
-    cls_status_t status = cls_memory_init(agent->memory, cfg->memory_size);
+    /* Run memory as a fixed-footprint cache so new percepts displace
+     * stale ones instead of being dropped */
+    cls_memory_config_t mem_cfg = CLS_MEMORY_CONFIG_DEFAULT;
+    mem_cfg.pool_size = cfg->memory_size;
+    mem_cfg.evict = CLS_MEM_EVICT_CLOCK;
+
+    cls_status_t status = image_fd >= 0 ?
+        cls_memory_init_image(agent->memory, &mem_cfg, image_fd, mem_off, mem_len) :
+        cls_memory_init_ex(agent->memory, &mem_cfg);
     if (CLS_IS_ERR(status)) {
         cls_agent_log(agent, CLS_LOG_FATAL, "MEMORY", "Memory init failed");
         free(agent->memory);
@@ -108,6 +568,24 @@ cls_status_t cls_agent_init(cls_agent_t *agent, const cls_config_t *cfg) {
         return status;
     }
 
+    /* Planning, action and the stage rings between them */
+    agent->planner = (cls_planner_t *)calloc(1, sizeof(cls_planner_t));
+    agent->action = (cls_action_exec_t *)calloc(1, sizeof(cls_action_exec_t));
+    agent->pipe = cls_pipe_create(cfg->max_sensors);
+    cls_agent_feed_config_t feed = CLS_AGENT_FEED_CONFIG_DEFAULT;
+    agent->feedq = cls_feedq_create(&feed);
+    status = (agent->planner && agent->action && agent->pipe && agent->feedq) ?
+             CLS_OK : CLS_ERR_NOMEM;
+    if (CLS_IS_OK(status))
+        status = cls_planner_init(agent->planner, CLS_AGENT_MAX_PLANS, CLS_AGENT_MAX_GOALS);
+    if (CLS_IS_OK(status))
+        status = cls_action_init(agent->action, CLS_AGENT_MAX_HANDLERS, CLS_AGENT_MAX_HISTORY);
+    if (CLS_IS_ERR(status)) {
+        cls_agent_log(agent, CLS_LOG_FATAL, "CORE", "Pipeline init failed");
+        cls_agent_destroy(agent);
+        return status;
+    }
+
     agent->cycle_count = 0;
     agent->uptime_us = 0;
     agent->last_step_us = cls_agent_time_us();
@@ -121,37 +599,41 @@ cls_status_t cls_agent_init(cls_agent_t *agent, const cls_config_t *cfg) {
     return CLS_OK;
 }
 
+cls_status_t cls_agent_init(cls_agent_t *agent, const cls_config_t *cfg) {
+    if (!agent || !cfg)
+        return CLS_ERR_INVALID;
+    return cls_agent_setup(agent, cfg, -1, 0, 0);
+}
+
 cls_status_t cls_agent_step(cls_agent_t *agent) {
     if (!agent || !agent->initialized)
         return CLS_ERR_STATE;
 
-    if (agent->shutting_down)
+    if (__atomic_load_n(&agent->shutting_down, __ATOMIC_ACQUIRE))
         return CLS_ERR_STATE;
 
     uint64_t step_start = cls_agent_time_us();
     agent->state = CLS_STATE_ACTIVE;
 
-    /* Phase 1: Perception — poll all sensors */
-    cls_status_t status = cls_perception_poll(agent->perception);
-    if (CLS_IS_ERR(status) && status != CLS_ERR_NOT_FOUND) {
-        cls_agent_log(agent, CLS_LOG_WARN, "PERCEPTION", "Sensor poll returned error");
-    }
+    /* Phase 1: Perception — poll all sensors and drain fed frames onto
+     * the percept ring */
+    cls_stage_poll(agent);
+    cls_stage_drain(agent);
 
     /* Phase 2: Memory — prune expired entries */
-    uint32_t pruned = cls_memory_prune(agent->memory);
-    if (pruned > 0) {
-        char buf[64];
-        snprintf(buf, sizeof(buf), "Pruned %u expired entries", pruned);
-        cls_agent_log(agent, CLS_LOG_DEBUG, "MEMORY", buf);
-    }
+    cls_stage_prune(agent);
 
-    /* Phase 3: Cognitive — inference cycle */
+    /* Phase 3: Cognitive — one decision per queued percept */
+    cls_stage_infer(agent);
+
+    /* Phase 4: Planning — queued decisions become this step's plan */
     agent->state = CLS_STATE_PLANNING;
-    /* NOTE: In a full implementation, perception output would feed into
-     * cognitive inference here. For now, the step increments cycle count
-     * and maintains the agent loop timing. */
+    cls_stage_plan(agent);
+
+    /* Phase 5: Action — execute the plan's tasks */
+    agent->state = CLS_STATE_EXECUTING;
+    cls_stage_act(agent);
 
-    /* Phase 4: Return to ready */
     agent->state = CLS_STATE_READY;
     agent->cycle_count++;
 
@@ -162,6 +644,63 @@ cls_status_t cls_agent_step(cls_agent_t *agent) {
     return CLS_OK;
 }
 
+cls_status_t cls_agent_run(cls_agent_t *agent, const cls_agent_run_opts_t *opts) {
+    if (!agent || !opts) return CLS_ERR_INVALID;
+    if (!agent->initialized || __atomic_load_n(&agent->shutting_down, __ATOMIC_ACQUIRE))
+        return CLS_ERR_STATE;
+
+    uint32_t hz = opts->hz ? opts->hz : agent->config.inference_hz;
+    if (hz == 0) return CLS_ERR_INVALID;
+
+    cls_agent_run_stats_t *st = &agent->run_stats;
+    memset(st, 0, sizeof(*st));
+    st->period_ns = 1000000000ULL / hz;
+
+    uint64_t spin_ns = (uint64_t)opts->spin_us * 1000ULL;
+    uint64_t release = cls_agent_time_ns();
+    cls_status_t status = CLS_OK;
+
+    while (!__atomic_load_n(&agent->run_stop, __ATOMIC_ACQUIRE) &&
+           (opts->max_steps == 0 || st->steps < opts->max_steps)) {
+        cls_run_wait(release, spin_ns);
+        uint64_t start = cls_agent_time_ns();
+        cls_run_jitter(st, start > release ? start - release : 0);
+
+        status = cls_agent_step(agent);
+        if (CLS_IS_OK(status) && opts->on_tick)
+            status = opts->on_tick(agent, opts->tick_ctx);
+        if (CLS_IS_ERR(status)) break;
+        st->steps++;
+
+        /* Releases stay on the original grid, so sleeps never drift */
+        release += st->period_ns;
+        uint64_t end = cls_agent_time_ns();
+        if (end <= release) continue;
+
+        st->overruns++;
+        uint64_t behind = (end - release) / st->period_ns;
+        if (opts->overrun == CLS_AGENT_OVERRUN_SKIP ||
+            (opts->max_catchup > 0 && behind >= opts->max_catchup)) {
+            release += (behind + 1) * st->period_ns;
+            st->skipped += behind + 1;
+        }
+    }
+
+    __atomic_store_n(&agent->run_stop, 0, __ATOMIC_RELEASE);
+    return status;
+}
+
+void cls_agent_run_stop(cls_agent_t *agent) {
+    if (!agent) return;
+    __atomic_store_n(&agent->run_stop, 1, __ATOMIC_RELEASE);
+}
+
+cls_status_t cls_agent_run_stats(const cls_agent_t *agent, cls_agent_run_stats_t *out) {
+    if (!agent || !out) return CLS_ERR_INVALID;
+    *out = agent->run_stats;
+    return CLS_OK;
+}
+
 cls_agent_state_t cls_agent_get_state(const cls_agent_t *agent) {
     if (!agent) return CLS_STATE_ERROR;
     return agent->state;
@@ -178,31 +717,78 @@ void cls_agent_set_event_handler(cls_agent_t *agent, cls_event_fn fn) {
 cls_status_t cls_agent_feed(cls_agent_t *agent, const cls_frame_t *frame) {
     if (!agent || !frame || !agent->initialized)
         return CLS_ERR_INVALID;
+    if (frame->payload_len > 0 && !frame->payload)
+        return CLS_ERR_INVALID;
 
-    cls_percept_t percept = {0};
-    cls_status_t status = cls_perception_process(agent->perception, frame, &percept);
-    if (CLS_IS_ERR(status)) return status;
-
-    /* Store perception result in memory */
-    char key[128];
-    snprintf(key, sizeof(key), "percept:%u:%llu",
-             frame->sensor_id, (unsigned long long)frame->timestamp_us);
+    cls_agent_feedq_t *q = agent->feedq;
+    if (frame->payload_len > q->payload_max)
+        return CLS_ERR_OVERFLOW;
+    if (!cls_perception_get_sensor(agent->perception, frame->sensor_id)) {
+        __atomic_fetch_add(&q->rejected, 1, __ATOMIC_RELAXED);
+        return CLS_ERR_NOT_FOUND;
+    }
 
-    cls_memory_store_ttl(agent->memory, key, &percept, sizeof(percept), 300);
+    bool waited = false;
+    for (;;) {
+        if (__atomic_load_n(&agent->shutting_down, __ATOMIC_ACQUIRE)) return CLS_ERR_STATE;
+        if (CLS_IS_OK(cls_feedq_push(q, frame))) break;
 
-    /* Notify event handler if anomaly detected */
-    if (percept.classification >= CLS_EVENT_ANOMALY && agent->event_fn) {
-        agent->event_fn(percept.classification, &percept, sizeof(percept));
+        if (q->overflow == CLS_AGENT_FEED_DROP_NEWEST) {
+            __atomic_fetch_add(&q->dropped, 1, __ATOMIC_RELAXED);
+            return CLS_ERR_OVERFLOW;
+        }
+        if (q->overflow == CLS_AGENT_FEED_DROP_OLDEST) {
+            uint64_t pos;
+            if (cls_feedq_claim(q, &pos)) {
+                cls_feedq_release(q, pos);
+                __atomic_fetch_add(&q->dropped, 1, __ATOMIC_RELAXED);
+            } else {
+                sched_yield();      /* Oldest still being written */
+            }
+            continue;
+        }
+        if (!waited) {
+            __atomic_fetch_add(&q->waits, 1, __ATOMIC_RELAXED);
+            waited = true;
+        }
+        if (CLS_IS_OK(cls_feedq_park(q, frame, &agent->shutting_down))) break;
     }
 
+    __atomic_fetch_add(&q->enqueued, 1, __ATOMIC_RELAXED);
+    return CLS_OK;
+}
+
+cls_status_t cls_agent_feed_configure(cls_agent_t *agent, const cls_agent_feed_config_t *cfg) {
+    if (!agent || !cfg || !agent->initialized) return CLS_ERR_INVALID;
+    if (cfg->depth == 0 || cfg->overflow > CLS_AGENT_FEED_BLOCK) return CLS_ERR_INVALID;
+
+    cls_agent_feedq_t *q = cls_feedq_create(cfg);
+    if (!q) return CLS_ERR_NOMEM;
+
+    cls_feedq_free(agent->feedq);
+    agent->feedq = q;
+    return CLS_OK;
+}
+
+cls_status_t cls_agent_feed_stats(const cls_agent_t *agent, cls_agent_feed_stats_t *out) {
+    if (!agent || !out || !agent->feedq) return CLS_ERR_INVALID;
+
+    cls_agent_feedq_t *q = agent->feedq;
+    uint64_t head = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+    uint64_t tail = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+
+    out->enqueued = __atomic_load_n(&q->enqueued, __ATOMIC_RELAXED);
+    out->drained = __atomic_load_n(&q->drained, __ATOMIC_RELAXED);
+    out->dropped = __atomic_load_n(&q->dropped, __ATOMIC_RELAXED);
+    out->rejected = __atomic_load_n(&q->rejected, __ATOMIC_RELAXED);
+    out->waits = __atomic_load_n(&q->waits, __ATOMIC_RELAXED);
+    out->queued = head > tail ? (uint32_t)(head - tail) : 0;
     return CLS_OK;
 }
 
 cls_status_t cls_agent_get_decision(const cls_agent_t *agent, cls_decision_t *decision) {
     if (!agent || !decision) return CLS_ERR_INVALID;
-    /* Placeholder — returns last cognitive decision */
-    CLS_UNUSED(agent);
-    memset(decision, 0, sizeof(cls_decision_t));
+    *decision = agent->last_decision;
     return CLS_OK;
 }
 
@@ -212,11 +798,49 @@ void cls_agent_stats(const cls_agent_t *agent, uint64_t *cycles, uint64_t *uptim
     if (uptime)  *uptime = agent->uptime_us;
 }
 
+cls_status_t cls_agent_stage_stats(const cls_agent_t *agent, cls_agent_stage_t stage,
+                                   cls_agent_stage_stats_t *out) {
+    if (!agent || !out || (uint32_t)stage >= CLS_AGENT_STAGE_COUNT)
+        return CLS_ERR_INVALID;
+    *out = agent->stages[stage];
+    return CLS_OK;
+}
+
+cls_status_t cls_agent_phase_latency(const cls_agent_t *agent, cls_agent_stage_t stage,
+                                     cls_agent_latency_t *out) {
+    if (!agent || !out || (uint32_t)stage >= CLS_AGENT_STAGE_COUNT)
+        return CLS_ERR_INVALID;
+
+    memset(out, 0, sizeof(*out));
+#if CLS_AGENT_PHASE_HIST
+    if (!agent->pipe) return CLS_ERR_STATE;
+    const cls_agent_hist_t *h = &agent->pipe->phase_hist[stage];
+    out->count = h->count;
+    out->p50_ns = cls_hist_pct(h->buckets, CLS_AGENT_HIST_BUCKETS, CLS_AGENT_HIST_BITS,
+                                h->count, h->max_ns, 500);
+    out->p99_ns = cls_hist_pct(h->buckets, CLS_AGENT_HIST_BUCKETS, CLS_AGENT_HIST_BITS,
+                                h->count, h->max_ns, 990);
+    out->max_ns = h->max_ns;
+    return CLS_OK;
+#else
+    return CLS_ERR_STATE;
+#endif
+}
+
+void cls_agent_phase_reset(cls_agent_t *agent) {
+    if (!agent || !agent->pipe) return;
+#if CLS_AGENT_PHASE_HIST
+    memset(agent->pipe->phase_hist, 0, sizeof(agent->pipe->phase_hist));
+#endif
+}
+
 cls_status_t cls_agent_shutdown(cls_agent_t *agent) {
     if (!agent || !agent->initialized)
         return CLS_ERR_STATE;
 
-    agent->shutting_down = true;
+    /* Feeders on other threads poll this before every push */
+    __atomic_store_n(&agent->shutting_down, true, __ATOMIC_RELEASE);
+    if (agent->feedq) cls_feedq_wake(agent->feedq);
     cls_agent_log(agent, CLS_LOG_INFO, "CORE", "Shutting down agent...");
 
     /* Flush memory */
@@ -231,11 +855,33 @@ cls_status_t cls_agent_shutdown(cls_agent_t *agent) {
 void cls_agent_destroy(cls_agent_t *agent) {
     if (!agent) return;
 
+    if (agent->action) {
+        cls_action_destroy(agent->action);
+        free(agent->action);
+        agent->action = NULL;
+    }
+
+    if (agent->planner) {
+        cls_planner_destroy(agent->planner);
+        free(agent->planner);
+        agent->planner = NULL;
+    }
+
+    cls_pipe_free(agent->pipe);
+    agent->pipe = NULL;
+    cls_feedq_free(agent->feedq);
+    agent->feedq = NULL;
+
     if (agent->cognitive) {
         cls_cognitive_destroy(agent->cognitive);
         free(agent->cognitive);
         agent->cognitive = NULL;
     }
+    if (agent->image_model) {
+        munmap(agent->image_model, agent->image_model_len);
+        agent->image_model = NULL;
+        agent->image_model_len = 0;
+    }
 
     if (agent->perception) {
         cls_perception_destroy(agent->perception);
@@ -249,9 +895,718 @@ void cls_agent_destroy(cls_agent_t *agent) {
         agent->memory = NULL;
     }
 
+    free(agent->image_strings);
+    agent->image_strings = NULL;
     agent->initialized = false;
 }
 
+/* ============================================================
+ * Checkpoint Image
+ * ============================================================ */
+
+/* A 4096-byte header page with a section table, then each section
+ * page-aligned. Sections hold native-endian fixed-width fields, so an
+ * image is read back by the same build. Every section is FNV-1a summed.
+ * The memory section is a memory store snapshot and the weights section
+ * the raw model_data; both are mapped in place at restore, which checks
+ * only the snapshot's own header, and their sums are checked by
+ * cls_agent_image_verify. The others are summed and parsed from a
+ * read-only mapping at restore. */
+#define CLS_AGENT_IMG_MAGIC         0x31544E4741534C43ULL   /* "CLSAGNT1" */
+#define CLS_AGENT_IMG_VERSION       5
+#define CLS_AGENT_IMG_PAGE          4096
+#define CLS_AGENT_IMG_MAX_SECTIONS  16
+#define CLS_AGENT_IMG_NOSTR         0xFFFFFFFFu
+
+typedef enum {
+    CLS_IMG_SEC_AGENT   = 1,    /* Identity, config, counters, stage stats */
+    CLS_IMG_SEC_STRINGS = 2,    /* NUL-terminated names other sections point into */
+    CLS_IMG_SEC_MEMORY  = 3,    /* Memory store snapshot */
+    CLS_IMG_SEC_MODEL   = 4,    /* Cognitive settings, metrics and model_data */
+    CLS_IMG_SEC_SENSORS = 5,    /* Perception sensor table */
+    CLS_IMG_SEC_PLANNER = 6,    /* Goals, plans and counters */
+    CLS_IMG_SEC_ACTIONS = 7,    /* Execution history and counters */
+    CLS_IMG_SEC_WEIGHTS = 8     /* model_data, sized by the model section */
+} cls_img_sec_type_t;
+
+#define CLS_IMG_SEC_MAPPED          0x2     /* Mapped at restore; sum checked only by verify */
+
+typedef struct {
+    uint32_t    type;
+    uint32_t    flags;
+    uint64_t    offset;
+    uint64_t    length;
+    uint64_t    sum;
+} cls_img_sec_t;
+
+typedef struct {
+    uint64_t        magic;
+    uint32_t        version;
+    uint32_t        count;
+    uint64_t        created_us;     /* Wall clock */
+    uint64_t        sum;            /* Over this header with sum = 0 */
+    cls_img_sec_t   sections[CLS_AGENT_IMG_MAX_SECTIONS];
+} cls_img_hdr_t;
+
+typedef struct {
+    uint8_t    *data;
+    size_t      len;
+    size_t      cap;
+    bool        failed;
+} cls_img_buf_t;
+
+typedef struct {
+    const uint8_t  *p;
+    size_t          left;
+    bool            failed;
+} cls_img_rd_t;
+
+#define CLS_IMG_FNV_SEED            0xCBF29CE484222325ULL
+
+static uint64_t cls_img_fnv_step(uint64_t h, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 0x100000001B3ULL;
+    }
+    return h;
+}
+
+static uint64_t cls_img_fnv(const void *data, size_t len) {
+    return cls_img_fnv_step(CLS_IMG_FNV_SEED, data, len);
+}
+
+static uint64_t cls_img_hdr_sum(const cls_img_hdr_t *hdr) {
+    cls_img_hdr_t tmp = *hdr;
+    tmp.sum = 0;
+    return cls_img_fnv(&tmp, sizeof(tmp));
+}
+
+static void cls_img_put(cls_img_buf_t *b, const void *src, size_t n) {
+    if (b->failed || n == 0) return;
+    if (b->len + n > b->cap) {
+        size_t cap = b->cap ? b->cap : 1024;
+        while (cap < b->len + n) cap *= 2;
+        uint8_t *data = (uint8_t *)realloc(b->data, cap);
+        if (!data) {
+            b->failed = true;
+            return;
+        }
+        b->data = data;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, src, n);
+    b->len += n;
+}
+
+static void cls_img_u32(cls_img_buf_t *b, uint32_t v) { cls_img_put(b, &v, sizeof(v)); }
+static void cls_img_u64(cls_img_buf_t *b, uint64_t v) { cls_img_put(b, &v, sizeof(v)); }
+static void cls_img_f32(cls_img_buf_t *b, float v)    { cls_img_put(b, &v, sizeof(v)); }
+
+/* Append s to the string table and record its offset */
+static void cls_img_str(cls_img_buf_t *b, cls_img_buf_t *strs, const char *s) {
+    if (!s) {
+        cls_img_u32(b, CLS_AGENT_IMG_NOSTR);
+        return;
+    }
+    cls_img_u32(b, (uint32_t)strs->len);
+    cls_img_put(strs, s, strlen(s) + 1);
+}
+
+static void cls_img_get(cls_img_rd_t *r, void *out, size_t n) {
+    if (r->failed || n > r->left) {
+        r->failed = true;
+        memset(out, 0, n);
+        return;
+    }
+    memcpy(out, r->p, n);
+    r->p += n;
+    r->left -= n;
+}
+
+static uint32_t cls_img_get_u32(cls_img_rd_t *r) { uint32_t v; cls_img_get(r, &v, sizeof(v)); return v; }
+static uint64_t cls_img_get_u64(cls_img_rd_t *r) { uint64_t v; cls_img_get(r, &v, sizeof(v)); return v; }
+static float    cls_img_get_f32(cls_img_rd_t *r) { float v;    cls_img_get(r, &v, sizeof(v)); return v; }
+
+/* Resolve a string table offset; NULL for none, failure if out of range */
+static const char *cls_img_get_str(cls_img_rd_t *r, const char *strs, size_t strs_len) {
+    uint32_t off = cls_img_get_u32(r);
+    if (r->failed || off == CLS_AGENT_IMG_NOSTR) return NULL;
+    if (off >= strs_len || !memchr(strs + off, '\0', strs_len - off)) {
+        r->failed = true;
+        return NULL;
+    }
+    return strs + off;
+}
+
+static cls_status_t cls_img_write_all(int fd, const void *buf, size_t len) {
+    const uint8_t *p = (const uint8_t *)buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return CLS_ERR_IO;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return CLS_OK;
+}
+
+/* Zero-fill fd up to the next page boundary; *pos tracks the offset */
+static cls_status_t cls_img_pad(int fd, uint64_t *pos) {
+    static const uint8_t zeros[CLS_AGENT_IMG_PAGE];
+    uint64_t pad = (CLS_AGENT_IMG_PAGE - (*pos % CLS_AGENT_IMG_PAGE)) % CLS_AGENT_IMG_PAGE;
+    *pos += pad;
+    return cls_img_write_all(fd, zeros, (size_t)pad);
+}
+
+/* Sum len bytes of fd from off, for sections streamed rather than buffered */
+static cls_status_t cls_img_sum_fd(int fd, uint64_t off, uint64_t len, uint64_t *sum) {
+    uint8_t buf[65536];
+    uint64_t h = CLS_IMG_FNV_SEED;
+    while (len > 0) {
+        ssize_t n = pread(fd, buf, (size_t)CLS_MIN(len, (uint64_t)sizeof(buf)), (off_t)off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return CLS_ERR_IO;
+        h = cls_img_fnv_step(h, buf, (size_t)n);
+        off += (uint64_t)n;
+        len -= (uint64_t)n;
+    }
+    *sum = h;
+    return CLS_OK;
+}
+
+static cls_status_t cls_img_section(int fd, uint64_t *pos, cls_img_hdr_t *hdr,
+                                    uint32_t type, const cls_img_buf_t *b) {
+    if (b->failed) return CLS_ERR_NOMEM;
+    if (hdr->count >= CLS_AGENT_IMG_MAX_SECTIONS) return CLS_ERR_OVERFLOW;
+
+    cls_status_t status = cls_img_pad(fd, pos);
+    if (CLS_IS_OK(status))
+        status = cls_img_write_all(fd, b->data, b->len);
+    if (CLS_IS_ERR(status)) return status;
+
+    cls_img_sec_t *sec = &hdr->sections[hdr->count++];
+    sec->type = type;
+    sec->offset = *pos;
+    sec->length = b->len;
+    sec->sum = cls_img_fnv(b->data, b->len);
+    *pos += b->len;
+    return CLS_OK;
+}
+
+/* ---- Encoders ---- */
+
+static void cls_img_enc_agent(const cls_agent_t *agent, cls_img_buf_t *b, cls_img_buf_t *strs) {
+    cls_img_u32(b, agent->id);
+    cls_img_u64(b, (uint64_t)agent->config.memory_size);
+    cls_img_u32(b, agent->config.max_sensors);
+    cls_img_u32(b, agent->config.inference_hz);
+    cls_img_u32(b, (uint32_t)agent->config.security_level);
+    cls_img_u32(b, (uint32_t)agent->config.log_level);
+    cls_img_str(b, strs, agent->name);
+
+    cls_img_u64(b, agent->cycle_count);
+    cls_img_u64(b, agent->uptime_us);
+    cls_img_u64(b, agent->percepts_dropped);
+    cls_img_u64(b, agent->actions_unhandled);
+    cls_img_u32(b, agent->last_decision.action_id);
+    cls_img_f32(b, agent->last_decision.confidence);
+    cls_img_u32(b, agent->last_decision.priority);
+
+    cls_img_u32(b, agent->feedq->mask + 1);
+    cls_img_u32(b, agent->feedq->payload_max);
+    cls_img_u32(b, agent->feedq->drain_batch);
+    cls_img_u32(b, (uint32_t)agent->feedq->overflow);
+
+    cls_img_u32(b, CLS_AGENT_STAGE_COUNT);
+    cls_img_put(b, agent->stages, sizeof(agent->stages));
+    cls_img_put(b, &agent->run_stats, sizeof(agent->run_stats));
+}
+
+static void cls_img_enc_model(const cls_cognitive_t *cog, cls_img_buf_t *b) {
+    cls_img_u32(b, (uint32_t)cog->model_type);
+    cls_img_f32(b, cog->confidence_threshold);
+    cls_img_u32(b, cog->max_decisions);
+    cls_img_u32(b, cog->is_trained ? 1 : 0);
+    cls_img_put(b, &cog->metrics, sizeof(cog->metrics));
+    cls_img_u64(b, cog->model_data ? (uint64_t)cog->model_size : 0);
+}
+
+static void cls_img_enc_sensors(const cls_perception_t *p, cls_img_buf_t *b, cls_img_buf_t *strs) {
+    cls_img_u64(b, p->frames_processed);
+    cls_img_u32(b, p->sensor_count);
+    for (uint32_t i = 0; i < p->sensor_count; i++) {
+        const cls_sensor_t *s = &p->sensors[i];
+        cls_img_u32(b, s->id);
+        cls_img_u32(b, (uint32_t)s->type);
+        cls_img_u32(b, s->poll_hz);
+        cls_img_u32(b, s->active ? 1 : 0);
+        cls_img_str(b, strs, s->name);
+    }
+}
+
+static void cls_img_enc_planner(const cls_planner_t *pl, cls_img_buf_t *b, cls_img_buf_t *strs) {
+    cls_img_u64(b, pl->plans_generated);
+    cls_img_u64(b, pl->plans_completed);
+    cls_img_u64(b, pl->plans_failed);
+
+    cls_img_u32(b, pl->goal_count);
+    for (uint32_t i = 0; i < pl->goal_count; i++) {
+        const cls_goal_t *g = &pl->goals[i];
+        cls_img_u32(b, g->goal_id);
+        cls_img_str(b, strs, g->description);
+        cls_img_u32(b, (uint32_t)g->priority);
+        cls_img_f32(b, g->progress);
+        cls_img_f32(b, g->utility);
+        cls_img_u32(b, g->achieved ? 1 : 0);
+    }
+
+    /* Task params belong to the caller and are not carried over */
+    cls_img_u32(b, pl->plan_count);
+    for (uint32_t i = 0; i < pl->plan_count; i++) {
+        const cls_plan_t *plan = &pl->plans[i];
+        cls_img_u32(b, plan->plan_id);
+        cls_img_u32(b, (uint32_t)plan->status);
+        cls_img_u32(b, plan->max_tasks);
+        cls_img_f32(b, plan->total_cost);
+        cls_img_f32(b, plan->total_reward);
+        cls_img_f32(b, plan->success_probability);
+        cls_img_u64(b, plan->created_at);
+        cls_img_u32(b, plan->task_count);
+        for (uint32_t t = 0; t < plan->task_count; t++) {
+            cls_task_t task;
+            memcpy(&task, &plan->tasks[t], sizeof(task));
+            task.params = NULL;
+            task.params_len = 0;
+            cls_img_put(b, &task, sizeof(task));
+        }
+    }
+}
+
+static void cls_img_enc_actions(const cls_action_exec_t *ex, cls_img_buf_t *b) {
+    uint32_t count = ex->history_count < ex->max_history ? ex->history_count : ex->max_history;
+
+    cls_img_u32(b, ex->next_exec_id);
+    cls_img_u64(b, ex->total_executed);
+    cls_img_u64(b, ex->total_success);
+    cls_img_u64(b, ex->total_failed);
+    cls_img_u64(b, ex->total_rollbacks);
+    cls_img_u32(b, count);
+    cls_img_put(b, ex->history, count * sizeof(cls_action_record_t));
+}
+
+/* ---- Decoders ---- */
+
+/* The weights are used where they are mapped, not copied */
+static cls_status_t cls_img_dec_model(cls_cognitive_t *cog, cls_img_rd_t *r,
+                                      void *weights, size_t weights_len) {
+    cog->model_type = (cls_model_type_t)cls_img_get_u32(r);
+    cog->confidence_threshold = cls_img_get_f32(r);
+    cog->max_decisions = cls_img_get_u32(r);
+    bool trained = cls_img_get_u32(r) != 0;
+    cls_img_get(r, &cog->metrics, sizeof(cog->metrics));
+    uint64_t size = cls_img_get_u64(r);
+    if (r->failed || size != weights_len) return CLS_ERR_NOT_FOUND;
+
+    if (size > 0) {
+        cls_status_t status = cls_cognitive_attach_model(cog, weights, weights_len);
+        if (CLS_IS_ERR(status)) return status;
+    }
+    cog->is_trained = trained;
+    return CLS_OK;
+}
+
+static cls_status_t cls_img_dec_sensors(cls_perception_t *p, cls_img_rd_t *r,
+                                        const char *strs, size_t strs_len) {
+    p->frames_processed = cls_img_get_u64(r);
+    uint32_t count = cls_img_get_u32(r);
+    if (r->failed) return CLS_ERR_NOT_FOUND;
+    if (count > p->max_sensors) return CLS_ERR_OVERFLOW;
+
+    for (uint32_t i = 0; i < count; i++) {
+        cls_sensor_t s;
+        memset(&s, 0, sizeof(s));
+        s.id = cls_img_get_u32(r);
+        s.type = (cls_sensor_type_t)cls_img_get_u32(r);
+        s.poll_hz = cls_img_get_u32(r);
+        bool active = cls_img_get_u32(r) != 0;
+        s.name = cls_img_get_str(r, strs, strs_len);
+        if (r->failed) return CLS_ERR_NOT_FOUND;
+
+        cls_status_t status = cls_perception_register(p, &s);
+        if (CLS_IS_ERR(status)) return status;
+        p->sensors[p->sensor_count - 1].active = active;
+    }
+    return CLS_OK;
+}
+
+static cls_status_t cls_img_dec_planner(cls_planner_t *pl, cls_img_rd_t *r,
+                                        const char *strs, size_t strs_len) {
+    pl->plans_generated = cls_img_get_u64(r);
+    pl->plans_completed = cls_img_get_u64(r);
+    pl->plans_failed = cls_img_get_u64(r);
+
+    uint32_t goals = cls_img_get_u32(r);
+    if (r->failed) return CLS_ERR_NOT_FOUND;
+    if (goals > pl->max_goals) return CLS_ERR_OVERFLOW;
+    for (uint32_t i = 0; i < goals; i++) {
+        cls_goal_t *g = &pl->goals[i];
+        g->goal_id = cls_img_get_u32(r);
+        g->description = cls_img_get_str(r, strs, strs_len);
+        g->priority = (cls_priority_t)cls_img_get_u32(r);
+        g->progress = cls_img_get_f32(r);
+        g->utility = cls_img_get_f32(r);
+        g->achieved = cls_img_get_u32(r) != 0;
+    }
+    pl->goal_count = goals;
+
+    uint32_t plans = cls_img_get_u32(r);
+    if (r->failed) return CLS_ERR_NOT_FOUND;
+    if (plans > pl->max_plans) return CLS_ERR_OVERFLOW;
+    for (uint32_t i = 0; i < plans; i++) {
+        cls_plan_t *plan = &pl->plans[i];
+        memset(plan, 0, sizeof(*plan));
+        plan->plan_id = cls_img_get_u32(r);
+        plan->status = (cls_plan_status_t)cls_img_get_u32(r);
+        plan->max_tasks = cls_img_get_u32(r);
+        plan->total_cost = cls_img_get_f32(r);
+        plan->total_reward = cls_img_get_f32(r);
+        plan->success_probability = cls_img_get_f32(r);
+        plan->created_at = cls_img_get_u64(r);
+        uint32_t tasks = cls_img_get_u32(r);
+        if (r->failed || tasks > plan->max_tasks ||
+            (uint64_t)tasks * sizeof(cls_task_t) > r->left)
+            return CLS_ERR_NOT_FOUND;
+
+        /* Counted as soon as it owns tasks so destroy frees them */
+        plan->tasks = (cls_task_t *)calloc(plan->max_tasks ? plan->max_tasks : 1,
+                                           sizeof(cls_task_t));
+        if (!plan->tasks) return CLS_ERR_NOMEM;
+        pl->plan_count = i + 1;
+        cls_img_get(r, plan->tasks, tasks * sizeof(cls_task_t));
+        plan->task_count = tasks;
+    }
+    return r->failed ? CLS_ERR_NOT_FOUND : CLS_OK;
+}
+
+static cls_status_t cls_img_dec_actions(cls_action_exec_t *ex, cls_img_rd_t *r) {
+    ex->next_exec_id = cls_img_get_u32(r);
+    ex->total_executed = cls_img_get_u64(r);
+    ex->total_success = cls_img_get_u64(r);
+    ex->total_failed = cls_img_get_u64(r);
+    ex->total_rollbacks = cls_img_get_u64(r);
+    uint32_t count = cls_img_get_u32(r);
+    if (r->failed) return CLS_ERR_NOT_FOUND;
+    if (count > ex->max_history) return CLS_ERR_OVERFLOW;
+
+    cls_img_get(r, ex->history, count * sizeof(cls_action_record_t));
+    ex->history_count = count;
+    return r->failed ? CLS_ERR_NOT_FOUND : CLS_OK;
+}
+
+static const cls_img_sec_t *cls_img_find(const cls_img_hdr_t *hdr, uint32_t type) {
+    for (uint32_t i = 0; i < hdr->count; i++)
+        if (hdr->sections[i].type == type) return &hdr->sections[i];
+    return NULL;
+}
+
+static cls_img_rd_t cls_img_reader(const uint8_t *map, const cls_img_sec_t *sec) {
+    cls_img_rd_t r;
+    r.p = map + sec->offset;
+    r.left = (size_t)sec->length;
+    r.failed = false;
+    return r;
+}
+
+/* Open an image and check its header and that every section lies
+ * inside the file. CLS_ERR_NOT_FOUND for a missing or damaged one */
+static cls_status_t cls_img_open(const char *path, int *out_fd, cls_img_hdr_t *hdr,
+                                 uint64_t *file_len) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return CLS_ERR_NOT_FOUND;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        pread(fd, hdr, sizeof(*hdr), 0) != (ssize_t)sizeof(*hdr) ||
+        hdr->magic != CLS_AGENT_IMG_MAGIC || hdr->version != CLS_AGENT_IMG_VERSION ||
+        hdr->count > CLS_AGENT_IMG_MAX_SECTIONS || hdr->sum != cls_img_hdr_sum(hdr)) {
+        close(fd);
+        return CLS_ERR_NOT_FOUND;
+    }
+
+    uint64_t len = (uint64_t)st.st_size;
+    for (uint32_t i = 0; i < hdr->count; i++) {
+        const cls_img_sec_t *sec = &hdr->sections[i];
+        if (sec->offset < CLS_AGENT_IMG_PAGE || sec->offset > len ||
+            sec->length > len - sec->offset) {
+            close(fd);
+            return CLS_ERR_NOT_FOUND;
+        }
+    }
+    *out_fd = fd;
+    *file_len = len;
+    return CLS_OK;
+}
+
+/* Check the sum of every section not flagged with any of skip */
+static bool cls_img_sums_ok(const uint8_t *map, const cls_img_hdr_t *hdr, uint32_t skip) {
+    for (uint32_t i = 0; i < hdr->count; i++) {
+        const cls_img_sec_t *sec = &hdr->sections[i];
+        if (!(sec->flags & skip) &&
+            cls_img_fnv(map + sec->offset, (size_t)sec->length) != sec->sum)
+            return false;
+    }
+    return true;
+}
+
+cls_status_t cls_agent_checkpoint(cls_agent_t *agent, const char *path) {
+    if (!agent || !path || !agent->initialized)
+        return CLS_ERR_INVALID;
+
+    size_t plen = strlen(path);
+    char *tmp = (char *)malloc(plen + sizeof(".tmp"));
+    if (!tmp) return CLS_ERR_NOMEM;
+    memcpy(tmp, path, plen);
+    memcpy(tmp + plen, ".tmp", sizeof(".tmp"));
+
+    int fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        free(tmp);
+        return CLS_ERR_IO;
+    }
+
+    cls_img_hdr_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    cls_img_buf_t strs, b;
+    memset(&strs, 0, sizeof(strs));
+    memset(&b, 0, sizeof(b));
+
+    /* Header page is filled in last */
+    uint64_t pos = CLS_AGENT_IMG_PAGE;
+    cls_status_t status = CLS_OK;
+    if (lseek(fd, (off_t)pos, SEEK_SET) < 0)
+        status = CLS_ERR_IO;
+
+    if (CLS_IS_OK(status)) {
+        cls_img_enc_agent(agent, &b, &strs);
+        status = cls_img_section(fd, &pos, &hdr, CLS_IMG_SEC_AGENT, &b);
+    }
+    if (CLS_IS_OK(status)) {
+        b.len = 0;
+        cls_img_enc_model(agent->cognitive, &b);
+        status = cls_img_section(fd, &pos, &hdr, CLS_IMG_SEC_MODEL, &b);
+    }
+    if (CLS_IS_OK(status) && agent->cognitive->model_data) {
+        cls_img_buf_t w = { (uint8_t *)agent->cognitive->model_data,
+                            agent->cognitive->model_size, 0, false };
+        status = cls_img_section(fd, &pos, &hdr, CLS_IMG_SEC_WEIGHTS, &w);
+        if (CLS_IS_OK(status)) hdr.sections[hdr.count - 1].flags = CLS_IMG_SEC_MAPPED;
+    }
+    if (CLS_IS_OK(status)) {
+        b.len = 0;
+        cls_img_enc_sensors(agent->perception, &b, &strs);
+        status = cls_img_section(fd, &pos, &hdr, CLS_IMG_SEC_SENSORS, &b);
+    }
+    if (CLS_IS_OK(status)) {
+        b.len = 0;
+        cls_img_enc_planner(agent->planner, &b, &strs);
+        status = cls_img_section(fd, &pos, &hdr, CLS_IMG_SEC_PLANNER, &b);
+    }
+    if (CLS_IS_OK(status)) {
+        b.len = 0;
+        cls_img_enc_actions(agent->action, &b);
+        status = cls_img_section(fd, &pos, &hdr, CLS_IMG_SEC_ACTIONS, &b);
+    }
+    if (CLS_IS_OK(status))
+        status = cls_img_section(fd, &pos, &hdr, CLS_IMG_SEC_STRINGS, &strs);
+
+    /* The memory snapshot streams straight from the pool and is summed
+     * back from the file */
+    if (CLS_IS_OK(status))
+        status = cls_img_pad(fd, &pos);
+    if (CLS_IS_OK(status)) {
+        uint64_t len = 0, sum = 0;
+        status = cls_memory_image_write(agent->memory, fd, &len);
+        if (CLS_IS_OK(status))
+            status = cls_img_sum_fd(fd, pos, len, &sum);
+        if (CLS_IS_OK(status)) {
+            cls_img_sec_t *sec = &hdr.sections[hdr.count++];
+            sec->type = CLS_IMG_SEC_MEMORY;
+            sec->flags = CLS_IMG_SEC_MAPPED;
+            sec->offset = pos;
+            sec->length = len;
+            sec->sum = sum;
+            pos += len;
+        }
+    }
+
+    if (CLS_IS_OK(status)) {
+        hdr.magic = CLS_AGENT_IMG_MAGIC;
+        hdr.version = CLS_AGENT_IMG_VERSION;
+        hdr.created_us = (uint64_t)time(NULL) * 1000000ULL;
+        hdr.sum = cls_img_hdr_sum(&hdr);
+        if (pwrite(fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) || fsync(fd) != 0)
+            status = CLS_ERR_IO;
+    }
+    close(fd);
+
+    if (CLS_IS_OK(status) && rename(tmp, path) != 0)
+        status = CLS_ERR_IO;
+    if (CLS_IS_ERR(status)) unlink(tmp);
+
+    free(b.data);
+    free(strs.data);
+    free(tmp);
+    return status;
+}
+
+cls_status_t cls_agent_restore(cls_agent_t *agent, const char *path) {
+    if (!agent || !path)
+        return CLS_ERR_INVALID;
+
+    int fd;
+    cls_img_hdr_t hdr;
+    uint64_t file_len;
+    cls_status_t status = cls_img_open(path, &fd, &hdr, &file_len);
+    if (CLS_IS_ERR(status)) return status;
+
+    const cls_img_sec_t *s_agent = cls_img_find(&hdr, CLS_IMG_SEC_AGENT);
+    const cls_img_sec_t *s_strs = cls_img_find(&hdr, CLS_IMG_SEC_STRINGS);
+    const cls_img_sec_t *s_mem = cls_img_find(&hdr, CLS_IMG_SEC_MEMORY);
+    if (!s_agent || !s_strs || !s_mem) {
+        close(fd);
+        return CLS_ERR_NOT_FOUND;
+    }
+
+    /* Small sections are parsed straight from a read-only mapping */
+    uint8_t *map = (uint8_t *)mmap(NULL, (size_t)file_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        return CLS_ERR_IO;
+    }
+
+    if (!cls_img_sums_ok(map, &hdr, CLS_IMG_SEC_MAPPED))
+        status = CLS_ERR_NOT_FOUND;
+
+    /* Names outlive the mapping in one agent-owned block */
+    char *strs = NULL;
+    size_t strs_len = (size_t)s_strs->length;
+    if (CLS_IS_OK(status)) {
+        strs = (char *)malloc(strs_len ? strs_len : 1);
+        if (strs) memcpy(strs, map + s_strs->offset, strs_len);
+        else status = CLS_ERR_NOMEM;
+    }
+
+    cls_config_t cfg = CLS_CONFIG_DEFAULT;
+    cls_agent_feed_config_t feed = CLS_AGENT_FEED_CONFIG_DEFAULT;
+    cls_img_rd_t r = cls_img_reader(map, s_agent);
+    if (CLS_IS_OK(status)) {
+        cfg.agent_id = cls_img_get_u32(&r);
+        cfg.memory_size = (size_t)cls_img_get_u64(&r);
+        cfg.max_sensors = cls_img_get_u32(&r);
+        cfg.inference_hz = cls_img_get_u32(&r);
+        cfg.security_level = (cls_security_level_t)cls_img_get_u32(&r);
+        cfg.log_level = (cls_log_level_t)cls_img_get_u32(&r);
+        cfg.agent_name = cls_img_get_str(&r, strs, strs_len);
+        if (r.failed) status = CLS_ERR_NOT_FOUND;
+    }
+
+    if (CLS_IS_OK(status))
+        status = cls_agent_setup(agent, &cfg, fd, s_mem->offset, s_mem->length);
+    if (CLS_IS_ERR(status)) {
+        free(strs);
+        munmap(map, (size_t)file_len);
+        close(fd);
+        return status;
+    }
+    agent->image_strings = strs;
+
+    agent->cycle_count = cls_img_get_u64(&r);
+    agent->uptime_us = cls_img_get_u64(&r);
+    agent->percepts_dropped = cls_img_get_u64(&r);
+    agent->actions_unhandled = cls_img_get_u64(&r);
+    agent->last_decision.action_id = cls_img_get_u32(&r);
+    agent->last_decision.confidence = cls_img_get_f32(&r);
+    agent->last_decision.priority = cls_img_get_u32(&r);
+    feed.depth = cls_img_get_u32(&r);
+    feed.payload_max = cls_img_get_u32(&r);
+    feed.drain_batch = cls_img_get_u32(&r);
+    feed.overflow = (cls_agent_feed_overflow_t)cls_img_get_u32(&r);
+    if (cls_img_get_u32(&r) != CLS_AGENT_STAGE_COUNT) r.failed = true;
+    cls_img_get(&r, agent->stages, sizeof(agent->stages));
+    cls_img_get(&r, &agent->run_stats, sizeof(agent->run_stats));
+    if (r.failed) status = CLS_ERR_NOT_FOUND;
+
+    if (CLS_IS_OK(status))
+        status = cls_agent_feed_configure(agent, &feed);
+
+    /* Weights get their own private mapping that lives with the agent */
+    const cls_img_sec_t *sec = cls_img_find(&hdr, CLS_IMG_SEC_WEIGHTS);
+    if (CLS_IS_OK(status) && sec && sec->length > 0) {
+        void *w = mmap(NULL, (size_t)sec->length, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                       fd, (off_t)sec->offset);
+        if (w == MAP_FAILED) {
+            status = CLS_ERR_IO;
+        } else {
+            agent->image_model = w;
+            agent->image_model_len = (size_t)sec->length;
+        }
+    }
+    sec = cls_img_find(&hdr, CLS_IMG_SEC_MODEL);
+    if (CLS_IS_OK(status) && sec) {
+        r = cls_img_reader(map, sec);
+        status = cls_img_dec_model(agent->cognitive, &r, agent->image_model,
+                                   agent->image_model_len);
+    }
+    sec = cls_img_find(&hdr, CLS_IMG_SEC_SENSORS);
+    if (CLS_IS_OK(status) && sec) {
+        r = cls_img_reader(map, sec);
+        status = cls_img_dec_sensors(agent->perception, &r, strs, strs_len);
+    }
+    sec = cls_img_find(&hdr, CLS_IMG_SEC_PLANNER);
+    if (CLS_IS_OK(status) && sec) {
+        r = cls_img_reader(map, sec);
+        status = cls_img_dec_planner(agent->planner, &r, strs, strs_len);
+    }
+    sec = cls_img_find(&hdr, CLS_IMG_SEC_ACTIONS);
+    if (CLS_IS_OK(status) && sec) {
+        r = cls_img_reader(map, sec);
+        status = cls_img_dec_actions(agent->action, &r);
+    }
+
+    munmap(map, (size_t)file_len);
+    close(fd);
+
+    if (CLS_IS_ERR(status)) {
+        cls_agent_log(agent, CLS_LOG_ERROR, "CORE", "Agent image restore failed");
+        cls_agent_destroy(agent);
+        return status;
+    }
+
+    cls_agent_log(agent, CLS_LOG_INFO, "CORE", "Agent restored from image. Status: READY");
+    return CLS_OK;
+}
+
+cls_status_t cls_agent_image_verify(const char *path) {
+    if (!path) return CLS_ERR_INVALID;
+
+    int fd;
+    cls_img_hdr_t hdr;
+    uint64_t file_len;
+    cls_status_t status = cls_img_open(path, &fd, &hdr, &file_len);
+    if (CLS_IS_ERR(status)) return status;
+
+    uint8_t *map = (uint8_t *)mmap(NULL, (size_t)file_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return CLS_ERR_IO;
+
+    status = cls_img_sums_ok(map, &hdr, 0) ? CLS_OK : CLS_ERR_NOT_FOUND;
+    munmap(map, (size_t)file_len);
+    return status;
+}
+
 const char *cls_version(void) {
     return CLS_VERSION_STRING;
 }
@@ -0,0 +1,52 @@
+/*
+ * ClawLobstars - Latency Histogram Internals
+ * Log-linear bucket math shared by the agent's phase histograms, the
+ * runtime's lag histogram and the memory benchmark
+ */
+
+#ifndef CLS_HIST_H
+#define CLS_HIST_H
+
+#include <stdint.h>
+
+/* Values below 2^bits land in their own bucket; above that each power of
+ * two is split into 2^bits equal buckets, so a bucket is within about
+ * 100 / 2^bits percent of any value in it. Counts live in a plain
+ * uint64_t array owned by the caller. */
+
+/* Bucket for ns, clamped to the last of nbuckets */
+static inline uint32_t cls_hist_index(uint64_t ns, uint32_t bits, uint32_t nbuckets) {
+    uint32_t sub = 1u << bits;
+    if (ns < sub) return (uint32_t)ns;
+    uint32_t msb = 63u - (uint32_t)__builtin_clzll(ns);
+    uint32_t idx = (msb - bits + 1) * sub + ((uint32_t)(ns >> (msb - bits)) & (sub - 1));
+    return idx < nbuckets ? idx : nbuckets - 1;
+}
+
+/* Midpoint of a bucket's range */
+static inline uint64_t cls_hist_value(uint32_t idx, uint32_t bits) {
+    uint32_t sub = 1u << bits;
+    if (idx < sub) return idx;
+    uint32_t msb = idx / sub + bits - 1;
+    uint64_t width = 1ULL << (msb - bits);
+    return (uint64_t)(sub + idx % sub) * width + width / 2;
+}
+
+/* Value at permille (500 = p50, 999 = p99.9) of count samples, capped at
+ * the largest one seen */
+static inline uint64_t cls_hist_pct(const uint64_t *buckets, uint32_t nbuckets,
+                                    uint32_t bits, uint64_t count, uint64_t max,
+                                    uint32_t permille) {
+    if (count == 0) return 0;
+    uint64_t rank = (count * permille + 999) / 1000, seen = 0;
+    for (uint32_t i = 0; i < nbuckets; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            uint64_t v = cls_hist_value(i, bits);
+            return v < max ? v : max;
+        }
+    }
+    return max;
+}
+
+#endif /* CLS_HIST_H */
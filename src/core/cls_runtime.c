@@ -0,0 +1,518 @@
+/*
+ * ClawLobstars - Agent Runtime
+ * Work-stealing pool that steps hosted agents at their inference rate
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include "../include/cls_framework.h"
+#include "cls_hist.h"
+
+/* ============================================================
+ * Internal Helpers
+ * ============================================================ */
+
+#define CLS_RT_NIL              0xFFFFFFFFu
+#define CLS_RT_IDLE_NS          500000ULL   /* Default idle sleep cap */
+#define CLS_RT_HIST_BITS        3           /* 8 lag buckets per power of two, ~12% */
+#define CLS_RT_HIST_BUCKETS     (62u << CLS_RT_HIST_BITS)
+
+#define CLS_RT_LOAD(p)          __atomic_load_n((p), __ATOMIC_RELAXED)
+#define CLS_RT_STORE(p, v)      __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define CLS_RT_BUMP(p, n)       CLS_RT_STORE((p), CLS_RT_LOAD(p) + (n))
+
+/* Each worker owns a release heap of the slots it will step next and a
+ * deque of slots already due. The owner moves due slots from heap to
+ * deque only once its deque is empty, so a batch finishes before newer
+ * releases join; idle workers steal from the other end. A slot that
+ * falls due while its owner is busy stepping would wait in the heap, so
+ * an idle worker that finds no deque to steal from also takes due slots
+ * off other heaps, under the heap's lock. A slot is in exactly one heap
+ * or deque, or being stepped, so an agent never runs on two workers at
+ * once, and whoever steps it keeps it afterwards. */
+struct cls_runtime_worker {
+    int64_t             top;            /* Thieves take here */
+    uint8_t             pad0[56];
+    int64_t             bottom;         /* Owner pushes and takes here */
+    uint8_t             pad1[56];
+    uint32_t           *deque;
+    uint32_t            mask;
+    uint32_t           *heap;
+    uint32_t            heap_count;
+    uint64_t            heap_next_ns;   /* Earliest release, UINT64_MAX if none */
+    pthread_mutex_t     heap_lock;      /* Owner and heap thieves */
+    uint32_t            id;
+    uint32_t            victim;         /* Next worker to try stealing from */
+    cls_runtime_t      *rt;
+    pthread_t           thread;
+    bool                started;
+
+    /* Counters, written by the owner and read by cls_runtime_stats */
+    uint64_t            steps;
+    uint64_t            steps_failed;
+    uint64_t            steals;
+    uint64_t            misses;
+    uint64_t            skipped;
+    uint64_t            lag_total;
+    uint64_t            lag_max;
+    uint64_t            hist[CLS_RT_HIST_BUCKETS];
+};
+
+static uint64_t cls_rt_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void cls_rt_sleep_ns(uint64_t ns) {
+    struct timespec ts = { (time_t)(ns / 1000000000ULL), (long)(ns % 1000000000ULL) };
+    nanosleep(&ts, NULL);
+}
+
+/* ---- Release heap (under heap_lock) ---- */
+
+static bool cls_rt_before(const cls_runtime_t *rt, uint32_t a, uint32_t b) {
+    return rt->slots[a].release_ns < rt->slots[b].release_ns;
+}
+
+static void cls_rt_heap_push(cls_runtime_worker_t *w, uint32_t idx) {
+    uint32_t i = w->heap_count++;
+    while (i > 0) {
+        uint32_t parent = (i - 1) / 2;
+        if (!cls_rt_before(w->rt, idx, w->heap[parent])) break;
+        w->heap[i] = w->heap[parent];
+        i = parent;
+    }
+    w->heap[i] = idx;
+}
+
+static uint32_t cls_rt_heap_pop(cls_runtime_worker_t *w) {
+    uint32_t top = w->heap[0];
+    uint32_t last = w->heap[--w->heap_count];
+    uint32_t i = 0;
+
+    for (;;) {
+        uint32_t child = 2 * i + 1;
+        if (child >= w->heap_count) break;
+        if (child + 1 < w->heap_count && cls_rt_before(w->rt, w->heap[child + 1], w->heap[child]))
+            child++;
+        if (!cls_rt_before(w->rt, w->heap[child], last)) break;
+        w->heap[i] = w->heap[child];
+        i = child;
+    }
+    if (w->heap_count > 0) w->heap[i] = last;
+    return top;
+}
+
+/* Let thieves check for due slots without taking the lock */
+static void cls_rt_heap_publish(cls_runtime_worker_t *w) {
+    CLS_RT_STORE(&w->heap_next_ns, w->heap_count > 0 ?
+                 w->rt->slots[w->heap[0]].release_ns : UINT64_MAX);
+}
+
+/* ---- Chase-Lev deque ---- */
+
+static void cls_rt_push(cls_runtime_worker_t *w, uint32_t idx) {
+    int64_t b = CLS_RT_LOAD(&w->bottom);
+    CLS_RT_STORE(&w->deque[b & w->mask], idx);
+    __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELEASE);
+}
+
+static uint32_t cls_rt_take(cls_runtime_worker_t *w) {
+    int64_t b = CLS_RT_LOAD(&w->bottom) - 1;
+    CLS_RT_STORE(&w->bottom, b);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t t = CLS_RT_LOAD(&w->top);
+
+    if (t > b) {
+        CLS_RT_STORE(&w->bottom, b + 1);
+        return CLS_RT_NIL;
+    }
+
+    uint32_t idx = CLS_RT_LOAD(&w->deque[b & w->mask]);
+    if (t == b) {
+        /* Last one: race any thief for it */
+        if (!__atomic_compare_exchange_n(&w->top, &t, t + 1, false,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+            idx = CLS_RT_NIL;
+        CLS_RT_STORE(&w->bottom, b + 1);
+    }
+    return idx;
+}
+
+static uint32_t cls_rt_steal_from(cls_runtime_worker_t *victim) {
+    int64_t t = __atomic_load_n(&victim->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t b = __atomic_load_n(&victim->bottom, __ATOMIC_ACQUIRE);
+    if (t >= b) return CLS_RT_NIL;
+
+    uint32_t idx = CLS_RT_LOAD(&victim->deque[t & victim->mask]);
+    if (!__atomic_compare_exchange_n(&victim->top, &t, t + 1, false,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        return CLS_RT_NIL;
+    return idx;
+}
+
+/* Take a released slot its busy owner has not moved to its deque yet */
+static uint32_t cls_rt_steal_due(cls_runtime_worker_t *victim, uint64_t now) {
+    if (CLS_RT_LOAD(&victim->heap_next_ns) > now) return CLS_RT_NIL;
+    if (pthread_mutex_trylock(&victim->heap_lock) != 0) return CLS_RT_NIL;
+
+    uint32_t idx = CLS_RT_NIL;
+    if (victim->heap_count > 0 && victim->rt->slots[victim->heap[0]].release_ns <= now) {
+        idx = cls_rt_heap_pop(victim);
+        cls_rt_heap_publish(victim);
+    }
+    pthread_mutex_unlock(&victim->heap_lock);
+    return idx;
+}
+
+/* Deques first, then heaps whose due slots are waiting on their owner */
+static uint32_t cls_rt_steal(cls_runtime_worker_t *w, uint64_t now) {
+    cls_runtime_t *rt = w->rt;
+    for (uint32_t n = 1; n < rt->worker_count; n++) {
+        w->victim = (w->victim + 1) % rt->worker_count;
+        if (w->victim == w->id) continue;
+        uint32_t idx = cls_rt_steal_from(&rt->workers[w->victim]);
+        if (idx != CLS_RT_NIL) return idx;
+    }
+    for (uint32_t n = 1; n < rt->worker_count; n++) {
+        uint32_t v = (w->id + n) % rt->worker_count;
+        uint32_t idx = cls_rt_steal_due(&rt->workers[v], now);
+        if (idx != CLS_RT_NIL) return idx;
+    }
+    return CLS_RT_NIL;
+}
+
+/* Earliest release on any heap, for the idle sleep */
+static uint64_t cls_rt_next_release(const cls_runtime_t *rt) {
+    uint64_t next = UINT64_MAX;
+    for (uint32_t i = 0; i < rt->worker_count; i++)
+        next = CLS_MIN(next, CLS_RT_LOAD(&rt->workers[i].heap_next_ns));
+    return next;
+}
+
+/* ---- Worker ---- */
+
+/* Move every released slot from the heap to the deque */
+static uint32_t cls_rt_refill(cls_runtime_worker_t *w, uint64_t now) {
+    uint32_t moved = 0;
+    if (CLS_RT_LOAD(&w->heap_next_ns) > now) return 0;
+
+    pthread_mutex_lock(&w->heap_lock);
+    while (w->heap_count > 0 && w->rt->slots[w->heap[0]].release_ns <= now) {
+        cls_rt_push(w, cls_rt_heap_pop(w));
+        moved++;
+    }
+    cls_rt_heap_publish(w);
+    pthread_mutex_unlock(&w->heap_lock);
+    return moved;
+}
+
+static void cls_rt_run(cls_runtime_worker_t *w, uint32_t idx) {
+    cls_runtime_slot_t *slot = &w->rt->slots[idx];
+    uint64_t start = cls_rt_time_ns();
+    uint64_t lag = start > slot->release_ns ? start - slot->release_ns : 0;
+
+    cls_status_t status = cls_agent_step(slot->agent);
+    uint64_t end = cls_rt_time_ns();
+
+    CLS_RT_BUMP(&slot->steps, 1);
+    CLS_RT_STORE(&slot->last_lag_ns, lag);
+    if (lag > CLS_RT_LOAD(&slot->max_lag_ns)) CLS_RT_STORE(&slot->max_lag_ns, lag);
+    CLS_RT_BUMP(&w->steps, 1);
+    CLS_RT_BUMP(&w->lag_total, lag);
+    CLS_RT_BUMP(&w->hist[cls_hist_index(lag, CLS_RT_HIST_BITS, CLS_RT_HIST_BUCKETS)], 1);
+    if (lag > CLS_RT_LOAD(&w->lag_max)) CLS_RT_STORE(&w->lag_max, lag);
+    if (CLS_IS_ERR(status)) {
+        CLS_RT_BUMP(&slot->steps_failed, 1);
+        CLS_RT_BUMP(&w->steps_failed, 1);
+    }
+
+    uint64_t next = end;
+    if (slot->period_ns > 0) {
+        next = slot->release_ns + slot->period_ns;
+        if (end > next) {
+            CLS_RT_BUMP(&slot->deadline_misses, 1);
+            CLS_RT_BUMP(&w->misses, 1);
+        }
+        /* A whole period behind: drop the missed releases, don't burst */
+        if (end >= next + slot->period_ns) {
+            uint64_t behind = (end - next) / slot->period_ns;
+            next += behind * slot->period_ns;
+            CLS_RT_BUMP(&slot->skipped, behind);
+            CLS_RT_BUMP(&w->skipped, behind);
+        }
+    }
+    pthread_mutex_lock(&w->heap_lock);
+    slot->release_ns = next;
+    cls_rt_heap_push(w, idx);
+    cls_rt_heap_publish(w);
+    pthread_mutex_unlock(&w->heap_lock);
+}
+
+static void *cls_rt_worker(void *arg) {
+    cls_runtime_worker_t *w = (cls_runtime_worker_t *)arg;
+    cls_runtime_t *rt = w->rt;
+
+    while (__atomic_load_n(&rt->running, __ATOMIC_ACQUIRE)) {
+        uint32_t idx = cls_rt_take(w);
+        if (idx == CLS_RT_NIL) {
+            uint64_t now = cls_rt_time_ns();
+            if (cls_rt_refill(w, now) > 0) continue;
+
+            idx = cls_rt_steal(w, now);
+            if (idx == CLS_RT_NIL) {
+                uint64_t wait = rt->idle_ns;
+                uint64_t next = cls_rt_next_release(rt);
+                if (next > now) wait = CLS_MIN(wait, next - now);
+                cls_rt_sleep_ns(wait);
+                continue;
+            }
+            CLS_RT_BUMP(&w->steals, 1);
+        }
+        cls_rt_run(w, idx);
+    }
+    return NULL;
+}
+
+static void cls_rt_pin(cls_runtime_t *rt, cls_runtime_worker_t *w) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus <= 0) return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET((int)(w->id % (uint32_t)cpus), &set);
+    if (pthread_setaffinity_np(w->thread, sizeof(set), &set) == 0)
+        rt->pinned++;
+}
+
+static void cls_rt_join(cls_runtime_t *rt) {
+    __atomic_store_n(&rt->running, 0, __ATOMIC_RELEASE);
+    for (uint32_t i = 0; i < rt->worker_count; i++) {
+        if (!rt->workers[i].started) continue;
+        pthread_join(rt->workers[i].thread, NULL);
+        rt->workers[i].started = false;
+    }
+    rt->stopped_ns = cls_rt_time_ns();
+}
+
+/* ============================================================
+ * API Implementation
+ * ============================================================ */
+
+cls_status_t cls_runtime_init(cls_runtime_t *rt, const cls_runtime_config_t *cfg) {
+    if (!rt || !cfg || cfg->max_agents == 0) return CLS_ERR_INVALID;
+
+    memset(rt, 0, sizeof(cls_runtime_t));
+
+    uint32_t workers = cfg->workers;
+    if (workers == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cpus > 0 ? (uint32_t)cpus : 1;
+    }
+    workers = CLS_MIN(workers, CLS_RUNTIME_MAX_WORKERS);
+
+    uint32_t cap = 1;
+    while (cap < cfg->max_agents) cap <<= 1;
+
+    rt->slots = (cls_runtime_slot_t *)calloc(cfg->max_agents, sizeof(cls_runtime_slot_t));
+    rt->workers = (cls_runtime_worker_t *)calloc(workers, sizeof(cls_runtime_worker_t));
+    if (!rt->slots || !rt->workers) {
+        cls_runtime_destroy(rt);
+        return CLS_ERR_NOMEM;
+    }
+    rt->worker_count = workers;
+
+    for (uint32_t i = 0; i < workers; i++) {
+        cls_runtime_worker_t *w = &rt->workers[i];
+        w->deque = (uint32_t *)calloc(cap, sizeof(uint32_t));
+        w->heap = (uint32_t *)calloc(cfg->max_agents, sizeof(uint32_t));
+        if (!w->deque || !w->heap) {
+            cls_runtime_destroy(rt);
+            return CLS_ERR_NOMEM;
+        }
+        if (pthread_mutex_init(&w->heap_lock, NULL) != 0) {
+            cls_runtime_destroy(rt);
+            return CLS_ERR_INTERNAL;
+        }
+        w->mask = cap - 1;
+        w->id = i;
+        w->victim = i;
+        w->rt = rt;         /* Marks heap_lock initialised */
+    }
+
+    rt->max_agents = cfg->max_agents;
+    rt->idle_ns = cfg->idle_us ? (uint64_t)cfg->idle_us * 1000ULL : CLS_RT_IDLE_NS;
+    rt->pin = cfg->pin;
+    rt->initialized = true;
+    return CLS_OK;
+}
+
+cls_status_t cls_runtime_add(cls_runtime_t *rt, cls_agent_t *agent) {
+    if (!rt || !agent || !rt->initialized) return CLS_ERR_INVALID;
+    if (!agent->initialized) return CLS_ERR_STATE;
+    if (__atomic_load_n(&rt->running, __ATOMIC_ACQUIRE)) return CLS_ERR_BUSY;
+    if (rt->slot_count >= rt->max_agents) return CLS_ERR_OVERFLOW;
+
+    for (uint32_t i = 0; i < rt->slot_count; i++)
+        if (rt->slots[i].agent == agent) return CLS_ERR_INVALID;
+
+    cls_runtime_slot_t *slot = &rt->slots[rt->slot_count++];
+    memset(slot, 0, sizeof(*slot));
+    slot->agent = agent;
+    slot->period_ns = agent->config.inference_hz ?
+                      1000000000ULL / agent->config.inference_hz : 0;
+    return CLS_OK;
+}
+
+cls_status_t cls_runtime_remove(cls_runtime_t *rt, cls_agent_t *agent) {
+    if (!rt || !agent || !rt->initialized) return CLS_ERR_INVALID;
+    if (__atomic_load_n(&rt->running, __ATOMIC_ACQUIRE)) return CLS_ERR_BUSY;
+
+    for (uint32_t i = 0; i < rt->slot_count; i++) {
+        if (rt->slots[i].agent != agent) continue;
+        rt->slots[i] = rt->slots[--rt->slot_count];
+        return CLS_OK;
+    }
+    return CLS_ERR_NOT_FOUND;
+}
+
+cls_status_t cls_runtime_start(cls_runtime_t *rt) {
+    if (!rt || !rt->initialized) return CLS_ERR_INVALID;
+    if (__atomic_load_n(&rt->running, __ATOMIC_ACQUIRE)) return CLS_ERR_BUSY;
+
+    uint64_t now = cls_rt_time_ns();
+
+    /* Fresh counters; spread the agents round-robin, all released now */
+    for (uint32_t i = 0; i < rt->worker_count; i++) {
+        cls_runtime_worker_t *w = &rt->workers[i];
+        w->top = w->bottom = 0;
+        w->heap_count = 0;
+        w->steps = w->steps_failed = w->steals = 0;
+        w->misses = w->skipped = w->lag_total = w->lag_max = 0;
+        memset(w->hist, 0, sizeof(w->hist));
+    }
+    for (uint32_t i = 0; i < rt->slot_count; i++) {
+        cls_runtime_slot_t *slot = &rt->slots[i];
+        cls_agent_t *agent = slot->agent;
+        memset(slot, 0, sizeof(*slot));
+        slot->agent = agent;
+        slot->period_ns = agent->config.inference_hz ?
+                          1000000000ULL / agent->config.inference_hz : 0;
+        slot->release_ns = now;
+        cls_rt_heap_push(&rt->workers[i % rt->worker_count], i);
+    }
+    for (uint32_t i = 0; i < rt->worker_count; i++)
+        cls_rt_heap_publish(&rt->workers[i]);
+
+    rt->pinned = 0;
+    rt->started_ns = now;
+    rt->stopped_ns = 0;
+    __atomic_store_n(&rt->running, 1, __ATOMIC_RELEASE);
+
+    for (uint32_t i = 0; i < rt->worker_count; i++) {
+        cls_runtime_worker_t *w = &rt->workers[i];
+        if (pthread_create(&w->thread, NULL, cls_rt_worker, w) != 0) {
+            cls_rt_join(rt);
+            return CLS_ERR_INTERNAL;
+        }
+        w->started = true;
+        if (rt->pin) cls_rt_pin(rt, w);
+    }
+    return CLS_OK;
+}
+
+cls_status_t cls_runtime_stop(cls_runtime_t *rt) {
+    if (!rt || !rt->initialized) return CLS_ERR_INVALID;
+    if (!__atomic_load_n(&rt->running, __ATOMIC_ACQUIRE)) return CLS_ERR_STATE;
+
+    cls_rt_join(rt);
+    return CLS_OK;
+}
+
+cls_status_t cls_runtime_stats(const cls_runtime_t *rt, cls_runtime_stats_t *out) {
+    if (!rt || !out || !rt->initialized) return CLS_ERR_INVALID;
+
+    memset(out, 0, sizeof(cls_runtime_stats_t));
+    out->agents = rt->slot_count;
+    out->workers = rt->worker_count;
+    out->pinned = rt->pinned;
+
+    uint64_t hist[CLS_RT_HIST_BUCKETS];
+    uint64_t lag_total = 0;
+    memset(hist, 0, sizeof(hist));
+
+    for (uint32_t i = 0; i < rt->worker_count; i++) {
+        const cls_runtime_worker_t *w = &rt->workers[i];
+        out->steps += CLS_RT_LOAD(&w->steps);
+        out->steps_failed += CLS_RT_LOAD(&w->steps_failed);
+        out->steals += CLS_RT_LOAD(&w->steals);
+        out->deadline_misses += CLS_RT_LOAD(&w->misses);
+        out->skipped += CLS_RT_LOAD(&w->skipped);
+        lag_total += CLS_RT_LOAD(&w->lag_total);
+        out->lag_max_ns = CLS_MAX(out->lag_max_ns, CLS_RT_LOAD(&w->lag_max));
+        for (uint32_t b = 0; b < CLS_RT_HIST_BUCKETS; b++)
+            hist[b] += CLS_RT_LOAD(&w->hist[b]);
+    }
+
+    /* Histogram and totals may be a step apart while running */
+    uint64_t counted = 0;
+    for (uint32_t b = 0; b < CLS_RT_HIST_BUCKETS; b++) counted += hist[b];
+    out->lag_avg_ns = counted ? lag_total / counted : 0;
+    out->lag_p50_ns = cls_hist_pct(hist, CLS_RT_HIST_BUCKETS, CLS_RT_HIST_BITS,
+                                   counted, out->lag_max_ns, 500);
+    out->lag_p99_ns = cls_hist_pct(hist, CLS_RT_HIST_BUCKETS, CLS_RT_HIST_BITS,
+                                   counted, out->lag_max_ns, 990);
+
+    if (rt->started_ns) {
+        uint64_t end = __atomic_load_n(&rt->running, __ATOMIC_ACQUIRE) ?
+                       cls_rt_time_ns() : rt->stopped_ns;
+        if (end > rt->started_ns)
+            out->steps_per_sec = (double)out->steps * 1e9 / (double)(end - rt->started_ns);
+    }
+    return CLS_OK;
+}
+
+cls_status_t cls_runtime_agent_stats(const cls_runtime_t *rt, const cls_agent_t *agent,
+                                     cls_runtime_slot_t *out) {
+    if (!rt || !agent || !out || !rt->initialized) return CLS_ERR_INVALID;
+
+    for (uint32_t i = 0; i < rt->slot_count; i++) {
+        const cls_runtime_slot_t *slot = &rt->slots[i];
+        if (slot->agent != agent) continue;
+
+        out->agent = slot->agent;
+        out->period_ns = slot->period_ns;
+        out->release_ns = 0;            /* Owned by the stepping worker */
+        out->steps = CLS_RT_LOAD(&slot->steps);
+        out->steps_failed = CLS_RT_LOAD(&slot->steps_failed);
+        out->deadline_misses = CLS_RT_LOAD(&slot->deadline_misses);
+        out->skipped = CLS_RT_LOAD(&slot->skipped);
+        out->last_lag_ns = CLS_RT_LOAD(&slot->last_lag_ns);
+        out->max_lag_ns = CLS_RT_LOAD(&slot->max_lag_ns);
+        return CLS_OK;
+    }
+    return CLS_ERR_NOT_FOUND;
+}
+
+void cls_runtime_destroy(cls_runtime_t *rt) {
+    if (!rt) return;
+
+    if (rt->workers) {
+        if (__atomic_load_n(&rt->running, __ATOMIC_ACQUIRE)) cls_rt_join(rt);
+        for (uint32_t i = 0; i < rt->worker_count; i++) {
+            free(rt->workers[i].deque);
+            free(rt->workers[i].heap);
+            if (rt->workers[i].rt) pthread_mutex_destroy(&rt->workers[i].heap_lock);
+        }
+    }
+    free(rt->workers);
+    free(rt->slots);
+    memset(rt, 0, sizeof(cls_runtime_t));
+}
@@ -69,6 +69,9 @@ cls_status_t cls_action_init(cls_action_exec_t *exec, uint32_t max_handlers, uin
 cls_status_t cls_action_register(cls_action_exec_t *exec, const cls_action_handler_t *handler);
 cls_status_t cls_action_unregister(cls_action_exec_t *exec, uint32_t action_id);
 
+/* Whether a handler is registered for action_id */
+bool cls_action_handles(const cls_action_exec_t *exec, uint32_t action_id);
+
 /* Execute an action */
 cls_status_t cls_action_execute(cls_action_exec_t *exec, uint32_t action_id,
                                  const void *params, size_t params_len,
@@ -13,6 +13,110 @@
 extern "C" {
 #endif
 
+/* Step pipeline stages, in order */
+typedef enum {
+    CLS_AGENT_STAGE_POLL    = 0,    /* Sensors -> percept ring */
+    CLS_AGENT_STAGE_DRAIN   = 1,    /* Fed frames -> percept ring */
+    CLS_AGENT_STAGE_PRUNE   = 2,    /* Memory maintenance */
+    CLS_AGENT_STAGE_INFER   = 3,    /* Percept ring -> decision ring */
+    CLS_AGENT_STAGE_PLAN    = 4,    /* Decision ring -> plan */
+    CLS_AGENT_STAGE_ACT     = 5,    /* Plan -> action executor */
+    CLS_AGENT_STAGE_COUNT
+} cls_agent_stage_t;
+
+/* Cumulative cost of one stage */
+typedef struct {
+    uint64_t    runs;
+    uint64_t    items;          /* Percepts, entries, decisions or tasks handled */
+    uint64_t    failed;         /* Rejected frames, failed inferences */
+    uint64_t    total_ns;
+    uint64_t    last_ns;
+    uint64_t    max_ns;
+} cls_agent_stage_stats_t;
+
+/* What cls_agent_feed does when the ingestion queue is full */
+typedef enum {
+    CLS_AGENT_FEED_DROP_OLDEST  = 0,    /* Discard the oldest queued frame */
+    CLS_AGENT_FEED_DROP_NEWEST  = 1,    /* Refuse the frame, CLS_ERR_OVERFLOW */
+    CLS_AGENT_FEED_BLOCK        = 2     /* Sleep until a step drains a slot */
+} cls_agent_feed_overflow_t;
+
+/* Ingestion queue configuration. A step drains no more frames than its
+ * percept ring (at least 64 slots, or twice max_sensors) has room for;
+ * the rest stay queued under the overflow policy */
+typedef struct {
+    uint32_t                    depth;          /* Frames, rounded up to a power of two */
+    uint32_t                    payload_max;    /* Largest payload accepted per frame */
+    uint32_t                    drain_batch;    /* Most frames per step, 0 = depth */
+    cls_agent_feed_overflow_t   overflow;
+} cls_agent_feed_config_t;
+
+#define CLS_AGENT_FEED_CONFIG_DEFAULT { \
+    .depth       = 256,  \
+    .payload_max = 1024, \
+    .drain_batch = 0,    \
+    .overflow    = CLS_AGENT_FEED_DROP_OLDEST \
+}
+
+typedef struct {
+    uint64_t    enqueued;
+    uint64_t    drained;
+    uint64_t    dropped;        /* Oldest discarded or newest refused */
+    uint64_t    rejected;       /* Unknown sensor, at feed or at drain */
+    uint64_t    waits;          /* Blocking feeds that found the queue full */
+    uint32_t    queued;
+} cls_agent_feed_stats_t;
+
+/* Bounded MPMC frame queue with a payload buffer per slot: feeders
+ * push, the step and drop-oldest feeders pop */
+typedef struct cls_agent_feedq cls_agent_feedq_t;
+
+/* What cls_agent_run does after a step overruns its period */
+typedef enum {
+    CLS_AGENT_OVERRUN_SKIP      = 0,    /* Drop missed releases, resume on the grid */
+    CLS_AGENT_OVERRUN_CATCHUP   = 1     /* Run missed releases back to back */
+} cls_agent_overrun_t;
+
+/* Called after every step of cls_agent_run; non-OK ends the loop */
+typedef cls_status_t (*cls_agent_tick_fn)(cls_agent_t *agent, void *ctx);
+
+/* Fixed-rate loop options */
+typedef struct {
+    uint32_t            hz;             /* 0 = config.inference_hz */
+    uint32_t            spin_us;        /* Busy-wait this long before each release */
+    cls_agent_overrun_t overrun;
+    uint32_t            max_catchup;    /* Catch-up: periods behind before skipping, 0 = no limit */
+    uint64_t            max_steps;      /* 0 = until cls_agent_run_stop */
+    cls_agent_tick_fn   on_tick;
+    void               *tick_ctx;
+} cls_agent_run_opts_t;
+
+#define CLS_AGENT_JITTER_BUCKETS    16
+
+/* Fixed-rate loop statistics. Jitter is step start minus release;
+ * bucket 0 is under 1 us, bucket i covers [2^(i-1), 2^i) us and the
+ * last one everything above. */
+typedef struct {
+    uint64_t            period_ns;
+    uint64_t            steps;
+    uint64_t            overruns;       /* Steps that ended past the next release */
+    uint64_t            skipped;        /* Releases dropped */
+    uint64_t            jitter_total_ns;
+    uint64_t            jitter_max_ns;
+    uint64_t            jitter_hist[CLS_AGENT_JITTER_BUCKETS];
+} cls_agent_run_stats_t;
+
+/* One phase's step latency, from a histogram kept in the agent's pipe */
+typedef struct {
+    uint64_t    count;
+    uint64_t    p50_ns;
+    uint64_t    p99_ns;
+    uint64_t    max_ns;
+} cls_agent_latency_t;
+
+/* Stage rings, working plan and phase histograms, sized once at init */
+typedef struct cls_agent_pipe cls_agent_pipe_t;
+
 /* Agent structure */
 struct cls_agent {
     uint32_t            id;
@@ -24,11 +128,20 @@ struct cls_agent {
     cls_memory_ctx_t   *memory;
     cls_perception_t   *perception;
     cls_cognitive_t    *cognitive;
+    cls_planner_t      *planner;
+    cls_action_exec_t  *action;
+    cls_agent_pipe_t   *pipe;
+    cls_agent_feedq_t  *feedq;
 
     /* Runtime stats */
     uint64_t            cycle_count;
     uint64_t            uptime_us;
     uint64_t            last_step_us;
+    cls_decision_t      last_decision;
+    uint64_t            percepts_dropped;   /* Overwritten before inference */
+    uint64_t            actions_unhandled;  /* Tasks skipped: no handler */
+    cls_agent_stage_stats_t stages[CLS_AGENT_STAGE_COUNT];
+    cls_agent_run_stats_t run_stats;    /* Last or current cls_agent_run */
 
     /* Callbacks */
     cls_log_fn          log_fn;
@@ -37,6 +150,10 @@ struct cls_agent {
     /* Internal state */
     bool                initialized;
     bool                shutting_down;
+    int                 run_stop;       /* Set by cls_agent_run_stop */
+    char               *image_strings;  /* Names restored from an image */
+    void               *image_model;    /* Model weights mapped from an image */
+    size_t              image_model_len;
 };
 
 /* ---- API ---- */
@@ -46,9 +163,26 @@ cls_status_t cls_agent_init(cls_agent_t *agent, const cls_config_t *cfg);
 
 /* Execute one full processing cycle:
  * perception -> cognitive -> planning -> action
+ * Percepts from polling and fed frames queue on a ring, inference
+ * turns them into decisions on a second ring, and those become one plan
+ * whose tasks run through the agent's action executor. All buffers are
+ * allocated at init, so a step does not allocate.
+ * cls_agent_init registers no action handlers: register them on
+ * agent->action with cls_action_register. A task whose action has no
+ * handler is skipped, not failed, and counted in actions_unhandled.
  */
 cls_status_t cls_agent_step(cls_agent_t *agent);
 
+/* Step at a fixed rate on absolute deadlines until stopped, max_steps
+ * is reached, or a step or the tick callback fails */
+cls_status_t cls_agent_run(cls_agent_t *agent, const cls_agent_run_opts_t *opts);
+
+/* Ask a running loop to return after its current step; safe from any
+ * thread or a signal handler */
+void cls_agent_run_stop(cls_agent_t *agent);
+
+cls_status_t cls_agent_run_stats(const cls_agent_t *agent, cls_agent_run_stats_t *out);
+
 /* Get current agent state */
 cls_agent_state_t cls_agent_get_state(const cls_agent_t *agent);
 
@@ -58,15 +192,67 @@ void cls_agent_set_logger(cls_agent_t *agent, cls_log_fn fn);
 /* Set event callback */
 void cls_agent_set_event_handler(cls_agent_t *agent, cls_event_fn fn);
 
-/* Feed input data to agent */
+/* Queue a frame for the next step; the payload is copied. Safe to call
+ * from any number of threads concurrently with cls_agent_step. The frame
+ * is not perceived here: it reaches memory, the percept ring and the
+ * event callback only when a later cls_agent_step drains it. Payloads
+ * longer than the queue's payload_max (1024 bytes unless set through
+ * cls_agent_feed_configure) are refused with CLS_ERR_OVERFLOW. Under
+ * CLS_AGENT_FEED_BLOCK a full queue puts the caller to sleep until a
+ * step drains a slot; cls_agent_shutdown wakes it with CLS_ERR_STATE.
+ * A frame whose sensor_id is not registered on agent->perception is
+ * refused with CLS_ERR_NOT_FOUND, and one whose sensor is unregistered
+ * before the drain is discarded there; both count in rejected. Do not
+ * register or unregister sensors while other threads are feeding. */
 cls_status_t cls_agent_feed(cls_agent_t *agent, const cls_frame_t *frame);
 
+/* Replace the ingestion queue, dropping queued frames. Not while other
+ * threads are feeding. */
+cls_status_t cls_agent_feed_configure(cls_agent_t *agent, const cls_agent_feed_config_t *cfg);
+
+cls_status_t cls_agent_feed_stats(const cls_agent_t *agent, cls_agent_feed_stats_t *out);
+
 /* Get last decision */
 cls_status_t cls_agent_get_decision(const cls_agent_t *agent, cls_decision_t *decision);
 
 /* Get runtime statistics */
 void cls_agent_stats(const cls_agent_t *agent, uint64_t *cycles, uint64_t *uptime_us);
 
+/* Get one pipeline stage's cumulative cost */
+cls_status_t cls_agent_stage_stats(const cls_agent_t *agent, cls_agent_stage_t stage,
+                                   cls_agent_stage_stats_t *out);
+
+/* One phase's latency percentiles since init or the last reset.
+ * CLS_ERR_STATE when the library was built with CLS_AGENT_PHASE_HIST=0
+ * or the agent is not initialised. Read from the
+ * stepping thread or between steps. */
+cls_status_t cls_agent_phase_latency(const cls_agent_t *agent, cls_agent_stage_t stage,
+                                     cls_agent_latency_t *out);
+
+/* Clear the phase histograms */
+void cls_agent_phase_reset(cls_agent_t *agent);
+
+/* Write memory, model, sensors, planner, action history and counters to
+ * path as a versioned, sectioned image (via path.tmp and rename). Not
+ * while the agent is stepping; queued frames and stage rings are not
+ * saved. */
+cls_status_t cls_agent_checkpoint(cls_agent_t *agent, const char *path);
+
+/* Initialize agent from a checkpoint image. Memory and the model
+ * weights are mapped from the file privately, in place, and page in on
+ * first touch. Sensors come back without read callbacks (see
+ * cls_perception_bind); action handlers and the logger and event
+ * callbacks must be set again. CLS_ERR_NOT_FOUND for a missing image, a
+ * damaged header, or damage in any section restore parses. The memory
+ * pool and the weights are not read here, so damage inside them is not
+ * detected; run cls_agent_image_verify first where that matters. */
+cls_status_t cls_agent_restore(cls_agent_t *agent, const char *path);
+
+/* Check every section of a checkpoint image against its sum, including
+ * the memory pool and the weights, reading the whole file.
+ * CLS_ERR_NOT_FOUND for a missing or damaged image. */
+cls_status_t cls_agent_image_verify(const char *path);
+
 /* Graceful shutdown */
 cls_status_t cls_agent_shutdown(cls_agent_t *agent);
 
@@ -60,6 +60,7 @@ struct cls_cognitive {
     cls_model_type_t    model_type;
     void               *model_data;
     size_t              model_size;
+    bool                model_owned;    /* false when attached, not copied */
     cls_model_metrics_t metrics;
     float               confidence_threshold;
     uint32_t            max_decisions;
@@ -74,6 +75,10 @@ cls_status_t cls_cognitive_init(cls_cognitive_t *cog, cls_model_type_t model_typ
 /* Load model weights from buffer */
 cls_status_t cls_cognitive_load_model(cls_cognitive_t *cog, const void *data, size_t len);
 
+/* Use weights the caller keeps alive (e.g. a mapped image) without
+ * copying; they are never freed here */
+cls_status_t cls_cognitive_attach_model(cls_cognitive_t *cog, void *data, size_t len);
+
 /* Save model weights to buffer */
 cls_status_t cls_cognitive_save_model(cls_cognitive_t *cog, void *buf, size_t *len);
 
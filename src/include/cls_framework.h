@@ -122,6 +122,7 @@ typedef struct cls_resource_mgr  cls_resource_mgr_t;
 typedef struct cls_telemetry     cls_telemetry_t;
 typedef struct cls_scheduler     cls_scheduler_t;
 typedef struct cls_network       cls_network_t;
+typedef struct cls_runtime       cls_runtime_t;
 
 /* ============================================================
  * Callback Types
@@ -204,6 +205,7 @@ typedef struct {
 #include "cls_diagnostics.h"
 #include "cls_plugin.h"
 #include "cls_agent.h"
+#include "cls_runtime.h"
 
 #ifdef __cplusplus
 }
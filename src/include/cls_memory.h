@@ -13,6 +13,15 @@
 extern "C" {
 #endif
 
+#define CLS_MEMORY_KEY_MAX      128     /* Key length limit, including NUL */
+#define CLS_MEMORY_BATCH_MAX    64      /* Entries per cursor batch */
+#define CLS_MEMORY_INLINE_MAX   48      /* Default largest value stored inside its entry */
+#define CLS_MEMORY_NS_MAX       8       /* Namespaces besides the default one */
+#define CLS_MEMORY_NS_PREFIX_MAX 32     /* Namespace prefix limit, including NUL */
+#define CLS_MEMORY_HOT_MAX      32      /* Keys kept per hot-key ranking */
+#define CLS_MEMORY_SNAPSHOT_MAX 4       /* Snapshots open at once */
+#define CLS_MEMORY_MIN_POOL     32768   /* Smallest pool_size, and namespace share */
+
 /* Memory entry metadata */
 typedef struct {
     uint32_t    hash;
@@ -21,6 +30,7 @@ typedef struct {
     uint32_t    access_count;
     uint32_t    ttl_seconds;
     size_t      data_len;
+    size_t      stored_len;     /* Bytes held; below data_len when compressed */
 } cls_mem_entry_meta_t;
 
 /* Memory context */
@@ -32,8 +42,144 @@ struct cls_memory_ctx {
     uint32_t    max_entries;    /* Maximum entries */
     uint32_t    hit_count;      /* Cache hits */
     uint32_t    miss_count;     /* Cache misses */
+    void       *store;          /* Shard directory (internal) */
+    uint32_t    shard_count;    /* Number of shards */
 };
 
+/* What a full store does with a new key */
+typedef enum {
+    CLS_MEM_EVICT_NONE      = 0,    /* Reject with CLS_ERR_OVERFLOW */
+    CLS_MEM_EVICT_CLOCK     = 1,    /* Second-chance sweep */
+    CLS_MEM_EVICT_LRU       = 2,    /* Sampled least-recently-accessed */
+    CLS_MEM_EVICT_TINYLFU   = 3     /* W-TinyLFU frequency admission */
+} cls_mem_evict_t;
+
+/* A namespace is a partition of the store for keys starting with
+ * `prefix`: it gets pool_size bytes and shard_count shards of its own,
+ * so its quota, eviction and pruning never touch another namespace's
+ * entries. A key goes to the longest prefix it starts with. */
+typedef struct {
+    const char     *prefix;         /* Non-empty, unique */
+    size_t          pool_size;      /* Carved out of cls_memory_config_t.pool_size;
+                                       at least CLS_MEMORY_MIN_POOL, leaving at
+                                       least that much for the default namespace */
+    uint32_t        shard_count;    /* Power of two; 0 = 1, or 16 if concurrent */
+    cls_mem_evict_t evict;
+    uint32_t        max_entries;    /* 0 = derived from pool_size */
+} cls_mem_ns_config_t;
+
+/* Store configuration. In concurrent mode any number of threads may call
+ * the API at once: writers lock one shard, retrieve/exists never block.
+ *
+ * With persist_path set, the store is saved as <path>.snap (a snapshot
+ * mapped back at init) plus <path>.wal (stores and deletes since). An
+ * existing snapshot's geometry, policy and namespaces override the
+ * fields here.
+ * Expiry is not logged; an evicting store logs its evictions, though
+ * replay may evict differently when it refills.
+ *
+ * Namespaces take their pool_size off the top; keys matching none of
+ * them form the default namespace (id 0), which gets the remaining bytes
+ * and the shard_count, evict and max_entries fields here. Namespace i
+ * has id i + 1.
+ *
+ * With hot_sample set, one in that many reads, misses and writes per
+ * thread (or per shard, without a reader slot) is fed to a fixed-size
+ * count-min sketch that keeps a top-k of keys and of key prefixes (up
+ * to the last ':'); see cls_memory_hot_keys.
+ *
+ * With cold_after_ms set, each prune checks a run of slots per shard and
+ * compresses values idle that long. Retrieve expands a cold value into
+ * the caller's buffer; borrow, query and cursors need a pointer, so they
+ * store it back expanded, as does a prune that finds it read again.
+ *
+ * With shm_name set (e.g. "/agents"), the pool lives in that POSIX
+ * shared-memory object and the store is concurrent. The first process
+ * to init creates and formats it; later ones attach, taking its geometry
+ * and namespaces in place of the fields here, and read and write the
+ * same entries: a value stored by one process is borrowed by another
+ * with no copy. Up to 64 processes may be attached (CLS_ERR_OVERFLOW
+ * past that); the last destroy removes the object. Hits and misses in
+ * the context, interned keys and hot-key tracking are per process;
+ * persist_path and cls_memory_snapshot_begin are not available. A
+ * process that dies inside a read is skipped. If one dies holding a
+ * shard's write lock, the next process to take that lock recovers it
+ * and counts it in lock_recoveries; the dead writer's store or delete
+ * may then be lost or half-applied in that shard, so treat its keys as
+ * suspect. */
+typedef struct {
+    size_t          pool_size;      /* Total bytes, namespaces included;
+                                       at least CLS_MEMORY_MIN_POOL */
+    uint32_t        shard_count;    /* Power of two; 0 = 1, or 16 if concurrent */
+    bool            concurrent;     /* Thread-safe mode */
+    cls_mem_evict_t evict;          /* Policy at max_entries or a full arena */
+    uint32_t        max_entries;    /* 0 = derived from pool_size */
+    const char     *persist_path;   /* NULL = volatile */
+    bool            wal_sync;       /* Stores return once their record is on disk */
+    size_t          checkpoint_bytes; /* Log size at which prune snapshots; 0 = 64MB */
+    size_t          inline_max;     /* Values up to this size skip a separate block;
+                                       0 = CLS_MEMORY_INLINE_MAX, capped at 512 */
+    uint32_t        cold_after_ms;  /* Compress values idle this long; 0 = off */
+    size_t          cold_min_bytes; /* Smallest value compressed; 0 = 256 */
+    const cls_mem_ns_config_t *namespaces; /* Up to CLS_MEMORY_NS_MAX */
+    uint32_t        ns_count;
+    uint32_t        hot_sample;     /* Track one in this many operations; 0 = off */
+    const char     *shm_name;       /* Shared-memory object; NULL = private */
+} cls_memory_config_t;
+
+#define CLS_MEMORY_CONFIG_DEFAULT { \
+    .pool_size   = 262144, /* 256KB */ \
+    .shard_count = 0,      \
+    .concurrent  = false,  \
+    .evict       = CLS_MEM_EVICT_NONE, \
+    .max_entries = 0,      \
+    .persist_path = NULL,  \
+    .wal_sync    = false,  \
+    .checkpoint_bytes = 0, \
+    .inline_max  = 0,      \
+    .cold_after_ms = 0,    \
+    .cold_min_bytes = 0,   \
+    .namespaces  = NULL,   \
+    .ns_count    = 0,      \
+    .hot_sample  = 0,      \
+    .shm_name    = NULL    \
+}
+
+/* Extended statistics. Hit/miss counts from lock-free readers are folded
+ * in batches, so they may trail by a few thousand per thread. */
+typedef struct {
+    size_t          used;
+    size_t          total;
+    uint32_t        entries;
+    uint32_t        max_entries;
+    uint64_t        hits;
+    uint64_t        misses;
+    double          hit_ratio;      /* hits / (hits + misses) */
+    uint64_t        evictions;
+    uint64_t        rejections;     /* TinyLFU candidates refused admission */
+    cls_mem_evict_t evict;
+    uint32_t        inline_entries; /* Values stored inside their entry */
+    uint32_t        spilled_entries; /* Values in a separate arena block */
+    uint32_t        cold_entries;   /* Values held compressed */
+    uint64_t        cold_bytes;     /* Their size uncompressed */
+    uint64_t        cold_stored;    /* Their size compressed */
+    uint32_t        lock_recoveries; /* Shared store: shard locks taken over from dead writers */
+} cls_memory_stats_t;
+
+/* Operations a hot-key ranking counts */
+typedef enum {
+    CLS_MEM_HOT_READS   = 0,    /* Hits from retrieve, batches and borrow */
+    CLS_MEM_HOT_MISSES  = 1,
+    CLS_MEM_HOT_WRITES  = 2     /* Successful stores */
+} cls_mem_hot_kind_t;
+
+/* One ranked key or prefix. count estimates operations (sampled ones
+ * scaled up) and is halved now and then so old traffic fades. */
+typedef struct {
+    char        key[CLS_MEMORY_KEY_MAX];
+    uint64_t    count;
+} cls_mem_hot_entry_t;
+
 /* Query structure */
 typedef struct {
     const char *key_pattern;    /* Key pattern (supports * wildcard) */
@@ -42,7 +188,9 @@ typedef struct {
     uint32_t    max_results;    /* Max results to return */
 } cls_query_t;
 
-/* Result set */
+/* Result set. With a concurrent store its entries are pinned like
+ * borrows, so key/data stay valid through overwrites and deletes until
+ * cls_memory_query_release; every such query needs one. */
 typedef struct {
     uint32_t    count;
     struct {
@@ -50,14 +198,118 @@ typedef struct {
         const void *data;
         size_t      data_len;
         cls_mem_entry_meta_t meta;
+        uint32_t    shard;      /* Internal */
+        uint32_t    ref;        /* Internal; 0 = not pinned */
     } entries[64]; /* Fixed-size result buffer */
 } cls_result_set_t;
 
+/* Pre-hashed key. From cls_memory_key_intern the string is shared by
+ * every handle to the same key and lives until the store is destroyed;
+ * from a builder it points into the builder. Treat as read-only. */
+typedef struct {
+    const char *str;
+    uint32_t    hash;
+    uint32_t    len;
+} cls_mem_key_t;
+
+/* Builds a key piece by piece, hashing as it appends */
+typedef struct {
+    char        buf[CLS_MEMORY_KEY_MAX];
+    uint32_t    len;
+    uint32_t    hash;
+    bool        overflow;       /* Key outgrew CLS_MEMORY_KEY_MAX */
+} cls_mem_key_builder_t;
+
+/* One key of a batched store or retrieve */
+typedef struct {
+    const char     *key;
+    void           *data;       /* Value to store, or buffer to retrieve into */
+    size_t          len;        /* Value length; for retrieve, buffer size in and value length out */
+    uint32_t        ttl_sec;    /* Store only; 0 = no expiry */
+    cls_status_t    status;     /* Per-key result */
+} cls_mem_batch_item_t;
+
+/* Read-only view of a stored value, valid until cls_memory_release.
+ * Overwrites, deletes and pruning leave a borrowed value in place. */
+typedef struct {
+    const void *data;
+    size_t      len;
+    uint32_t    shard;          /* Internal */
+    uint32_t    ref;            /* Internal */
+} cls_mem_borrow_t;
+
+/* Streaming query cursor. Batches come in key order and each key that
+ * stays stored for the whole scan is returned exactly once; keys stored
+ * or deleted mid-scan may or may not appear. Entries in the current batch
+ * are pinned like borrows until the next batch or close. `token` is the
+ * last key returned: pass it to cls_memory_query_open to resume. */
+typedef struct {
+    cls_memory_ctx_t *ctx;
+    char        prefix[CLS_MEMORY_KEY_MAX];
+    uint32_t    prefix_len;
+    bool        exact;          /* Pattern had no trailing '*' */
+    bool        done;
+    bool        started;        /* token holds a key */
+    uint64_t    created_after;
+    uint64_t    created_before;
+    uint32_t    batch_size;
+    char        token[CLS_MEMORY_KEY_MAX];
+    uint32_t    count;          /* Entries in the current batch */
+    struct {
+        const char *key;
+        const void *data;
+        size_t      data_len;
+        const cls_mem_entry_meta_t *meta;
+        uint32_t    shard;      /* Internal */
+        uint32_t    ref;        /* Internal */
+    } entries[CLS_MEMORY_BATCH_MAX];
+} cls_mem_cursor_t;
+
+/* Read-only view of the whole store as it stood at
+ * cls_memory_snapshot_begin, read in batches of up to
+ * CLS_MEMORY_BATCH_MAX. Each entry live (and unexpired) then comes back
+ * exactly once with the value it had then, whatever is stored or
+ * deleted meanwhile; batches go shard by shard, in key order within a
+ * shard. Writers never wait on a view: what it has yet to return is kept
+ * out of reclamation instead, so a long scan under heavy overwrites
+ * costs arena space. Batch entries are pinned until the next batch or
+ * end, and cold values are expanded into buffers the view owns. On a
+ * concurrent store one other thread may read the view. */
+typedef struct {
+    cls_memory_ctx_t *ctx;
+    uint32_t    slot;           /* Internal */
+    uint32_t    shard;          /* Internal: shard being read */
+    uint64_t    now;            /* Store clock at begin */
+    bool        done;
+    uint32_t    count;          /* Entries in the current batch */
+    struct {
+        const char *key;
+        const void *data;
+        size_t      data_len;
+        const cls_mem_entry_meta_t *meta;
+        void       *expanded;   /* Internal */
+        uint32_t    shard;      /* Internal */
+        uint32_t    ref;        /* Internal */
+    } entries[CLS_MEMORY_BATCH_MAX];
+} cls_mem_snapshot_t;
+
 /* ---- API ---- */
 
-/* Initialize memory context with given pool size */
+/* Initialize memory context with given pool size. The pool is a page
+ * arena, so anything under CLS_MEMORY_MIN_POOL bytes is CLS_ERR_INVALID. */
 cls_status_t cls_memory_init(cls_memory_ctx_t *ctx, size_t pool_size);
 
+/* Initialize with explicit configuration (sharding, concurrency) */
+cls_status_t cls_memory_init_ex(cls_memory_ctx_t *ctx, const cls_memory_config_t *cfg);
+
+/* Initialize from an image written by cls_memory_image_write, len bytes
+ * at a 4096-aligned offset in fd. The pool is mapped privately in place,
+ * so nothing is read until touched; geometry, policy and namespaces come
+ * from the image, the rest of cfg applies (persist_path and shm_name must
+ * be unset). fd may be closed afterwards. */
+cls_status_t cls_memory_init_image(cls_memory_ctx_t *ctx, const cls_memory_config_t *cfg,
+                                   int fd, uint64_t offset, uint64_t len);
+
 /* Store data with key */
 cls_status_t cls_memory_store(cls_memory_ctx_t *ctx, const char *key,
                                const void *data, size_t len);
@@ -70,6 +322,43 @@ cls_status_t cls_memory_store_ttl(cls_memory_ctx_t *ctx, const char *key,
 cls_status_t cls_memory_retrieve(cls_memory_ctx_t *ctx, const char *key,
                                   void *buf, size_t *len);
 
+/* Intern key and return its pre-hashed handle */
+cls_status_t cls_memory_key_intern(cls_memory_ctx_t *ctx, const char *key,
+                                    cls_mem_key_t *out);
+
+/* Store/retrieve through a handle, skipping the key hash and length scan */
+cls_status_t cls_memory_store_key(cls_memory_ctx_t *ctx, const cls_mem_key_t *key,
+                                   const void *data, size_t len, uint32_t ttl_sec);
+cls_status_t cls_memory_retrieve_key(cls_memory_ctx_t *ctx, const cls_mem_key_t *key,
+                                      void *buf, size_t *len);
+
+/* Key builder: begin, append strings and decimal integers, then end to
+ * get a handle into the builder (CLS_ERR_OVERFLOW if it got too long) */
+void cls_mem_key_begin(cls_mem_key_builder_t *b);
+void cls_mem_key_add(cls_mem_key_builder_t *b, const char *s);
+void cls_mem_key_add_u64(cls_mem_key_builder_t *b, uint64_t v);
+cls_status_t cls_mem_key_end(const cls_mem_key_builder_t *b, cls_mem_key_t *out);
+
+/* Store several keys: all are hashed and their slots prefetched before
+ * any is written, keys sharing a shard take its lock once, and the batch
+ * reads the clock once. Keys apply in order within a shard. Returns
+ * CLS_OK, or the first failing item's status. */
+cls_status_t cls_memory_store_batch(cls_memory_ctx_t *ctx, cls_mem_batch_item_t *items,
+                                     uint32_t count);
+
+/* Retrieve several keys under one read guard and one clock read, with
+ * every lookup's slots prefetched up front. Returns CLS_OK, or the first
+ * failing item's status (a missing key is CLS_ERR_NOT_FOUND). */
+cls_status_t cls_memory_retrieve_batch(cls_memory_ctx_t *ctx, cls_mem_batch_item_t *items,
+                                        uint32_t count);
+
+/* Borrow a value without copying; every borrow needs a release */
+cls_status_t cls_memory_borrow(cls_memory_ctx_t *ctx, const char *key,
+                                cls_mem_borrow_t *out);
+
+/* Return a borrowed value */
+void cls_memory_release(cls_memory_ctx_t *ctx, cls_mem_borrow_t *borrow);
+
 /* Check if key exists */
 bool cls_memory_exists(cls_memory_ctx_t *ctx, const char *key);
 
@@ -80,14 +369,81 @@ cls_status_t cls_memory_delete(cls_memory_ctx_t *ctx, const char *key);
 cls_status_t cls_memory_query(cls_memory_ctx_t *ctx, const cls_query_t *query,
                                cls_result_set_t *results);
 
-/* Prune expired entries */
+/* Unpin a query's results (a no-op unless the store is concurrent) */
+void cls_memory_query_release(cls_memory_ctx_t *ctx, cls_result_set_t *results);
+
+/* Open a cursor; max_results is the batch size (0 = CLS_MEMORY_BATCH_MAX).
+ * token may be NULL or a saved cursor->token to resume after that key. */
+cls_status_t cls_memory_query_open(cls_memory_ctx_t *ctx, const cls_query_t *query,
+                                    const char *token, cls_mem_cursor_t *cursor);
+
+/* Fetch the next batch; CLS_ERR_NOT_FOUND once the scan is complete */
+cls_status_t cls_memory_query_next(cls_mem_cursor_t *cursor);
+
+/* Unpin the current batch */
+void cls_memory_query_close(cls_mem_cursor_t *cursor);
+
+/* Open a consistent view of the store; CLS_ERR_BUSY when
+ * CLS_MEMORY_SNAPSHOT_MAX are already open, CLS_ERR_STATE on a shared
+ * store */
+cls_status_t cls_memory_snapshot_begin(cls_memory_ctx_t *ctx, cls_mem_snapshot_t *snap);
+
+/* Fetch the next batch; CLS_ERR_NOT_FOUND once the view is exhausted,
+ * CLS_ERR_NOMEM if an entry could not be held for it (end and retry) */
+cls_status_t cls_memory_snapshot_next(cls_mem_snapshot_t *snap);
+
+/* Release the batch and everything the view still holds */
+void cls_memory_snapshot_end(cls_mem_snapshot_t *snap);
+
+/* Prune expired entries and advance the cold sweep; a persistent store
+ * also flushes its log here and snapshots once the log passes
+ * checkpoint_bytes */
 uint32_t cls_memory_prune(cls_memory_ctx_t *ctx);
 
+/* Write a snapshot and start a fresh log (CLS_ERR_STATE if volatile) */
+cls_status_t cls_memory_checkpoint(cls_memory_ctx_t *ctx);
+
+/* Append the store's snapshot image at fd's current position; *len gets
+ * its size. Writers wait for the copy. CLS_ERR_STATE for shared-memory
+ * stores. */
+cls_status_t cls_memory_image_write(cls_memory_ctx_t *ctx, int fd, uint64_t *len);
+
+/* Force buffered log records to disk */
+cls_status_t cls_memory_flush(cls_memory_ctx_t *ctx);
+
 /* Get memory statistics */
 void cls_memory_stats(const cls_memory_ctx_t *ctx,
                        size_t *used, size_t *total, uint32_t *entries);
 
-/* Destroy and free all memory */
+/* Get extended statistics, including hit ratio and evictions */
+void cls_memory_stats_ex(const cls_memory_ctx_t *ctx, cls_memory_stats_t *out);
+
+/* Namespace id for key: the namespace it would be stored in */
+uint32_t cls_memory_ns_find(const cls_memory_ctx_t *ctx, const char *key);
+
+/* Statistics for one namespace; total is its share of the pool */
+cls_status_t cls_memory_ns_stats(const cls_memory_ctx_t *ctx, uint32_t ns,
+                                  cls_memory_stats_t *out);
+
+/* Query only one namespace's shards. cls_memory_query and cursors skip
+ * namespaces their key prefix rules out on their own. */
+cls_status_t cls_memory_ns_query(cls_memory_ctx_t *ctx, uint32_t ns,
+                                  const cls_query_t *query, cls_result_set_t *results);
+
+/* Prune expired entries and advance the cold sweep in one namespace;
+ * log maintenance is left to cls_memory_prune */
+uint32_t cls_memory_ns_prune(cls_memory_ctx_t *ctx, uint32_t ns);
+
+/* Hottest keys (or, with prefixes set, key prefixes) for one kind of
+ * operation, largest count first; returns how many were written to out.
+ * Returns 0 when tracking is off. */
+uint32_t cls_memory_hot_keys(const cls_memory_ctx_t *ctx, cls_mem_hot_kind_t kind,
+                             bool prefixes, cls_mem_hot_entry_t *out, uint32_t max);
+
+/* Forget all hot-key counts */
+void cls_memory_hot_reset(cls_memory_ctx_t *ctx);
+
+/* Destroy and free all memory, snapshotting a persistent store first */
 void cls_memory_destroy(cls_memory_ctx_t *ctx);
 
 #ifdef __cplusplus
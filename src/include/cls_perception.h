@@ -76,6 +76,11 @@ cls_status_t cls_perception_register(cls_perception_t *p, const cls_sensor_t *se
 /* Unregister a sensor */
 cls_status_t cls_perception_unregister(cls_perception_t *p, uint32_t sensor_id);
 
+/* Attach a read callback to a registered sensor, e.g. one restored
+ * from an agent image */
+cls_status_t cls_perception_bind(cls_perception_t *p, uint32_t sensor_id,
+                                 cls_sensor_read_fn read_fn, void *user_ctx);
+
 /* Process incoming data frame */
 cls_status_t cls_perception_process(cls_perception_t *p, const cls_frame_t *frame,
                                      cls_percept_t *output);
@@ -83,6 +88,10 @@ cls_status_t cls_perception_process(cls_perception_t *p, const cls_frame_t *fram
 /* Poll all active sensors */
 cls_status_t cls_perception_poll(cls_perception_t *p);
 
+/* Poll all active sensors, keeping up to max percepts in out */
+cls_status_t cls_perception_poll_into(cls_perception_t *p, cls_percept_t *out,
+                                       uint32_t max, uint32_t *count);
+
 /* Set event callback */
 void cls_perception_on_event(cls_perception_t *p, cls_event_fn callback);
 
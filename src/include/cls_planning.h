@@ -107,6 +107,20 @@ cls_goal_t  *cls_planner_get_goal(cls_planner_t *planner, uint32_t goal_id);
 cls_status_t cls_planner_generate(cls_planner_t *planner, const cls_decision_t *decisions,
                                    uint32_t decision_count, cls_plan_t **out_plan);
 
+/* Reuse a caller-owned plan (tasks/max_tasks already set): empty it and
+ * clear its plan id */
+void cls_planner_reset_plan(cls_planner_t *planner, cls_plan_t *plan);
+
+/* Append tasks for decisions to a plan without allocating; returns how
+ * many decisions were consumed (fewer once the plan is full). The first
+ * task added gives the plan its id and counts it in plans_generated */
+uint32_t cls_planner_fill(cls_planner_t *planner, cls_plan_t *plan,
+                          const cls_decision_t *decisions, uint32_t decision_count);
+
+/* Count a run plan as completed or failed once its tasks are done; plans
+ * with no tasks or still in progress are not counted */
+void cls_planner_finish_plan(cls_planner_t *planner, const cls_plan_t *plan);
+
 /* Add task to plan */
 cls_status_t cls_plan_add_task(cls_plan_t *plan, const cls_task_t *task);
 
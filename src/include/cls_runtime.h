@@ -0,0 +1,113 @@
+/*
+ * ClawLobstars - Agent Runtime
+ * Steps many agents at their configured rates on a work-stealing
+ * worker pool
+ */
+
+#ifndef CLS_RUNTIME_H
+#define CLS_RUNTIME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CLS_RUNTIME_MAX_WORKERS  64
+
+/* Runtime configuration */
+typedef struct {
+    uint32_t    max_agents;
+    uint32_t    workers;        /* 0 = one per online CPU */
+    bool        pin;            /* Pin worker i to CPU i mod CPUs */
+    uint32_t    idle_us;        /* Longest idle sleep between steal attempts, 0 = 500 */
+} cls_runtime_config_t;
+
+#define CLS_RUNTIME_CONFIG_DEFAULT { \
+    .max_agents = 256,  \
+    .workers    = 0,    \
+    .pin        = false, \
+    .idle_us    = 0     \
+}
+
+/* One hosted agent. Release is when its next step is due, one period
+ * (1 / inference_hz) after the last; it should finish within a period
+ * of release. */
+typedef struct {
+    cls_agent_t        *agent;
+    uint64_t            period_ns;      /* 0 = step whenever a worker is free */
+    uint64_t            release_ns;
+    uint64_t            steps;
+    uint64_t            steps_failed;
+    uint64_t            deadline_misses;
+    uint64_t            skipped;        /* Releases dropped after falling a period behind */
+    uint64_t            last_lag_ns;
+    uint64_t            max_lag_ns;
+} cls_runtime_slot_t;
+
+/* Chase-Lev deque of slot indices plus the owner's release heap */
+typedef struct cls_runtime_worker cls_runtime_worker_t;
+
+/* Runtime context */
+struct cls_runtime {
+    cls_runtime_slot_t     *slots;
+    uint32_t                slot_count;
+    uint32_t                max_agents;
+    cls_runtime_worker_t   *workers;
+    uint32_t                worker_count;
+    bool                    pin;
+    uint32_t                pinned;         /* Workers whose affinity was set */
+    uint64_t                idle_ns;
+    uint64_t                started_ns;
+    uint64_t                stopped_ns;
+    int                     running;
+    bool                    initialized;
+};
+
+/* Aggregate statistics for the current (or last) run */
+typedef struct {
+    uint32_t    agents;
+    uint32_t    workers;
+    uint32_t    pinned;
+    uint64_t    steps;
+    uint64_t    steps_failed;
+    double      steps_per_sec;
+    uint64_t    steals;
+    uint64_t    deadline_misses;
+    uint64_t    skipped;
+    uint64_t    lag_avg_ns;     /* Step start minus release */
+    uint64_t    lag_p50_ns;
+    uint64_t    lag_p99_ns;
+    uint64_t    lag_max_ns;
+} cls_runtime_stats_t;
+
+/* ---- API ---- */
+
+cls_status_t cls_runtime_init(cls_runtime_t *rt, const cls_runtime_config_t *cfg);
+
+/* Host or drop an initialized agent; only while stopped */
+cls_status_t cls_runtime_add(cls_runtime_t *rt, cls_agent_t *agent);
+cls_status_t cls_runtime_remove(cls_runtime_t *rt, cls_agent_t *agent);
+
+/* Start the workers; every agent is released immediately. An agent is
+ * only ever stepped by one worker at a time. */
+cls_status_t cls_runtime_start(cls_runtime_t *rt);
+
+/* Stop and join the workers; steps in progress finish first */
+cls_status_t cls_runtime_stop(cls_runtime_t *rt);
+
+cls_status_t cls_runtime_stats(const cls_runtime_t *rt, cls_runtime_stats_t *out);
+
+/* Copy of one agent's counters */
+cls_status_t cls_runtime_agent_stats(const cls_runtime_t *rt, const cls_agent_t *agent,
+                                     cls_runtime_slot_t *out);
+
+void cls_runtime_destroy(cls_runtime_t *rt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CLS_RUNTIME_H */
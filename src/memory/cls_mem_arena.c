@@ -0,0 +1,268 @@
+/*
+ * ClawLobstars - Memory Arena Implementation
+ * Buddy page allocator with size-class slabs, all inside one reservation
+ */
+
+#include <string.h>
+#include "cls_mem_internal.h"
+
+/* ============================================================
+ * Size Classes
+ * ============================================================ */
+
+static const uint16_t cls_class_size[CLS_MEM_CLASS_COUNT] = {
+    16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048
+};
+
+static uint32_t cls_size_class(size_t len) {
+    uint32_t c = 0;
+    while (cls_class_size[c] < len) c++;
+    return c;
+}
+
+static uint32_t cls_pages_order(size_t len) {
+    size_t pages = (len + CLS_MEM_PAGE_SIZE - 1) >> CLS_MEM_PAGE_SHIFT;
+    uint32_t order = 0;
+    while (((size_t)1 << order) < pages) order++;
+    return order;
+}
+
+/* ============================================================
+ * Internal Helpers
+ * ============================================================ */
+
+static cls_mem_page_t *cls_arena_desc(cls_mem_arena_t *arena) {
+    return (cls_mem_page_t *)((uint8_t *)arena + arena->desc_offset);
+}
+
+static uint8_t *cls_page_addr(cls_mem_arena_t *arena, uint32_t page) {
+    return (uint8_t *)arena + arena->data_offset + ((size_t)page << CLS_MEM_PAGE_SHIFT);
+}
+
+static uint32_t cls_page_of(const cls_mem_arena_t *arena, cls_mem_ref_t ref) {
+    size_t off = ((size_t)ref << CLS_MEM_GRANULE_SHIFT) - arena->data_offset;
+    return (uint32_t)(off >> CLS_MEM_PAGE_SHIFT);
+}
+
+static void cls_list_push(cls_mem_page_t *desc, uint32_t *head, uint32_t page) {
+    desc[page].prev = CLS_MEM_NIL;
+    desc[page].next = *head;
+    if (*head != CLS_MEM_NIL) desc[*head].prev = page;
+    *head = page;
+}
+
+static void cls_list_remove(cls_mem_page_t *desc, uint32_t *head, uint32_t page) {
+    if (desc[page].prev != CLS_MEM_NIL)
+        desc[desc[page].prev].next = desc[page].next;
+    else
+        *head = desc[page].next;
+    if (desc[page].next != CLS_MEM_NIL)
+        desc[desc[page].next].prev = desc[page].prev;
+}
+
+/* ---- Buddy pages ---- */
+
+static uint32_t cls_buddy_alloc(cls_mem_arena_t *arena, uint32_t order) {
+    cls_mem_page_t *desc = cls_arena_desc(arena);
+
+    uint32_t k = order;
+    while (k <= CLS_MEM_MAX_ORDER && arena->free_lists[k] == CLS_MEM_NIL) k++;
+    if (k > CLS_MEM_MAX_ORDER) return CLS_MEM_NIL;
+
+    uint32_t page = arena->free_lists[k];
+    cls_list_remove(desc, &arena->free_lists[k], page);
+
+    /* Split down, returning upper halves to their lists */
+    while (k > order) {
+        k--;
+        uint32_t buddy = page + (1u << k);
+        desc[buddy].kind = CLS_PAGE_FREE;
+        desc[buddy].order = (uint8_t)k;
+        cls_list_push(desc, &arena->free_lists[k], buddy);
+    }
+
+    desc[page].kind = CLS_PAGE_BLOCK;
+    desc[page].order = (uint8_t)order;
+    arena->free_pages -= 1u << order;
+    return page;
+}
+
+static void cls_buddy_free(cls_mem_arena_t *arena, uint32_t page, uint32_t order) {
+    cls_mem_page_t *desc = cls_arena_desc(arena);
+    arena->free_pages += 1u << order;
+
+    while (order < CLS_MEM_MAX_ORDER) {
+        uint32_t buddy = page ^ (1u << order);
+        if (buddy >= arena->page_count ||
+            desc[buddy].kind != CLS_PAGE_FREE || desc[buddy].order != order)
+            break;
+
+        cls_list_remove(desc, &arena->free_lists[order], buddy);
+        desc[CLS_MAX(page, buddy)].kind = CLS_PAGE_TAIL;
+        page = CLS_MIN(page, buddy);
+        order++;
+    }
+
+    desc[page].kind = CLS_PAGE_FREE;
+    desc[page].order = (uint8_t)order;
+    cls_list_push(desc, &arena->free_lists[order], page);
+}
+
+/* ============================================================
+ * Arena API
+ * ============================================================ */
+
+cls_status_t cls_arena_format(void *base, size_t size) {
+    size_t hdr = (sizeof(cls_mem_arena_t) + CLS_MEM_GRANULE - 1) & ~(size_t)(CLS_MEM_GRANULE - 1);
+    if (!base || size < hdr || size > ((size_t)UINT32_MAX << CLS_MEM_GRANULE_SHIFT))
+        return CLS_ERR_INVALID;
+
+    cls_mem_arena_t *arena = (cls_mem_arena_t *)base;
+    memset(arena, 0, sizeof(cls_mem_arena_t));
+
+    /* Solve for page count: header + descriptors + pages <= size */
+    size_t pages = (size - hdr) / (CLS_MEM_PAGE_SIZE + sizeof(cls_mem_page_t));
+    size_t data = hdr + pages * sizeof(cls_mem_page_t);
+    data = (data + CLS_MEM_PAGE_SIZE - 1) & ~(size_t)(CLS_MEM_PAGE_SIZE - 1);
+    while (pages > 0 && data + (pages << CLS_MEM_PAGE_SHIFT) > size) pages--;
+
+    if (pages < CLS_MEM_MIN_PAGES)
+        return CLS_ERR_INVALID;
+
+    arena->page_count = (uint32_t)pages;
+    arena->desc_offset = (uint32_t)hdr;
+    arena->data_offset = data;
+    arena->size = size;
+    arena->used = data;
+    arena->free_pages = 0;
+
+    for (uint32_t i = 0; i <= CLS_MEM_MAX_ORDER; i++)
+        arena->free_lists[i] = CLS_MEM_NIL;
+    for (uint32_t i = 0; i < CLS_MEM_CLASS_COUNT; i++)
+        arena->partial[i] = CLS_MEM_NIL;
+
+    cls_mem_page_t *desc = cls_arena_desc(arena);
+    memset(desc, 0, pages * sizeof(cls_mem_page_t));
+
+    /* Carve the page range into the largest naturally aligned blocks */
+    uint32_t page = 0;
+    while (page < arena->page_count) {
+        uint32_t order = 0;
+        while (order < CLS_MEM_MAX_ORDER &&
+               (page & (1u << order)) == 0 &&
+               page + (2u << order) <= arena->page_count)
+            order++;
+
+        desc[page].kind = CLS_PAGE_FREE;
+        desc[page].order = (uint8_t)order;
+        cls_list_push(desc, &arena->free_lists[order], page);
+        arena->free_pages += 1u << order;
+        page += 1u << order;
+    }
+
+    return CLS_OK;
+}
+
+size_t cls_arena_alloc_size(size_t len) {
+    if (len <= CLS_MEM_SLAB_MAX)
+        return cls_class_size[cls_size_class(len)];
+    return (size_t)CLS_MEM_PAGE_SIZE << cls_pages_order(len);
+}
+
+cls_mem_ref_t cls_arena_alloc(cls_mem_arena_t *arena, size_t len) {
+    if (!arena || len == 0) return 0;
+
+    cls_mem_page_t *desc = cls_arena_desc(arena);
+
+    if (len > CLS_MEM_SLAB_MAX) {
+        uint32_t order = cls_pages_order(len);
+        if (order > CLS_MEM_MAX_ORDER) return 0;
+
+        uint32_t page = cls_buddy_alloc(arena, order);
+        if (page == CLS_MEM_NIL) return 0;
+
+        arena->used += (size_t)CLS_MEM_PAGE_SIZE << order;
+        return cls_arena_ref(arena, cls_page_addr(arena, page));
+    }
+
+    uint32_t c = cls_size_class(len);
+    uint32_t size = cls_class_size[c];
+    uint32_t per_page = CLS_MEM_PAGE_SIZE / size;
+
+    uint32_t page = arena->partial[c];
+    if (page == CLS_MEM_NIL) {
+        page = cls_buddy_alloc(arena, 0);
+        if (page == CLS_MEM_NIL) return 0;
+
+        desc[page].kind = CLS_PAGE_SLAB;
+        desc[page].order = (uint8_t)c;
+        desc[page].inuse = 0;
+        desc[page].carved = 0;
+        desc[page].free_head = CLS_MEM_OBJ_NIL;
+        cls_list_push(desc, &arena->partial[c], page);
+    }
+
+    cls_mem_page_t *pd = &desc[page];
+    uint8_t *base = cls_page_addr(arena, page);
+    uint32_t obj;
+
+    if (pd->free_head != CLS_MEM_OBJ_NIL) {
+        obj = pd->free_head;
+        memcpy(&pd->free_head, base + obj * size, sizeof(uint16_t));
+    } else {
+        obj = pd->carved++;
+    }
+
+    pd->inuse++;
+    if (pd->inuse == per_page)
+        cls_list_remove(desc, &arena->partial[c], page);
+
+    arena->used += size;
+    return cls_arena_ref(arena, base + obj * size);
+}
+
+size_t cls_arena_block_size(const cls_mem_arena_t *arena, cls_mem_ref_t ref) {
+    if (!arena || !ref) return 0;
+
+    const cls_mem_page_t *desc =
+        (const cls_mem_page_t *)((const uint8_t *)arena + arena->desc_offset);
+    const cls_mem_page_t *pd = &desc[cls_page_of(arena, ref)];
+
+    if (pd->kind == CLS_PAGE_SLAB)
+        return cls_class_size[pd->order];
+    return (size_t)CLS_MEM_PAGE_SIZE << pd->order;
+}
+
+void cls_arena_free(cls_mem_arena_t *arena, cls_mem_ref_t ref) {
+    if (!arena || !ref) return;
+
+    cls_mem_page_t *desc = cls_arena_desc(arena);
+    uint32_t page = cls_page_of(arena, ref);
+    cls_mem_page_t *pd = &desc[page];
+
+    if (pd->kind != CLS_PAGE_SLAB) {
+        arena->used -= (size_t)CLS_MEM_PAGE_SIZE << pd->order;
+        cls_buddy_free(arena, page, pd->order);
+        return;
+    }
+
+    uint32_t c = pd->order;
+    uint32_t size = cls_class_size[c];
+    uint32_t per_page = CLS_MEM_PAGE_SIZE / size;
+    uint8_t *base = cls_page_addr(arena, page);
+    uint16_t obj = (uint16_t)(((uint8_t *)cls_arena_ptr(arena, ref) - base) / size);
+
+    memcpy(base + obj * size, &pd->free_head, sizeof(uint16_t));
+    pd->free_head = obj;
+
+    if (pd->inuse == per_page)
+        cls_list_push(desc, &arena->partial[c], page);
+    pd->inuse--;
+    arena->used -= size;
+
+    /* Empty slabs go back to the buddy allocator */
+    if (pd->inuse == 0) {
+        cls_list_remove(desc, &arena->partial[c], page);
+        cls_buddy_free(arena, page, 0);
+    }
+}
@@ -0,0 +1,313 @@
+/*
+ * ClawLobstars - Memory Epoch Reclamation
+ * Reader slots, global epoch and per-shard retire rings used by the
+ * concurrent memory store
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#include "../include/cls_framework.h"
+#include "cls_mem_internal.h"
+
+/* ============================================================
+ * Internal Helpers
+ * ============================================================ */
+
+static void cls_reader_release(void *p) {
+    cls_mem_reader_t *reader = (cls_mem_reader_t *)p;
+
+    cls_epoch_fold_counts(reader);
+    reader->depth = 0;
+    CLS_STORE_REL(&reader->epoch, 0);
+    CLS_STORE_REL(&reader->owned, 0);
+}
+
+static cls_mem_reader_t *cls_reader_claim(cls_mem_store_t *store) {
+    for (uint32_t i = 0; i < CLS_MEM_MAX_READERS; i++) {
+        cls_mem_reader_t *reader = &store->ep->readers[i];
+        uint32_t expected = 0;
+
+        if (CLS_LOAD_RLX(&reader->owned)) continue;
+        if (!__atomic_compare_exchange_n(&reader->owned, &expected, (uint32_t)getpid(), false,
+                                         __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            continue;
+
+        reader->store = store;
+        reader->depth = 0;
+        reader->pending = 0;
+        reader->hot_tick = 0;
+        memset(reader->hits, 0, sizeof(reader->hits));
+        memset(reader->misses, 0, sizeof(reader->misses));
+
+        /* Writers only scan slots below the high-water mark */
+        uint32_t high = CLS_LOAD_RLX(&store->ep->reader_high);
+        while (high < i + 1 &&
+               !__atomic_compare_exchange_n(&store->ep->reader_high, &high, i + 1, false,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            ;
+
+        if (pthread_setspecific(store->reader_key, reader) != 0) {
+            CLS_STORE_REL(&reader->owned, 0);
+            return NULL;
+        }
+        return reader;
+    }
+    return NULL;
+}
+
+/* A process that died inside a read section never leaves it; free its
+ * slot so the epoch can move on */
+static bool cls_reader_orphaned(cls_mem_reader_t *reader) {
+    uint32_t pid = CLS_LOAD_ACQ(&reader->owned);
+    if (pid == 0 || kill((pid_t)pid, 0) == 0 || errno != ESRCH) return false;
+
+    CLS_STORE_REL(&reader->epoch, 0);
+    return __atomic_compare_exchange_n(&reader->owned, &pid, 0, false,
+                                       __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+}
+
+/* Bump the global epoch if every active reader has caught up with it */
+static bool cls_epoch_try_advance(cls_mem_store_t *store) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    cls_mem_epoch_t *ep = store->ep;
+    uint64_t epoch = CLS_LOAD_ACQ(&ep->epoch);
+    uint32_t high = CLS_LOAD_ACQ(&ep->reader_high);
+
+    for (uint32_t i = 0; i < high; i++) {
+        uint64_t seen = CLS_LOAD_ACQ(&ep->readers[i].epoch);
+        if (seen != 0 && seen != epoch &&
+            !(store->shm && cls_reader_orphaned(&ep->readers[i])))
+            return false;
+    }
+
+    return __atomic_compare_exchange_n(&ep->epoch, &epoch, epoch + 1, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+
+static void cls_retired_free(cls_mem_arena_t *arena, const cls_mem_retired_t *r) {
+    if (r->kind == CLS_RETIRE_ENTRY)
+        cls_arena_free(arena, cls_arena_entry(arena, r->ref)->data);
+    cls_arena_free(arena, r->ref);
+}
+
+static bool cls_retired_pinned(cls_mem_arena_t *arena, const cls_mem_retired_t *r) {
+    const cls_mem_entry_t *entry = cls_arena_entry(arena, r->ref);
+    return r->kind == CLS_RETIRE_ENTRY && entry && CLS_LOAD_ACQ(&entry->pins) != 0;
+}
+
+static void cls_retired_push(cls_mem_shard_t *shard, const cls_mem_retired_t *r) {
+    cls_mem_ring_t *ring = shard->ring;
+    cls_ring_slots(shard)[(ring->head + ring->count) % ring->cap] = *r;
+    ring->count++;
+}
+
+/* Double the ring (a shared one starts out empty); on allocation failure
+ * the caller keeps waiting */
+static bool cls_retired_grow(cls_mem_shard_t *shard) {
+    cls_mem_ring_t *ring = shard->ring;
+    bool shared = ring != &shard->ring_own;
+    uint32_t cap = ring->cap ? ring->cap * 2 : CLS_MEM_RETIRE_SHM_INIT;
+    cls_mem_ref_t block = 0;
+    cls_mem_retired_t *slots;
+
+    if (shared) {
+        block = cls_arena_alloc(shard->arena, cap * sizeof(cls_mem_retired_t));
+        slots = (cls_mem_retired_t *)cls_arena_ptr(shard->arena, block);
+    } else {
+        slots = (cls_mem_retired_t *)malloc(cap * sizeof(cls_mem_retired_t));
+    }
+    if (!slots) return false;
+
+    const cls_mem_retired_t *old = cls_ring_slots(shard);
+    for (uint32_t i = 0; i < ring->count; i++)
+        slots[i] = old[(ring->head + i) % ring->cap];
+
+    if (shared) {
+        if (ring->block) cls_arena_free(shard->arena, ring->block);
+        ring->block = block;
+    } else {
+        free(shard->retired);
+        shard->retired = slots;
+    }
+    ring->cap = cap;
+    ring->head = 0;
+    return true;
+}
+
+/* Walk the ring once from the head: free what is past its grace period,
+ * rotate still-pinned entries to the tail, stop at the first record that
+ * readers may still reach. Non-concurrent stores have no grace period. */
+static void cls_retired_drain(cls_mem_store_t *store, cls_mem_shard_t *shard) {
+    uint64_t epoch = CLS_LOAD_ACQ(&store->ep->epoch);
+    cls_mem_ring_t *ring = shard->ring;
+    const cls_mem_retired_t *slots = cls_ring_slots(shard);
+    uint32_t n = ring->count;
+
+    while (n-- > 0) {
+        cls_mem_retired_t r = slots[ring->head];
+        if (store->concurrent && r.epoch + 2 > epoch) break;
+
+        ring->head = (ring->head + 1) % ring->cap;
+        ring->count--;
+
+        if (cls_retired_pinned(shard->arena, &r))
+            cls_retired_push(shard, &r);
+        else
+            cls_retired_free(shard->arena, &r);
+    }
+}
+
+/* ============================================================
+ * Epoch API
+ * ============================================================ */
+
+cls_status_t cls_epoch_init(cls_mem_store_t *store) {
+    if (!store) return CLS_ERR_INVALID;
+
+    /* A shared segment's epoch is already running when we attach */
+    if (store->ep->epoch == 0) store->ep->epoch = 1;
+
+    /* Every store keeps a ring: borrowed entries outlive their unlink.
+     * A segment's rings are already there, and get slots on first use */
+    for (uint32_t i = 0; i < store->shard_count; i++) {
+        cls_mem_shard_t *shard = &store->shards[i];
+        if (store->shm) {
+            shard->ring = &store->shm->hdr->rings[i];
+            continue;
+        }
+        shard->ring = &shard->ring_own;
+        shard->retired = (cls_mem_retired_t *)calloc(CLS_MEM_RETIRE_INIT,
+                                                     sizeof(cls_mem_retired_t));
+        if (!shard->retired) {
+            cls_epoch_destroy(store);
+            return CLS_ERR_NOMEM;
+        }
+        shard->ring_own.cap = CLS_MEM_RETIRE_INIT;
+    }
+
+    if (store->concurrent &&
+        pthread_key_create(&store->reader_key, cls_reader_release) != 0) {
+        store->concurrent = false;
+        cls_epoch_destroy(store);
+        return CLS_ERR_INTERNAL;
+    }
+    return CLS_OK;
+}
+
+void cls_epoch_destroy(cls_mem_store_t *store) {
+    if (!store) return;
+
+    /* A private ring's retirements die with the arena; a segment's stay
+     * for the next process to take the shard lock */
+    for (uint32_t i = 0; i < store->shard_count; i++) {
+        free(store->shards[i].retired);
+        store->shards[i].retired = NULL;
+        store->shards[i].ring_own.count = 0;
+    }
+    if (!store->concurrent) return;
+
+    /* Slots in a shared segment outlive us; hand ours back */
+    uint32_t pid = (uint32_t)getpid();
+    for (uint32_t i = 0; store->shm && i < CLS_MEM_MAX_READERS; i++) {
+        cls_mem_reader_t *reader = &store->ep->readers[i];
+        if (CLS_LOAD_RLX(&reader->owned) != pid || reader->store != store) continue;
+        CLS_STORE_REL(&reader->epoch, 0);
+        CLS_STORE_REL(&reader->owned, 0);
+    }
+    pthread_key_delete(store->reader_key);
+}
+
+cls_mem_reader_t *cls_epoch_enter(cls_mem_store_t *store) {
+    if (!store->concurrent) return NULL;
+
+    cls_mem_reader_t *reader = (cls_mem_reader_t *)pthread_getspecific(store->reader_key);
+    if (!reader) {
+        reader = cls_reader_claim(store);
+        if (!reader) return NULL;
+    }
+
+    if (reader->depth++ == 0) {
+        CLS_STORE_RLX(&reader->epoch, CLS_LOAD_RLX(&store->ep->epoch));
+        /* Announcement must be visible before any table load */
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+    return reader;
+}
+
+void cls_epoch_leave(cls_mem_reader_t *reader) {
+    if (!reader) return;
+    if (--reader->depth == 0)
+        CLS_STORE_REL(&reader->epoch, 0);
+}
+
+void cls_epoch_fold_counts(cls_mem_reader_t *reader) {
+    cls_mem_store_t *store = reader->store;
+    if (!store) return;
+
+    if (reader->pending == 0) return;
+    uint32_t hits = 0, misses = 0;
+    for (uint32_t i = 0; i < store->ns_count; i++) {
+        if (reader->hits[i]) CLS_ADD_RLX(&store->ns[i].hits, reader->hits[i]);
+        if (reader->misses[i]) CLS_ADD_RLX(&store->ns[i].misses, reader->misses[i]);
+        hits += reader->hits[i];
+        misses += reader->misses[i];
+        reader->hits[i] = 0;
+        reader->misses[i] = 0;
+    }
+    if (hits) CLS_ADD_RLX(&store->ctx->hit_count, hits);
+    if (misses) CLS_ADD_RLX(&store->ctx->miss_count, misses);
+    reader->pending = 0;
+}
+
+void cls_shard_retire(cls_mem_store_t *store, cls_mem_shard_t *shard,
+                      cls_mem_ref_t ref, cls_mem_retire_kind_t kind) {
+    if (!ref) return;
+
+    cls_mem_retired_t r;
+    r.ref = ref;
+    r.kind = (uint32_t)kind;
+    r.epoch = 0;
+
+    if (!store->concurrent) {
+        if (!cls_retired_pinned(shard->arena, &r)) {
+            cls_retired_free(shard->arena, &r);
+            return;
+        }
+    } else {
+        /* The unlink must be ordered before the epoch we stamp */
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        r.epoch = CLS_LOAD_ACQ(&store->ep->epoch);
+    }
+
+    cls_mem_ring_t *ring = shard->ring;
+    if (ring->count == ring->cap) {
+        cls_shard_reclaim(store, shard);
+        while (ring->count == ring->cap && !cls_retired_grow(shard)) {
+            sched_yield();
+            cls_shard_reclaim(store, shard);
+        }
+    }
+
+    cls_retired_push(shard, &r);
+
+    if (++shard->retired_since >= CLS_MEM_RETIRE_BATCH)
+        cls_shard_reclaim(store, shard);
+}
+
+void cls_shard_reclaim(cls_mem_store_t *store, cls_mem_shard_t *shard) {
+    shard->retired_since = 0;
+    if (shard->ring->count == 0) return;
+
+    cls_retired_drain(store, shard);
+
+    /* Two advances cover everything retired up to now */
+    for (uint32_t i = 0; i < 2 && store->concurrent && shard->ring->count > 0; i++) {
+        if (cls_epoch_try_advance(store))
+            cls_retired_drain(store, shard);
+    }
+}
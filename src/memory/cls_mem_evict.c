@@ -0,0 +1,178 @@
+/*
+ * ClawLobstars - Memory Eviction Support
+ * Frequency sketch and admission window used by the W-TinyLFU policy
+ */
+
+#include <string.h>
+#include "cls_mem_internal.h"
+
+/* ============================================================
+ * Internal Helpers
+ * ============================================================ */
+
+#define CLS_SKETCH_MIN_WIDTH    64
+#define CLS_SKETCH_COUNTER_MAX  15      /* 4-bit saturating counters */
+#define CLS_SKETCH_SAMPLE_MUL   10      /* Age after 10 x capacity adds */
+
+static uint8_t *cls_sketch_rows(const cls_mem_sketch_t *sk, const cls_mem_arena_t *arena) {
+    return (uint8_t *)cls_arena_ptr(arena, sk->block);
+}
+
+/* Independent column per row from one key hash */
+static uint32_t cls_sketch_index(const cls_mem_sketch_t *sk, uint32_t mixed, uint32_t row) {
+    uint32_t h = (mixed + row * 0x9E3779B9u) * 0x85EBCA6Bu;
+    h ^= h >> 15;
+    return row * (sk->mask + 1) + (h & sk->mask);
+}
+
+static cls_mem_ref_t *cls_window_slots(const cls_mem_window_t *w, const cls_mem_arena_t *arena) {
+    return (cls_mem_ref_t *)cls_arena_ptr(arena, w->block);
+}
+
+/* ============================================================
+ * Frequency Sketch
+ * ============================================================ */
+
+cls_status_t cls_sketch_init(cls_mem_sketch_t *sk, cls_mem_arena_t *arena, uint32_t capacity) {
+    uint32_t width = CLS_SKETCH_MIN_WIDTH;
+    while (width < capacity && width < 0x40000000u) width <<= 1;
+
+    sk->block = cls_arena_alloc(arena, (size_t)width * CLS_SKETCH_DEPTH);
+    if (!sk->block) return CLS_ERR_NOMEM;
+
+    memset(cls_sketch_rows(sk, arena), 0, (size_t)width * CLS_SKETCH_DEPTH);
+    sk->mask = width - 1;
+    sk->additions = 0;
+    sk->sample = capacity * CLS_SKETCH_SAMPLE_MUL;
+    if (sk->sample < width) sk->sample = width;
+    return CLS_OK;
+}
+
+/* Lock-free: readers count their lookups too. Racing increments may be
+ * lost, which only makes the estimate a little low. */
+void cls_sketch_add(cls_mem_sketch_t *sk, const cls_mem_arena_t *arena, uint32_t mixed) {
+    uint8_t *rows = cls_sketch_rows(sk, arena);
+    if (!rows) return;
+
+    for (uint32_t r = 0; r < CLS_SKETCH_DEPTH; r++) {
+        uint8_t *c = &rows[cls_sketch_index(sk, mixed, r)];
+        uint8_t v = CLS_LOAD_RLX(c);
+        if (v < CLS_SKETCH_COUNTER_MAX) CLS_STORE_RLX(c, (uint8_t)(v + 1));
+    }
+    CLS_ADD_RLX(&sk->additions, 1);
+}
+
+uint32_t cls_sketch_estimate(const cls_mem_sketch_t *sk, const cls_mem_arena_t *arena,
+                             uint32_t mixed) {
+    const uint8_t *rows = cls_sketch_rows(sk, arena);
+    if (!rows) return 0;
+
+    uint32_t est = CLS_SKETCH_COUNTER_MAX;
+    for (uint32_t r = 0; r < CLS_SKETCH_DEPTH; r++) {
+        uint8_t v = CLS_LOAD_RLX(&rows[cls_sketch_index(sk, mixed, r)]);
+        if (v < est) est = v;
+    }
+    return est;
+}
+
+/* Halve every counter once a sample period has passed, so the sketch
+ * tracks recent popularity (shard lock held) */
+void cls_sketch_age(cls_mem_sketch_t *sk, cls_mem_arena_t *arena) {
+    uint8_t *rows = cls_sketch_rows(sk, arena);
+    if (!rows || CLS_LOAD_RLX(&sk->additions) < sk->sample) return;
+
+    size_t n = (size_t)(sk->mask + 1) * CLS_SKETCH_DEPTH;
+    for (size_t i = 0; i < n; i++)
+        CLS_STORE_RLX(&rows[i], (uint8_t)(CLS_LOAD_RLX(&rows[i]) >> 1));
+    CLS_STORE_RLX(&sk->additions, 0);
+}
+
+/* ============================================================
+ * Admission Window
+ * ============================================================ */
+
+cls_status_t cls_window_init(cls_mem_window_t *w, cls_mem_arena_t *arena, uint32_t capacity) {
+    w->block = cls_arena_alloc(arena, (size_t)capacity * sizeof(cls_mem_ref_t));
+    if (!w->block) return CLS_ERR_NOMEM;
+
+    w->cap = capacity;
+    w->head = 0;
+    w->used = 0;
+    w->live = 0;
+    return CLS_OK;
+}
+
+/* Compact holes left by removals; the ring must be non-empty */
+static void cls_window_compact(cls_mem_window_t *w, cls_mem_ref_t *slots) {
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < w->used; i++) {
+        cls_mem_ref_t ref = slots[(w->head + i) % w->cap];
+        if (ref) slots[(w->head + n++) % w->cap] = ref;
+    }
+    w->used = n;
+}
+
+bool cls_window_full(const cls_mem_window_t *w) {
+    return w->live >= w->cap;
+}
+
+void cls_window_push(cls_mem_window_t *w, cls_mem_arena_t *arena, cls_mem_ref_t ref) {
+    cls_mem_ref_t *slots = cls_window_slots(w, arena);
+    if (!slots || w->live >= w->cap) return;
+
+    if (w->used == w->cap) cls_window_compact(w, slots);
+    slots[(w->head + w->used) % w->cap] = ref;
+    w->used++;
+    w->live++;
+    cls_arena_entry(arena, ref)->flags |= CLS_ENTRY_WINDOW;
+}
+
+cls_mem_ref_t cls_window_pop(cls_mem_window_t *w, cls_mem_arena_t *arena) {
+    cls_mem_ref_t *slots = cls_window_slots(w, arena);
+
+    while (slots && w->used > 0) {
+        cls_mem_ref_t ref = slots[w->head];
+        w->head = (w->head + 1) % w->cap;
+        w->used--;
+        if (!ref) continue;
+
+        w->live--;
+        cls_arena_entry(arena, ref)->flags &= (uint16_t)~CLS_ENTRY_WINDOW;
+        return ref;
+    }
+    return 0;
+}
+
+/* The window is small (about 1% of a shard), so a scan is cheap */
+static uint32_t cls_window_find(const cls_mem_window_t *w, const cls_mem_ref_t *slots,
+                                cls_mem_ref_t ref) {
+    for (uint32_t i = 0; i < w->used; i++) {
+        uint32_t pos = (w->head + i) % w->cap;
+        if (slots[pos] == ref) return pos;
+    }
+    return UINT32_MAX;
+}
+
+void cls_window_remove(cls_mem_window_t *w, cls_mem_arena_t *arena, cls_mem_ref_t ref) {
+    cls_mem_ref_t *slots = cls_window_slots(w, arena);
+    if (!slots) return;
+
+    uint32_t pos = cls_window_find(w, slots, ref);
+    if (pos == UINT32_MAX) return;
+
+    slots[pos] = 0;
+    w->live--;
+    cls_arena_entry(arena, ref)->flags &= (uint16_t)~CLS_ENTRY_WINDOW;
+}
+
+void cls_window_replace(cls_mem_window_t *w, cls_mem_arena_t *arena,
+                        cls_mem_ref_t old, cls_mem_ref_t fresh) {
+    cls_mem_ref_t *slots = cls_window_slots(w, arena);
+    if (!slots) return;
+
+    uint32_t pos = cls_window_find(w, slots, old);
+    if (pos == UINT32_MAX) return;
+
+    slots[pos] = fresh;
+    cls_arena_entry(arena, fresh)->flags |= CLS_ENTRY_WINDOW;
+}
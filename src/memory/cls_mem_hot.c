@@ -0,0 +1,198 @@
+/*
+ * ClawLobstars - Memory Hot-Key Tracking
+ * Count-min sketch plus top-k heap per operation kind, for keys and for
+ * key prefixes, in constant memory
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "cls_mem_internal.h"
+
+/* ============================================================
+ * Internal Helpers
+ * ============================================================ */
+
+#define CLS_HOT_AGE_PERIOD      (CLS_HOT_WIDTH * 8)     /* Additions between halvings */
+
+/* Independent column per row from one key hash */
+static uint32_t cls_hot_index(uint32_t hash, uint32_t row) {
+    uint32_t h = (hash + row * 0x9E3779B9u) * 0x85EBCA6Bu;
+    h ^= h >> 15;
+    return h & (CLS_HOT_WIDTH - 1);
+}
+
+/* Conservative update: only the counters at the current minimum grow,
+ * which keeps collisions from inflating the estimate. Returns it. */
+static uint32_t cls_hot_sketch_add(cls_mem_hot_rank_t *rank, uint32_t hash, uint32_t weight) {
+    uint32_t cols[CLS_HOT_DEPTH];
+    uint32_t min = UINT32_MAX;
+    for (uint32_t r = 0; r < CLS_HOT_DEPTH; r++) {
+        cols[r] = cls_hot_index(hash, r);
+        if (rank->rows[r][cols[r]] < min) min = rank->rows[r][cols[r]];
+    }
+
+    uint32_t est = min > UINT32_MAX - weight ? UINT32_MAX : min + weight;
+    for (uint32_t r = 0; r < CLS_HOT_DEPTH; r++) {
+        if (rank->rows[r][cols[r]] < est) rank->rows[r][cols[r]] = est;
+    }
+    return est;
+}
+
+static void cls_hot_swap(cls_mem_hot_rank_t *rank, uint32_t a, uint32_t b) {
+    cls_mem_hot_slot_t t = rank->heap[a];
+    rank->heap[a] = rank->heap[b];
+    rank->heap[b] = t;
+}
+
+static void cls_hot_sift_down(cls_mem_hot_rank_t *rank, uint32_t i) {
+    for (;;) {
+        uint32_t l = 2 * i + 1, r = l + 1, m = i;
+        if (l < rank->size && rank->heap[l].count < rank->heap[m].count) m = l;
+        if (r < rank->size && rank->heap[r].count < rank->heap[m].count) m = r;
+        if (m == i) return;
+        cls_hot_swap(rank, i, m);
+        i = m;
+    }
+}
+
+static void cls_hot_sift_up(cls_mem_hot_rank_t *rank, uint32_t i) {
+    while (i > 0 && rank->heap[(i - 1) / 2].count > rank->heap[i].count) {
+        cls_hot_swap(rank, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+/* Halve every counter so the ranking follows recent traffic; halving
+ * keeps the heap ordered */
+static void cls_hot_age(cls_mem_hot_rank_t *rank) {
+    for (uint32_t r = 0; r < CLS_HOT_DEPTH; r++) {
+        for (uint32_t c = 0; c < CLS_HOT_WIDTH; c++)
+            rank->rows[r][c] >>= 1;
+    }
+    for (uint32_t i = 0; i < rank->size; i++)
+        rank->heap[i].count >>= 1;
+    rank->additions = 0;
+}
+
+static void cls_hot_rank_add(cls_mem_hot_rank_t *rank, const char *key, size_t len,
+                             uint32_t hash, uint32_t weight) {
+    if (++rank->additions >= CLS_HOT_AGE_PERIOD) cls_hot_age(rank);
+    uint32_t est = cls_hot_sketch_add(rank, hash, weight);
+
+    /* Already ranked: its count only grows, so it moves toward the leaves */
+    for (uint32_t i = 0; i < rank->size; i++) {
+        cls_mem_hot_slot_t *slot = &rank->heap[i];
+        if (slot->hash == hash && slot->len == len && memcmp(slot->key, key, len) == 0) {
+            slot->count = est;
+            cls_hot_sift_down(rank, i);
+            return;
+        }
+    }
+
+    uint32_t i;
+    if (rank->size < CLS_MEMORY_HOT_MAX) {
+        i = rank->size++;
+    } else if (est > rank->heap[0].count) {
+        i = 0;
+    } else {
+        return;
+    }
+
+    cls_mem_hot_slot_t *slot = &rank->heap[i];
+    memcpy(slot->key, key, len);
+    slot->key[len] = '\0';
+    slot->len = (uint32_t)len;
+    slot->hash = hash;
+    slot->count = est;
+    if (i == 0) cls_hot_sift_down(rank, 0);
+    else cls_hot_sift_up(rank, i);
+}
+
+/* Prefix up to and including the last ':'; 0 when the key has none */
+static size_t cls_hot_prefix_len(const char *key, size_t len) {
+    while (len > 0 && key[len - 1] != ':') len--;
+    return len;
+}
+
+static uint32_t cls_hot_hash(const char *key, size_t len) {
+    uint32_t hash = CLS_FNV_OFFSET;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)key[i];
+        hash *= CLS_FNV_PRIME;
+    }
+    return hash;
+}
+
+/* ============================================================
+ * Tracker
+ * ============================================================ */
+
+cls_mem_hot_t *cls_hot_create(uint32_t sample, bool concurrent) {
+    cls_mem_hot_t *hot = (cls_mem_hot_t *)calloc(1, sizeof(cls_mem_hot_t));
+    if (!hot) return NULL;
+
+    if (concurrent && pthread_mutex_init(&hot->lock, NULL) != 0) {
+        free(hot);
+        return NULL;
+    }
+    hot->concurrent = concurrent;
+    hot->sample = sample ? sample : 1;
+    return hot;
+}
+
+void cls_hot_free(cls_mem_hot_t *hot) {
+    if (!hot) return;
+    if (hot->concurrent) pthread_mutex_destroy(&hot->lock);
+    free(hot);
+}
+
+void cls_hot_reset(cls_mem_hot_t *hot) {
+    if (!hot) return;
+
+    if (hot->concurrent) pthread_mutex_lock(&hot->lock);
+    memset(hot->ranks, 0, sizeof(hot->ranks));
+    if (hot->concurrent) pthread_mutex_unlock(&hot->lock);
+}
+
+void cls_hot_record(cls_mem_hot_t *hot, cls_mem_hot_kind_t kind,
+                    const char *key, size_t key_len, uint32_t hash) {
+    if (!hot || !key || (uint32_t)kind >= CLS_HOT_KINDS || key_len >= CLS_MEM_KEY_MAX)
+        return;
+
+    /* A sample is cheap to lose and waiting would serialize readers */
+    if (hot->concurrent && pthread_mutex_trylock(&hot->lock) != 0)
+        return;
+
+    cls_hot_rank_add(&hot->ranks[kind][0], key, key_len, hash, hot->sample);
+    size_t plen = cls_hot_prefix_len(key, key_len);
+    if (plen > 0)
+        cls_hot_rank_add(&hot->ranks[kind][1], key, plen, cls_hot_hash(key, plen), hot->sample);
+
+    if (hot->concurrent) pthread_mutex_unlock(&hot->lock);
+}
+
+uint32_t cls_hot_top(cls_mem_hot_t *hot, cls_mem_hot_kind_t kind, bool prefixes,
+                     cls_mem_hot_entry_t *out, uint32_t max) {
+    if (!hot || !out || (uint32_t)kind >= CLS_HOT_KINDS) return 0;
+
+    if (hot->concurrent) pthread_mutex_lock(&hot->lock);
+    const cls_mem_hot_rank_t *rank = &hot->ranks[kind][prefixes ? 1 : 0];
+
+    /* Insertion sort into out, largest first, keeping the top max */
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < rank->size; i++) {
+        const cls_mem_hot_slot_t *slot = &rank->heap[i];
+        uint32_t j = n < max ? n++ : max;
+        while (j > 0 && out[j - 1].count < slot->count) {
+            if (j < max) out[j] = out[j - 1];
+            j--;
+        }
+        if (j < max) {
+            memcpy(out[j].key, slot->key, slot->len + 1);
+            out[j].count = slot->count;
+        }
+    }
+
+    if (hot->concurrent) pthread_mutex_unlock(&hot->lock);
+    return n;
+}
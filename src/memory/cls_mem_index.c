@@ -0,0 +1,207 @@
+/*
+ * ClawLobstars - Memory Key Index Implementation
+ * Crit-bit tree over entry keys for ordered prefix scans
+ */
+
+#include <string.h>
+#include "cls_mem_internal.h"
+
+/* ============================================================
+ * Internal Helpers
+ * ============================================================ */
+
+/* Internal node; a leaf is the entry itself. `otherbits` has every bit
+ * set except the critical one, so (1 + (otherbits | c)) >> 8 yields the
+ * direction for byte c. */
+typedef struct {
+    cls_mem_ref_t   child[2];
+    uint32_t        byte;
+    uint8_t         otherbits;
+} cls_index_node_t;
+
+static bool cls_index_is_node(cls_mem_ref_t ref) {
+    return (ref & CLS_INDEX_NODE_BIT) != 0;
+}
+
+static cls_index_node_t *cls_index_node(const cls_mem_arena_t *arena, cls_mem_ref_t ref) {
+    return (cls_index_node_t *)cls_arena_ptr(arena, ref & ~CLS_INDEX_NODE_BIT);
+}
+
+static uint8_t cls_key_byte(const char *key, size_t len, uint32_t byte) {
+    return byte < len ? (uint8_t)key[byte] : 0;
+}
+
+static uint32_t cls_index_dir(const cls_index_node_t *n, const char *key, size_t len) {
+    return (1u + (n->otherbits | cls_key_byte(key, len, n->byte))) >> 8;
+}
+
+/* Leaf a search for key ends at; shares the longest tested prefix */
+static cls_mem_ref_t cls_index_best(const cls_mem_arena_t *arena, cls_mem_ref_t p,
+                                    const char *key, size_t len) {
+    while (cls_index_is_node(p)) {
+        const cls_index_node_t *n = cls_index_node(arena, p);
+        p = n->child[cls_index_dir(n, key, len)];
+    }
+    return p;
+}
+
+/* First differing bit between key and a leaf; false when equal */
+static bool cls_index_crit(const cls_mem_entry_t *leaf, const char *key, size_t len,
+                           uint32_t *out_byte, uint8_t *out_otherbits) {
+    size_t max = CLS_MAX(len, (size_t)leaf->key_len);
+
+    for (uint32_t b = 0; b <= max; b++) {
+        uint8_t diff = cls_key_byte(key, len, b) ^ cls_key_byte(leaf->key, leaf->key_len, b);
+        if (!diff) continue;
+
+        /* Isolate the most significant differing bit */
+        diff |= diff >> 1;
+        diff |= diff >> 2;
+        diff |= diff >> 4;
+        diff = (uint8_t)(diff & ~(diff >> 1));
+
+        *out_byte = b;
+        *out_otherbits = (uint8_t)~diff;
+        return true;
+    }
+    return false;
+}
+
+/* Crit positions order by byte, then by higher bit first */
+static bool cls_index_before(uint32_t byte_a, uint8_t bits_a, uint32_t byte_b, uint8_t bits_b) {
+    return byte_a < byte_b || (byte_a == byte_b && bits_a < bits_b);
+}
+
+/* ============================================================
+ * Index API
+ * ============================================================ */
+
+cls_status_t cls_index_insert(cls_mem_arena_t *arena, cls_mem_ref_t *root, cls_mem_ref_t entry) {
+    const cls_mem_entry_t *e = cls_arena_entry(arena, entry);
+
+    if (!*root) {
+        *root = entry;
+        return CLS_OK;
+    }
+
+    const cls_mem_entry_t *best = cls_arena_entry(arena,
+                                                  cls_index_best(arena, *root, e->key, e->key_len));
+    uint32_t byte;
+    uint8_t otherbits;
+    if (!cls_index_crit(best, e->key, e->key_len, &byte, &otherbits))
+        return CLS_ERR_INVALID;
+
+    cls_mem_ref_t ref = cls_arena_alloc(arena, sizeof(cls_index_node_t));
+    if (!ref) return CLS_ERR_NOMEM;
+
+    uint8_t c = cls_key_byte(best->key, best->key_len, byte);
+    uint32_t newdir = (1u + (otherbits | c)) >> 8;
+    cls_index_node_t *node = (cls_index_node_t *)cls_arena_ptr(arena, ref);
+    node->byte = byte;
+    node->otherbits = otherbits;
+    node->child[1 - newdir] = entry;
+
+    /* Splice in above the first node that tests a later bit */
+    cls_mem_ref_t *where = root;
+    while (cls_index_is_node(*where)) {
+        cls_index_node_t *n = cls_index_node(arena, *where);
+        if (!cls_index_before(n->byte, n->otherbits, byte, otherbits)) break;
+        where = &n->child[cls_index_dir(n, e->key, e->key_len)];
+    }
+
+    node->child[newdir] = *where;
+    *where = ref | CLS_INDEX_NODE_BIT;
+    return CLS_OK;
+}
+
+void cls_index_remove(cls_mem_arena_t *arena, cls_mem_ref_t *root, cls_mem_ref_t entry) {
+    if (!*root) return;
+
+    const cls_mem_entry_t *e = cls_arena_entry(arena, entry);
+    cls_mem_ref_t *where = root;
+    cls_mem_ref_t *whereq = NULL;
+    cls_index_node_t *q = NULL;
+    uint32_t dir = 0;
+
+    while (cls_index_is_node(*where)) {
+        whereq = where;
+        q = cls_index_node(arena, *where);
+        dir = cls_index_dir(q, e->key, e->key_len);
+        where = &q->child[dir];
+    }
+
+    if (*where != entry) return;
+
+    if (!whereq) {
+        *root = 0;
+        return;
+    }
+
+    /* Parent collapses into the sibling */
+    cls_mem_ref_t node_ref = *whereq & ~CLS_INDEX_NODE_BIT;
+    *whereq = q->child[1 - dir];
+    cls_arena_free(arena, node_ref);
+}
+
+void cls_index_replace(cls_mem_arena_t *arena, cls_mem_ref_t *root,
+                       cls_mem_ref_t old, cls_mem_ref_t fresh) {
+    if (!*root) return;
+
+    const cls_mem_entry_t *e = cls_arena_entry(arena, fresh);
+    cls_mem_ref_t *where = root;
+
+    while (cls_index_is_node(*where)) {
+        cls_index_node_t *n = cls_index_node(arena, *where);
+        where = &n->child[cls_index_dir(n, e->key, e->key_len)];
+    }
+    if (*where == old) *where = fresh;
+}
+
+void cls_index_scan(const cls_mem_arena_t *arena, cls_mem_ref_t root,
+                    const char *from, bool inclusive,
+                    cls_index_visit_fn fn, void *user_ctx) {
+    if (!root) return;
+
+    cls_mem_ref_t stack[CLS_INDEX_DEPTH];
+    uint32_t top = 0;
+    size_t len = from ? strlen(from) : 0;
+
+    if (!from || (len == 0 && inclusive)) {
+        stack[top++] = root;
+    } else {
+        /* Seek: the subtree where `from` would hang is either wholly after
+         * it or wholly before it; every right sibling skipped on the way
+         * down is wholly after it. */
+        const cls_mem_entry_t *best = cls_arena_entry(arena, cls_index_best(arena, root, from, len));
+        uint32_t byte = 0;
+        uint8_t otherbits = 0;
+        bool differs = cls_index_crit(best, from, len, &byte, &otherbits);
+
+        cls_mem_ref_t p = root;
+        while (cls_index_is_node(p)) {
+            const cls_index_node_t *n = cls_index_node(arena, p);
+            if (differs && !cls_index_before(n->byte, n->otherbits, byte, otherbits)) break;
+
+            uint32_t dir = cls_index_dir(n, from, len);
+            if (dir == 0) stack[top++] = n->child[1];
+            p = n->child[dir];
+        }
+
+        if (!differs) {
+            if (inclusive) stack[top++] = p;
+        } else if (((1u + (otherbits | cls_key_byte(from, len, byte))) >> 8) == 0) {
+            stack[top++] = p;
+        }
+    }
+
+    /* Leaves come off the stack in key order */
+    while (top > 0) {
+        cls_mem_ref_t p = stack[--top];
+        while (cls_index_is_node(p)) {
+            const cls_index_node_t *n = cls_index_node(arena, p);
+            stack[top++] = n->child[1];
+            p = n->child[0];
+        }
+        if (!fn(user_ctx, p)) return;
+    }
+}
@@ -0,0 +1,819 @@
+/*
+ * ClawLobstars - Memory Interface Internals
+ * Arena allocator, entry layout, expiry wheel, key and time indexes,
+ * value codec, key interning, persistence and shard/epoch state shared by the
+ * memory store implementation
+ */
+
+#ifndef CLS_MEM_INTERNAL_H
+#define CLS_MEM_INTERNAL_H
+
+#include <pthread.h>
+#include "../include/cls_framework.h"
+
+/* ============================================================
+ * Arena Layout
+ * ============================================================
+ *
+ * pool_size bytes are reserved once at init:
+ *
+ *   [ arena header | page descriptors | page 0 | page 1 | ... ]
+ *
+ * Pages are handed out by a binary buddy allocator. Objects up to
+ * CLS_MEM_SLAB_MAX bytes are carved from single-page slabs, one size
+ * class per page; anything larger takes a power-of-two run of pages.
+ * Everything is addressed by 32-bit refs (offset / CLS_MEM_GRANULE)
+ * so references stay valid wherever the arena is mapped.
+ */
+
+#define CLS_MEM_GRANULE         16
+#define CLS_MEM_GRANULE_SHIFT   4
+#define CLS_MEM_PAGE_SIZE       4096
+#define CLS_MEM_PAGE_SHIFT      12
+#define CLS_MEM_MAX_ORDER       20      /* Largest block: 4 GiB */
+#define CLS_MEM_SLAB_MAX        2048
+#define CLS_MEM_CLASS_COUNT     14
+#define CLS_MEM_MIN_PAGES       7       /* Header page + 7 = CLS_MEMORY_MIN_POOL */
+
+#define CLS_MEM_NIL             0xFFFFFFFFu
+#define CLS_MEM_OBJ_NIL         0xFFFFu
+
+typedef uint32_t cls_mem_ref_t;         /* 0 = null */
+
+typedef enum {
+    CLS_PAGE_FREE   = 0,    /* Head of a free buddy block */
+    CLS_PAGE_SLAB   = 1,    /* Single page split into one size class */
+    CLS_PAGE_BLOCK  = 2,    /* Head of an allocated multi-page block */
+    CLS_PAGE_TAIL   = 3     /* Interior page of a larger block */
+} cls_mem_page_kind_t;
+
+typedef struct {
+    uint32_t    next;           /* Free-list or partial-slab link */
+    uint32_t    prev;
+    uint16_t    inuse;          /* Live objects in this slab */
+    uint16_t    carved;         /* Objects handed out at least once */
+    uint16_t    free_head;      /* Recycled object index */
+    uint8_t     kind;
+    uint8_t     order;          /* Block order, or size class for slabs */
+} cls_mem_page_t;
+
+typedef struct {
+    uint32_t        page_count;
+    uint32_t        desc_offset;        /* Byte offset of descriptor array */
+    size_t          data_offset;        /* Byte offset of page 0 */
+    size_t          size;               /* Usable arena bytes */
+    size_t          used;               /* Bytes handed out + metadata */
+    uint32_t        free_pages;
+    uint32_t        free_lists[CLS_MEM_MAX_ORDER + 1];
+    uint32_t        partial[CLS_MEM_CLASS_COUNT];
+    cls_mem_ref_t   root;               /* Store root object */
+} cls_mem_arena_t;
+
+/* ============================================================
+ * Arena API
+ * ============================================================ */
+
+/* Format `size` bytes at base as an empty arena */
+cls_status_t cls_arena_format(void *base, size_t size);
+
+/* Allocate len bytes; returns 0 when the arena is exhausted */
+cls_mem_ref_t cls_arena_alloc(cls_mem_arena_t *arena, size_t len);
+
+/* Return an allocation to its slab or buddy list */
+void cls_arena_free(cls_mem_arena_t *arena, cls_mem_ref_t ref);
+
+/* Bytes actually reserved for an allocation of len (class-rounded) */
+size_t cls_arena_alloc_size(size_t len);
+
+/* Reserved size of a live allocation */
+size_t cls_arena_block_size(const cls_mem_arena_t *arena, cls_mem_ref_t ref);
+
+static inline void *cls_arena_ptr(const cls_mem_arena_t *arena, cls_mem_ref_t ref) {
+    return ref ? (uint8_t *)arena + ((size_t)ref << CLS_MEM_GRANULE_SHIFT) : NULL;
+}
+
+static inline cls_mem_ref_t cls_arena_ref(const cls_mem_arena_t *arena, const void *p) {
+    return p ? (cls_mem_ref_t)(((const uint8_t *)p - (const uint8_t *)arena)
+                               >> CLS_MEM_GRANULE_SHIFT) : 0;
+}
+
+/* ============================================================
+ * Entries
+ * ============================================================ */
+
+#define CLS_MEM_KEY_MAX         CLS_MEMORY_KEY_MAX
+#define CLS_WHEEL_NONE          0xFFFFu
+
+/* FNV-1a, shared by the store and the key builder */
+#define CLS_FNV_OFFSET          2166136261u
+#define CLS_FNV_PRIME           16777619u
+
+/* Entries are sized to their key and live in arena slabs */
+typedef struct cls_mem_entry {
+    cls_mem_entry_meta_t    meta;
+    cls_mem_ref_t           data;
+    uint16_t                key_len;
+    uint16_t                wheel_slot;     /* level * 64 + slot, or NONE */
+    cls_mem_ref_t           wheel_next;
+    cls_mem_ref_t           wheel_prev;
+    uint32_t                pins;           /* Outstanding borrows */
+    uint32_t                clock_seen;     /* access_count when the hand passed */
+    uint32_t                born;           /* View sequence when created */
+    uint16_t                flags;
+    uint16_t                held;           /* Open views still to return it, once unlinked */
+    char                    key[];
+} cls_mem_entry_t;
+
+#define CLS_ENTRY_WINDOW        0x0001  /* In the W-TinyLFU admission window */
+#define CLS_ENTRY_RAW           0x0002  /* Tried for the cold tier, would not compress */
+
+static inline cls_mem_entry_t *cls_arena_entry(const cls_mem_arena_t *arena, cls_mem_ref_t ref) {
+    return (cls_mem_entry_t *)cls_arena_ptr(arena, ref);
+}
+
+/* Absolute expiry in microseconds; entries without TTL never expire */
+static inline uint64_t cls_entry_expiry_us(const cls_mem_entry_t *entry) {
+    return entry->meta.created_at + (uint64_t)entry->meta.ttl_seconds * 1000000ULL;
+}
+
+/* ============================================================
+ * Expiry Wheel
+ * ============================================================
+ *
+ * Hierarchical timing wheel over ~1 ms ticks (2^10 us). Level L has 64
+ * slots of 64^L ticks each; an entry sits at the lowest level whose span
+ * covers its remaining time and cascades down as the wheel turns. Six
+ * levels reach ~2 years; longer TTLs park in the top level and are
+ * re-filed when their slot comes round. Per-level occupancy bitmaps let
+ * an advance jump straight to the next non-empty slot, so its cost
+ * follows the number of entries touched rather than elapsed time.
+ */
+
+#define CLS_WHEEL_TICK_SHIFT    10
+#define CLS_WHEEL_LEVELS        6
+#define CLS_WHEEL_SLOTS         64
+#define CLS_WHEEL_SLOT_BITS     6
+
+typedef struct {
+    uint64_t        tick;                   /* Last fully processed tick */
+    uint64_t        occupied[CLS_WHEEL_LEVELS];
+    cls_mem_ref_t   slots[CLS_WHEEL_LEVELS][CLS_WHEEL_SLOTS];
+    uint32_t        count;
+} cls_mem_wheel_t;
+
+/* Called for each entry whose expiry has passed; already unlinked */
+typedef void (*cls_wheel_expire_fn)(void *user_ctx, cls_mem_ref_t ref);
+
+void cls_wheel_init(cls_mem_wheel_t *wheel, uint64_t now_us);
+
+/* Link an entry by its TTL expiry */
+void cls_wheel_insert(cls_mem_wheel_t *wheel, cls_mem_arena_t *arena, cls_mem_ref_t ref);
+
+/* Unlink an entry; no-op when it is not on the wheel */
+void cls_wheel_remove(cls_mem_wheel_t *wheel, cls_mem_arena_t *arena, cls_mem_ref_t ref);
+
+/* Turn the wheel up to now_us, handing every expired entry to fn */
+uint32_t cls_wheel_advance(cls_mem_wheel_t *wheel, cls_mem_arena_t *arena,
+                           uint64_t now_us, cls_wheel_expire_fn fn, void *user_ctx);
+
+/* ============================================================
+ * Key Index
+ * ============================================================
+ *
+ * Crit-bit tree over entry keys, one per shard, kept under the shard
+ * lock. Leaves are the entries themselves; each internal node is one
+ * small arena object naming the first bit where its two subtrees differ,
+ * so an in-order walk yields keys in strcmp order and a seek costs one
+ * pass down the tree. Child refs carry CLS_INDEX_NODE_BIT for internal
+ * nodes, which caps a shard arena at 32 GiB.
+ */
+
+#define CLS_INDEX_NODE_BIT      0x80000000u
+#define CLS_INDEX_ARENA_MAX     ((uint64_t)CLS_INDEX_NODE_BIT << CLS_MEM_GRANULE_SHIFT)
+#define CLS_INDEX_DEPTH         (CLS_MEM_KEY_MAX * 8 + 1)
+
+/* Return false to stop the scan */
+typedef bool (*cls_index_visit_fn)(void *user_ctx, cls_mem_ref_t entry);
+
+/* Link a new entry; its key must not be indexed yet */
+cls_status_t cls_index_insert(cls_mem_arena_t *arena, cls_mem_ref_t *root, cls_mem_ref_t entry);
+
+/* Unlink an entry; no-op when it is not the indexed one for its key */
+void cls_index_remove(cls_mem_arena_t *arena, cls_mem_ref_t *root, cls_mem_ref_t entry);
+
+/* Swap the leaf for old with fresh, which carries the same key */
+void cls_index_replace(cls_mem_arena_t *arena, cls_mem_ref_t *root,
+                       cls_mem_ref_t old, cls_mem_ref_t fresh);
+
+/* Visit entries in key order starting at `from` (NULL = first key);
+ * `inclusive` decides whether an exact match is visited */
+void cls_index_scan(const cls_mem_arena_t *arena, cls_mem_ref_t root,
+                    const char *from, bool inclusive,
+                    cls_index_visit_fn fn, void *user_ctx);
+
+/* ============================================================
+ * Time Log
+ * ============================================================
+ *
+ * Per-shard array of (created_at, entry) records sorted by creation
+ * time, kept under the shard lock. New entries append at the tail;
+ * deletes leave tombstones that are trimmed off the front or compacted
+ * once they outnumber live records. A time window costs one binary
+ * search plus the records inside it.
+ */
+
+typedef struct {
+    uint64_t        created_at;
+    cls_mem_ref_t   entry;          /* 0 = removed */
+    uint32_t        pad;
+} cls_mem_tlog_rec_t;
+
+typedef struct {
+    cls_mem_ref_t   block;          /* Record array */
+    uint32_t        cap;
+    uint32_t        head;           /* First record in use */
+    uint32_t        len;            /* Records from head, tombstones included */
+    uint32_t        dead;
+} cls_mem_tlog_t;
+
+cls_status_t cls_tlog_append(cls_mem_tlog_t *log, cls_mem_arena_t *arena,
+                             uint64_t created_at, cls_mem_ref_t ref);
+void cls_tlog_remove(cls_mem_tlog_t *log, cls_mem_arena_t *arena,
+                     uint64_t created_at, cls_mem_ref_t ref);
+
+/* Point the record for old at fresh, which keeps old's creation time */
+void cls_tlog_replace(cls_mem_tlog_t *log, cls_mem_arena_t *arena,
+                      uint64_t created_at, cls_mem_ref_t old, cls_mem_ref_t fresh);
+
+/* Records, tombstones included, created in [after, before] (before 0 =
+ * open-ended): what a scan of that window would walk */
+uint32_t cls_tlog_count(const cls_mem_tlog_t *log, const cls_mem_arena_t *arena,
+                        uint64_t after, uint64_t before);
+
+/* Visit entries created in [after, before] (before 0 = open-ended) in
+ * creation order */
+void cls_tlog_scan(const cls_mem_tlog_t *log, const cls_mem_arena_t *arena,
+                   uint64_t after, uint64_t before,
+                   cls_index_visit_fn fn, void *user_ctx);
+
+/* ============================================================
+ * Eviction
+ * ============================================================
+ *
+ * With an eviction policy each shard holds at most its share of
+ * max_entries, and a full shard (or arena) makes room by evicting:
+ *
+ *   CLOCK     a hand sweeps the table; an entry whose access_count has
+ *             moved since the last pass gets a second chance
+ *   LRU       sampled: the least recently accessed of a few random slots
+ *   TINYLFU   new entries land in a small FIFO window; one leaving the
+ *             window must beat the sampled-LRU victim of the main region
+ *             on a count-min frequency estimate, or it is evicted instead
+ */
+
+#define CLS_SKETCH_DEPTH        4
+
+typedef struct {
+    cls_mem_ref_t   block;          /* DEPTH rows of 4-bit counters (one byte each) */
+    uint32_t        mask;           /* Row width - 1 */
+    uint32_t        additions;      /* Since last aging */
+    uint32_t        sample;         /* Aging period */
+} cls_mem_sketch_t;
+
+typedef struct {
+    cls_mem_ref_t   block;          /* Ring of entry refs, 0 = removed */
+    uint32_t        cap;
+    uint32_t        head;
+    uint32_t        used;           /* Ring slots from head, holes included */
+    uint32_t        live;
+} cls_mem_window_t;
+
+cls_status_t cls_sketch_init(cls_mem_sketch_t *sk, cls_mem_arena_t *arena, uint32_t capacity);
+void cls_sketch_add(cls_mem_sketch_t *sk, const cls_mem_arena_t *arena, uint32_t mixed);
+uint32_t cls_sketch_estimate(const cls_mem_sketch_t *sk, const cls_mem_arena_t *arena,
+                             uint32_t mixed);
+void cls_sketch_age(cls_mem_sketch_t *sk, cls_mem_arena_t *arena);
+
+cls_status_t cls_window_init(cls_mem_window_t *w, cls_mem_arena_t *arena, uint32_t capacity);
+bool cls_window_full(const cls_mem_window_t *w);
+void cls_window_push(cls_mem_window_t *w, cls_mem_arena_t *arena, cls_mem_ref_t ref);
+
+/* Oldest live entry, now out of the window; 0 when empty */
+cls_mem_ref_t cls_window_pop(cls_mem_window_t *w, cls_mem_arena_t *arena);
+void cls_window_remove(cls_mem_window_t *w, cls_mem_arena_t *arena, cls_mem_ref_t ref);
+void cls_window_replace(cls_mem_window_t *w, cls_mem_arena_t *arena,
+                        cls_mem_ref_t old, cls_mem_ref_t fresh);
+
+/* ============================================================
+ * Value Codec
+ * ============================================================ */
+
+/* Compress n bytes into dst; returns the compressed size, or 0 if it
+ * would not fit in cap */
+size_t cls_lz_compress(const uint8_t *src, size_t n, uint8_t *dst, size_t cap);
+
+/* Expand into exactly out_len bytes; CLS_ERR_INTERNAL on a corrupt block */
+cls_status_t cls_lz_decompress(const uint8_t *src, size_t n, uint8_t *dst, size_t out_len);
+
+/* ============================================================
+ * Key Interning
+ * ============================================================
+ *
+ * Interned strings live on the heap, outside the arena, so handles stay
+ * valid across evictions, deletes and snapshots until the store is
+ * destroyed. The table itself is open-addressed on the FNV hash.
+ */
+
+typedef struct {
+    pthread_mutex_t     lock;           /* Concurrent stores only */
+    cls_mem_key_t      *slots;          /* str == NULL marks an empty slot */
+    uint32_t            mask;
+    uint32_t            count;
+    bool                concurrent;
+} cls_mem_intern_t;
+
+cls_status_t cls_intern_init(cls_mem_intern_t *in, bool concurrent);
+void cls_intern_destroy(cls_mem_intern_t *in);
+
+/* Return the shared copy of key, adding it on first use */
+cls_status_t cls_intern_get(cls_mem_intern_t *in, const char *key, size_t key_len,
+                            uint32_t hash, cls_mem_key_t *out);
+
+/* ============================================================
+ * Hot Keys
+ * ============================================================
+ *
+ * One ranking per operation kind, for whole keys and for prefixes: a
+ * count-min sketch with conservative update estimates each sampled key,
+ * and a min-heap of CLS_MEMORY_HOT_MAX keeps the largest estimates seen.
+ * All of it lives in one fixed heap block. Sampled operations that find
+ * the tracker busy are dropped rather than waited on.
+ */
+
+#define CLS_HOT_DEPTH           4
+#define CLS_HOT_WIDTH           1024
+#define CLS_HOT_KINDS           3
+
+typedef struct {
+    uint64_t        count;
+    uint32_t        hash;
+    uint32_t        len;
+    char            key[CLS_MEM_KEY_MAX];
+} cls_mem_hot_slot_t;
+
+typedef struct {
+    uint32_t            rows[CLS_HOT_DEPTH][CLS_HOT_WIDTH];
+    uint32_t            additions;      /* Since last halving */
+    uint32_t            size;
+    cls_mem_hot_slot_t  heap[CLS_MEMORY_HOT_MAX]; /* Min-heap on count */
+} cls_mem_hot_rank_t;
+
+typedef struct {
+    pthread_mutex_t     lock;           /* Concurrent stores only */
+    bool                concurrent;
+    uint32_t            sample;         /* Weight of each recorded operation */
+    cls_mem_hot_rank_t  ranks[CLS_HOT_KINDS][2]; /* [kind][prefix] */
+} cls_mem_hot_t;
+
+cls_mem_hot_t *cls_hot_create(uint32_t sample, bool concurrent);
+void cls_hot_free(cls_mem_hot_t *hot);
+void cls_hot_reset(cls_mem_hot_t *hot);
+
+/* Count one sampled operation on key and on its prefix */
+void cls_hot_record(cls_mem_hot_t *hot, cls_mem_hot_kind_t kind,
+                    const char *key, size_t key_len, uint32_t hash);
+
+/* Copy out a ranking, largest first */
+uint32_t cls_hot_top(cls_mem_hot_t *hot, cls_mem_hot_kind_t kind, bool prefixes,
+                     cls_mem_hot_entry_t *out, uint32_t max);
+
+/* ============================================================
+ * Persistence
+ * ============================================================
+ *
+ * A persistent store keeps two files next to each other:
+ *
+ *   <path>.snap   [ header page | raw pool image | fixups ]
+ *   <path>.wal    [ header | record | record | ... ]
+ *
+ * Arenas address everything by offset, so a snapshot is the pool bytes
+ * as they stand under all shard locks, mapped back privately at init
+ * with no per-entry work. Fixups name what the image cannot say on its
+ * own: blocks still waiting on the retire rings, entries held for open
+ * views, and pins held by borrows that will not survive the restart.
+ * Stores and deletes after the snapshot go to the log, tagged with its
+ * generation; a log from any other generation is stale and ignored.
+ * Entry times come from a store clock that resumes across restarts from
+ * the saved anchor.
+ */
+
+#define CLS_SNAP_HDR_SIZE       4096
+#define CLS_WAL_RECORD_MAX      (1u << 30)      /* Largest logged value */
+
+typedef enum {
+    CLS_WAL_STORE   = 1,
+    CLS_WAL_DELETE  = 2
+} cls_mem_wal_type_t;
+
+/* The first two match cls_mem_retire_kind_t */
+typedef enum {
+    CLS_FIXUP_ENTRY = 0,    /* Retired entry: free it and its value */
+    CLS_FIXUP_BLOCK = 1,    /* Retired bare block */
+    CLS_FIXUP_UNPIN = 2,    /* Live entry: clear its pins */
+    CLS_FIXUP_HELD  = 3     /* Entry held by an open view: drop one hold */
+} cls_mem_fixup_kind_t;
+
+/* Followed by the key, then the value, padded to 8 bytes. The CRC
+ * covers everything after itself. */
+typedef struct {
+    uint32_t        crc;
+    uint32_t        size;
+    uint8_t         type;
+    uint8_t         pad;
+    uint16_t        key_len;
+    uint32_t        ttl_sec;
+    uint64_t        time_us;        /* Store clock when applied */
+    uint64_t        data_len;
+} cls_mem_wal_rec_t;
+
+/* shard_count, evict and max_entries in the header describe the default
+ * namespace; pool_size is the whole pool */
+typedef struct {
+    char            prefix[CLS_MEMORY_NS_PREFIX_MAX];
+    uint64_t        pool_size;
+    uint32_t        shard_count;
+    uint32_t        evict;
+    uint32_t        max_entries;
+    uint32_t        pad;
+} cls_mem_snap_ns_t;
+
+typedef struct {
+    uint64_t        magic;
+    uint32_t        version;
+    uint32_t        shard_count;
+    uint64_t        gen;
+    uint64_t        pool_size;
+    uint64_t        store_time_us;  /* Clock anchor: store and wall time */
+    uint64_t        real_time_us;
+    uint64_t        fixup_count;
+    uint32_t        evict;
+    uint32_t        max_entries;
+    uint32_t        ns_count;       /* Namespaces besides the default */
+    uint32_t        view_seq;       /* Stamp for new entries */
+    cls_mem_snap_ns_t ns[CLS_MEMORY_NS_MAX];
+    uint32_t        crc;            /* Over the fields above */
+    uint32_t        pad;
+} cls_mem_snap_hdr_t;
+
+typedef struct {
+    uint32_t        shard;
+    cls_mem_ref_t   ref;
+    uint32_t        kind;
+} cls_mem_snap_fixup_t;
+
+typedef struct {
+    cls_mem_snap_hdr_t          hdr;
+    void                       *map;
+    size_t                      map_len;
+    uint8_t                    *pool;
+    const cls_mem_snap_fixup_t *fixups;
+} cls_mem_snap_t;
+
+/* Appends fill one buffer while the other is written. `appended`,
+ * `written` and `durable` are running byte counts (LSNs) that never
+ * rewind, so a reset cannot strand a waiting committer. */
+typedef struct {
+    int                 fd;
+    bool                sync;           /* Stores wait for fdatasync */
+    bool                flushing;       /* A writer has the spare buffer */
+    cls_status_t        status;         /* Sticky I/O failure */
+    pthread_mutex_t     lock;
+    pthread_cond_t      cond;
+    uint8_t            *buf;
+    size_t              buf_len;
+    size_t              buf_cap;
+    uint8_t            *spare;
+    size_t              spare_cap;
+    uint64_t            appended;
+    uint64_t            written;
+    uint64_t            durable;
+    uint64_t            size;           /* Bytes in the file, buffered included */
+} cls_mem_wal_t;
+
+typedef void (*cls_wal_replay_fn)(void *user_ctx, const cls_mem_wal_rec_t *rec,
+                                  const char *key, const void *data);
+
+uint64_t cls_real_time_us(void);
+
+/* Read the generation and clock anchor of an existing log */
+cls_status_t cls_wal_peek(const char *path, uint64_t *gen,
+                          uint64_t *store_time_us, uint64_t *real_time_us);
+
+/* Open or create the log, replaying its records when it belongs to `gen`
+ * and cutting off any torn tail */
+cls_status_t cls_wal_open(cls_mem_wal_t *wal, const char *path, uint64_t gen,
+                          uint64_t now_us, bool sync,
+                          cls_wal_replay_fn fn, void *user_ctx);
+void cls_wal_close(cls_mem_wal_t *wal);
+
+/* Buffer one record (shard lock held, so per-key order is kept) */
+cls_status_t cls_wal_append(cls_mem_wal_t *wal, uint8_t type,
+                            const char *key, size_t key_len,
+                            const void *data, size_t data_len,
+                            uint32_t ttl_sec, uint64_t time_us, uint64_t *lsn);
+
+/* Wait until lsn is on disk (sync logs only; call without the shard lock) */
+cls_status_t cls_wal_commit(cls_mem_wal_t *wal, uint64_t lsn);
+cls_status_t cls_wal_flush(cls_mem_wal_t *wal);
+cls_status_t cls_wal_reset(cls_mem_wal_t *wal, uint64_t gen, uint64_t now_us);
+uint64_t cls_wal_size(cls_mem_wal_t *wal);
+
+/* Write header, pool image and fixups to a temp file, then rename it
+ * into place */
+cls_status_t cls_snap_write(const char *path, cls_mem_snap_hdr_t *hdr, const void *pool,
+                            const cls_mem_snap_fixup_t *fixups);
+
+/* The same image at fd's current position, without syncing */
+cls_status_t cls_snap_emit(int fd, cls_mem_snap_hdr_t *hdr, const void *pool,
+                           const cls_mem_snap_fixup_t *fixups);
+uint64_t cls_snap_size(const cls_mem_snap_hdr_t *hdr);
+
+cls_status_t cls_snap_map(const char *path, cls_mem_snap_t *snap);
+
+/* Map an image stored len bytes at offset inside a larger file; offset
+ * need only be 4096-aligned */
+cls_status_t cls_snap_map_fd(int fd, uint64_t offset, uint64_t len, cls_mem_snap_t *snap);
+void cls_snap_unmap(void *map, size_t len);
+
+/* ============================================================
+ * Shards and Epochs
+ * ============================================================
+ *
+ * The pool is split into namespaces by key prefix, and each namespace
+ * into power-of-two shards picked by key hash, each with its own arena.
+ * In concurrent mode writers serialize on the shard mutex while readers
+ * take no lock: they announce the global epoch in a per-thread slot,
+ * writers publish slot contents before the control byte and retire
+ * unlinked entries and tables instead of freeing them. A retired object
+ * goes back to the arena once the epoch has advanced twice past its
+ * retirement, i.e. no reader can still hold it. Entries pinned by
+ * cls_memory_borrow are held back, in either mode, until released.
+ * A shared segment keeps each shard's retire ring in the segment, its
+ * slots in the shard's arena, so whichever process next holds the shard
+ * lock frees what another one retired, even after that one has gone.
+ */
+
+#define CLS_MEM_MAX_SHARDS      256
+#define CLS_MEM_MAX_READERS     128
+#define CLS_MEM_RETIRE_INIT     1024    /* Initial retire ring capacity */
+#define CLS_MEM_RETIRE_SHM_INIT 64      /* Same, for a ring in a shared arena */
+#define CLS_MEM_RETIRE_BATCH    64      /* Reclaim attempt interval */
+#define CLS_MEM_COUNT_FLUSH     1024    /* Reader hit/miss fold interval */
+#define CLS_MEM_NS_SLOTS        (CLS_MEMORY_NS_MAX + 1)
+
+#define CLS_LOAD_ACQ(p)         __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define CLS_LOAD_RLX(p)         __atomic_load_n((p), __ATOMIC_RELAXED)
+#define CLS_STORE_REL(p, v)     __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define CLS_STORE_RLX(p, v)     __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define CLS_ADD_RLX(p, v)       __atomic_fetch_add((p), (v), __ATOMIC_RELAXED)
+#define CLS_SUB_RLX(p, v)       __atomic_fetch_sub((p), (v), __ATOMIC_RELAXED)
+
+typedef struct cls_mem_store cls_mem_store_t;
+typedef struct cls_mem_shm cls_mem_shm_t;
+
+typedef enum {
+    CLS_RETIRE_ENTRY    = 0,    /* Entry plus its value block */
+    CLS_RETIRE_BLOCK    = 1     /* Bare arena block */
+} cls_mem_retire_kind_t;
+
+typedef struct {
+    uint64_t        epoch;
+    cls_mem_ref_t   ref;
+    uint32_t        kind;
+} cls_mem_retired_t;
+
+/* FIFO ring of pending frees (shard lock held). Slots are on the heap,
+ * or in the shard's arena at `block` when the ring is in a segment. */
+typedef struct {
+    cls_mem_ref_t   block;          /* Shared rings only; 0 until first use */
+    uint32_t        cap;
+    uint32_t        head;
+    uint32_t        count;
+} cls_mem_ring_t;
+
+/* ---- Snapshot views ----
+ *
+ * cls_memory_snapshot_begin stamps a view with the current sequence
+ * under every shard lock and bumps it, so entries created later carry a
+ * higher `born` and the view skips them. A view walks one shard at a
+ * time through the key index. An entry unlinked while a view could still
+ * return it (born no later than the view, and past its scan position or
+ * in a shard not reached yet) is held on that shard's list instead of
+ * retired; the view hands held entries out after the shard's live ones.
+ */
+
+#define CLS_MEM_VIEW_MAX        CLS_MEMORY_SNAPSHOT_MAX
+
+typedef enum {
+    CLS_VIEW_IDLE       = 0,    /* No view, or done with this shard */
+    CLS_VIEW_PENDING    = 1,    /* Not reached: hold whatever it can see */
+    CLS_VIEW_LIVE       = 2,    /* Walking the index: hold keys past pos */
+    CLS_VIEW_HELD       = 3     /* Handing out held entries: hold nothing */
+} cls_mem_view_state_t;
+
+/* One view's state in one shard (shard lock held) */
+typedef struct {
+    uint32_t        state;
+    uint32_t        at;             /* The view's sequence */
+    cls_mem_ref_t  *held;           /* Unlinked entries still to return */
+    uint32_t        held_count;
+    uint32_t        held_cap;
+    bool            lost;           /* An entry could not be held */
+    bool            started;        /* pos holds a key */
+    char            pos[CLS_MEM_KEY_MAX]; /* Last key returned while LIVE */
+} cls_mem_view_shard_t;
+
+/* Per-thread reader slot; padded so neighbours never share a line */
+typedef struct {
+    uint64_t        epoch;          /* Announced epoch, 0 = idle */
+    cls_mem_store_t *store;         /* The owner's handle */
+    uint32_t        depth;          /* Nested guards */
+    uint32_t        owned;          /* Owning process id, 0 = free */
+    uint32_t        pending;        /* Unfolded counts, all namespaces */
+    uint32_t        hot_tick;       /* Operations since the last hot-key sample */
+    uint32_t        hits[CLS_MEM_NS_SLOTS];
+    uint32_t        misses[CLS_MEM_NS_SLOTS];
+    uint8_t         pad[128 - 24 - 8 * CLS_MEM_NS_SLOTS - sizeof(void *)];
+} cls_mem_reader_t;
+
+/* Global epoch and reader slots: part of the store, or of the segment
+ * header when processes share it */
+typedef struct {
+    uint64_t            epoch;          /* Global epoch, starts at 1 */
+    uint8_t             pad0[56];
+    uint32_t            reader_high;    /* Slots ever claimed */
+    uint8_t             pad1[60];
+    cls_mem_reader_t    readers[CLS_MEM_MAX_READERS];
+} cls_mem_epoch_t;
+
+typedef struct {
+    pthread_mutex_t     lock;           /* Writers only */
+    pthread_mutex_t    *mutex;          /* &lock, or the segment's */
+    cls_mem_arena_t    *arena;
+    size_t              used_reported;  /* Arena bytes folded into ctx->used */
+    cls_mem_ring_t     *ring;           /* &ring_own, or the segment's */
+    cls_mem_ring_t      ring_own;
+    cls_mem_retired_t  *retired;        /* ring_own's slots */
+    uint32_t            retired_since;  /* Our retirements since last reclaim */
+    uint32_t            ns;             /* Owning namespace */
+    uint32_t            hot_tick;       /* Hot-key sampling under the lock */
+    uint32_t            views_open;     /* Views not yet done with this shard */
+    cls_mem_view_shard_t views[CLS_MEM_VIEW_MAX];
+    uint8_t             pad[64];
+} cls_mem_shard_t;
+
+/* A namespace's slice of the store: a run of shards with their own
+ * policy and quota. Slot 0 is the default namespace. */
+typedef struct {
+    char                prefix[CLS_MEMORY_NS_PREFIX_MAX];
+    uint32_t            prefix_len;
+    size_t              pool_off;       /* Where its shards start in the pool */
+    size_t              pool_size;
+    uint32_t            shard_first;
+    uint32_t            shard_count;
+    uint32_t            shard_bits;
+    cls_mem_evict_t     evict;
+    uint32_t            max_entries;
+    uint32_t            shard_cap;      /* Entries per shard under eviction */
+    uint32_t            entry_count;
+    uint64_t            hits;
+    uint64_t            misses;
+    uint64_t            evictions;
+    uint64_t            rejections;     /* Window entries that lost admission */
+} cls_mem_ns_t;
+
+struct cls_mem_store {
+    cls_memory_ctx_t   *ctx;
+    cls_mem_shard_t    *shards;
+    uint32_t            shard_count;
+    bool                concurrent;
+    pthread_key_t       reader_key;
+    cls_mem_ns_t       *ns;             /* ns_own, or the segment's */
+    uint32_t            ns_count;       /* Including the default */
+    size_t              inline_max;     /* Largest value kept inside its entry */
+    uint64_t            cold_after_us;  /* Idle time before compression, 0 = off */
+    size_t              cold_min_bytes;
+    cls_mem_wal_t      *wal;            /* NULL = volatile */
+    char               *snap_path;
+    uint64_t            gen;            /* Generation of the last snapshot */
+    uint64_t            checkpoint_bytes;
+    int64_t             time_offset;    /* Store clock minus CLOCK_MONOTONIC */
+    void               *snap_map;       /* Pool mapping when loaded from a snapshot */
+    size_t              snap_len;
+    cls_mem_intern_t    intern;
+    cls_mem_hot_t      *hot;            /* NULL = not tracking */
+    uint32_t            view_seq;       /* Stamp for new entries; bumped under all shard locks */
+    uint32_t            views_used;     /* Bitmap of claimed view slots */
+    cls_mem_shm_t      *shm;            /* NULL = private to this process */
+    cls_mem_epoch_t    *ep;             /* ep_own, or the segment's */
+    cls_mem_ns_t        ns_own[CLS_MEM_NS_SLOTS];
+    uint8_t             pad0[64];
+    cls_mem_epoch_t     ep_own;
+};
+
+cls_status_t cls_epoch_init(cls_mem_store_t *store);
+void cls_epoch_destroy(cls_mem_store_t *store);
+
+/* Enter a read-side critical section. Returns NULL when the store is not
+ * concurrent or every reader slot is taken; callers then fall back to the
+ * shard lock. */
+cls_mem_reader_t *cls_epoch_enter(cls_mem_store_t *store);
+void cls_epoch_leave(cls_mem_reader_t *reader);
+
+/* Fold a reader's private hit/miss counts into its namespaces and the
+ * context */
+void cls_epoch_fold_counts(cls_mem_reader_t *reader);
+
+/* A ring's slots wherever they live (shard lock held) */
+static inline cls_mem_retired_t *cls_ring_slots(const cls_mem_shard_t *shard) {
+    if (shard->ring == &shard->ring_own) return shard->retired;
+    return (cls_mem_retired_t *)cls_arena_ptr(shard->arena, shard->ring->block);
+}
+
+/* Defer freeing ref until no reader can reach it (shard lock held) */
+void cls_shard_retire(cls_mem_store_t *store, cls_mem_shard_t *shard,
+                      cls_mem_ref_t ref, cls_mem_retire_kind_t kind);
+
+/* Free whatever retired memory is past its grace period and unpinned */
+void cls_shard_reclaim(cls_mem_store_t *store, cls_mem_shard_t *shard);
+
+/* ============================================================
+ * Shared Segment
+ * ============================================================
+ *
+ * With shm_name set the store lives in a named POSIX shared-memory
+ * object that other processes attach to:
+ *
+ *   [ header | pool ]
+ *
+ * The header holds what every attached process must agree on. That is
+ * the geometry, the namespaces with their counters, the shard locks
+ * (robust process-shared mutexes) and the global epoch with its reader
+ * slots.
+ * Arenas address everything by offset, so each process may map the
+ * segment at any address. The shard retire rings are here too, so a
+ * process's retirements are freed after it detaches or dies; interned
+ * keys and hot-key counts stay private to each process. The first process formats the
+ * pool and then publishes the magic; the last one to detach unlinks
+ * the name, counting processes that died attached as gone.
+ *
+ * A lock whose owner died is handed to the next process to take it.
+ * The header lock only guards the process table, which the sweep
+ * repairs. A shard lock may have died mid-write: the taker closes an
+ * odd table seq so readers stop retrying, and counts the takeover in
+ * lock_recoveries. The dead writer's operation itself may be lost or
+ * half-applied in that shard.
+ */
+
+#define CLS_MEM_SHM_PROCS       64      /* Processes attached at once */
+
+typedef struct {
+    uint64_t            magic;          /* Stored last by the creator */
+    uint32_t            version;
+    uint32_t            hdr_size;       /* sizeof(cls_mem_shm_hdr_t): same build */
+    uint64_t            pool_size;
+    uint32_t            shard_count;
+    uint32_t            ns_count;
+    pthread_mutex_t     lock;           /* Attach and detach */
+    uint32_t            procs[CLS_MEM_SHM_PROCS]; /* Attached process ids, 0 = free */
+    bool                dead;           /* Name unlinked; attachers start over */
+    uint32_t            lock_recoveries; /* Shard locks taken over from dead writers */
+    pthread_mutex_t     shard_locks[CLS_MEM_MAX_SHARDS];
+    cls_mem_ring_t      rings[CLS_MEM_MAX_SHARDS]; /* Retire rings, slots in each arena */
+    cls_mem_ns_t        ns[CLS_MEM_NS_SLOTS];
+    cls_mem_epoch_t     epoch;
+} cls_mem_shm_hdr_t;
+
+struct cls_mem_shm {
+    cls_mem_shm_hdr_t  *hdr;
+    uint8_t            *pool;
+    size_t              map_len;
+    char               *name;
+    uint32_t            proc;           /* Our slot in procs */
+};
+
+/* Create the segment or attach to the one already there. A creator gets
+ * a zeroed header with its locks ready and formats the pool before
+ * publishing; an attacher waits for the publish. */
+cls_status_t cls_shm_open(const char *name, size_t pool_size, cls_mem_shm_t *shm,
+                          bool *created);
+void cls_shm_publish(cls_mem_shm_t *shm);
+
+/* Lock a segment mutex; true when its previous owner died holding it,
+ * in which case it is now consistent and held by the caller */
+bool cls_shm_lock(pthread_mutex_t *mutex);
+
+/* Detach; the last process out unlinks the name */
+void cls_shm_close(cls_mem_shm_t *shm);
+
+#endif /* CLS_MEM_INTERNAL_H */
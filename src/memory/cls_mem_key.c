@@ -0,0 +1,156 @@
+/*
+ * ClawLobstars - Memory Key Handles
+ * Interned, pre-hashed keys and a formatting-free key builder
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "cls_mem_internal.h"
+
+/* ============================================================
+ * Internal Helpers
+ * ============================================================ */
+
+#define CLS_INTERN_MIN_SLOTS    64
+
+static uint32_t cls_intern_probe(const cls_mem_intern_t *in, const char *key,
+                                 size_t key_len, uint32_t hash) {
+    uint32_t i = hash & in->mask;
+    while (in->slots[i].str) {
+        const cls_mem_key_t *k = &in->slots[i];
+        if (k->hash == hash && k->len == key_len && memcmp(k->str, key, key_len) == 0)
+            break;
+        i = (i + 1) & in->mask;
+    }
+    return i;
+}
+
+/* Double the table, keeping it at most half full */
+static cls_status_t cls_intern_grow(cls_mem_intern_t *in) {
+    uint32_t capacity = in->slots ? (in->mask + 1) * 2 : CLS_INTERN_MIN_SLOTS;
+    cls_mem_key_t *slots = (cls_mem_key_t *)calloc(capacity, sizeof(cls_mem_key_t));
+    if (!slots) return CLS_ERR_NOMEM;
+
+    for (uint32_t i = 0; in->slots && i <= in->mask; i++) {
+        if (!in->slots[i].str) continue;
+        uint32_t j = in->slots[i].hash & (capacity - 1);
+        while (slots[j].str) j = (j + 1) & (capacity - 1);
+        slots[j] = in->slots[i];
+    }
+
+    free(in->slots);
+    in->slots = slots;
+    in->mask = capacity - 1;
+    return CLS_OK;
+}
+
+/* ============================================================
+ * Interning
+ * ============================================================ */
+
+cls_status_t cls_intern_init(cls_mem_intern_t *in, bool concurrent) {
+    if (!in) return CLS_ERR_INVALID;
+
+    memset(in, 0, sizeof(*in));
+    if (concurrent && pthread_mutex_init(&in->lock, NULL) != 0)
+        return CLS_ERR_INTERNAL;
+    in->concurrent = concurrent;
+    return CLS_OK;
+}
+
+void cls_intern_destroy(cls_mem_intern_t *in) {
+    if (!in) return;
+
+    for (uint32_t i = 0; in->slots && i <= in->mask; i++)
+        free((char *)in->slots[i].str);
+    free(in->slots);
+    if (in->concurrent) pthread_mutex_destroy(&in->lock);
+    memset(in, 0, sizeof(*in));
+}
+
+cls_status_t cls_intern_get(cls_mem_intern_t *in, const char *key, size_t key_len,
+                            uint32_t hash, cls_mem_key_t *out) {
+    if (!in || !key || !out) return CLS_ERR_INVALID;
+
+    cls_status_t status = CLS_OK;
+    if (in->concurrent) pthread_mutex_lock(&in->lock);
+
+    if ((in->count + 1) * 2 > (in->slots ? in->mask + 1 : 0))
+        status = cls_intern_grow(in);
+
+    if (CLS_IS_OK(status)) {
+        uint32_t i = cls_intern_probe(in, key, key_len, hash);
+        if (!in->slots[i].str) {
+            char *copy = (char *)malloc(key_len + 1);
+            if (copy) {
+                memcpy(copy, key, key_len);
+                copy[key_len] = '\0';
+                in->slots[i].str = copy;
+                in->slots[i].hash = hash;
+                in->slots[i].len = (uint32_t)key_len;
+                in->count++;
+            } else {
+                status = CLS_ERR_NOMEM;
+            }
+        }
+        if (CLS_IS_OK(status)) *out = in->slots[i];
+    }
+
+    if (in->concurrent) pthread_mutex_unlock(&in->lock);
+    return status;
+}
+
+/* ============================================================
+ * Key Builder
+ * ============================================================ */
+
+void cls_mem_key_begin(cls_mem_key_builder_t *b) {
+    if (!b) return;
+    b->len = 0;
+    b->hash = CLS_FNV_OFFSET;
+    b->overflow = false;
+    b->buf[0] = '\0';
+}
+
+void cls_mem_key_add(cls_mem_key_builder_t *b, const char *s) {
+    if (!b || !s) return;
+
+    uint32_t len = b->len;
+    uint32_t hash = b->hash;
+    for (; *s; s++) {
+        if (len + 1 >= CLS_MEMORY_KEY_MAX) {
+            b->overflow = true;
+            break;
+        }
+        b->buf[len++] = *s;
+        hash ^= (uint8_t)*s;
+        hash *= CLS_FNV_PRIME;
+    }
+    b->buf[len] = '\0';
+    b->len = len;
+    b->hash = hash;
+}
+
+void cls_mem_key_add_u64(cls_mem_key_builder_t *b, uint64_t v) {
+    if (!b) return;
+
+    /* Digits come out backwards; 20 covers UINT64_MAX */
+    char digits[21];
+    uint32_t n = sizeof(digits) - 1;
+    digits[n] = '\0';
+    do {
+        digits[--n] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    cls_mem_key_add(b, &digits[n]);
+}
+
+cls_status_t cls_mem_key_end(const cls_mem_key_builder_t *b, cls_mem_key_t *out) {
+    if (!b || !out) return CLS_ERR_INVALID;
+    if (b->overflow) return CLS_ERR_OVERFLOW;
+
+    out->str = b->buf;
+    out->hash = b->hash;
+    out->len = b->len;
+    return CLS_OK;
+}
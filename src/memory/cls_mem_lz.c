@@ -0,0 +1,142 @@
+/*
+ * ClawLobstars - Memory Value Codec
+ * Byte-oriented LZ77 for cold values: greedy single-probe matching on
+ * compress, bounds-checked copy on decompress
+ *
+ * A block is a run of sequences:
+ *   token      high nibble literal count, low nibble match length - 4
+ *              (15 = more length bytes follow, 255 = keep reading)
+ *   literals
+ *   offset     2 bytes little-endian, back from the current output
+ * The final sequence ends after its literals, with no offset.
+ */
+
+#include <string.h>
+#include "cls_mem_internal.h"
+
+/* ============================================================
+ * Internal Helpers
+ * ============================================================ */
+
+#define CLS_LZ_MIN_MATCH    4
+#define CLS_LZ_HASH_BITS    12
+#define CLS_LZ_MAX_OFFSET   65535u
+
+static uint32_t cls_lz_read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t cls_lz_hash(uint32_t seq) {
+    return (seq * 2654435761u) >> (32 - CLS_LZ_HASH_BITS);
+}
+
+/* Extra length bytes for a nibble that saturated at 15 */
+static void cls_lz_put_len(uint8_t *dst, size_t *op, size_t rem) {
+    while (rem >= 255) {
+        dst[(*op)++] = 255;
+        rem -= 255;
+    }
+    dst[(*op)++] = (uint8_t)rem;
+}
+
+/* Append one sequence; match_len 0 marks the final one. False if it
+ * would not fit in cap. */
+static bool cls_lz_emit(uint8_t *dst, size_t cap, size_t *op,
+                        const uint8_t *lit, size_t lit_len,
+                        size_t offset, size_t match_len) {
+    size_t need = 1 + lit_len + lit_len / 255 + 1 + 2 + match_len / 255 + 1;
+    if (*op + need > cap) return false;
+
+    size_t ml = match_len ? match_len - CLS_LZ_MIN_MATCH : 0;
+    uint8_t *token = &dst[(*op)++];
+    *token = (uint8_t)((lit_len < 15 ? lit_len : 15) << 4 | (ml < 15 ? ml : 15));
+
+    if (lit_len >= 15) cls_lz_put_len(dst, op, lit_len - 15);
+    memcpy(&dst[*op], lit, lit_len);
+    *op += lit_len;
+
+    if (match_len) {
+        dst[(*op)++] = (uint8_t)(offset & 0xFF);
+        dst[(*op)++] = (uint8_t)(offset >> 8);
+        if (ml >= 15) cls_lz_put_len(dst, op, ml - 15);
+    }
+    return true;
+}
+
+/* Read a saturated length's extra bytes; false on truncated input */
+static bool cls_lz_get_len(const uint8_t *src, size_t n, size_t *ip, size_t *len) {
+    uint8_t b;
+    do {
+        if (*ip >= n) return false;
+        b = src[(*ip)++];
+        *len += b;
+    } while (b == 255);
+    return true;
+}
+
+/* ============================================================
+ * Codec
+ * ============================================================ */
+
+size_t cls_lz_compress(const uint8_t *src, size_t n, uint8_t *dst, size_t cap) {
+    if (!src || !dst || n == 0 || n > UINT32_MAX) return 0;
+
+    uint32_t table[1u << CLS_LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    size_t ip = 0, anchor = 0, op = 0;
+    while (ip + CLS_LZ_MIN_MATCH <= n) {
+        uint32_t seq = cls_lz_read32(&src[ip]);
+        uint32_t h = cls_lz_hash(seq);
+        size_t ref = table[h];
+        table[h] = (uint32_t)ip;
+
+        if (ref < ip && ip - ref <= CLS_LZ_MAX_OFFSET && cls_lz_read32(&src[ref]) == seq) {
+            size_t len = CLS_LZ_MIN_MATCH;
+            while (ip + len < n && src[ref + len] == src[ip + len]) len++;
+            if (!cls_lz_emit(dst, cap, &op, &src[anchor], ip - anchor, ip - ref, len))
+                return 0;
+            ip += len;
+            anchor = ip;
+        } else {
+            ip++;
+        }
+    }
+
+    if (!cls_lz_emit(dst, cap, &op, &src[anchor], n - anchor, 0, 0))
+        return 0;
+    return op;
+}
+
+cls_status_t cls_lz_decompress(const uint8_t *src, size_t n, uint8_t *dst, size_t out_len) {
+    if (!src || !dst) return CLS_ERR_INVALID;
+
+    size_t ip = 0, op = 0;
+    while (ip < n) {
+        uint8_t token = src[ip++];
+
+        size_t lit = token >> 4;
+        if (lit == 15 && !cls_lz_get_len(src, n, &ip, &lit)) return CLS_ERR_INTERNAL;
+        if (lit > n - ip || lit > out_len - op) return CLS_ERR_INTERNAL;
+        memcpy(&dst[op], &src[ip], lit);
+        ip += lit;
+        op += lit;
+        if (ip == n) break;
+
+        if (n - ip < 2) return CLS_ERR_INTERNAL;
+        size_t offset = (size_t)src[ip] | (size_t)src[ip + 1] << 8;
+        ip += 2;
+        size_t len = token & 15;
+        if (len == 15 && !cls_lz_get_len(src, n, &ip, &len)) return CLS_ERR_INTERNAL;
+        len += CLS_LZ_MIN_MATCH;
+        if (offset == 0 || offset > op || len > out_len - op) return CLS_ERR_INTERNAL;
+
+        /* Byte by byte: a match may overlap the bytes it is producing */
+        const uint8_t *from = &dst[op - offset];
+        for (size_t i = 0; i < len; i++) dst[op + i] = from[i];
+        op += len;
+    }
+    return op == out_len ? CLS_OK : CLS_ERR_INTERNAL;
+}
@@ -0,0 +1,486 @@
+/*
+ * ClawLobstars - Memory Persistence
+ * Write-ahead log with group commit and mmap-able arena snapshots
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cls_mem_internal.h"
+
+/* ============================================================
+ * Internal Helpers
+ * ============================================================ */
+
+#define CLS_WAL_MAGIC           0x314C41574D534C43ULL  /* "CLSMWAL1" */
+#define CLS_SNAP_MAGIC          0x31504E534D534C43ULL  /* "CLSMSNP1" */
+#define CLS_PERSIST_VERSION     5
+#define CLS_WAL_BUF_INIT        (64u << 10)
+#define CLS_WAL_BUF_FLUSH       (1u << 20)      /* Unsynced logs write past this */
+
+typedef struct {
+    uint64_t    magic;
+    uint32_t    version;
+    uint32_t    pad;
+    uint64_t    gen;            /* Snapshot generation the log extends */
+    uint64_t    store_time_us;  /* Clock anchor at creation */
+    uint64_t    real_time_us;
+} cls_wal_hdr_t;
+
+static uint32_t cls_crc_table[256];
+static pthread_once_t cls_crc_once = PTHREAD_ONCE_INIT;
+
+static void cls_crc_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? 0x82F63B78u ^ (c >> 1) : c >> 1;     /* CRC-32C */
+        cls_crc_table[i] = c;
+    }
+}
+
+static uint32_t cls_crc32c(uint32_t crc, const void *buf, size_t len) {
+    const uint8_t *p = (const uint8_t *)buf;
+    crc = ~crc;
+    while (len--)
+        crc = cls_crc_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static cls_status_t cls_write_all(int fd, const void *buf, size_t len) {
+    const uint8_t *p = (const uint8_t *)buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return CLS_ERR_IO;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return CLS_OK;
+}
+
+/* Make a rename durable */
+static void cls_fsync_dir(const char *path) {
+    size_t len = strlen(path);
+    char *dir = (char *)malloc(len + 2);
+    if (!dir) return;
+
+    memcpy(dir, path, len + 1);
+    char *slash = strrchr(dir, '/');
+    if (slash == dir) slash[1] = '\0';
+    else if (slash) *slash = '\0';
+    else memcpy(dir, ".", 2);
+
+    int fd = open(dir, O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    free(dir);
+}
+
+static cls_status_t cls_wal_write_header(int fd, uint64_t gen, uint64_t now_us) {
+    cls_wal_hdr_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = CLS_WAL_MAGIC;
+    hdr.version = CLS_PERSIST_VERSION;
+    hdr.gen = gen;
+    hdr.store_time_us = now_us;
+    hdr.real_time_us = cls_real_time_us();
+
+    if (ftruncate(fd, 0) != 0 || lseek(fd, 0, SEEK_SET) != 0) return CLS_ERR_IO;
+    CLS_CHECK(cls_write_all(fd, &hdr, sizeof(hdr)));
+    return fdatasync(fd) == 0 ? CLS_OK : CLS_ERR_IO;
+}
+
+/* Hand every intact record to fn; returns the offset just past the last */
+static size_t cls_wal_replay(const uint8_t *buf, size_t len,
+                             cls_wal_replay_fn fn, void *user_ctx) {
+    size_t off = sizeof(cls_wal_hdr_t);
+
+    while (len - off >= sizeof(cls_mem_wal_rec_t)) {
+        cls_mem_wal_rec_t rec;
+        memcpy(&rec, buf + off, sizeof(rec));
+
+        if (rec.size < sizeof(rec) || rec.size > len - off || (rec.size & 7) ||
+            rec.key_len == 0 || rec.key_len >= CLS_MEM_KEY_MAX ||
+            rec.data_len > rec.size - sizeof(rec) - rec.key_len)
+            break;
+        if (cls_crc32c(0, buf + off + sizeof(rec.crc), rec.size - sizeof(rec.crc)) != rec.crc)
+            break;
+
+        const char *key = (const char *)(buf + off + sizeof(rec));
+        fn(user_ctx, &rec, key, key + rec.key_len);
+        off += rec.size;
+    }
+    return off;
+}
+
+/* Write out everything appended so far. Called and returns with the lock
+ * held, but drops it around the I/O so appends keep filling the other
+ * buffer: whoever flushes next takes that whole group at once. */
+static cls_status_t cls_wal_write_locked(cls_mem_wal_t *wal, bool durable) {
+    while (wal->flushing)
+        pthread_cond_wait(&wal->cond, &wal->lock);
+    if (CLS_IS_ERR(wal->status)) return wal->status;
+
+    uint64_t target = wal->appended;
+    if (wal->written >= target && (!durable || wal->durable >= target))
+        return CLS_OK;
+
+    uint8_t *buf = wal->buf;
+    size_t len = wal->buf_len;
+    size_t cap = wal->buf_cap;
+    wal->buf = wal->spare;
+    wal->buf_cap = wal->spare_cap;
+    wal->buf_len = 0;
+    wal->spare = buf;
+    wal->spare_cap = cap;
+    wal->flushing = true;
+    pthread_mutex_unlock(&wal->lock);
+
+    cls_status_t status = cls_write_all(wal->fd, buf, len);
+    if (CLS_IS_OK(status) && durable && fdatasync(wal->fd) != 0)
+        status = CLS_ERR_IO;
+
+    pthread_mutex_lock(&wal->lock);
+    wal->flushing = false;
+    if (CLS_IS_OK(status)) {
+        wal->written = target;
+        if (durable) wal->durable = target;
+    } else {
+        wal->status = status;
+    }
+    pthread_cond_broadcast(&wal->cond);
+    return status;
+}
+
+/* ============================================================
+ * Write-Ahead Log
+ * ============================================================ */
+
+uint64_t cls_real_time_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+cls_status_t cls_wal_peek(const char *path, uint64_t *gen,
+                          uint64_t *store_time_us, uint64_t *real_time_us) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return CLS_ERR_NOT_FOUND;
+
+    cls_wal_hdr_t hdr;
+    ssize_t n = pread(fd, &hdr, sizeof(hdr), 0);
+    close(fd);
+    if (n != (ssize_t)sizeof(hdr) || hdr.magic != CLS_WAL_MAGIC ||
+        hdr.version != CLS_PERSIST_VERSION)
+        return CLS_ERR_NOT_FOUND;
+
+    *gen = hdr.gen;
+    *store_time_us = hdr.store_time_us;
+    *real_time_us = hdr.real_time_us;
+    return CLS_OK;
+}
+
+cls_status_t cls_wal_open(cls_mem_wal_t *wal, const char *path, uint64_t gen,
+                          uint64_t now_us, bool sync,
+                          cls_wal_replay_fn fn, void *user_ctx) {
+    pthread_once(&cls_crc_once, cls_crc_init);
+    memset(wal, 0, sizeof(*wal));
+    wal->fd = -1;
+    wal->sync = sync;
+
+    wal->buf = (uint8_t *)malloc(CLS_WAL_BUF_INIT);
+    wal->spare = (uint8_t *)malloc(CLS_WAL_BUF_INIT);
+    if (!wal->buf || !wal->spare) {
+        free(wal->buf);
+        free(wal->spare);
+        wal->buf = NULL;
+        return CLS_ERR_NOMEM;
+    }
+    wal->buf_cap = CLS_WAL_BUF_INIT;
+    wal->spare_cap = CLS_WAL_BUF_INIT;
+    pthread_mutex_init(&wal->lock, NULL);
+    pthread_cond_init(&wal->cond, NULL);
+
+    wal->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (wal->fd < 0) {
+        cls_wal_close(wal);
+        return CLS_ERR_IO;
+    }
+
+    struct stat st;
+    size_t valid = 0;
+    if (fstat(wal->fd, &st) == 0 && (size_t)st.st_size >= sizeof(cls_wal_hdr_t)) {
+        size_t len = (size_t)st.st_size;
+        void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, wal->fd, 0);
+        if (map != MAP_FAILED) {
+            cls_wal_hdr_t hdr;
+            memcpy(&hdr, map, sizeof(hdr));
+            /* A log from another generation is already in the snapshot */
+            if (hdr.magic == CLS_WAL_MAGIC && hdr.version == CLS_PERSIST_VERSION &&
+                hdr.gen == gen)
+                valid = cls_wal_replay((const uint8_t *)map, len, fn, user_ctx);
+            munmap(map, len);
+        }
+    }
+
+    cls_status_t status;
+    if (valid == 0) {
+        status = cls_wal_write_header(wal->fd, gen, now_us);
+        valid = sizeof(cls_wal_hdr_t);
+    } else {
+        /* Cut a torn tail so new records follow the last good one */
+        status = (ftruncate(wal->fd, (off_t)valid) == 0 &&
+                  lseek(wal->fd, (off_t)valid, SEEK_SET) == (off_t)valid) ?
+                 CLS_OK : CLS_ERR_IO;
+    }
+    if (CLS_IS_ERR(status)) {
+        cls_wal_close(wal);
+        return status;
+    }
+
+    wal->size = valid;
+    return CLS_OK;
+}
+
+void cls_wal_close(cls_mem_wal_t *wal) {
+    if (!wal->buf) return;
+
+    if (wal->fd >= 0) {
+        pthread_mutex_lock(&wal->lock);
+        cls_wal_write_locked(wal, true);
+        pthread_mutex_unlock(&wal->lock);
+        close(wal->fd);
+    }
+    pthread_cond_destroy(&wal->cond);
+    pthread_mutex_destroy(&wal->lock);
+    free(wal->buf);
+    free(wal->spare);
+    wal->buf = NULL;
+    wal->spare = NULL;
+    wal->fd = -1;
+}
+
+cls_status_t cls_wal_append(cls_mem_wal_t *wal, uint8_t type,
+                            const char *key, size_t key_len,
+                            const void *data, size_t data_len,
+                            uint32_t ttl_sec, uint64_t time_us, uint64_t *lsn) {
+    cls_mem_wal_rec_t rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.size = (uint32_t)((sizeof(rec) + key_len + data_len + 7) & ~(size_t)7);
+    rec.type = type;
+    rec.key_len = (uint16_t)key_len;
+    rec.ttl_sec = ttl_sec;
+    rec.time_us = time_us;
+    rec.data_len = data_len;
+
+    pthread_mutex_lock(&wal->lock);
+    cls_status_t status = wal->status;
+
+    if (CLS_IS_OK(status) && wal->buf_len + rec.size > wal->buf_cap) {
+        size_t cap = wal->buf_cap;
+        while (cap < wal->buf_len + rec.size) cap *= 2;
+        uint8_t *buf = (uint8_t *)realloc(wal->buf, cap);
+        if (buf) {
+            wal->buf = buf;
+            wal->buf_cap = cap;
+        } else {
+            status = CLS_ERR_NOMEM;
+        }
+    }
+
+    if (CLS_IS_OK(status)) {
+        uint8_t *p = wal->buf + wal->buf_len;
+        memset(p, 0, rec.size);
+        memcpy(p + sizeof(rec), key, key_len);
+        if (data_len) memcpy(p + sizeof(rec) + key_len, data, data_len);
+        memcpy(p, &rec, sizeof(rec));
+        rec.crc = cls_crc32c(0, p + sizeof(rec.crc), rec.size - sizeof(rec.crc));
+        memcpy(p, &rec.crc, sizeof(rec.crc));
+
+        wal->buf_len += rec.size;
+        wal->appended += rec.size;
+        wal->size += rec.size;
+        *lsn = wal->appended;
+
+        /* Without per-store syncs, write whenever a buffer fills */
+        if (!wal->sync && wal->buf_len >= CLS_WAL_BUF_FLUSH)
+            cls_wal_write_locked(wal, false);
+    }
+
+    pthread_mutex_unlock(&wal->lock);
+    return status;
+}
+
+/* Group commit: the first waiter writes and syncs everything appended so
+ * far; writers arriving meanwhile queue behind the next sync */
+cls_status_t cls_wal_commit(cls_mem_wal_t *wal, uint64_t lsn) {
+    if (!wal->sync) return CLS_OK;
+
+    pthread_mutex_lock(&wal->lock);
+    cls_status_t status = wal->status;
+    while (CLS_IS_OK(status) && wal->durable < lsn) {
+        if (wal->flushing) {
+            pthread_cond_wait(&wal->cond, &wal->lock);
+            status = wal->status;
+        } else {
+            status = cls_wal_write_locked(wal, true);
+        }
+    }
+    pthread_mutex_unlock(&wal->lock);
+    return status;
+}
+
+cls_status_t cls_wal_flush(cls_mem_wal_t *wal) {
+    pthread_mutex_lock(&wal->lock);
+    cls_status_t status = cls_wal_write_locked(wal, true);
+    pthread_mutex_unlock(&wal->lock);
+    return status;
+}
+
+/* Start an empty log for a new snapshot generation. Everything appended
+ * so far is in the snapshot, so pending records are dropped and their
+ * committers released. */
+cls_status_t cls_wal_reset(cls_mem_wal_t *wal, uint64_t gen, uint64_t now_us) {
+    pthread_mutex_lock(&wal->lock);
+    while (wal->flushing)
+        pthread_cond_wait(&wal->cond, &wal->lock);
+
+    cls_status_t status = cls_wal_write_header(wal->fd, gen, now_us);
+    if (CLS_IS_OK(status)) {
+        wal->buf_len = 0;
+        wal->written = wal->appended;
+        wal->durable = wal->appended;
+        wal->size = sizeof(cls_wal_hdr_t);
+    }
+    wal->status = status;
+    pthread_cond_broadcast(&wal->cond);
+    pthread_mutex_unlock(&wal->lock);
+    return status;
+}
+
+uint64_t cls_wal_size(cls_mem_wal_t *wal) {
+    pthread_mutex_lock(&wal->lock);
+    uint64_t size = wal->size;
+    pthread_mutex_unlock(&wal->lock);
+    return size;
+}
+
+/* ============================================================
+ * Snapshots
+ * ============================================================ */
+
+static uint32_t cls_snap_hdr_crc(const cls_mem_snap_hdr_t *hdr) {
+    return cls_crc32c(0, hdr, offsetof(cls_mem_snap_hdr_t, crc));
+}
+
+uint64_t cls_snap_size(const cls_mem_snap_hdr_t *hdr) {
+    return CLS_SNAP_HDR_SIZE + hdr->pool_size + hdr->fixup_count * sizeof(cls_mem_snap_fixup_t);
+}
+
+cls_status_t cls_snap_emit(int fd, cls_mem_snap_hdr_t *hdr, const void *pool,
+                           const cls_mem_snap_fixup_t *fixups) {
+    pthread_once(&cls_crc_once, cls_crc_init);
+
+    hdr->magic = CLS_SNAP_MAGIC;
+    hdr->version = CLS_PERSIST_VERSION;
+    hdr->crc = cls_snap_hdr_crc(hdr);
+
+    /* The pool starts page-aligned so the file can be mapped in place */
+    uint8_t page[CLS_SNAP_HDR_SIZE];
+    memset(page, 0, sizeof(page));
+    memcpy(page, hdr, sizeof(*hdr));
+
+    cls_status_t status = cls_write_all(fd, page, sizeof(page));
+    if (CLS_IS_OK(status))
+        status = cls_write_all(fd, pool, hdr->pool_size);
+    if (CLS_IS_OK(status) && hdr->fixup_count)
+        status = cls_write_all(fd, fixups, hdr->fixup_count * sizeof(cls_mem_snap_fixup_t));
+    return status;
+}
+
+cls_status_t cls_snap_write(const char *path, cls_mem_snap_hdr_t *hdr, const void *pool,
+                            const cls_mem_snap_fixup_t *fixups) {
+    size_t plen = strlen(path);
+    char *tmp = (char *)malloc(plen + sizeof(".tmp"));
+    if (!tmp) return CLS_ERR_NOMEM;
+    memcpy(tmp, path, plen);
+    memcpy(tmp + plen, ".tmp", sizeof(".tmp"));
+
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        free(tmp);
+        return CLS_ERR_IO;
+    }
+
+    cls_status_t status = cls_snap_emit(fd, hdr, pool, fixups);
+    if (CLS_IS_OK(status) && fsync(fd) != 0)
+        status = CLS_ERR_IO;
+    close(fd);
+
+    if (CLS_IS_OK(status) && rename(tmp, path) != 0)
+        status = CLS_ERR_IO;
+    if (CLS_IS_OK(status)) cls_fsync_dir(path);
+    else unlink(tmp);
+
+    free(tmp);
+    return status;
+}
+
+cls_status_t cls_snap_map_fd(int fd, uint64_t offset, uint64_t len, cls_mem_snap_t *snap) {
+    pthread_once(&cls_crc_once, cls_crc_init);
+    memset(snap, 0, sizeof(*snap));
+
+    cls_mem_snap_hdr_t hdr;
+    if (len < CLS_SNAP_HDR_SIZE || (offset & (CLS_SNAP_HDR_SIZE - 1)) != 0 ||
+        pread(fd, &hdr, sizeof(hdr), (off_t)offset) != (ssize_t)sizeof(hdr) ||
+        hdr.magic != CLS_SNAP_MAGIC || hdr.version != CLS_PERSIST_VERSION ||
+        hdr.crc != cls_snap_hdr_crc(&hdr) || len != cls_snap_size(&hdr))
+        return CLS_ERR_NOT_FOUND;
+
+    /* mmap wants a page-aligned offset; the pool stays 4096-aligned */
+    long page = sysconf(_SC_PAGESIZE);
+    uint64_t align = page > 0 ? (uint64_t)page : CLS_SNAP_HDR_SIZE;
+    uint64_t lead = offset % align;
+
+    /* Private mapping: pages fault in on first touch, writes stay local */
+    size_t map_len = (size_t)(lead + len);
+    void *map = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+                     (off_t)(offset - lead));
+    if (map == MAP_FAILED) return CLS_ERR_IO;
+
+    snap->hdr = hdr;
+    snap->map = map;
+    snap->map_len = map_len;
+    snap->pool = (uint8_t *)map + lead + CLS_SNAP_HDR_SIZE;
+    snap->fixups = (const cls_mem_snap_fixup_t *)(snap->pool + hdr.pool_size);
+    return CLS_OK;
+}
+
+cls_status_t cls_snap_map(const char *path, cls_mem_snap_t *snap) {
+    memset(snap, 0, sizeof(*snap));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return CLS_ERR_NOT_FOUND;
+
+    struct stat st;
+    cls_status_t status = fstat(fd, &st) == 0 ?
+                          cls_snap_map_fd(fd, 0, (uint64_t)st.st_size, snap) : CLS_ERR_NOT_FOUND;
+    close(fd);
+    return status;
+}
+
+void cls_snap_unmap(void *map, size_t len) {
+    if (map) munmap(map, len);
+}
@@ -0,0 +1,230 @@
+/*
+ * ClawLobstars - Memory Shared Segment
+ * Named POSIX shared-memory object holding a store that several
+ * processes map at once
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cls_mem_internal.h"
+
+/* ============================================================
+ * Internal Helpers
+ * ============================================================ */
+
+#define CLS_SHM_MAGIC           0x314D48534D534C43ULL  /* "CLSMSHM1" */
+#define CLS_SHM_VERSION         2
+#define CLS_SHM_WAIT_NS         1000000L        /* Poll while the creator formats */
+#define CLS_SHM_WAIT_MAX        5000            /* Polls before giving up */
+
+static size_t cls_shm_hdr_len(void) {
+    long page = sysconf(_SC_PAGESIZE);
+    size_t align = page > 0 ? (size_t)page : 4096;
+    return (sizeof(cls_mem_shm_hdr_t) + align - 1) & ~(align - 1);
+}
+
+static void cls_shm_pause(void) {
+    struct timespec ts = { 0, CLS_SHM_WAIT_NS };
+    nanosleep(&ts, NULL);
+}
+
+/* Free the slots of processes that died without detaching (lock held) */
+static uint32_t cls_shm_sweep(cls_mem_shm_hdr_t *hdr) {
+    uint32_t live = 0;
+    for (uint32_t i = 0; i < CLS_MEM_SHM_PROCS; i++) {
+        if (hdr->procs[i] == 0) continue;
+        if (kill((pid_t)hdr->procs[i], 0) != 0 && errno == ESRCH) hdr->procs[i] = 0;
+        else live++;
+    }
+    return live;
+}
+
+static cls_status_t cls_shm_mutex_init(pthread_mutex_t *mutex) {
+    pthread_mutexattr_t attr;
+    if (pthread_mutexattr_init(&attr) != 0) return CLS_ERR_INTERNAL;
+
+    int rc = pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    if (rc == 0) rc = pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    if (rc == 0) rc = pthread_mutex_init(mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    return rc == 0 ? CLS_OK : CLS_ERR_INTERNAL;
+}
+
+static cls_status_t cls_shm_map(cls_mem_shm_t *shm, int fd, size_t len) {
+    void *map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) return errno == ENOMEM ? CLS_ERR_NOMEM : CLS_ERR_IO;
+
+    shm->hdr = (cls_mem_shm_hdr_t *)map;
+    shm->pool = (uint8_t *)map + cls_shm_hdr_len();
+    shm->map_len = len;
+    return CLS_OK;
+}
+
+static void cls_shm_unmap(cls_mem_shm_t *shm) {
+    if (shm->hdr) munmap(shm->hdr, shm->map_len);
+    shm->hdr = NULL;
+    shm->pool = NULL;
+    shm->map_len = 0;
+}
+
+/* A fresh, zero-filled object: size it and set up its locks. Nobody else
+ * touches it until the magic is published. */
+static cls_status_t cls_shm_create(cls_mem_shm_t *shm, int fd, size_t pool_size) {
+    size_t len = cls_shm_hdr_len() + pool_size;
+    if (ftruncate(fd, (off_t)len) != 0) return CLS_ERR_IO;
+
+    cls_status_t rc = cls_shm_map(shm, fd, len);
+    if (rc != CLS_OK) return rc;
+
+    cls_mem_shm_hdr_t *hdr = shm->hdr;
+    hdr->version = CLS_SHM_VERSION;
+    hdr->hdr_size = (uint32_t)sizeof(cls_mem_shm_hdr_t);
+    hdr->pool_size = pool_size;
+    hdr->procs[0] = (uint32_t)getpid();
+    shm->proc = 0;
+
+    rc = cls_shm_mutex_init(&hdr->lock);
+    for (uint32_t i = 0; rc == CLS_OK && i < CLS_MEM_MAX_SHARDS; i++)
+        rc = cls_shm_mutex_init(&hdr->shard_locks[i]);
+    if (rc != CLS_OK) cls_shm_unmap(shm);
+    return rc;
+}
+
+/* Someone else's object: wait until it is sized and published, then take
+ * a process slot. CLS_ERR_BUSY means it was unlinked under us. */
+static cls_status_t cls_shm_attach(cls_mem_shm_t *shm, int fd) {
+    size_t hdr_len = cls_shm_hdr_len();
+    struct stat st;
+    uint32_t polls = 0;
+
+    for (;;) {
+        if (fstat(fd, &st) != 0) return CLS_ERR_IO;
+        if ((size_t)st.st_size > hdr_len) break;
+        if (++polls > CLS_SHM_WAIT_MAX) return CLS_ERR_TIMEOUT;
+        cls_shm_pause();
+    }
+
+    cls_status_t rc = cls_shm_map(shm, fd, (size_t)st.st_size);
+    if (rc != CLS_OK) return rc;
+
+    cls_mem_shm_hdr_t *hdr = shm->hdr;
+    while (CLS_LOAD_ACQ(&hdr->magic) != CLS_SHM_MAGIC) {
+        if (CLS_LOAD_ACQ(&hdr->dead)) { rc = CLS_ERR_BUSY; break; }
+        if (++polls > CLS_SHM_WAIT_MAX) { rc = CLS_ERR_TIMEOUT; break; }
+        cls_shm_pause();
+    }
+    if (rc == CLS_OK &&
+        (hdr->version != CLS_SHM_VERSION ||
+         hdr->hdr_size != sizeof(cls_mem_shm_hdr_t) ||
+         hdr->pool_size != (size_t)st.st_size - hdr_len))
+        rc = CLS_ERR_INVALID;
+
+    if (rc == CLS_OK) {
+        cls_shm_lock(&hdr->lock);
+        if (hdr->dead) {
+            rc = CLS_ERR_BUSY;
+        } else {
+            cls_shm_sweep(hdr);
+            rc = CLS_ERR_OVERFLOW;
+            for (uint32_t i = 0; i < CLS_MEM_SHM_PROCS && rc != CLS_OK; i++) {
+                if (hdr->procs[i] != 0) continue;
+                hdr->procs[i] = (uint32_t)getpid();
+                shm->proc = i;
+                rc = CLS_OK;
+            }
+        }
+        pthread_mutex_unlock(&hdr->lock);
+    }
+
+    if (rc != CLS_OK) cls_shm_unmap(shm);
+    return rc;
+}
+
+/* ============================================================
+ * Segment
+ * ============================================================ */
+
+bool cls_shm_lock(pthread_mutex_t *mutex) {
+    if (pthread_mutex_lock(mutex) != EOWNERDEAD) return false;
+    pthread_mutex_consistent(mutex);
+    return true;
+}
+
+cls_status_t cls_shm_open(const char *name, size_t pool_size, cls_mem_shm_t *shm,
+                          bool *created) {
+    if (!name || !shm || !created || pool_size == 0) return CLS_ERR_INVALID;
+
+    memset(shm, 0, sizeof(*shm));
+    size_t name_len = strlen(name);
+    shm->name = (char *)malloc(name_len + 1);
+    if (!shm->name) return CLS_ERR_NOMEM;
+    memcpy(shm->name, name, name_len + 1);
+
+    cls_status_t rc;
+    for (;;) {
+        int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd >= 0) {
+            rc = cls_shm_create(shm, fd, pool_size);
+            close(fd);
+            if (rc != CLS_OK) shm_unlink(name);
+            *created = true;
+            break;
+        }
+        if (errno != EEXIST) { rc = CLS_ERR_IO; break; }
+
+        /* Gone again between our two opens: try creating it ourselves */
+        fd = shm_open(name, O_RDWR, 0600);
+        if (fd < 0) {
+            if (errno == ENOENT) continue;
+            rc = CLS_ERR_IO;
+            break;
+        }
+        rc = cls_shm_attach(shm, fd);
+        close(fd);
+        if (rc == CLS_ERR_BUSY) {
+            cls_shm_pause();
+            continue;
+        }
+        *created = false;
+        break;
+    }
+
+    if (rc != CLS_OK) {
+        free(shm->name);
+        shm->name = NULL;
+    }
+    return rc;
+}
+
+void cls_shm_publish(cls_mem_shm_t *shm) {
+    if (!shm || !shm->hdr) return;
+    CLS_STORE_REL(&shm->hdr->magic, CLS_SHM_MAGIC);
+}
+
+void cls_shm_close(cls_mem_shm_t *shm) {
+    if (!shm || !shm->hdr) return;
+
+    cls_mem_shm_hdr_t *hdr = shm->hdr;
+    bool last;
+    cls_shm_lock(&hdr->lock);
+    hdr->procs[shm->proc] = 0;
+    last = cls_shm_sweep(hdr) == 0;
+    if (last) CLS_STORE_REL(&hdr->dead, true);
+    pthread_mutex_unlock(&hdr->lock);
+
+    /* Locks in the segment are left alone: another process that opened
+     * the name before the unlink may still be about to look at dead */
+    if (last) shm_unlink(shm->name);
+
+    cls_shm_unmap(shm);
+    free(shm->name);
+    shm->name = NULL;
+}
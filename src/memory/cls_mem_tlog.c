@@ -0,0 +1,168 @@
+/*
+ * ClawLobstars - Memory Time Log Implementation
+ * Per-shard creation-time index for windowed queries
+ */
+
+#include <string.h>
+#include "cls_mem_internal.h"
+
+/* ============================================================
+ * Internal Helpers
+ * ============================================================ */
+
+#define CLS_TLOG_MIN_CAP    64
+
+static cls_mem_tlog_rec_t *cls_tlog_recs(const cls_mem_tlog_t *log, const cls_mem_arena_t *arena) {
+    return (cls_mem_tlog_rec_t *)cls_arena_ptr(arena, log->block);
+}
+
+/* First record in [lo, hi) created at or after t */
+static uint32_t cls_tlog_lower(const cls_mem_tlog_rec_t *recs, uint32_t lo, uint32_t hi,
+                               uint64_t t) {
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (recs[mid].created_at < t) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* Index of the record for ref, or UINT32_MAX */
+static uint32_t cls_tlog_find(const cls_mem_tlog_t *log, const cls_mem_tlog_rec_t *recs,
+                              uint64_t created_at, cls_mem_ref_t ref) {
+    uint32_t end = log->head + log->len;
+    for (uint32_t i = cls_tlog_lower(recs, log->head, end, created_at);
+         i < end && recs[i].created_at == created_at; i++) {
+        if (recs[i].entry == ref) return i;
+    }
+    return UINT32_MAX;
+}
+
+/* Squeeze out tombstones, moving live records to the front of dst
+ * (which may be the source block) */
+static void cls_tlog_compact_into(cls_mem_tlog_t *log, const cls_mem_tlog_rec_t *src,
+                                  cls_mem_tlog_rec_t *dst) {
+    uint32_t n = 0;
+    for (uint32_t i = log->head; i < log->head + log->len; i++) {
+        if (src[i].entry) dst[n++] = src[i];
+    }
+    log->head = 0;
+    log->len = n;
+    log->dead = 0;
+}
+
+/* Make room for one more record at the tail */
+static cls_status_t cls_tlog_reserve(cls_mem_tlog_t *log, cls_mem_arena_t *arena) {
+    if (log->head + log->len < log->cap) return CLS_OK;
+
+    cls_mem_tlog_rec_t *recs = cls_tlog_recs(log, arena);
+    uint32_t live = log->len - log->dead;
+
+    /* Plenty of tombstones or head slack: reuse the block */
+    if (recs && live < log->cap / 2) {
+        cls_tlog_compact_into(log, recs, recs);
+        return CLS_OK;
+    }
+
+    uint32_t cap = log->cap ? log->cap * 2 : CLS_TLOG_MIN_CAP;
+    if (cap < log->cap) return CLS_ERR_OVERFLOW;
+
+    cls_mem_ref_t block = cls_arena_alloc(arena, (size_t)cap * sizeof(cls_mem_tlog_rec_t));
+    if (!block) {
+        if (!recs || live == log->cap) return CLS_ERR_NOMEM;
+        cls_tlog_compact_into(log, recs, recs);
+        return CLS_OK;
+    }
+
+    if (recs) {
+        cls_tlog_compact_into(log, recs, (cls_mem_tlog_rec_t *)cls_arena_ptr(arena, block));
+        cls_arena_free(arena, log->block);
+    }
+    log->block = block;
+    log->cap = cap;
+    return CLS_OK;
+}
+
+/* ============================================================
+ * Time Log API
+ * ============================================================ */
+
+cls_status_t cls_tlog_append(cls_mem_tlog_t *log, cls_mem_arena_t *arena,
+                             uint64_t created_at, cls_mem_ref_t ref) {
+    CLS_CHECK(cls_tlog_reserve(log, arena));
+
+    cls_mem_tlog_rec_t *recs = cls_tlog_recs(log, arena);
+    uint32_t i = log->head + log->len;
+
+    /* Creation times arrive in order under the shard lock; restored
+     * entries may not, so keep the log sorted either way */
+    while (i > log->head && recs[i - 1].created_at > created_at) {
+        recs[i] = recs[i - 1];
+        i--;
+    }
+    recs[i].created_at = created_at;
+    recs[i].entry = ref;
+    log->len++;
+    return CLS_OK;
+}
+
+void cls_tlog_remove(cls_mem_tlog_t *log, cls_mem_arena_t *arena,
+                     uint64_t created_at, cls_mem_ref_t ref) {
+    cls_mem_tlog_rec_t *recs = cls_tlog_recs(log, arena);
+    if (!recs) return;
+
+    uint32_t i = cls_tlog_find(log, recs, created_at, ref);
+    if (i == UINT32_MAX) return;
+
+    recs[i].entry = 0;
+    log->dead++;
+
+    /* Expiry mostly removes the oldest records; trim them off the front */
+    while (log->len > 0 && !recs[log->head].entry) {
+        log->head++;
+        log->len--;
+        log->dead--;
+    }
+    /* An empty log hands its block back so large values can have it */
+    if (log->len == 0) {
+        cls_arena_free(arena, log->block);
+        log->block = 0;
+        log->cap = 0;
+        log->head = 0;
+    } else if (log->dead > CLS_TLOG_MIN_CAP && log->dead > log->len / 2)
+        cls_tlog_compact_into(log, recs, recs);
+}
+
+void cls_tlog_replace(cls_mem_tlog_t *log, cls_mem_arena_t *arena,
+                      uint64_t created_at, cls_mem_ref_t old, cls_mem_ref_t fresh) {
+    cls_mem_tlog_rec_t *recs = cls_tlog_recs(log, arena);
+    if (!recs) return;
+
+    uint32_t i = cls_tlog_find(log, recs, created_at, old);
+    if (i != UINT32_MAX) recs[i].entry = fresh;
+}
+
+uint32_t cls_tlog_count(const cls_mem_tlog_t *log, const cls_mem_arena_t *arena,
+                        uint64_t after, uint64_t before) {
+    const cls_mem_tlog_rec_t *recs = cls_tlog_recs(log, arena);
+    if (!recs) return 0;
+
+    uint32_t end = log->head + log->len;
+    uint32_t lo = cls_tlog_lower(recs, log->head, end, after);
+    uint32_t hi = before > 0 && before < UINT64_MAX ?
+                  cls_tlog_lower(recs, lo, end, before + 1) : end;
+    return hi - lo;
+}
+
+void cls_tlog_scan(const cls_mem_tlog_t *log, const cls_mem_arena_t *arena,
+                   uint64_t after, uint64_t before,
+                   cls_index_visit_fn fn, void *user_ctx) {
+    const cls_mem_tlog_rec_t *recs = cls_tlog_recs(log, arena);
+    if (!recs) return;
+
+    uint32_t end = log->head + log->len;
+    for (uint32_t i = cls_tlog_lower(recs, log->head, end, after); i < end; i++) {
+        if (before > 0 && recs[i].created_at > before) return;
+        if (recs[i].entry && !fn(user_ctx, recs[i].entry)) return;
+    }
+}
@@ -0,0 +1,181 @@
+/*
+ * ClawLobstars - Memory Expiry Wheel Implementation
+ * Hierarchical timing wheel that drives TTL pruning
+ */
+
+#include <string.h>
+#include "cls_mem_internal.h"
+
+/* ============================================================
+ * Internal Helpers
+ * ============================================================ */
+
+#define CLS_WHEEL_HORIZON   (1ULL << (CLS_WHEEL_SLOT_BITS * CLS_WHEEL_LEVELS))
+
+static uint64_t cls_expiry_tick(const cls_mem_entry_t *entry) {
+    return cls_entry_expiry_us(entry) >> CLS_WHEEL_TICK_SHIFT;
+}
+
+static uint64_t cls_rotr64(uint64_t x, uint32_t r) {
+    r &= 63;
+    return r ? (x >> r) | (x << (64 - r)) : x;
+}
+
+static void cls_wheel_link(cls_mem_wheel_t *wheel, cls_mem_arena_t *arena,
+                           cls_mem_ref_t ref, uint32_t level, uint32_t slot) {
+    cls_mem_entry_t *entry = cls_arena_entry(arena, ref);
+    cls_mem_ref_t head = wheel->slots[level][slot];
+
+    entry->wheel_slot = (uint16_t)(level * CLS_WHEEL_SLOTS + slot);
+    entry->wheel_prev = 0;
+    entry->wheel_next = head;
+    if (head) cls_arena_entry(arena, head)->wheel_prev = ref;
+
+    wheel->slots[level][slot] = ref;
+    wheel->occupied[level] |= 1ULL << slot;
+}
+
+/* File an entry relative to the last processed tick. Anything already
+ * due lands on the next tick; anything past the horizon is clamped to
+ * the far edge and re-filed from there. */
+static void cls_wheel_place(cls_mem_wheel_t *wheel, cls_mem_arena_t *arena,
+                            cls_mem_ref_t ref, uint64_t expiry_tick) {
+    if (expiry_tick <= wheel->tick)
+        expiry_tick = wheel->tick + 1;
+
+    uint64_t delta = expiry_tick - wheel->tick;
+    if (delta >= CLS_WHEEL_HORIZON) {
+        expiry_tick = wheel->tick + CLS_WHEEL_HORIZON - 1;
+        delta = CLS_WHEEL_HORIZON - 1;
+    }
+
+    uint32_t level = 0;
+    while (level < CLS_WHEEL_LEVELS - 1 &&
+           delta >= (1ULL << (CLS_WHEEL_SLOT_BITS * (level + 1))))
+        level++;
+
+    uint32_t slot = (uint32_t)(expiry_tick >> (CLS_WHEEL_SLOT_BITS * level)) &
+                    (CLS_WHEEL_SLOTS - 1);
+    cls_wheel_link(wheel, arena, ref, level, slot);
+}
+
+/* Next tick after wheel->tick at which any level has work */
+static uint64_t cls_wheel_next_event(const cls_mem_wheel_t *wheel) {
+    uint64_t next = UINT64_MAX;
+
+    for (uint32_t level = 0; level < CLS_WHEEL_LEVELS; level++) {
+        if (!wheel->occupied[level]) continue;
+
+        uint32_t shift = CLS_WHEEL_SLOT_BITS * level;
+        uint64_t window = wheel->tick >> shift;
+        uint32_t idx = (uint32_t)window & (CLS_WHEEL_SLOTS - 1);
+
+        /* Bit k of the rotated map is the slot k + 1 windows ahead */
+        uint64_t rot = cls_rotr64(wheel->occupied[level], idx + 1);
+        uint64_t dist = (uint64_t)__builtin_ctzll(rot) + 1;
+        uint64_t at = (window + dist) << shift;
+
+        if (at < next) next = at;
+    }
+
+    return next;
+}
+
+/* Detach a slot and either expire or re-file each of its entries */
+static uint32_t cls_wheel_drain(cls_mem_wheel_t *wheel, cls_mem_arena_t *arena,
+                                uint32_t level, uint32_t slot,
+                                cls_wheel_expire_fn fn, void *user_ctx) {
+    cls_mem_ref_t ref = wheel->slots[level][slot];
+    wheel->slots[level][slot] = 0;
+    wheel->occupied[level] &= ~(1ULL << slot);
+
+    uint32_t expired = 0;
+    while (ref) {
+        cls_mem_entry_t *entry = cls_arena_entry(arena, ref);
+        cls_mem_ref_t next = entry->wheel_next;
+
+        if (cls_expiry_tick(entry) <= wheel->tick) {
+            entry->wheel_slot = CLS_WHEEL_NONE;
+            wheel->count--;
+            fn(user_ctx, ref);
+            expired++;
+        } else {
+            cls_wheel_place(wheel, arena, ref, cls_expiry_tick(entry));
+        }
+        ref = next;
+    }
+
+    return expired;
+}
+
+/* ============================================================
+ * Wheel API
+ * ============================================================ */
+
+void cls_wheel_init(cls_mem_wheel_t *wheel, uint64_t now_us) {
+    memset(wheel, 0, sizeof(cls_mem_wheel_t));
+    wheel->tick = (now_us >> CLS_WHEEL_TICK_SHIFT) - 1;
+}
+
+void cls_wheel_insert(cls_mem_wheel_t *wheel, cls_mem_arena_t *arena, cls_mem_ref_t ref) {
+    cls_mem_entry_t *entry = cls_arena_entry(arena, ref);
+    if (entry->meta.ttl_seconds == 0) return;
+
+    cls_wheel_place(wheel, arena, ref, cls_expiry_tick(entry));
+    wheel->count++;
+}
+
+void cls_wheel_remove(cls_mem_wheel_t *wheel, cls_mem_arena_t *arena, cls_mem_ref_t ref) {
+    cls_mem_entry_t *entry = cls_arena_entry(arena, ref);
+    if (entry->wheel_slot == CLS_WHEEL_NONE) return;
+
+    uint32_t level = entry->wheel_slot / CLS_WHEEL_SLOTS;
+    uint32_t slot = entry->wheel_slot % CLS_WHEEL_SLOTS;
+
+    if (entry->wheel_prev)
+        cls_arena_entry(arena, entry->wheel_prev)->wheel_next = entry->wheel_next;
+    else
+        wheel->slots[level][slot] = entry->wheel_next;
+
+    if (entry->wheel_next)
+        cls_arena_entry(arena, entry->wheel_next)->wheel_prev = entry->wheel_prev;
+
+    if (!wheel->slots[level][slot])
+        wheel->occupied[level] &= ~(1ULL << slot);
+
+    entry->wheel_slot = CLS_WHEEL_NONE;
+    wheel->count--;
+}
+
+uint32_t cls_wheel_advance(cls_mem_wheel_t *wheel, cls_mem_arena_t *arena,
+                           uint64_t now_us, cls_wheel_expire_fn fn, void *user_ctx) {
+    /* Only ticks that have fully elapsed are processed */
+    uint64_t target = (now_us >> CLS_WHEEL_TICK_SHIFT) - 1;
+    if (target <= wheel->tick) return 0;
+
+    uint32_t expired = 0;
+
+    for (;;) {
+        uint64_t at = cls_wheel_next_event(wheel);
+        if (at > target) break;
+
+        wheel->tick = at;
+
+        /* Cascade coarser levels first so their due entries fire now */
+        for (uint32_t level = CLS_WHEEL_LEVELS - 1; level > 0; level--) {
+            uint32_t shift = CLS_WHEEL_SLOT_BITS * level;
+            if (at & ((1ULL << shift) - 1)) continue;
+
+            uint32_t slot = (uint32_t)(at >> shift) & (CLS_WHEEL_SLOTS - 1);
+            if (wheel->occupied[level] & (1ULL << slot))
+                expired += cls_wheel_drain(wheel, arena, level, slot, fn, user_ctx);
+        }
+
+        uint32_t slot = (uint32_t)at & (CLS_WHEEL_SLOTS - 1);
+        if (wheel->occupied[0] & (1ULL << slot))
+            expired += cls_wheel_drain(wheel, arena, 0, slot, fn, user_ctx);
+    }
+
+    wheel->tick = target;
+    return expired;
+}
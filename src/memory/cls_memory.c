@@ -1,64 +1,1972 @@
 /*
  * ClawLobstars - Memory Interface Implementation
- * Hash-table based key-value store with TTL support
+ * Open-addressing (Swiss-table style) key-value store with TTL support,
+ * sharded over pre-reserved arenas with lock-free readers, plus ordered
+ * key and creation-time indexes for queries
  */
 
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include "../include/cls_framework.h"
+#include "cls_mem_internal.h"
 
 /* ============================================================
  * Internal Structures
  * ============================================================ */
 
-#define CLS_MEM_BUCKET_COUNT    256
-#define CLS_MEM_KEY_MAX         128
+#define CLS_MEM_GROUP_WIDTH     8       /* Control bytes matched per probe step */
+#define CLS_MEM_MIN_SLOTS       16
+#define CLS_MEM_LOAD_NUM        9       /* Max load factor 9/10 */
+#define CLS_MEM_LOAD_DEN        10
+#define CLS_MEM_INPLACE_NUM     25      /* Live share up to which a full table */
+#define CLS_MEM_INPLACE_DEN     32      /* drops tombstones in place */
+#define CLS_MEM_MIGRATE_STEP    64      /* Old slots drained per write while growing */
 
-typedef struct cls_mem_entry {
-    char                    key[CLS_MEM_KEY_MAX];
-    void                   *data;
-    cls_mem_entry_meta_t    meta;
-    struct cls_mem_entry   *next;   /* Chaining for collisions */
-} cls_mem_entry_t;
+#define CLS_MEM_DEFAULT_SHARDS  16      /* Concurrent mode with shard_count 0 */
+#define CLS_MEM_SHARD_MIN_BYTES (1u << 20)
 
+#define CLS_MEM_EVICT_SAMPLE    5       /* Candidates compared by sampled LRU */
+#define CLS_MEM_WINDOW_PCT      1       /* TinyLFU window share of a shard */
+
+#define CLS_MEM_CHECKPOINT_BYTES (64u << 20) /* Default log size before a snapshot */
+#define CLS_MEM_BATCH_CHUNK     32      /* Keys hashed and prefetched together */
+#define CLS_MEM_INLINE_CAP      512     /* Upper bound for a configured inline_max */
+#define CLS_MEM_COLD_MIN_BYTES  256     /* Default smallest value worth compressing */
+#define CLS_MEM_COLD_SCAN       256     /* Slots a prune checks for cold values, per shard */
+
+/* Control byte encoding: 0x00-0x7F = full (low 7 bits of hash) */
+#define CLS_CTRL_EMPTY          0x80
+#define CLS_CTRL_DELETED        0xFE
+
+#define CLS_GROUP_LSBS          0x0101010101010101ULL
+#define CLS_GROUP_MSBS          0x8080808080808080ULL
+
+typedef struct {
+    uint32_t        hash;   /* Mixed hash, compared before the key */
+    cls_mem_ref_t   entry;
+} cls_mem_slot_t;
+
+/* One open-addressing table in a single arena block: capacity control
+ * bytes padded to a granule, then the slot array. Probes start on a
+ * group boundary so every group load is one aligned word. */
+typedef struct {
+    cls_mem_ref_t       block;
+    uint32_t            mask;           /* capacity - 1 */
+    uint32_t            count;          /* Live entries */
+    uint32_t            growth_left;    /* Inserts into EMPTY before rehash */
+} cls_mem_htab_t;
+
+/* Growth is incremental: inserts go to `cur` while each write moves a
+ * few slots out of `old`, so no single store pays for a full rehash.
+ * `seq` is odd while a writer swaps tables; readers snapshot the header
+ * under it. */
 typedef struct {
-    cls_mem_entry_t *buckets[CLS_MEM_BUCKET_COUNT];
+    cls_mem_htab_t  cur;
+    cls_mem_htab_t  old;
+    uint32_t        migrate_pos;
+    uint32_t        seq;
+    bool            migrating;
 } cls_mem_table_t;
 
-/* ============================================================
- * Internal Helpers
- * ============================================================ */
+/* Arena root object, one per shard */
+typedef struct {
+    cls_mem_table_t table;
+    cls_mem_wheel_t wheel;      /* TTL entries ordered by expiry */
+    cls_mem_ref_t   index;      /* Crit-bit tree, entries in key order */
+    cls_mem_tlog_t  tlog;       /* Entries in creation order */
+    uint32_t        clock_hand; /* Next slot the CLOCK hand inspects */
+    uint64_t        rng;        /* Eviction sampling state */
+    cls_mem_sketch_t sketch;    /* TinyLFU only */
+    cls_mem_window_t window;
+    uint32_t        inline_count; /* Entries holding their value inline */
+    uint32_t        cold_pos;   /* Next slot the cold sweep inspects */
+    uint32_t        cold_count; /* Entries holding a compressed value */
+    uint64_t        cold_bytes; /* Their values, uncompressed */
+    uint64_t        cold_stored; /* Their values as stored */
+} cls_mem_root_t;
+
+/* One table with its arena pointers resolved */
+typedef struct {
+    cls_mem_htab_t     *hdr;        /* Writers only */
+    uint32_t            mask;
+    uint8_t            *ctrl;
+    cls_mem_slot_t     *slots;
+} cls_mem_tview_t;
+
+/* Both tables as seen at one header sequence; `first` skips `old`
+ * when no migration is in flight */
+typedef struct {
+    cls_mem_tview_t     tabs[2];
+    uint32_t            first;
+    uint32_t            seq;
+} cls_mem_tsnap_t;
+
+typedef struct {
+    cls_memory_ctx_t   *ctx;
+    cls_mem_shard_t    *shard;
+} cls_mem_expire_ctx_t;
+
+/* Key pattern and time window shared by queries and cursors */
+typedef struct {
+    const char         *prefix;         /* "" = every key */
+    size_t              prefix_len;
+    bool                exact;
+    uint64_t            created_after;
+    uint64_t            created_before;
+    uint64_t            now;
+} cls_mem_filter_t;
+
+typedef enum {
+    CLS_FILTER_TAKE,
+    CLS_FILTER_SKIP,
+    CLS_FILTER_STOP     /* No later key in this shard can match */
+} cls_mem_verdict_t;
+
+/* One shard's pass of a query, merging into the shared sorted results */
+typedef struct {
+    cls_mem_filter_t    filter;
+    cls_result_set_t   *results;
+    cls_mem_store_t    *store;
+    cls_mem_shard_t    *shard;
+    uint32_t            max;
+    bool                key_order;      /* Visits arrive sorted by key */
+    uint32_t            budget;         /* Key-order visits left before the log is cheaper */
+    bool                over;           /* Budget ran out */
+} cls_mem_query_ctx_t;
+
+/* One shard's pass of a cursor batch */
+typedef struct {
+    cls_mem_filter_t    filter;
+    cls_mem_cursor_t   *cursor;
+    cls_mem_store_t    *store;
+    uint32_t            shard;
+} cls_mem_cursor_ctx_t;
+
+/* One shard's pass of a snapshot batch */
+typedef struct {
+    cls_mem_snapshot_t *snap;
+    cls_mem_shard_t    *shard;
+    cls_mem_view_shard_t *view;
+    bool                full;           /* Stopped with entries left */
+} cls_mem_view_ctx_t;
+
+/* Per-key state of a batch chunk, filled before any lookup */
+typedef struct {
+    uint32_t            hash;
+    uint32_t            mixed;
+    uint32_t            shard;          /* UINT32_MAX = no key */
+    size_t              key_len;
+} cls_mem_batch_key_t;
+
+/* Fixups gathered for a snapshot */
+typedef struct {
+    cls_mem_snap_fixup_t *items;
+    uint64_t            count;
+    uint64_t            cap;
+    bool                failed;
+} cls_mem_fixups_t;
+
+/* ============================================================
+ * Internal Helpers
+ * ============================================================ */
+
+static uint64_t cls_time_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+/* Entry times and expiry run on the store clock, which a persistent
+ * store carries over from the run that saved it */
+static uint64_t cls_store_now(const cls_mem_store_t *store) {
+    return (uint64_t)((int64_t)cls_time_us() + store->time_offset);
+}
+
+/* Offset that continues a saved clock: its reading at save time plus
+ * the wall-clock time since */
+static int64_t cls_clock_resume(uint64_t store_time_us, uint64_t real_time_us) {
+    uint64_t real_now = cls_real_time_us();
+    uint64_t resumed = store_time_us + (real_now > real_time_us ? real_now - real_time_us : 0);
+    return (int64_t)(resumed - cls_time_us());
+}
+
+/* FNV-1a hash; the length comes out of the same pass */
+static uint32_t cls_hash(const char *key, size_t *len) {
+    const char *p = key;
+    uint32_t hash = CLS_FNV_OFFSET;
+    while (*p) {
+        hash ^= (uint8_t)*p++;
+        hash *= CLS_FNV_PRIME;
+    }
+    *len = (size_t)(p - key);
+    return hash;
+}
+
+/* Finalizer so sequential keys spread across both H1 and H2 bits */
+static uint32_t cls_hash_mix(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h;
+}
+
+static uint8_t cls_h2(uint32_t mixed) {
+    return (uint8_t)(mixed >> 25);
+}
+
+static cls_mem_store_t *cls_get_store(const cls_memory_ctx_t *ctx) {
+    return (cls_mem_store_t *)ctx->store;
+}
+
+/* Longest namespace prefix the key starts with; 0 (default) if none */
+static uint32_t cls_ns_of(const cls_mem_store_t *store, const char *key, size_t key_len) {
+    uint32_t best = 0;
+    for (uint32_t i = 1; i < store->ns_count; i++) {
+        const cls_mem_ns_t *ns = &store->ns[i];
+        if (ns->prefix_len <= key_len && ns->prefix_len > store->ns[best].prefix_len &&
+            memcmp(key, ns->prefix, ns->prefix_len) == 0)
+            best = i;
+    }
+    return best;
+}
+
+/* Namespaces that can hold keys with this prefix: those whose own prefix
+ * agrees with it as far as both go, plus the default unless one of them
+ * covers the whole pattern */
+static uint32_t cls_ns_mask(const cls_mem_store_t *store, const char *prefix,
+                            size_t prefix_len, bool exact) {
+    uint32_t mask = 0;
+    bool covered = false;
+    for (uint32_t i = 1; i < store->ns_count; i++) {
+        const cls_mem_ns_t *ns = &store->ns[i];
+        if (exact && ns->prefix_len > prefix_len) continue;
+        if (memcmp(prefix, ns->prefix, CLS_MIN(prefix_len, (size_t)ns->prefix_len)) != 0)
+            continue;
+        mask |= 1u << i;
+        if (ns->prefix_len <= prefix_len) covered = true;
+    }
+    return covered ? mask : mask | 1u;
+}
+
+/* Shard choice uses a different function of the key hash than table
+ * placement, so each shard still sees the full range of H1 bits */
+static cls_mem_shard_t *cls_shard_of(const cls_mem_store_t *store, const char *key,
+                                     size_t key_len, uint32_t hash) {
+    const cls_mem_ns_t *ns = &store->ns[cls_ns_of(store, key, key_len)];
+    if (ns->shard_bits == 0) return &store->shards[ns->shard_first];
+    return &store->shards[ns->shard_first + ((hash * 0x9E3779B1u) >> (32 - ns->shard_bits))];
+}
+
+static cls_mem_ns_t *cls_shard_ns(cls_mem_store_t *store, const cls_mem_shard_t *sh) {
+    return &store->ns[sh->ns];
+}
+
+static cls_mem_root_t *cls_shard_root(const cls_mem_shard_t *sh) {
+    return (cls_mem_root_t *)cls_arena_ptr(sh->arena, sh->arena->root);
+}
+
+static cls_mem_table_t *cls_shard_table(const cls_mem_shard_t *sh) {
+    return &cls_shard_root(sh)->table;
+}
+
+static cls_mem_wheel_t *cls_shard_wheel(const cls_mem_shard_t *sh) {
+    return &cls_shard_root(sh)->wheel;
+}
+
+static cls_mem_ref_t *cls_shard_index(const cls_mem_shard_t *sh) {
+    return &cls_shard_root(sh)->index;
+}
+
+static cls_mem_tlog_t *cls_shard_tlog(const cls_mem_shard_t *sh) {
+    return &cls_shard_root(sh)->tlog;
+}
+
+static cls_mem_entry_t *cls_entry_at(const cls_mem_shard_t *sh, cls_mem_ref_t ref) {
+    return cls_arena_entry(sh->arena, ref);
+}
+
+/* Small values sit after the key, 8-byte aligned, in the entry's own
+ * allocation; those entries have no data ref */
+static size_t cls_entry_inline_off(size_t key_len) {
+    return (sizeof(cls_mem_entry_t) + key_len + 1 + 7) & ~(size_t)7;
+}
+
+static void *cls_entry_data(const cls_mem_shard_t *sh, const cls_mem_entry_t *entry) {
+    if (!entry->data)
+        return (uint8_t *)entry + cls_entry_inline_off(entry->key_len);
+    return cls_arena_ptr(sh->arena, entry->data);
+}
+
+static bool cls_entry_expired(const cls_mem_entry_t *entry, uint64_t now) {
+    if (entry->meta.ttl_seconds == 0) return false;
+    return now > cls_entry_expiry_us(entry);
+}
+
+/* Compression only ever keeps a shorter value, so the sizes tell */
+static bool cls_entry_compressed(const cls_mem_entry_t *entry) {
+    return entry->meta.stored_len < entry->meta.data_len;
+}
+
+/* Copy a value out, expanding it if cold; buf holds data_len bytes */
+static cls_status_t cls_entry_copy(const cls_mem_shard_t *sh, const cls_mem_entry_t *entry,
+                                   void *buf) {
+    if (cls_entry_compressed(entry))
+        return cls_lz_decompress((const uint8_t *)cls_entry_data(sh, entry),
+                                 entry->meta.stored_len, (uint8_t *)buf, entry->meta.data_len);
+    memcpy(buf, cls_entry_data(sh, entry), entry->meta.data_len);
+    return CLS_OK;
+}
+
+/* Readers bump access stats without the shard lock */
+static void cls_entry_touch(cls_mem_entry_t *entry, uint64_t now) {
+    CLS_STORE_RLX(&entry->meta.accessed_at, now);
+    CLS_ADD_RLX(&entry->meta.access_count, 1);
+}
+
+static void cls_entry_meta(const cls_mem_entry_t *entry, cls_mem_entry_meta_t *out) {
+    out->hash = entry->meta.hash;
+    out->created_at = entry->meta.created_at;
+    out->accessed_at = CLS_LOAD_RLX(&entry->meta.accessed_at);
+    out->access_count = CLS_LOAD_RLX(&entry->meta.access_count);
+    out->ttl_seconds = entry->meta.ttl_seconds;
+    out->data_len = entry->meta.data_len;
+    out->stored_len = entry->meta.stored_len;
+}
+
+/* Per-shard layout counters; sign is +1 as an entry is published and
+ * -1 as it is unlinked (shard lock held) */
+static void cls_shard_account(const cls_mem_shard_t *sh, const cls_mem_entry_t *entry,
+                              int sign) {
+    cls_mem_root_t *root = cls_shard_root(sh);
+    if (!entry->data)
+        CLS_ADD_RLX(&root->inline_count, (uint32_t)sign);
+    if (cls_entry_compressed(entry)) {
+        CLS_ADD_RLX(&root->cold_count, (uint32_t)sign);
+        CLS_ADD_RLX(&root->cold_bytes, (uint64_t)(int64_t)sign * entry->meta.data_len);
+        CLS_ADD_RLX(&root->cold_stored, (uint64_t)(int64_t)sign * entry->meta.stored_len);
+    }
+}
+
+/* ---- Locking ---- */
+
+/* The lock's last owner died inside a write. Close a table swap it left
+ * open so readers stop retrying; the rest of the shard is suspect. */
+static void cls_shard_recover(const cls_mem_store_t *store, cls_mem_shard_t *sh) {
+    cls_mem_table_t *table = cls_shard_table(sh);
+    if (table->seq & 1) CLS_STORE_REL(&table->seq, table->seq + 1);
+    if (store->shm) CLS_ADD_RLX(&store->shm->hdr->lock_recoveries, 1);
+}
+
+static void cls_shard_lock(const cls_mem_store_t *store, cls_mem_shard_t *sh) {
+    if (store->concurrent && cls_shm_lock(sh->mutex)) cls_shard_recover(store, sh);
+}
+
+static void cls_shard_unlock(const cls_mem_store_t *store, cls_mem_shard_t *sh) {
+    if (store->concurrent) pthread_mutex_unlock(sh->mutex);
+}
+
+/* Readers run under an epoch guard; only when no reader slot is free do
+ * they fall back to the writer lock */
+static cls_mem_reader_t *cls_read_begin(cls_mem_store_t *store, cls_mem_shard_t *sh) {
+    cls_mem_reader_t *reader = cls_epoch_enter(store);
+    if (!reader) cls_shard_lock(store, sh);
+    return reader;
+}
+
+static void cls_read_end(cls_mem_store_t *store, cls_mem_shard_t *sh,
+                         cls_mem_reader_t *reader) {
+    if (reader) cls_epoch_leave(reader);
+    else cls_shard_unlock(store, sh);
+}
+
+/* Feed one in `sample` operations to the hot-key tracker. The tick is
+ * the reader's own, or the shard's when its lock is held instead. */
+static void cls_hot_note(cls_mem_store_t *store, cls_mem_reader_t *reader, cls_mem_shard_t *sh,
+                         cls_mem_hot_kind_t kind, const char *key, size_t key_len,
+                         uint32_t hash) {
+    if (!store->hot) return;
+
+    uint32_t *tick = reader ? &reader->hot_tick : &sh->hot_tick;
+    if (++*tick < store->hot->sample) return;
+    *tick = 0;
+    cls_hot_record(store->hot, kind, key, key_len, hash);
+}
+
+static void cls_count_access(cls_memory_ctx_t *ctx, cls_mem_reader_t *reader,
+                             cls_mem_shard_t *sh, const char *key, size_t key_len,
+                             uint32_t hash, bool hit) {
+    cls_hot_note(cls_get_store(ctx), reader, sh, hit ? CLS_MEM_HOT_READS : CLS_MEM_HOT_MISSES,
+                 key, key_len, hash);
+    if (!reader) {
+        cls_mem_ns_t *ns = cls_shard_ns(cls_get_store(ctx), sh);
+        CLS_ADD_RLX(hit ? &ns->hits : &ns->misses, 1);
+        CLS_ADD_RLX(hit ? &ctx->hit_count : &ctx->miss_count, 1);
+        return;
+    }
+    if (hit) reader->hits[sh->ns]++;
+    else reader->misses[sh->ns]++;
+    if (++reader->pending >= CLS_MEM_COUNT_FLUSH)
+        cls_epoch_fold_counts(reader);
+}
+
+static void cls_shard_sync_used(cls_memory_ctx_t *ctx, cls_mem_shard_t *sh) {
+    size_t now = sh->arena->used;
+    if (now != sh->used_reported) {
+        CLS_ADD_RLX(&ctx->used, now - sh->used_reported);
+        CLS_STORE_RLX(&sh->used_reported, now);
+    }
+}
+
+/* Arena bytes in use; in a shared segment other processes move it too */
+static size_t cls_shard_used(const cls_mem_store_t *store, const cls_mem_shard_t *sh) {
+    return store->shm ? CLS_LOAD_RLX(&sh->arena->used) : CLS_LOAD_RLX(&sh->used_reported);
+}
+
+/* Retired memory may be all that stands between us and a full arena */
+static cls_mem_ref_t cls_shard_alloc(cls_mem_store_t *store, cls_mem_shard_t *sh, size_t len) {
+    cls_mem_ref_t ref = cls_arena_alloc(sh->arena, len);
+    if (!ref && sh->ring->count > 0) {
+        cls_shard_reclaim(store, sh);
+        ref = cls_arena_alloc(sh->arena, len);
+    }
+    return ref;
+}
+
+/* ---- Control group matching (SWAR, 8 bytes at a time) ---- */
+
+static uint64_t cls_group_load(const uint8_t *ctrl) {
+    uint64_t g = CLS_LOAD_ACQ((const uint64_t *)(const void *)ctrl);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    g = __builtin_bswap64(g);
+#endif
+    return g;
+}
+
+/* May report false positives above a true match; callers verify */
+static uint64_t cls_group_match(uint64_t g, uint8_t h2) {
+    uint64_t x = g ^ (CLS_GROUP_LSBS * h2);
+    return (x - CLS_GROUP_LSBS) & ~x & CLS_GROUP_MSBS;
+}
+
+static uint64_t cls_group_match_empty(uint64_t g) {
+    return g & ~(g << 6) & CLS_GROUP_MSBS;
+}
+
+static uint64_t cls_group_match_free(uint64_t g) {
+    return g & ~(g << 7) & CLS_GROUP_MSBS;
+}
+
+static uint32_t cls_group_first(uint64_t mask) {
+    return (uint32_t)__builtin_ctzll(mask) >> 3;
+}
+
+static uint32_t cls_probe_start(uint32_t mixed, uint32_t mask) {
+    return mixed & mask & ~(uint32_t)(CLS_MEM_GROUP_WIDTH - 1);
+}
+
+static uint32_t cls_capacity_growth(uint32_t capacity) {
+    return (uint32_t)((uint64_t)capacity * CLS_MEM_LOAD_NUM / CLS_MEM_LOAD_DEN);
+}
+
+static size_t cls_htab_ctrl_bytes(uint32_t capacity) {
+    return ((size_t)capacity + CLS_MEM_GRANULE - 1) & ~(size_t)(CLS_MEM_GRANULE - 1);
+}
+
+static size_t cls_htab_bytes(uint32_t capacity) {
+    return cls_htab_ctrl_bytes(capacity) + (size_t)capacity * sizeof(cls_mem_slot_t);
+}
+
+static cls_mem_tview_t cls_htab_view_of(const cls_mem_shard_t *sh, cls_mem_htab_t *hdr,
+                                        cls_mem_ref_t block, uint32_t mask) {
+    cls_mem_tview_t v;
+    v.hdr = hdr;
+    v.mask = mask;
+    v.ctrl = (uint8_t *)cls_arena_ptr(sh->arena, block);
+    v.slots = v.ctrl ? (cls_mem_slot_t *)(v.ctrl + cls_htab_ctrl_bytes(mask + 1)) : NULL;
+    return v;
+}
+
+/* Writer-side view; the header is stable under the shard lock */
+static cls_mem_tview_t cls_htab_view(const cls_mem_shard_t *sh, cls_mem_htab_t *t) {
+    return cls_htab_view_of(sh, t, t->block, t->mask);
+}
+
+static void cls_htab_set_ctrl(const cls_mem_tview_t *v, uint32_t i, uint8_t c) {
+    CLS_STORE_REL(&v->ctrl[i], c);
+}
+
+/* Header fields readers snapshot are written atomically */
+static void cls_htab_publish(cls_mem_htab_t *dst, const cls_mem_htab_t *src) {
+    CLS_STORE_RLX(&dst->block, src->block);
+    CLS_STORE_RLX(&dst->mask, src->mask);
+    dst->count = src->count;
+    dst->growth_left = src->growth_left;
+}
+
+static cls_status_t cls_htab_alloc(cls_mem_store_t *store, cls_mem_shard_t *sh,
+                                   cls_mem_htab_t *t, uint32_t capacity) {
+    cls_mem_ref_t block = cls_shard_alloc(store, sh, cls_htab_bytes(capacity));
+    if (!block) return CLS_ERR_NOMEM;
+
+    t->block = block;
+    t->mask = capacity - 1;
+    t->count = 0;
+    t->growth_left = cls_capacity_growth(capacity);
+    memset(cls_arena_ptr(sh->arena, block), CLS_CTRL_EMPTY, capacity);
+    return CLS_OK;
+}
+
+/* Find slot index holding key, or UINT32_MAX */
+static uint32_t cls_htab_find(const cls_mem_shard_t *sh, const cls_mem_tview_t *v,
+                              const char *key, size_t key_len, uint32_t mixed) {
+    if (!v->ctrl) return UINT32_MAX;
+
+    uint32_t mask = v->mask;
+    uint8_t h2 = cls_h2(mixed);
+    uint32_t pos = cls_probe_start(mixed, mask);
+    uint32_t stride = 0;
+
+    for (;;) {
+        uint64_t g = cls_group_load(&v->ctrl[pos]);
+        uint64_t m = cls_group_match(g, h2);
+        while (m) {
+            uint32_t i = pos + cls_group_first(m);
+            const cls_mem_slot_t *s = &v->slots[i];
+            if (CLS_LOAD_RLX(&s->hash) == mixed) {
+                const cls_mem_entry_t *e = cls_entry_at(sh, CLS_LOAD_ACQ(&s->entry));
+                if (e->key_len == key_len && memcmp(e->key, key, key_len) == 0)
+                    return i;
+            }
+            m &= m - 1;
+        }
+        if (cls_group_match_empty(g))
+            return UINT32_MAX;
+        stride += CLS_MEM_GROUP_WIDTH;
+        pos = (pos + stride) & mask;
+    }
+}
+
+/* Find the slot pointing at a known entry, or UINT32_MAX */
+static uint32_t cls_htab_find_ref(const cls_mem_tview_t *v, uint32_t mixed,
+                                  cls_mem_ref_t ref) {
+    if (!v->ctrl) return UINT32_MAX;
+
+    uint32_t mask = v->mask;
+    uint8_t h2 = cls_h2(mixed);
+    uint32_t pos = cls_probe_start(mixed, mask);
+    uint32_t stride = 0;
+
+    for (;;) {
+        uint64_t g = cls_group_load(&v->ctrl[pos]);
+        uint64_t m = cls_group_match(g, h2);
+        while (m) {
+            uint32_t i = pos + cls_group_first(m);
+            if (v->slots[i].entry == ref && !(v->ctrl[i] & CLS_CTRL_EMPTY))
+                return i;
+            m &= m - 1;
+        }
+        if (cls_group_match_empty(g))
+            return UINT32_MAX;
+        stride += CLS_MEM_GROUP_WIDTH;
+        pos = (pos + stride) & mask;
+    }
+}
+
+/* First EMPTY or DELETED slot on the probe path; table must have room */
+static uint32_t cls_htab_find_free(const cls_mem_tview_t *v, uint32_t mixed) {
+    uint32_t mask = v->mask;
+    uint32_t pos = cls_probe_start(mixed, mask);
+    uint32_t stride = 0;
+
+    for (;;) {
+        uint64_t m = cls_group_match_free(cls_group_load(&v->ctrl[pos]));
+        if (m)
+            return pos + cls_group_first(m);
+        stride += CLS_MEM_GROUP_WIDTH;
+        pos = (pos + stride) & mask;
+    }
+}
+
+/* Slot contents go out before the control byte that makes them visible */
+static void cls_htab_insert(const cls_mem_tview_t *v, uint32_t mixed, cls_mem_ref_t entry) {
+    uint32_t i = cls_htab_find_free(v, mixed);
+    if (v->ctrl[i] == CLS_CTRL_EMPTY)
+        v->hdr->growth_left--;
+    CLS_STORE_RLX(&v->slots[i].hash, mixed);
+    /* Release: a reader that matched the tombstone's old control byte
+     * may load this ref before the new control byte */
+    CLS_STORE_REL(&v->slots[i].entry, entry);
+    cls_htab_set_ctrl(v, i, cls_h2(mixed));
+    v->hdr->count++;
+}
+
+/* Tombstone rather than empty: keeps every probe chain intact */
+static void cls_htab_erase(const cls_mem_tview_t *v, uint32_t i) {
+    cls_htab_set_ctrl(v, i, CLS_CTRL_DELETED);
+    v->hdr->count--;
+}
+
+/* Drop every tombstone without a new block. Live slots are marked
+ * DELETED while they wait to be placed again, so the first free slot
+ * on a waiting entry's probe path is never past its own group; one
+ * already in the right group stays put, one whose target is still
+ * waiting trades places with it. Readers must be fenced off by seq. */
+static void cls_htab_rehash(const cls_mem_tview_t *v) {
+    uint32_t capacity = v->mask + 1;
+    uint32_t group = ~(uint32_t)(CLS_MEM_GROUP_WIDTH - 1);
+
+    for (uint32_t i = 0; i < capacity; i++)
+        cls_htab_set_ctrl(v, i, (v->ctrl[i] & CLS_CTRL_EMPTY) ? CLS_CTRL_EMPTY : CLS_CTRL_DELETED);
+
+    for (uint32_t i = 0; i < capacity; i++) {
+        if (v->ctrl[i] != CLS_CTRL_DELETED) continue;
+
+        cls_mem_slot_t s = v->slots[i];
+        uint32_t j = cls_htab_find_free(v, s.hash);
+        if ((j & group) == (i & group)) {
+            cls_htab_set_ctrl(v, i, cls_h2(s.hash));
+            continue;
+        }
+
+        bool swap = v->ctrl[j] == CLS_CTRL_DELETED;
+        cls_mem_slot_t t = v->slots[j];
+        CLS_STORE_RLX(&v->slots[j].hash, s.hash);
+        CLS_STORE_RLX(&v->slots[j].entry, s.entry);
+        cls_htab_set_ctrl(v, j, cls_h2(s.hash));
+        if (swap) {
+            CLS_STORE_RLX(&v->slots[i].hash, t.hash);
+            CLS_STORE_RLX(&v->slots[i].entry, t.entry);
+            i--;
+        } else {
+            cls_htab_set_ctrl(v, i, CLS_CTRL_EMPTY);
+        }
+    }
+    v->hdr->growth_left = cls_capacity_growth(capacity) - v->hdr->count;
+}
+
+/* ---- Table header snapshots ---- */
+
+static void cls_table_seq_begin(cls_mem_table_t *table) {
+    CLS_STORE_RLX(&table->seq, table->seq + 1);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void cls_table_seq_end(cls_mem_table_t *table) {
+    CLS_STORE_REL(&table->seq, table->seq + 1);
+}
+
+static void cls_table_snapshot(const cls_mem_shard_t *sh, cls_mem_table_t *table,
+                               cls_mem_tsnap_t *snap) {
+    for (;;) {
+        uint32_t seq = CLS_LOAD_ACQ(&table->seq);
+        if (seq & 1) continue;
+
+        cls_mem_ref_t old_block = CLS_LOAD_RLX(&table->old.block);
+        uint32_t old_mask = CLS_LOAD_RLX(&table->old.mask);
+        cls_mem_ref_t cur_block = CLS_LOAD_RLX(&table->cur.block);
+        uint32_t cur_mask = CLS_LOAD_RLX(&table->cur.mask);
+        bool migrating = CLS_LOAD_RLX(&table->migrating);
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (CLS_LOAD_RLX(&table->seq) != seq) continue;
+
+        snap->tabs[0] = cls_htab_view_of(sh, &table->old, old_block, old_mask);
+        snap->tabs[1] = cls_htab_view_of(sh, &table->cur, cur_block, cur_mask);
+        snap->first = migrating ? 0 : 1;
+        snap->seq = seq;
+        return;
+    }
+}
+
+/* A miss only counts if no table swap raced the probe */
+static bool cls_table_snapshot_stale(cls_mem_table_t *table, const cls_mem_tsnap_t *snap) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return CLS_LOAD_RLX(&table->seq) != snap->seq;
+}
+
+/* ---- Incremental growth ---- */
+
+static void cls_table_migrate(cls_mem_store_t *store, cls_mem_shard_t *sh,
+                              cls_mem_table_t *table, uint32_t steps) {
+    if (!table->migrating) return;
+
+    cls_mem_tview_t old = cls_htab_view(sh, &table->old);
+    cls_mem_tview_t cur = cls_htab_view(sh, &table->cur);
+    uint32_t capacity = table->old.mask + 1;
+
+    /* Insert before erase, so a reader checking old then cur sees it */
+    while (steps-- > 0 && table->migrate_pos < capacity) {
+        uint32_t i = table->migrate_pos++;
+        if (old.ctrl[i] & CLS_CTRL_EMPTY) continue;
+
+        cls_htab_insert(&cur, old.slots[i].hash, old.slots[i].entry);
+        cls_htab_erase(&old, i);
+    }
+
+    if (table->migrate_pos >= capacity) {
+        cls_mem_ref_t block = table->old.block;
+        cls_mem_htab_t none;
+        memset(&none, 0, sizeof(none));
+
+        cls_table_seq_begin(table);
+        CLS_STORE_RLX(&table->migrating, false);
+        cls_htab_publish(&table->old, &none);
+        cls_table_seq_end(table);
+
+        cls_shard_retire(store, sh, block, CLS_RETIRE_BLOCK);
+        table->migrate_pos = 0;
+    }
+}
+
+/* Start a rehash sized so the live set lands at half the max load.
+ * A table whose room went to tombstones is cleaned in place instead,
+ * so churn in a full arena needs no second block. */
+static cls_status_t cls_table_grow(cls_mem_store_t *store, cls_mem_shard_t *sh,
+                                   cls_mem_table_t *table) {
+    if (table->migrating)
+        cls_table_migrate(store, sh, table, UINT32_MAX);
+
+    if ((uint64_t)table->cur.count * CLS_MEM_INPLACE_DEN <=
+        ((uint64_t)table->cur.mask + 1) * CLS_MEM_INPLACE_NUM) {
+        cls_mem_tview_t cur = cls_htab_view(sh, &table->cur);
+        cls_table_seq_begin(table);
+        cls_htab_rehash(&cur);
+        cls_table_seq_end(table);
+        return CLS_OK;
+    }
+
+    uint64_t need = ((uint64_t)table->cur.count + 1) * 2;
+    uint32_t capacity = CLS_MEM_MIN_SLOTS;
+    while (cls_capacity_growth(capacity) < need) {
+        if (capacity >= 0x80000000u) return CLS_ERR_OVERFLOW;
+        capacity <<= 1;
+    }
+
+    /* Build the new table before readers can see it */
+    cls_mem_htab_t fresh;
+    CLS_CHECK(cls_htab_alloc(store, sh, &fresh, capacity));
+
+    cls_table_seq_begin(table);
+    cls_htab_publish(&table->old, &table->cur);
+    cls_htab_publish(&table->cur, &fresh);
+    CLS_STORE_RLX(&table->migrating, true);
+    cls_table_seq_end(table);
+    table->migrate_pos = 0;
+
+    return CLS_OK;
+}
+
+/* Look up key in the draining table first, then the live one */
+static bool cls_table_find(const cls_mem_shard_t *sh, cls_mem_table_t *table,
+                           const char *key, size_t key_len, uint32_t mixed,
+                           cls_mem_tview_t *out_view, uint32_t *out_idx) {
+    cls_mem_tsnap_t snap;
+    cls_table_snapshot(sh, table, &snap);
+
+    for (uint32_t t = snap.first; t < 2; t++) {
+        uint32_t i = cls_htab_find(sh, &snap.tabs[t], key, key_len, mixed);
+        if (i != UINT32_MAX) {
+            *out_view = snap.tabs[t];
+            *out_idx = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Lock-free lookup; retries a miss, or a hit whose slot was refilled,
+ * that raced a table swap or an in-place rehash */
+static cls_mem_entry_t *cls_table_lookup(const cls_mem_shard_t *sh, const char *key,
+                                         size_t key_len, uint32_t mixed) {
+    cls_mem_table_t *table = cls_shard_table(sh);
+    cls_mem_tsnap_t snap;
+
+    do {
+        cls_table_snapshot(sh, table, &snap);
+        for (uint32_t t = snap.first; t < 2; t++) {
+            uint32_t i = cls_htab_find(sh, &snap.tabs[t], key, key_len, mixed);
+            if (i == UINT32_MAX) continue;
+
+            cls_mem_entry_t *e = cls_entry_at(sh, CLS_LOAD_ACQ(&snap.tabs[t].slots[i].entry));
+            if (e->key_len == key_len && memcmp(e->key, key, key_len) == 0)
+                return e;
+            break;
+        }
+    } while (cls_table_snapshot_stale(table, &snap));
+
+    return NULL;
+}
+
+/* Counted lookup for retrieve/borrow: TinyLFU's sketch sees every
+ * access, hit or miss */
+static cls_mem_entry_t *cls_shard_lookup(cls_mem_store_t *store, const cls_mem_shard_t *sh,
+                                         const char *key, size_t key_len, uint32_t hash) {
+    uint32_t mixed = cls_hash_mix(hash);
+    if (cls_shard_ns(store, sh)->evict == CLS_MEM_EVICT_TINYLFU)
+        cls_sketch_add(&cls_shard_root(sh)->sketch, sh->arena, mixed);
+    return cls_table_lookup(sh, key, key_len, mixed);
+}
+
+/* Warm the first control group and slots a lookup of `mixed` probes.
+ * Only a hint: a racing table swap just makes it useless. */
+static void cls_table_prefetch(const cls_mem_shard_t *sh, uint32_t mixed) {
+    cls_mem_table_t *table = cls_shard_table(sh);
+    cls_mem_ref_t block = CLS_LOAD_RLX(&table->cur.block);
+    uint32_t mask = CLS_LOAD_RLX(&table->cur.mask);
+    cls_mem_tview_t v = cls_htab_view_of(sh, &table->cur, block, mask);
+    if (!v.ctrl) return;
+
+    uint32_t pos = cls_probe_start(mixed, mask);
+    __builtin_prefetch(&v.ctrl[pos]);
+    __builtin_prefetch(&v.slots[pos]);
+}
+
+static bool cls_table_find_ref(const cls_mem_shard_t *sh, cls_mem_table_t *table,
+                               uint32_t mixed, cls_mem_ref_t ref,
+                               cls_mem_tview_t *out_view, uint32_t *out_idx) {
+    cls_mem_tsnap_t snap;
+    cls_table_snapshot(sh, table, &snap);
+
+    for (uint32_t t = snap.first; t < 2; t++) {
+        uint32_t i = cls_htab_find_ref(&snap.tabs[t], mixed, ref);
+        if (i != UINT32_MAX) {
+            *out_view = snap.tabs[t];
+            *out_idx = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* ---- Snapshot views ---- */
+
+/* Whether a view could still return an entry unlinked from this shard */
+static bool cls_view_wants(const cls_mem_view_shard_t *vs, const cls_mem_entry_t *entry) {
+    if (vs->state != CLS_VIEW_PENDING && vs->state != CLS_VIEW_LIVE) return false;
+    if (vs->lost || entry->born > vs->at) return false;
+    return vs->state == CLS_VIEW_PENDING || !vs->started || strcmp(entry->key, vs->pos) > 0;
+}
+
+static bool cls_view_push(cls_mem_view_shard_t *vs, cls_mem_ref_t ref) {
+    if (vs->held_count == vs->held_cap) {
+        uint32_t cap = vs->held_cap ? vs->held_cap * 2 : 64;
+        cls_mem_ref_t *held = (cls_mem_ref_t *)realloc(vs->held, cap * sizeof(cls_mem_ref_t));
+        if (!held) return false;
+        vs->held = held;
+        vs->held_cap = cap;
+    }
+    vs->held[vs->held_count++] = ref;
+    return true;
+}
+
+/* Hold an unlinked entry for every view that has yet to return it; a
+ * view that cannot is marked lost. False when nothing holds it. */
+static bool cls_view_hold(cls_mem_shard_t *sh, cls_mem_ref_t ref) {
+    cls_mem_entry_t *entry = cls_entry_at(sh, ref);
+    for (uint32_t k = 0; k < CLS_MEM_VIEW_MAX; k++) {
+        cls_mem_view_shard_t *vs = &sh->views[k];
+        if (!cls_view_wants(vs, entry)) continue;
+        if (cls_view_push(vs, ref)) entry->held++;
+        else vs->lost = true;
+    }
+    return entry->held > 0;
+}
+
+/* The last view to let go retires the entry */
+static void cls_view_unhold(cls_mem_store_t *store, cls_mem_shard_t *sh, cls_mem_ref_t ref) {
+    if (--cls_entry_at(sh, ref)->held == 0)
+        cls_shard_retire(store, sh, ref, CLS_RETIRE_ENTRY);
+}
+
+/* A view is done with this shard: drop what it still holds */
+static void cls_view_close(cls_mem_store_t *store, cls_mem_shard_t *sh,
+                           cls_mem_view_shard_t *vs) {
+    if (vs->state == CLS_VIEW_IDLE) return;
+
+    for (uint32_t i = 0; i < vs->held_count; i++)
+        cls_view_unhold(store, sh, vs->held[i]);
+    free(vs->held);
+    memset(vs, 0, sizeof(*vs));
+    sh->views_open--;
+}
+
+/* Retire an unlinked entry unless an open view still needs it */
+static void cls_entry_drop(cls_mem_store_t *store, cls_mem_shard_t *sh, cls_mem_ref_t ref) {
+    if (sh->views_open > 0 && cls_view_hold(sh, ref)) return;
+    cls_shard_retire(store, sh, ref, CLS_RETIRE_ENTRY);
+}
+
+static void cls_table_remove(cls_memory_ctx_t *ctx, cls_mem_shard_t *sh,
+                             const cls_mem_tview_t *v, uint32_t i) {
+    cls_mem_ref_t ref = v->slots[i].entry;
+
+    cls_htab_erase(v, i);
+    cls_wheel_remove(cls_shard_wheel(sh), sh->arena, ref);
+    cls_index_remove(sh->arena, cls_shard_index(sh), ref);
+    if (cls_entry_at(sh, ref)->flags & CLS_ENTRY_WINDOW)
+        cls_window_remove(&cls_shard_root(sh)->window, sh->arena, ref);
+    cls_tlog_remove(cls_shard_tlog(sh), sh->arena, cls_entry_at(sh, ref)->meta.created_at, ref);
+    cls_shard_account(sh, cls_entry_at(sh, ref), -1);
+    CLS_SUB_RLX(&cls_shard_ns(cls_get_store(ctx), sh)->entry_count, 1);
+    CLS_SUB_RLX(&ctx->entry_count, 1);
+    cls_entry_drop(cls_get_store(ctx), sh, ref);
+}
+
+/* Wheel callback: the entry is already off the wheel, drop it from the table */
+static void cls_expire_entry(void *user_ctx, cls_mem_ref_t ref) {
+    cls_mem_expire_ctx_t *ec = (cls_mem_expire_ctx_t *)user_ctx;
+    uint32_t mixed = cls_hash_mix(cls_entry_at(ec->shard, ref)->meta.hash);
+    cls_mem_tview_t v;
+    uint32_t i;
+
+    if (cls_table_find_ref(ec->shard, cls_shard_table(ec->shard), mixed, ref, &v, &i))
+        cls_table_remove(ec->ctx, ec->shard, &v, i);
+}
+
+/* ---- Logging ---- */
+
+/* Log an entry's removal so replay drops it too (shard lock held). A
+ * failed append sticks in the log and fails the next store. */
+static uint64_t cls_log_delete(cls_mem_store_t *store, const cls_mem_entry_t *entry) {
+    uint64_t lsn = 0;
+    if (store->wal)
+        cls_wal_append(store->wal, CLS_WAL_DELETE, entry->key, entry->key_len,
+                       NULL, 0, 0, 0, &lsn);
+    return lsn;
+}
+
+/* ---- Eviction ---- */
+
+static uint64_t cls_evict_rand(cls_mem_root_t *root) {
+    root->rng ^= root->rng << 13;
+    root->rng ^= root->rng >> 7;
+    root->rng ^= root->rng << 17;
+    return root->rng;
+}
+
+/* Second-chance sweep; an expired entry goes first. Two turns of the
+ * hand are enough for every reference to have been cleared once. */
+static uint32_t cls_evict_clock(const cls_mem_shard_t *sh, const cls_mem_tview_t *v,
+                                cls_mem_ref_t keep, uint64_t now) {
+    cls_mem_root_t *root = cls_shard_root(sh);
+    uint64_t turns = ((uint64_t)v->mask + 1) * 2;
+
+    for (uint64_t n = 0; n < turns; n++) {
+        uint32_t i = root->clock_hand & v->mask;
+        root->clock_hand = (i + 1) & v->mask;
+        if (v->ctrl[i] & CLS_CTRL_EMPTY || v->slots[i].entry == keep) continue;
+
+        cls_mem_entry_t *entry = cls_entry_at(sh, v->slots[i].entry);
+        if (cls_entry_expired(entry, now)) return i;
+
+        uint32_t seen = CLS_LOAD_RLX(&entry->meta.access_count);
+        if (seen != entry->clock_seen) {
+            entry->clock_seen = seen;
+            continue;
+        }
+        return i;
+    }
+    return UINT32_MAX;
+}
+
+/* Least recently accessed of a few consecutive occupied slots from a
+ * random start; hash placement makes neighbours a random sample */
+static uint32_t cls_evict_sample(const cls_mem_shard_t *sh, const cls_mem_tview_t *v,
+                                 cls_mem_ref_t keep, bool main_only, uint64_t now) {
+    cls_mem_root_t *root = cls_shard_root(sh);
+    uint32_t start = (uint32_t)cls_evict_rand(root) & v->mask;
+    uint32_t best = UINT32_MAX, found = 0;
+    uint64_t best_at = 0;
+
+    for (uint32_t n = 0; n <= v->mask && found < CLS_MEM_EVICT_SAMPLE; n++) {
+        uint32_t i = (start + n) & v->mask;
+        if (v->ctrl[i] & CLS_CTRL_EMPTY || v->slots[i].entry == keep) continue;
+
+        cls_mem_entry_t *entry = cls_entry_at(sh, v->slots[i].entry);
+        if (main_only && (entry->flags & CLS_ENTRY_WINDOW)) continue;
+        if (cls_entry_expired(entry, now)) return i;
+
+        uint64_t at = CLS_LOAD_RLX(&entry->meta.accessed_at);
+        if (found++ == 0 || at < best_at) {
+            best = i;
+            best_at = at;
+        }
+    }
+    return best;
+}
+
+/* Main-region victim for the active policy, or UINT32_MAX */
+static uint32_t cls_evict_pick(cls_mem_store_t *store, const cls_mem_shard_t *sh,
+                               const cls_mem_tview_t *v, cls_mem_ref_t keep, uint64_t now) {
+    cls_mem_evict_t evict = cls_shard_ns(store, sh)->evict;
+    if (evict == CLS_MEM_EVICT_CLOCK)
+        return cls_evict_clock(sh, v, keep, now);
+    return cls_evict_sample(sh, v, keep, evict == CLS_MEM_EVICT_TINYLFU, now);
+}
+
+static void cls_evict_slot(cls_memory_ctx_t *ctx, cls_mem_shard_t *sh,
+                           const cls_mem_tview_t *v, uint32_t i) {
+    cls_mem_store_t *store = cls_get_store(ctx);
+    cls_log_delete(store, cls_entry_at(sh, v->slots[i].entry));
+    cls_table_remove(ctx, sh, v, i);
+    CLS_ADD_RLX(&cls_shard_ns(store, sh)->evictions, 1);
+}
+
+/* Evict one entry other than `keep`; false when nothing is left to evict.
+ * Victims come from the live table only, so a rehash is finished first. */
+static bool cls_evict_one(cls_memory_ctx_t *ctx, cls_mem_shard_t *sh,
+                          cls_mem_ref_t keep, uint64_t now) {
+    cls_mem_store_t *store = cls_get_store(ctx);
+    cls_mem_table_t *table = cls_shard_table(sh);
+
+    cls_table_migrate(store, sh, table, UINT32_MAX);
+    cls_mem_tview_t v = cls_htab_view(sh, &table->cur);
+
+    uint32_t i = cls_evict_pick(store, sh, &v, keep, now);
+    if (i == UINT32_MAX && cls_shard_ns(store, sh)->evict == CLS_MEM_EVICT_TINYLFU) {
+        /* Everything left is in the window: take its oldest */
+        cls_mem_ref_t ref = cls_window_pop(&cls_shard_root(sh)->window, sh->arena);
+        if (ref && ref != keep &&
+            cls_table_find_ref(sh, table, cls_hash_mix(cls_entry_at(sh, ref)->meta.hash),
+                               ref, &v, &i)) {
+            cls_evict_slot(ctx, sh, &v, i);
+            return true;
+        }
+        return false;
+    }
+    if (i == UINT32_MAX) return false;
+
+    cls_evict_slot(ctx, sh, &v, i);
+    return true;
+}
+
+/* TinyLFU: the entry leaving the window meets the main region's victim;
+ * the one the sketch has seen less often goes */
+static void cls_evict_admit(cls_memory_ctx_t *ctx, cls_mem_shard_t *sh,
+                            cls_mem_ref_t cand, uint64_t now) {
+    cls_mem_store_t *store = cls_get_store(ctx);
+    cls_mem_root_t *root = cls_shard_root(sh);
+    cls_mem_table_t *table = cls_shard_table(sh);
+
+    cls_table_migrate(store, sh, table, UINT32_MAX);
+    cls_mem_tview_t v = cls_htab_view(sh, &table->cur);
+
+    uint32_t victim = cls_evict_sample(sh, &v, cand, true, now);
+    cls_mem_entry_t *ce = cls_entry_at(sh, cand);
+    bool admit = false;
+
+    if (victim != UINT32_MAX) {
+        uint32_t vf = cls_sketch_estimate(&root->sketch, sh->arena, v.slots[victim].hash);
+        uint32_t cf = cls_sketch_estimate(&root->sketch, sh->arena,
+                                          cls_hash_mix(ce->meta.hash));
+        admit = cf > vf || cls_entry_expired(cls_entry_at(sh, v.slots[victim].entry), now);
+    }
+
+    if (admit) {
+        cls_evict_slot(ctx, sh, &v, victim);
+        return;
+    }
+
+    uint32_t i;
+    if (cls_table_find_ref(sh, table, cls_hash_mix(ce->meta.hash), cand, &v, &i)) {
+        cls_evict_slot(ctx, sh, &v, i);
+        CLS_ADD_RLX(&cls_shard_ns(store, sh)->rejections, 1);
+    }
+}
+
+/* Make room in a shard for one new key */
+static cls_status_t cls_evict_make_room(cls_memory_ctx_t *ctx, cls_mem_shard_t *sh,
+                                        uint64_t now) {
+    const cls_mem_ns_t *ns = cls_shard_ns(cls_get_store(ctx), sh);
+    cls_mem_root_t *root = cls_shard_root(sh);
+    cls_mem_table_t *table = cls_shard_table(sh);
+    cls_mem_ref_t cand = 0;
+
+    /* The window's oldest entry moves to the main region */
+    if (ns->evict == CLS_MEM_EVICT_TINYLFU) {
+        cls_sketch_age(&root->sketch, sh->arena);
+        if (cls_window_full(&root->window))
+            cand = cls_window_pop(&root->window, sh->arena);
+    }
+
+    uint32_t live = table->cur.count + (table->migrating ? table->old.count : 0);
+    if (live < ns->shard_cap) return CLS_OK;
+
+    if (cand) {
+        cls_evict_admit(ctx, sh, cand, now);
+        return CLS_OK;
+    }
+    return cls_evict_one(ctx, sh, 0, now) ? CLS_OK : CLS_ERR_OVERFLOW;
+}
+
+/* Entries are immutable once published; an overwrite builds a new one.
+ * A NULL data leaves the value for the caller to fill. */
+static cls_mem_ref_t cls_entry_create(cls_mem_store_t *store, cls_mem_shard_t *sh,
+                                      const char *key, size_t key_len, uint32_t hash,
+                                      const void *data, size_t len, uint32_t ttl_sec,
+                                      uint64_t now) {
+    bool inl = len <= store->inline_max;
+    cls_mem_ref_t ref = cls_shard_alloc(store, sh, inl ? cls_entry_inline_off(key_len) + len :
+                                                         sizeof(cls_mem_entry_t) + key_len + 1);
+    if (!ref) return 0;
+
+    cls_mem_entry_t *entry = cls_entry_at(sh, ref);
+    memset(entry, 0, sizeof(cls_mem_entry_t));
+    if (!inl) {
+        entry->data = cls_shard_alloc(store, sh, len);
+        if (!entry->data) {
+            cls_arena_free(sh->arena, ref);
+            return 0;
+        }
+    }
+
+    memcpy(entry->key, key, key_len + 1);
+    entry->key_len = (uint16_t)key_len;
+    entry->wheel_slot = CLS_WHEEL_NONE;
+    if (data) memcpy(cls_entry_data(sh, entry), data, len);
+    entry->meta.hash = hash;
+    entry->meta.created_at = now;
+    entry->meta.accessed_at = now;
+    entry->meta.access_count = 1;
+    entry->meta.ttl_seconds = ttl_sec;
+    entry->meta.data_len = len;
+    entry->meta.stored_len = len;
+    entry->born = store->view_seq;
+    return ref;
+}
+
+/* Under an eviction policy a full arena gives up entries (never `keep`)
+ * until the new one fits. Small victims rarely free a whole page, so
+ * this runs until the allocation succeeds or the shard has nothing left
+ * to evict rather than for a fixed number of tries. */
+static cls_mem_ref_t cls_entry_create_evicting(cls_memory_ctx_t *ctx, cls_mem_shard_t *sh,
+                                               cls_mem_ref_t keep, const char *key,
+                                               size_t key_len, uint32_t hash,
+                                               const void *data, size_t len,
+                                               uint32_t ttl_sec, uint64_t now) {
+    cls_mem_store_t *store = cls_get_store(ctx);
+    cls_mem_ref_t ref = cls_entry_create(store, sh, key, key_len, hash, data, len, ttl_sec, now);
+
+    while (!ref && cls_shard_ns(store, sh)->evict != CLS_MEM_EVICT_NONE &&
+           cls_evict_one(ctx, sh, keep, now))
+        ref = cls_entry_create(store, sh, key, key_len, hash, data, len, ttl_sec, now);
+    return ref;
+}
+
+/* Publish `fresh` in place of the entry in slot idx and retire the old
+ * one; fresh carries the same key and creation time */
+static void cls_entry_swap(cls_mem_store_t *store, cls_mem_shard_t *sh,
+                           const cls_mem_tview_t *v, uint32_t idx, cls_mem_ref_t fresh) {
+    cls_mem_ref_t old = v->slots[idx].entry;
+    cls_mem_entry_t *prev = cls_entry_at(sh, old);
+    cls_mem_entry_t *entry = cls_entry_at(sh, fresh);
+
+    CLS_STORE_REL(&v->slots[idx].entry, fresh);
+    if (prev->flags & CLS_ENTRY_WINDOW)
+        cls_window_replace(&cls_shard_root(sh)->window, sh->arena, old, fresh);
+    cls_index_replace(sh->arena, cls_shard_index(sh), old, fresh);
+    cls_tlog_replace(cls_shard_tlog(sh), sh->arena, entry->meta.created_at, old, fresh);
+    cls_wheel_remove(cls_shard_wheel(sh), sh->arena, old);
+    cls_wheel_insert(cls_shard_wheel(sh), sh->arena, fresh);
+    cls_shard_account(sh, prev, -1);
+    cls_shard_account(sh, entry, 1);
+
+    /* A recode keeps the stamp, so views return the new copy instead */
+    if (entry->born == prev->born)
+        cls_shard_retire(store, sh, old, CLS_RETIRE_ENTRY);
+    else
+        cls_entry_drop(store, sh, old);
+}
+
+/* ---- Cold tier ---- */
+
+/* Rebuild slot idx's entry with its value compressed to `packed`, or
+ * expanded when packed is NULL. Never evicts, so it is safe mid-scan;
+ * returns NULL when the arena is full. */
+static cls_mem_entry_t *cls_entry_recode(cls_mem_store_t *store, cls_mem_shard_t *sh,
+                                         const cls_mem_tview_t *v, uint32_t idx,
+                                         const void *packed, size_t packed_len) {
+    cls_mem_entry_t *prev = cls_entry_at(sh, v->slots[idx].entry);
+    size_t len = packed ? packed_len : prev->meta.data_len;
+    cls_mem_ref_t ref = cls_entry_create(store, sh, prev->key, prev->key_len, prev->meta.hash,
+                                         packed, len, prev->meta.ttl_seconds,
+                                         prev->meta.created_at);
+    if (!ref) return NULL;
+
+    cls_mem_entry_t *entry = cls_entry_at(sh, ref);
+    if (!packed && CLS_IS_ERR(cls_entry_copy(sh, prev, cls_entry_data(sh, entry)))) {
+        cls_arena_free(sh->arena, entry->data);
+        cls_arena_free(sh->arena, ref);
+        return NULL;
+    }
+
+    entry->meta.accessed_at = CLS_LOAD_RLX(&prev->meta.accessed_at);
+    entry->meta.access_count = CLS_LOAD_RLX(&prev->meta.access_count);
+    entry->meta.data_len = prev->meta.data_len;
+    entry->clock_seen = prev->clock_seen;
+    entry->born = prev->born;
+    cls_entry_swap(store, sh, v, idx, ref);
+    return entry;
+}
+
+/* Expand a cold entry so callers can be handed a pointer to its value
+ * (shard lock held). NULL if it cannot be found or the arena is full. */
+static cls_mem_entry_t *cls_entry_thaw(cls_mem_store_t *store, cls_mem_shard_t *sh,
+                                       cls_mem_entry_t *entry) {
+    cls_mem_tview_t v;
+    uint32_t idx;
+    if (!cls_table_find_ref(sh, cls_shard_table(sh), cls_hash_mix(entry->meta.hash),
+                            cls_arena_ref(sh->arena, entry), &v, &idx))
+        return NULL;
+    return cls_entry_recode(store, sh, &v, idx, NULL, 0);
+}
+
+/* Compress slot i's value if that saves at least an eighth; values that
+ * do not are flagged so the sweep stops retrying them */
+static void cls_entry_freeze(cls_mem_store_t *store, cls_mem_shard_t *sh,
+                             const cls_mem_tview_t *v, uint32_t i) {
+    cls_mem_entry_t *entry = cls_entry_at(sh, v->slots[i].entry);
+    size_t len = entry->meta.data_len;
+    size_t cap = len - len / 8;
+    uint8_t *packed = (uint8_t *)malloc(cap);
+    if (!packed) return;
+
+    size_t n = cls_lz_compress((const uint8_t *)cls_entry_data(sh, entry), len, packed, cap);
+    if (n > 0) cls_entry_recode(store, sh, v, i, packed, n);
+    else entry->flags |= CLS_ENTRY_RAW;
+    free(packed);
+}
+
+/* Compress values idle for cold_after, and expand cold ones that have
+ * been read since; a bounded run of slots per call (shard lock held) */
+static void cls_shard_cool(cls_mem_store_t *store, cls_mem_shard_t *sh, uint64_t now) {
+    /* Only the live table is swept; help a pending rehash drain into it */
+    cls_mem_table_t *table = cls_shard_table(sh);
+    if (table->migrating) cls_table_migrate(store, sh, table, CLS_MEM_COLD_SCAN);
+
+    cls_mem_root_t *root = cls_shard_root(sh);
+    cls_mem_tview_t v = cls_htab_view(sh, &table->cur);
+    if (!v.ctrl) return;
+
+    for (uint32_t n = 0; n < CLS_MEM_COLD_SCAN && n <= v.mask; n++) {
+        uint32_t i = root->cold_pos++ & v.mask;
+        if (v.ctrl[i] & CLS_CTRL_EMPTY) continue;
+
+        cls_mem_entry_t *entry = cls_entry_at(sh, v.slots[i].entry);
+        if (cls_entry_expired(entry, now)) continue;
+
+        uint64_t seen = CLS_LOAD_RLX(&entry->meta.accessed_at);
+        bool idle = now > seen && now - seen >= store->cold_after_us;
+        if (cls_entry_compressed(entry)) {
+            if (!idle) cls_entry_recode(store, sh, &v, i, NULL, 0);
+        } else if (idle && entry->meta.data_len >= store->cold_min_bytes &&
+                   !(entry->flags & CLS_ENTRY_RAW)) {
+            cls_entry_freeze(store, sh, &v, i);
+        }
+    }
+}
+
+static cls_status_t cls_shard_format(cls_mem_store_t *store, cls_mem_shard_t *sh,
+                                     void *base, size_t size) {
+    CLS_CHECK(cls_arena_format(base, size));
+
+    cls_mem_arena_t *arena = (cls_mem_arena_t *)base;
+    arena->root = cls_arena_alloc(arena, sizeof(cls_mem_root_t));
+    if (!arena->root) return CLS_ERR_INVALID;
+    memset(cls_arena_ptr(arena, arena->root), 0, sizeof(cls_mem_root_t));
+
+    sh->arena = arena;
+    if (CLS_IS_ERR(cls_htab_alloc(store, sh, &cls_shard_table(sh)->cur, CLS_MEM_MIN_SLOTS)))
+        return CLS_ERR_INVALID;
+    cls_wheel_init(cls_shard_wheel(sh), cls_store_now(store));
+
+    cls_mem_root_t *root = cls_shard_root(sh);
+    const cls_mem_ns_t *ns = cls_shard_ns(store, sh);
+    root->rng = (cls_time_us() ^ ((uint64_t)(sh - store->shards) << 32)) | 1;
+    if (ns->evict == CLS_MEM_EVICT_TINYLFU) {
+        uint32_t window = ns->shard_cap * CLS_MEM_WINDOW_PCT / 100;
+        if (CLS_IS_ERR(cls_sketch_init(&root->sketch, arena, ns->shard_cap)) ||
+            CLS_IS_ERR(cls_window_init(&root->window, arena, window > 0 ? window : 1)))
+            return CLS_ERR_NOMEM;
+    }
+    sh->used_reported = arena->used;
+
+    if (store->concurrent && !store->shm && pthread_mutex_init(&sh->lock, NULL) != 0)
+        return CLS_ERR_INTERNAL;
+    return CLS_OK;
+}
+
+/* A loaded pool lives inside the snapshot mapping, a shared one in the
+ * segment */
+static void cls_pool_free(void *pool, void *map, size_t map_len, cls_mem_shm_t *shm) {
+    if (shm) {
+        cls_shm_close(shm);
+        free(shm);
+    } else if (map) {
+        cls_snap_unmap(map, map_len);
+    } else {
+        free(pool);
+    }
+}
+
+static void cls_store_free(cls_mem_store_t *store, uint32_t formatted) {
+    if (!store) return;
+
+    if (store->wal) {
+        cls_wal_close(store->wal);
+        free(store->wal);
+    }
+    free(store->snap_path);
+    cls_hot_free(store->hot);
+    cls_intern_destroy(&store->intern);
+    for (uint32_t i = 0; i < store->shard_count; i++) {
+        for (uint32_t k = 0; k < CLS_MEM_VIEW_MAX; k++)
+            free(store->shards[i].views[k].held);
+    }
+    cls_epoch_destroy(store);
+    if (store->concurrent && !store->shm) {
+        for (uint32_t i = 0; i < formatted; i++)
+            pthread_mutex_destroy(&store->shards[i].lock);
+    }
+    free(store->shards);
+    free(store);
+}
+
+/* NULL or "*" matches everything, a trailing '*' is a prefix match,
+ * anything else must match exactly. Returns false for a pattern no key
+ * can match. */
+static bool cls_pattern_parse(const char *pattern, char *prefix,
+                              size_t *prefix_len, bool *exact) {
+    prefix[0] = '\0';
+    *prefix_len = 0;
+    *exact = false;
+    if (!pattern || strcmp(pattern, "*") == 0) return true;
+
+    size_t plen = strlen(pattern);
+    *exact = plen == 0 || pattern[plen - 1] != '*';
+    if (!*exact) plen--;
+    if (plen >= CLS_MEM_KEY_MAX) return false;
+
+    memcpy(prefix, pattern, plen);
+    prefix[plen] = '\0';
+    *prefix_len = plen;
+    return true;
+}
+
+static cls_mem_verdict_t cls_filter_check(const cls_mem_filter_t *f,
+                                          const cls_mem_entry_t *entry) {
+    /* Keys come in order: once past the prefix nothing later can match */
+    if (strncmp(entry->key, f->prefix, f->prefix_len) != 0)
+        return CLS_FILTER_STOP;
+    if (f->exact && entry->key_len != f->prefix_len)
+        return CLS_FILTER_STOP;
+
+    if (cls_entry_expired(entry, f->now)) return CLS_FILTER_SKIP;
+    if (f->created_after > 0 && entry->meta.created_at < f->created_after)
+        return CLS_FILTER_SKIP;
+    if (f->created_before > 0 && entry->meta.created_at > f->created_before)
+        return CLS_FILTER_SKIP;
+    return CLS_FILTER_TAKE;
+}
+
+/* Lower bound of key in a sorted array whose elements start with their
+ * key pointer (result and cursor entries both do) */
+static uint32_t cls_sorted_slot(const void *base, size_t stride, uint32_t count,
+                                const char *key) {
+    uint32_t lo = 0, hi = count;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        const char *k = *(const char *const *)((const uint8_t *)base + mid * stride);
+        if (strcmp(k, key) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static void cls_cursor_unpin(cls_mem_store_t *store, uint32_t shard, cls_mem_ref_t ref) {
+    cls_mem_entry_t *entry = cls_entry_at(&store->shards[shard], ref);
+    __atomic_fetch_sub(&entry->pins, 1, __ATOMIC_RELEASE);
+}
+
+/* Insert into the sorted result array, dropping the largest when full.
+ * On a concurrent store results are pinned like cursor batches, since
+ * the shard lock is gone by the time the caller reads them */
+static void cls_query_insert(cls_mem_query_ctx_t *qc, cls_mem_entry_t *entry) {
+    cls_result_set_t *rs = qc->results;
+    cls_mem_store_t *store = qc->store;
+    uint32_t lo = cls_sorted_slot(rs->entries, sizeof(rs->entries[0]), rs->count, entry->key);
+    if (lo >= qc->max) return;
+
+    if (rs->count == qc->max) {
+        if (store->concurrent)
+            cls_cursor_unpin(store, rs->entries[rs->count - 1].shard,
+                             rs->entries[rs->count - 1].ref);
+        rs->count--;
+    }
+    memmove(&rs->entries[lo + 1], &rs->entries[lo],
+            (rs->count - lo) * sizeof(rs->entries[0]));
+
+    rs->entries[lo].key = entry->key;
+    rs->entries[lo].data = cls_entry_data(qc->shard, entry);
+    rs->entries[lo].data_len = entry->meta.data_len;
+    cls_entry_meta(entry, &rs->entries[lo].meta);
+    rs->entries[lo].shard = (uint32_t)(qc->shard - store->shards);
+    rs->entries[lo].ref = 0;
+    if (store->concurrent) {
+        CLS_ADD_RLX(&entry->pins, 1);
+        rs->entries[lo].ref = cls_arena_ref(qc->shard->arena, entry);
+    }
+    rs->count++;
+}
+
+/* Whether a key is already in the results, from an abandoned index pass */
+static bool cls_query_has(const cls_mem_query_ctx_t *qc, const char *key) {
+    const cls_result_set_t *rs = qc->results;
+    uint32_t lo = cls_sorted_slot(rs->entries, sizeof(rs->entries[0]), rs->count, key);
+    return lo < rs->count && strcmp(rs->entries[lo].key, key) == 0;
+}
+
+static bool cls_query_visit(void *user_ctx, cls_mem_ref_t ref) {
+    cls_mem_query_ctx_t *qc = (cls_mem_query_ctx_t *)user_ctx;
+    cls_mem_entry_t *entry = cls_entry_at(qc->shard, ref);
+    const cls_result_set_t *rs = qc->results;
+
+    if (qc->key_order && qc->budget-- == 0) {
+        qc->over = true;
+        return false;
+    }
+
+    /* A full result set only takes keys below its current last one */
+    if (rs->count == qc->max && strcmp(entry->key, rs->entries[rs->count - 1].key) > 0)
+        return !qc->key_order;
+
+    /* Results point at values, so cold ones are expanded; with the arena
+     * too full for that, the entry is left out */
+    cls_mem_verdict_t verdict = cls_filter_check(&qc->filter, entry);
+    if (!qc->key_order) {
+        if (verdict == CLS_FILTER_STOP) return true;    /* The log is not key-ordered */
+        if (verdict == CLS_FILTER_TAKE && cls_query_has(qc, entry->key)) return true;
+    }
+    if (verdict == CLS_FILTER_TAKE && cls_entry_compressed(entry))
+        entry = cls_entry_thaw(qc->store, qc->shard, entry);
+    if (verdict == CLS_FILTER_TAKE && entry) cls_query_insert(qc, entry);
+    return verdict != CLS_FILTER_STOP;
+}
+
+static void cls_cursor_unpin_all(cls_mem_cursor_t *cursor) {
+    cls_mem_store_t *store = cls_get_store(cursor->ctx);
+    for (uint32_t i = 0; i < cursor->count; i++)
+        cls_cursor_unpin(store, cursor->entries[i].shard, cursor->entries[i].ref);
+    cursor->count = 0;
+}
+
+/* Like cls_query_insert, but batch entries are pinned in any mode, so
+ * the shard lock can be dropped between batches */
+static void cls_cursor_insert(cls_mem_cursor_ctx_t *cc, cls_mem_entry_t *entry) {
+    cls_mem_cursor_t *cur = cc->cursor;
+    cls_mem_shard_t *sh = &cc->store->shards[cc->shard];
+    uint32_t max = cur->batch_size;
+    uint32_t lo = cls_sorted_slot(cur->entries, sizeof(cur->entries[0]), cur->count, entry->key);
+    if (lo >= max) return;
+
+    if (cur->count == max) {
+        cls_cursor_unpin(cc->store, cur->entries[max - 1].shard, cur->entries[max - 1].ref);
+        cur->count--;
+    }
+    memmove(&cur->entries[lo + 1], &cur->entries[lo],
+            (cur->count - lo) * sizeof(cur->entries[0]));
+
+    CLS_ADD_RLX(&entry->pins, 1);
+    cur->entries[lo].key = entry->key;
+    cur->entries[lo].data = cls_entry_data(sh, entry);
+    cur->entries[lo].data_len = entry->meta.data_len;
+    cur->entries[lo].meta = &entry->meta;
+    cur->entries[lo].shard = cc->shard;
+    cur->entries[lo].ref = cls_arena_ref(sh->arena, entry);
+    cur->count++;
+}
+
+static bool cls_cursor_visit(void *user_ctx, cls_mem_ref_t ref) {
+    cls_mem_cursor_ctx_t *cc = (cls_mem_cursor_ctx_t *)user_ctx;
+    cls_mem_cursor_t *cur = cc->cursor;
+    cls_mem_entry_t *entry = cls_entry_at(&cc->store->shards[cc->shard], ref);
+
+    if (cur->count == cur->batch_size &&
+        strcmp(entry->key, cur->entries[cur->count - 1].key) > 0)
+        return false;
+
+    cls_mem_verdict_t verdict = cls_filter_check(&cc->filter, entry);
+    if (verdict == CLS_FILTER_TAKE && cls_entry_compressed(entry))
+        entry = cls_entry_thaw(cc->store, &cc->store->shards[cc->shard], entry);
+    if (verdict == CLS_FILTER_TAKE && entry) cls_cursor_insert(cc, entry);
+    return verdict != CLS_FILTER_STOP;
+}
+
+/* Pin an entry into a snapshot batch */
+static void cls_view_take(cls_mem_snapshot_t *snap, cls_mem_shard_t *sh, cls_mem_entry_t *entry) {
+    uint32_t i = snap->count++;
+    CLS_ADD_RLX(&entry->pins, 1);
+    snap->entries[i].key = entry->key;
+    snap->entries[i].data = cls_entry_data(sh, entry);
+    snap->entries[i].data_len = entry->meta.data_len;
+    snap->entries[i].meta = &entry->meta;
+    snap->entries[i].expanded = NULL;
+    snap->entries[i].shard = snap->shard;
+    snap->entries[i].ref = cls_arena_ref(sh->arena, entry);
+}
+
+/* Live entries the view can see, in key order; the position moves with
+ * each one taken so writers know which unlinks to hold */
+static bool cls_view_visit(void *user_ctx, cls_mem_ref_t ref) {
+    cls_mem_view_ctx_t *vc = (cls_mem_view_ctx_t *)user_ctx;
+    cls_mem_entry_t *entry = cls_entry_at(vc->shard, ref);
+
+    if (entry->born > vc->view->at || cls_entry_expired(entry, vc->snap->now))
+        return true;
+    if (vc->snap->count == CLS_MEMORY_BATCH_MAX) {
+        vc->full = true;
+        return false;
+    }
+
+    cls_view_take(vc->snap, vc->shard, entry);
+    memcpy(vc->view->pos, entry->key, (size_t)entry->key_len + 1);
+    vc->view->started = true;
+    return true;
+}
+
+static void cls_view_release(cls_mem_snapshot_t *snap) {
+    cls_mem_store_t *store = cls_get_store(snap->ctx);
+    for (uint32_t i = 0; i < snap->count; i++) {
+        free(snap->entries[i].expanded);
+        cls_cursor_unpin(store, snap->entries[i].shard, snap->entries[i].ref);
+    }
+    snap->count = 0;
+}
+
+/* ---- Writes ---- */
+
+/* Insert or overwrite one key (shard lock held). A logged store returns
+ * its LSN for the caller to commit once the lock is dropped. */
+static cls_status_t cls_store_locked(cls_memory_ctx_t *ctx, cls_mem_shard_t *sh,
+                                     const char *key, size_t key_len, uint32_t hash,
+                                     const void *data, size_t len, uint32_t ttl_sec,
+                                     uint64_t now, uint64_t *lsn) {
+    cls_mem_store_t *store = cls_get_store(ctx);
+    cls_mem_ns_t *ns = cls_shard_ns(store, sh);
+    uint32_t mixed = cls_hash_mix(hash);
+    cls_mem_table_t *table = cls_shard_table(sh);
+    cls_status_t status = CLS_OK;
+
+    cls_table_migrate(store, sh, table, CLS_MEM_MIGRATE_STEP);
+    if (ns->evict == CLS_MEM_EVICT_TINYLFU)
+        cls_sketch_add(&cls_shard_root(sh)->sketch, sh->arena, mixed);
+
+    /* Existing key: swap in a fresh entry, retire the old one */
+    cls_mem_tview_t v;
+    uint32_t idx;
+    if (cls_table_find(sh, table, key, key_len, mixed, &v, &idx)) {
+        cls_mem_ref_t old = v.slots[idx].entry;
+        cls_mem_ref_t ref = cls_entry_create_evicting(ctx, sh, old, key, key_len, hash,
+                                                      data, len, ttl_sec, now);
+        if (!ref) {
+            status = CLS_ERR_NOMEM;
+            goto out;
+        }
+
+        /* Eviction may have finished a rehash and moved the slot */
+        if (!cls_table_find_ref(sh, table, mixed, old, &v, &idx)) {
+            cls_arena_free(sh->arena, cls_entry_at(sh, ref)->data);
+            cls_arena_free(sh->arena, ref);
+            status = CLS_ERR_INTERNAL;
+            goto out;
+        }
+
+        cls_mem_entry_t *prev = cls_entry_at(sh, old);
+        cls_mem_entry_t *entry = cls_entry_at(sh, ref);
+        entry->meta.created_at = prev->meta.created_at;
+        entry->meta.access_count = CLS_LOAD_RLX(&prev->meta.access_count) + 1;
+        cls_entry_swap(store, sh, &v, idx, ref);
+        goto out;
+    }
+
+    /* New entry; the quota is the namespace's, so a full one leaves the
+     * others alone */
+    if (ns->evict != CLS_MEM_EVICT_NONE) {
+        status = cls_evict_make_room(ctx, sh, now);
+        if (CLS_IS_ERR(status)) goto out;
+    } else if (CLS_LOAD_RLX(&ns->entry_count) >= ns->max_entries) {
+        status = CLS_ERR_OVERFLOW;
+        goto out;
+    }
+
+    /* A full arena has no block for a bigger table: shed entries until
+     * the live set fits the one there is and it can be cleaned in place */
+    if (table->cur.growth_left == 0) {
+        status = cls_table_grow(store, sh, table);
+        while (status == CLS_ERR_NOMEM && ns->evict != CLS_MEM_EVICT_NONE &&
+               cls_evict_one(ctx, sh, 0, now))
+            status = cls_table_grow(store, sh, table);
+        if (CLS_IS_ERR(status)) goto out;
+    }
+
+    cls_mem_ref_t ref = cls_entry_create_evicting(ctx, sh, 0, key, key_len, hash,
+                                                  data, len, ttl_sec, now);
+    if (!ref) {
+        status = CLS_ERR_NOMEM;
+        goto out;
+    }
+
+    /* Indexes first: they are the only steps after allocation that can
+     * fail. Their nodes come straight from the arena, so under eviction
+     * a victim's memory is reclaimed before trying again. */
+    for (;;) {
+        status = cls_index_insert(sh->arena, cls_shard_index(sh), ref);
+        if (CLS_IS_OK(status)) {
+            status = cls_tlog_append(cls_shard_tlog(sh), sh->arena, now, ref);
+            if (CLS_IS_ERR(status))
+                cls_index_remove(sh->arena, cls_shard_index(sh), ref);
+        }
+        if (status != CLS_ERR_NOMEM || ns->evict == CLS_MEM_EVICT_NONE ||
+            !cls_evict_one(ctx, sh, 0, now))
+            break;
+        cls_shard_reclaim(store, sh);
+    }
+    if (CLS_IS_ERR(status)) {
+        cls_arena_free(sh->arena, cls_entry_at(sh, ref)->data);
+        cls_arena_free(sh->arena, ref);
+        goto out;
+    }
+
+    cls_mem_tview_t cur = cls_htab_view(sh, &table->cur);
+    cls_htab_insert(&cur, mixed, ref);
+    cls_wheel_insert(cls_shard_wheel(sh), sh->arena, ref);
+    if (ns->evict == CLS_MEM_EVICT_TINYLFU)
+        cls_window_push(&cls_shard_root(sh)->window, sh->arena, ref);
+    cls_shard_account(sh, cls_entry_at(sh, ref), 1);
+    CLS_ADD_RLX(&ns->entry_count, 1);
+    CLS_ADD_RLX(&ctx->entry_count, 1);
+
+out:
+    /* Logged under the lock so the log keeps each key's order; the
+     * commit waits outside it, where concurrent stores can share a sync */
+    if (CLS_IS_OK(status) && store->wal)
+        status = cls_wal_append(store->wal, CLS_WAL_STORE, key, key_len, data, len,
+                                ttl_sec, now, lsn);
+    if (CLS_IS_OK(status))
+        cls_hot_note(store, NULL, sh, CLS_MEM_HOT_WRITES, key, key_len, hash);
+    return status;
+}
+
+/* Prevent absurdly large allocations */
+static cls_status_t cls_store_check(const cls_mem_store_t *store, const cls_mem_shard_t *sh,
+                                    size_t key_len, size_t len) {
+    if (key_len >= CLS_MEM_KEY_MAX) return CLS_ERR_OVERFLOW;
+    if (len > sh->arena->size / 2 || (store->wal && len > CLS_WAL_RECORD_MAX))
+        return CLS_ERR_OVERFLOW;
+    return CLS_OK;
+}
+
+/* Store with the clock read under the shard lock, or at a given time
+ * (`at`) when replaying the log */
+static cls_status_t cls_store_put(cls_memory_ctx_t *ctx, const char *key, size_t key_len,
+                                  uint32_t hash, const void *data, size_t len,
+                                  uint32_t ttl_sec, uint64_t at) {
+    cls_mem_store_t *store = cls_get_store(ctx);
+    cls_mem_shard_t *sh = cls_shard_of(store, key, key_len, hash);
+    CLS_CHECK(cls_store_check(store, sh, key_len, len));
+
+    uint64_t lsn = 0;
+    cls_shard_lock(store, sh);
+    cls_status_t status = cls_store_locked(ctx, sh, key, key_len, hash, data, len, ttl_sec,
+                                           at ? at : cls_store_now(store), &lsn);
+    cls_shard_sync_used(ctx, sh);
+    cls_shard_unlock(store, sh);
+
+    if (lsn) status = cls_wal_commit(store->wal, lsn);
+    return status;
+}
+
+/* ---- Batches ---- */
+
+/* Hash a chunk of keys, then touch each shard root and first probe
+ * group, so the lookups that follow overlap their cache misses */
+static void cls_batch_hash(const cls_mem_store_t *store, const cls_mem_batch_item_t *items,
+                           uint32_t n, cls_mem_batch_key_t *keys) {
+    for (uint32_t i = 0; i < n; i++) {
+        if (!items[i].key) {
+            keys[i].shard = UINT32_MAX;
+            continue;
+        }
+        keys[i].hash = cls_hash(items[i].key, &keys[i].key_len);
+        keys[i].mixed = cls_hash_mix(keys[i].hash);
+        const cls_mem_shard_t *sh = cls_shard_of(store, items[i].key, keys[i].key_len,
+                                                 keys[i].hash);
+        keys[i].shard = (uint32_t)(sh - store->shards);
+        __builtin_prefetch(cls_shard_root(sh));
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        if (keys[i].shard != UINT32_MAX)
+            cls_table_prefetch(&store->shards[keys[i].shard], keys[i].mixed);
+    }
+}
+
+/* Chunk positions ordered by shard; stable, so a key stored twice in
+ * one batch keeps its order */
+static void cls_batch_order(const cls_mem_batch_key_t *keys, uint32_t n, uint32_t *order) {
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t j = i;
+        while (j > 0 && keys[order[j - 1]].shard > keys[i].shard) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+}
+
+/* ---- Persistence ---- */
 
-static uint64_t cls_time_us(void) {
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+static char *cls_persist_file(const char *base, const char *suffix) {
+    size_t a = strlen(base), b = strlen(suffix);
+    char *path = (char *)malloc(a + b + 1);
+    if (!path) return NULL;
+    memcpy(path, base, a);
+    memcpy(path + a, suffix, b + 1);
+    return path;
 }
 
-/* FNV-1a hash */
-static uint32_t cls_hash(const char *key) {
-    uint32_t hash = 2166136261u;
-    while (*key) {
-        hash ^= (uint8_t)*key++;
-        hash *= 16777619u;
+static void cls_replay_record(void *user_ctx, const cls_mem_wal_rec_t *rec,
+                              const char *key, const void *data) {
+    cls_memory_ctx_t *ctx = (cls_memory_ctx_t *)user_ctx;
+    char name[CLS_MEM_KEY_MAX];
+    memcpy(name, key, rec->key_len);
+    name[rec->key_len] = '\0';
+
+    if (rec->type == CLS_WAL_STORE && rec->data_len > 0) {
+        size_t key_len;
+        uint32_t hash = cls_hash(name, &key_len);
+        cls_store_put(ctx, name, key_len, hash, data, (size_t)rec->data_len, rec->ttl_sec,
+                      rec->time_us);
+    } else if (rec->type == CLS_WAL_DELETE) {
+        cls_memory_delete(ctx, name);
+    }
+}
+
+static void cls_fixups_push(cls_mem_fixups_t *fx, uint32_t shard, cls_mem_ref_t ref,
+                            uint32_t kind) {
+    if (fx->count == fx->cap) {
+        uint64_t cap = fx->cap ? fx->cap * 2 : 256;
+        cls_mem_snap_fixup_t *items = (cls_mem_snap_fixup_t *)realloc(
+            fx->items, cap * sizeof(cls_mem_snap_fixup_t));
+        if (!items) {
+            fx->failed = true;
+            return;
+        }
+        fx->items = items;
+        fx->cap = cap;
+    }
+    fx->items[fx->count].shard = shard;
+    fx->items[fx->count].ref = ref;
+    fx->items[fx->count].kind = kind;
+    fx->count++;
+}
+
+/* Everything the pool image cannot resolve on its own: retired blocks
+ * nobody will reclaim after a restart, entries held for open views, and
+ * pins nobody will release (all shard locks held) */
+static void cls_fixups_collect(cls_mem_store_t *store, cls_mem_fixups_t *fx) {
+    for (uint32_t s = 0; s < store->shard_count; s++) {
+        cls_mem_shard_t *sh = &store->shards[s];
+
+        for (uint32_t i = 0; i < sh->ring->count; i++) {
+            const cls_mem_retired_t *r = &cls_ring_slots(sh)[(sh->ring->head + i) % sh->ring->cap];
+            cls_fixups_push(fx, s, r->ref, r->kind);
+        }
+        for (uint32_t k = 0; k < CLS_MEM_VIEW_MAX; k++) {
+            for (uint32_t i = 0; i < sh->views[k].held_count; i++)
+                cls_fixups_push(fx, s, sh->views[k].held[i], CLS_FIXUP_HELD);
+        }
+
+        cls_mem_table_t *table = cls_shard_table(sh);
+        cls_mem_tview_t tabs[2] = { cls_htab_view(sh, &table->old),
+                                    cls_htab_view(sh, &table->cur) };
+        for (uint32_t t = table->migrating ? 0 : 1; t < 2; t++) {
+            for (uint32_t i = 0; i <= tabs[t].mask; i++) {
+                if (tabs[t].ctrl[i] & CLS_CTRL_EMPTY) continue;
+                cls_mem_ref_t ref = tabs[t].slots[i].entry;
+                if (CLS_LOAD_RLX(&cls_entry_at(sh, ref)->pins) != 0)
+                    cls_fixups_push(fx, s, ref, CLS_FIXUP_UNPIN);
+            }
+        }
     }
-    return hash;
 }
 
-static uint32_t cls_bucket_idx(uint32_t hash) {
-    return hash & (CLS_MEM_BUCKET_COUNT - 1);
+static void cls_fixups_apply(cls_mem_store_t *store, const cls_mem_snap_fixup_t *fixups,
+                             uint64_t count) {
+    for (uint64_t i = 0; i < count; i++) {
+        const cls_mem_snap_fixup_t *f = &fixups[i];
+        if (f->shard >= store->shard_count || !f->ref) continue;
+
+        cls_mem_arena_t *arena = store->shards[f->shard].arena;
+        if (f->kind == CLS_FIXUP_UNPIN) {
+            cls_arena_entry(arena, f->ref)->pins = 0;
+            continue;
+        }
+        /* One record per view holding the entry; the last frees it */
+        if (f->kind == CLS_FIXUP_HELD) {
+            cls_mem_entry_t *entry = cls_arena_entry(arena, f->ref);
+            if (entry->held == 0 || --entry->held > 0) continue;
+        }
+        if (f->kind == CLS_FIXUP_ENTRY || f->kind == CLS_FIXUP_HELD)
+            cls_arena_free(arena, cls_arena_entry(arena, f->ref)->data);
+        cls_arena_free(arena, f->ref);
+    }
 }
 
-static cls_mem_table_t *cls_get_table(cls_memory_ctx_t *ctx) {
-    return (cls_mem_table_t *)ctx->pool;
+/* Adopt a shard arena from a loaded snapshot */
+static cls_status_t cls_shard_attach(cls_mem_store_t *store, cls_mem_shard_t *sh,
+                                     void *base, size_t size) {
+    cls_mem_arena_t *arena = (cls_mem_arena_t *)base;
+    if (arena->size != size || !arena->root) return CLS_ERR_INVALID;
+
+    sh->arena = arena;
+    sh->used_reported = arena->used;
+    if (store->concurrent && !store->shm && pthread_mutex_init(&sh->lock, NULL) != 0)
+        return CLS_ERR_INTERNAL;
+    return CLS_OK;
 }
 
-static bool cls_entry_expired(const cls_mem_entry_t *entry) {
-    if (entry->meta.ttl_seconds == 0) return false;
-    uint64_t now = cls_time_us();
-    uint64_t expiry = entry->meta.created_at + (uint64_t)entry->meta.ttl_seconds * 1000000ULL;
-    return now > expiry;
+/* ---- Namespaces ---- */
+
+static size_t cls_ns_span(const cls_mem_ns_t *ns) {
+    return (ns->pool_size / ns->shard_count) & ~(size_t)(CLS_MEM_PAGE_SIZE - 1);
+}
+
+/* Size one namespace's shards and quota once its pool share is known */
+static cls_status_t cls_ns_shape(cls_mem_ns_t *ns, uint32_t shards, bool concurrent,
+                                 cls_mem_evict_t evict, uint32_t max_entries) {
+    if (shards == 0)
+        shards = concurrent ? CLS_MEM_DEFAULT_SHARDS : 1;
+    if ((shards & (shards - 1)) != 0 || shards > CLS_MEM_MAX_SHARDS)
+        return CLS_ERR_INVALID;
+    if ((uint32_t)evict > CLS_MEM_EVICT_TINYLFU)
+        return CLS_ERR_INVALID;
+
+    /* Keep every shard arena big enough to be useful */
+    while (shards > 1 && ns->pool_size / shards < CLS_MEM_SHARD_MIN_BYTES)
+        shards >>= 1;
+    if ((uint64_t)ns->pool_size / shards > CLS_INDEX_ARENA_MAX)
+        return CLS_ERR_OVERFLOW;
+
+    ns->shard_count = shards;
+    ns->shard_bits = 0;
+    while ((1u << ns->shard_bits) < shards) ns->shard_bits++;
+    ns->evict = evict;
+    ns->max_entries = max_entries ? max_entries :
+                      (uint32_t)(ns->pool_size / (sizeof(cls_mem_entry_t) + CLS_MEM_KEY_MAX + 64));
+
+    /* Evicting namespaces cap each shard at its share of max_entries */
+    ns->shard_cap = ns->max_entries >> ns->shard_bits;
+    if (ns->shard_cap == 0) ns->shard_cap = 1;
+    return CLS_OK;
+}
+
+/* Split the pool: configured namespaces take whole pages from the front,
+ * the default namespace (slot 0) the rest. Shards are numbered in slot
+ * order. */
+static cls_status_t cls_ns_layout(const cls_memory_config_t *geo, cls_mem_ns_t *ns,
+                                  uint32_t *ns_count, uint32_t *shards) {
+    if (geo->ns_count > CLS_MEMORY_NS_MAX || (geo->ns_count > 0 && !geo->namespaces))
+        return CLS_ERR_INVALID;
+
+    memset(ns, 0, CLS_MEM_NS_SLOTS * sizeof(cls_mem_ns_t));
+    size_t off = 0;
+    for (uint32_t i = 0; i < geo->ns_count; i++) {
+        const cls_mem_ns_config_t *nc = &geo->namespaces[i];
+        cls_mem_ns_t *n = &ns[i + 1];
+        size_t plen = nc->prefix ? strlen(nc->prefix) : 0;
+        if (plen == 0 || plen >= CLS_MEMORY_NS_PREFIX_MAX) return CLS_ERR_INVALID;
+        for (uint32_t j = 1; j <= i; j++) {
+            if (strcmp(ns[j].prefix, nc->prefix) == 0) return CLS_ERR_INVALID;
+        }
+
+        memcpy(n->prefix, nc->prefix, plen + 1);
+        n->prefix_len = (uint32_t)plen;
+        n->pool_size = nc->pool_size & ~(size_t)(CLS_MEM_PAGE_SIZE - 1);
+        n->pool_off = off;
+        if (n->pool_size < CLS_MEMORY_MIN_POOL || n->pool_size >= geo->pool_size - off)
+            return CLS_ERR_INVALID;
+        off += n->pool_size;
+        CLS_CHECK(cls_ns_shape(n, nc->shard_count, geo->concurrent, nc->evict,
+                               nc->max_entries));
+    }
+
+    ns[0].pool_off = off;
+    ns[0].pool_size = geo->pool_size - off;
+    if (ns[0].pool_size < CLS_MEMORY_MIN_POOL) return CLS_ERR_INVALID;
+    CLS_CHECK(cls_ns_shape(&ns[0], geo->shard_count, geo->concurrent, geo->evict,
+                           geo->max_entries));
+
+    uint32_t total = 0;
+    for (uint32_t i = 0; i <= geo->ns_count; i++) {
+        ns[i].shard_first = total;
+        total += ns[i].shard_count;
+    }
+    if (total > CLS_MEM_MAX_SHARDS) return CLS_ERR_INVALID;
+
+    *ns_count = geo->ns_count + 1;
+    *shards = total;
+    return CLS_OK;
+}
+
+/* Rebuild the layout a shared segment was created with, checking that
+ * this process arrives at the same offsets */
+static cls_status_t cls_ns_adopt(const cls_mem_shm_hdr_t *hdr, cls_memory_config_t *geo,
+                                 cls_mem_ns_config_t *saved, cls_mem_ns_t *ns,
+                                 uint32_t *ns_count, uint32_t *shards) {
+    const cls_mem_ns_t *src = hdr->ns;
+    if (hdr->ns_count == 0 || hdr->ns_count > CLS_MEM_NS_SLOTS) return CLS_ERR_INVALID;
+
+    geo->pool_size = (size_t)hdr->pool_size;
+    geo->shard_count = src[0].shard_count;
+    geo->evict = src[0].evict;
+    geo->max_entries = src[0].max_entries;
+    geo->ns_count = hdr->ns_count - 1;
+    geo->namespaces = saved;
+    for (uint32_t i = 0; i < geo->ns_count; i++) {
+        saved[i].prefix = src[i + 1].prefix;
+        saved[i].pool_size = src[i + 1].pool_size;
+        saved[i].shard_count = src[i + 1].shard_count;
+        saved[i].evict = src[i + 1].evict;
+        saved[i].max_entries = src[i + 1].max_entries;
+    }
+
+    CLS_CHECK(cls_ns_layout(geo, ns, ns_count, shards));
+    for (uint32_t i = 0; i < *ns_count; i++) {
+        if (ns[i].pool_off != src[i].pool_off || ns[i].shard_first != src[i].shard_first ||
+            ns[i].shard_count != src[i].shard_count)
+            return CLS_ERR_INVALID;
+    }
+    return *shards == hdr->shard_count ? CLS_OK : CLS_ERR_INVALID;
+}
+
+/* Shared by prune and its per-namespace form (shard lock not held) */
+static uint32_t cls_shard_prune(cls_memory_ctx_t *ctx, cls_mem_shard_t *sh, uint64_t now) {
+    cls_mem_store_t *store = cls_get_store(ctx);
+    cls_mem_expire_ctx_t ec = { ctx, sh };
+
+    /* Only wheel slots whose ticks have passed are visited; tombstones
+     * left behind are reclaimed by the next rehash */
+    cls_shard_lock(store, sh);
+    uint32_t pruned = cls_wheel_advance(cls_shard_wheel(sh), sh->arena, now,
+                                        cls_expire_entry, &ec);
+    if (store->cold_after_us > 0) cls_shard_cool(store, sh, now);
+    cls_shard_reclaim(store, sh);
+    cls_shard_sync_used(ctx, sh);
+    cls_shard_unlock(store, sh);
+    return pruned;
 }
 
 /* ============================================================
@@ -66,23 +1974,243 @@ static bool cls_entry_expired(const cls_mem_entry_t *entry) {
  * ============================================================ */
 
 cls_status_t cls_memory_init(cls_memory_ctx_t *ctx, size_t pool_size) {
-    if (!ctx || pool_size < sizeof(cls_mem_table_t))
-        return CLS_ERR_INVALID;
+    cls_memory_config_t cfg = CLS_MEMORY_CONFIG_DEFAULT;
+    cfg.pool_size = pool_size;
+    return cls_memory_init_ex(ctx, &cfg);
+}
+
+/* Build a store from cfg; image, when given, is an already mapped
+ * snapshot whose mapping the store takes over */
+static cls_status_t cls_store_open(cls_memory_ctx_t *ctx, const cls_memory_config_t *cfg,
+                                   const cls_mem_snap_t *image) {
+    cls_memory_config_t geo = *cfg;
+    geo.concurrent = cfg->concurrent || cfg->shm_name;
+    cls_mem_ns_config_t saved_ns[CLS_MEMORY_NS_MAX];
+    cls_mem_snap_t snap;
+    memset(&snap, 0, sizeof(snap));
+    if (image) snap = *image;
+    char *snap_path = NULL, *wal_path = NULL;
+
+    if (cfg->persist_path) {
+        snap_path = cls_persist_file(cfg->persist_path, ".snap");
+        wal_path = cls_persist_file(cfg->persist_path, ".wal");
+        if (!snap_path || !wal_path) {
+            free(snap_path);
+            free(wal_path);
+            return CLS_ERR_NOMEM;
+        }
+        cls_snap_map(snap_path, &snap);
+    }
 
-    cls_mem_table_t *table = (cls_mem_table_t *)calloc(1, sizeof(cls_mem_table_t));
-    if (!table) return CLS_ERR_NOMEM;
+    /* A saved snapshot brings its own geometry and policy */
+    if (snap.map) {
+        geo.pool_size = (size_t)snap.hdr.pool_size;
+        geo.shard_count = snap.hdr.shard_count;
+        geo.evict = (cls_mem_evict_t)snap.hdr.evict;
+        geo.max_entries = snap.hdr.max_entries;
+        geo.ns_count = CLS_MIN(snap.hdr.ns_count, (uint32_t)CLS_MEMORY_NS_MAX);
+        geo.namespaces = saved_ns;
+        for (uint32_t i = 0; i < geo.ns_count; i++) {
+            cls_mem_snap_ns_t *sn = &snap.hdr.ns[i];
+            sn->prefix[CLS_MEMORY_NS_PREFIX_MAX - 1] = '\0';
+            saved_ns[i].prefix = sn->prefix;
+            saved_ns[i].pool_size = (size_t)sn->pool_size;
+            saved_ns[i].shard_count = sn->shard_count;
+            saved_ns[i].evict = (cls_mem_evict_t)sn->evict;
+            saved_ns[i].max_entries = sn->max_entries;
+        }
+    }
+    bool loaded = snap.map != NULL;
+
+    cls_mem_ns_t ns[CLS_MEM_NS_SLOTS];
+    uint32_t ns_count = 0, shards = 0;
+    cls_status_t status = cls_ns_layout(&geo, ns, &ns_count, &shards);
+
+    /* The first process creates the segment with this layout; later ones
+     * take the layout it was created with */
+    cls_mem_shm_t *shm = NULL;
+    bool created = false;
+    if (CLS_IS_OK(status) && cfg->shm_name) {
+        shm = (cls_mem_shm_t *)malloc(sizeof(cls_mem_shm_t));
+        status = shm ? cls_shm_open(cfg->shm_name, geo.pool_size, shm, &created) :
+                       CLS_ERR_NOMEM;
+        if (CLS_IS_ERR(status)) {
+            free(shm);
+            shm = NULL;
+        } else if (!created) {
+            status = cls_ns_adopt(shm->hdr, &geo, saved_ns, ns, &ns_count, &shards);
+        }
+    }
+    bool adopted = loaded || (shm && !created);
+
+    /* One reservation up front; every later allocation is carved from it.
+     * A snapshot's pool is used where it is mapped, a segment's likewise. */
+    void *pool = NULL;
+    cls_mem_store_t *store = NULL;
+    cls_mem_shard_t *shard_arr = NULL;
+    if (CLS_IS_OK(status)) {
+        pool = shm ? (void *)shm->pool : loaded ? (void *)snap.pool : malloc(geo.pool_size);
+        store = (cls_mem_store_t *)calloc(1, sizeof(cls_mem_store_t));
+        shard_arr = (cls_mem_shard_t *)calloc(shards, sizeof(cls_mem_shard_t));
+        if (!pool || !store || !shard_arr) status = CLS_ERR_NOMEM;
+    }
+    if (CLS_IS_ERR(status)) {
+        free(shard_arr);
+        free(store);
+        cls_pool_free(pool, snap.map, snap.map_len, shm);
+        free(snap_path);
+        free(wal_path);
+        return status;
+    }
 
-    ctx->pool = table;
-    ctx->pool_size = pool_size;
-    ctx->used = sizeof(cls_mem_table_t);
+    store->ctx = ctx;
+    store->shards = shard_arr;
+    store->shard_count = shards;
+    store->concurrent = geo.concurrent;
+    store->shm = shm;
+    store->ns = shm ? shm->hdr->ns : store->ns_own;
+    store->ep = shm ? &shm->hdr->epoch : &store->ep_own;
+    if (!shm || created) memcpy(store->ns, ns, sizeof(ns));
+    if (created) {
+        shm->hdr->shard_count = shards;
+        shm->hdr->ns_count = ns_count;
+    }
+    store->ns_count = ns_count;
+    store->inline_max = cfg->inline_max ? CLS_MIN(cfg->inline_max, (size_t)CLS_MEM_INLINE_CAP) :
+                                          CLS_MEMORY_INLINE_MAX;
+    store->cold_after_us = (uint64_t)cfg->cold_after_ms * 1000;
+    store->cold_min_bytes = cfg->cold_min_bytes ? cfg->cold_min_bytes : CLS_MEM_COLD_MIN_BYTES;
+    store->snap_path = snap_path;
+    store->snap_map = snap.map;
+    store->snap_len = snap.map_len;
+    store->gen = snap.hdr.gen;
+    store->view_seq = snap.hdr.view_seq ? snap.hdr.view_seq : 1;
+    store->checkpoint_bytes = cfg->checkpoint_bytes ? cfg->checkpoint_bytes :
+                              CLS_MEM_CHECKPOINT_BYTES;
+
+    /* Pick the store clock up where the saved state left it */
+    uint64_t wal_gen, anchor_store, anchor_real;
+    if (loaded)
+        store->time_offset = cls_clock_resume(snap.hdr.store_time_us, snap.hdr.real_time_us);
+    else if (wal_path && CLS_IS_OK(cls_wal_peek(wal_path, &wal_gen, &anchor_store, &anchor_real)) &&
+             wal_gen == 0)
+        store->time_offset = cls_clock_resume(anchor_store, anchor_real);
+
+    ctx->pool = pool;
+    ctx->pool_size = geo.pool_size;
+    ctx->used = 0;
     ctx->entry_count = 0;
-    ctx->max_entries = (uint32_t)(pool_size / (sizeof(cls_mem_entry_t) + 64));
+    uint64_t max_entries = 0;
+    for (uint32_t n = 0; n < ns_count; n++) max_entries += ns[n].max_entries;
+    ctx->max_entries = (uint32_t)CLS_MIN(max_entries, (uint64_t)UINT32_MAX);
     ctx->hit_count = 0;
     ctx->miss_count = 0;
+    ctx->store = store;
+    ctx->shard_count = shards;
+
+    status = cls_epoch_init(store);
+    if (CLS_IS_OK(status)) {
+        status = cls_intern_init(&store->intern, store->concurrent);
+        if (CLS_IS_ERR(status)) cls_epoch_destroy(store);
+    }
+    if (CLS_IS_ERR(status)) {
+        free(shard_arr);
+        free(store);
+        cls_pool_free(pool, snap.map, snap.map_len, shm);
+        free(snap_path);
+        free(wal_path);
+        ctx->pool = NULL;
+        ctx->store = NULL;
+        return status;
+    }
+
+    for (uint32_t n = 0; n < ns_count; n++) {
+        size_t span = cls_ns_span(&ns[n]);
+        for (uint32_t i = 0; i < ns[n].shard_count; i++)
+            shard_arr[ns[n].shard_first + i].ns = n;
+        if (!adopted)
+            memset((uint8_t *)pool + ns[n].pool_off + ns[n].shard_count * span, 0,
+                   ns[n].pool_size - ns[n].shard_count * span);
+    }
+
+    for (uint32_t i = 0; i < shards && CLS_IS_OK(status); i++) {
+        const cls_mem_ns_t *owner = &ns[shard_arr[i].ns];
+        size_t span = cls_ns_span(owner);
+        void *base = (uint8_t *)pool + owner->pool_off + (i - owner->shard_first) * span;
+        shard_arr[i].mutex = shm ? &shm->hdr->shard_locks[i] : &shard_arr[i].lock;
+        status = adopted ? cls_shard_attach(store, &shard_arr[i], base, span) :
+                          cls_shard_format(store, &shard_arr[i], base, span);
+        if (CLS_IS_ERR(status)) {
+            cls_store_free(store, i);
+            cls_pool_free(pool, snap.map, snap.map_len, shm);
+            free(wal_path);
+            ctx->pool = NULL;
+            ctx->store = NULL;
+            return status;
+        }
+    }
+
+    if (loaded)
+        cls_fixups_apply(store, snap.fixups, snap.hdr.fixup_count);
+    for (uint32_t i = 0; i < shards; i++) {
+        cls_mem_shard_t *sh = &shard_arr[i];
+        cls_mem_table_t *table = cls_shard_table(sh);
+        uint32_t live = table->cur.count + (table->migrating ? table->old.count : 0);
+        sh->used_reported = sh->arena->used;
+        ctx->used += sh->used_reported;
+        ctx->entry_count += live;
+        if (!shm) store->ns[sh->ns].entry_count += live;
+    }
+
+    /* Replay runs before the log is attached, so nothing is logged twice */
+    if (wal_path) {
+        cls_mem_wal_t *wal = (cls_mem_wal_t *)malloc(sizeof(cls_mem_wal_t));
+        status = wal ? cls_wal_open(wal, wal_path, store->gen, cls_store_now(store),
+                                    cfg->wal_sync, cls_replay_record, ctx) : CLS_ERR_NOMEM;
+        free(wal_path);
+        if (CLS_IS_ERR(status)) {
+            free(wal);
+            cls_store_free(store, shards);
+            cls_pool_free(pool, snap.map, snap.map_len, shm);
+            ctx->pool = NULL;
+            ctx->store = NULL;
+            return status;
+        }
+        store->wal = wal;
+    }
+
+    /* Tracking starts after replay so restored writes do not count */
+    if (cfg->hot_sample) {
+        store->hot = cls_hot_create(cfg->hot_sample, store->concurrent);
+        if (!store->hot) {
+            cls_store_free(store, shards);
+            cls_pool_free(pool, snap.map, snap.map_len, shm);
+            ctx->pool = NULL;
+            ctx->store = NULL;
+            return CLS_ERR_NOMEM;
+        }
+    }
 
+    if (created) cls_shm_publish(shm);
     return CLS_OK;
 }
 
+cls_status_t cls_memory_init_ex(cls_memory_ctx_t *ctx, const cls_memory_config_t *cfg) {
+    if (!ctx || !cfg || cfg->pool_size < CLS_MEMORY_MIN_POOL) return CLS_ERR_INVALID;
+    if (cfg->shm_name && cfg->persist_path) return CLS_ERR_INVALID;
+    return cls_store_open(ctx, cfg, NULL);
+}
+
+cls_status_t cls_memory_init_image(cls_memory_ctx_t *ctx, const cls_memory_config_t *cfg,
+                                   int fd, uint64_t offset, uint64_t len) {
+    if (!ctx || !cfg || fd < 0) return CLS_ERR_INVALID;
+    if (cfg->shm_name || cfg->persist_path) return CLS_ERR_INVALID;
+
+    cls_mem_snap_t snap;
+    CLS_CHECK(cls_snap_map_fd(fd, offset, len, &snap));
+    return cls_store_open(ctx, cfg, &snap);
+}
+
 cls_status_t cls_memory_store(cls_memory_ctx_t *ctx, const char *key,
                                const void *data, size_t len) {
     return cls_memory_store_ttl(ctx, key, data, len, 0);
@@ -90,263 +2218,845 @@ cls_status_t cls_memory_store(cls_memory_ctx_t *ctx, const char *key,
 
 cls_status_t cls_memory_store_ttl(cls_memory_ctx_t *ctx, const char *key,
                                    const void *data, size_t len, uint32_t ttl_sec) {
-    if (!ctx || !key || !data || len == 0)
+    if (!ctx || !ctx->store || !key || !data || len == 0)
         return CLS_ERR_INVALID;
 
-    if (strlen(key) >= CLS_MEM_KEY_MAX)
-        return CLS_ERR_OVERFLOW;
-
-    /* Prevent absurdly large allocations */
-    if (len > ctx->capacity / 2)
-        return CLS_ERR_OVERFLOW;
+    size_t key_len;
+    uint32_t hash = cls_hash(key, &key_len);
+    return cls_store_put(ctx, key, key_len, hash, data, len, ttl_sec, 0);
+}
 
-    cls_mem_table_t *table = cls_get_table(ctx);
-    uint32_t hash = cls_hash(key);
-    uint32_t idx = cls_bucket_idx(hash);
+cls_status_t cls_memory_store_key(cls_memory_ctx_t *ctx, const cls_mem_key_t *key,
+                                   const void *data, size_t len, uint32_t ttl_sec) {
+    if (!ctx || !ctx->store || !key || !key->str || !data || len == 0)
+        return CLS_ERR_INVALID;
+    return cls_store_put(ctx, key->str, key->len, key->hash, data, len, ttl_sec, 0);
+}
 
-    /* Check if key already exists — update in place */
-    cls_mem_entry_t *entry = table->buckets[idx];
-    while (entry) {
-        if (strcmp(entry->key, key) == 0) {
-            size_t old_len = entry->meta.data_len;
-            void *new_data = realloc(entry->data, len);
-            if (!new_data) return CLS_ERR_NOMEM;
+static cls_status_t cls_retrieve_hashed(cls_memory_ctx_t *ctx, const char *key,
+                                        size_t key_len, uint32_t hash,
+                                        void *buf, size_t *len) {
+    cls_mem_store_t *store = cls_get_store(ctx);
+    cls_mem_shard_t *sh = cls_shard_of(store, key, key_len, hash);
+    cls_status_t status = CLS_OK;
+
+    cls_mem_reader_t *reader = cls_read_begin(store, sh);
+    cls_mem_entry_t *entry = cls_shard_lookup(store, sh, key, key_len, hash);
+    uint64_t now = cls_store_now(store);
+
+    if (!entry || cls_entry_expired(entry, now)) {
+        cls_count_access(ctx, reader, sh, key, key_len, hash, false);
+        status = CLS_ERR_NOT_FOUND;
+    } else if (*len < entry->meta.data_len) {
+        *len = entry->meta.data_len;
+        status = CLS_ERR_OVERFLOW;
+    } else {
+        status = cls_entry_copy(sh, entry, buf);
+        *len = entry->meta.data_len;
+        cls_entry_touch(entry, now);
+        cls_count_access(ctx, reader, sh, key, key_len, hash, true);
+    }
 
-            memcpy(new_data, data, len);
-            entry->data = new_data;
-            entry->meta.data_len = len;
-            entry->meta.accessed_at = cls_time_us();
-            entry->meta.access_count++;
-            entry->meta.ttl_seconds = ttl_sec;
+    cls_read_end(store, sh, reader);
+    return status;
+}
 
-            /* Fix: update used-size tracking on resize */
-            ctx->used = ctx->used - old_len + len;
-            return CLS_OK;
-        }
-        entry = entry->next;
-    }
+cls_status_t cls_memory_retrieve(cls_memory_ctx_t *ctx, const char *key,
+                                  void *buf, size_t *len) {
+    if (!ctx || !ctx->store || !key || !buf || !len)
+        return CLS_ERR_INVALID;
 
-    /* New entry */
-    if (ctx->entry_count >= ctx->max_entries)
-        return CLS_ERR_OVERFLOW;
+    size_t key_len;
+    uint32_t hash = cls_hash(key, &key_len);
+    return cls_retrieve_hashed(ctx, key, key_len, hash, buf, len);
+}
 
-    entry = (cls_mem_entry_t *)calloc(1, sizeof(cls_mem_entry_t));
-    if (!entry) return CLS_ERR_NOMEM;
+cls_status_t cls_memory_retrieve_key(cls_memory_ctx_t *ctx, const cls_mem_key_t *key,
+                                      void *buf, size_t *len) {
+    if (!ctx || !ctx->store || !key || !key->str || !buf || !len)
+        return CLS_ERR_INVALID;
+    return cls_retrieve_hashed(ctx, key->str, key->len, key->hash, buf, len);
+}
 
-    entry->data = malloc(len);
-    if (!entry->data) {
-        free(entry);
-        return CLS_ERR_NOMEM;
-    }
+cls_status_t cls_memory_key_intern(cls_memory_ctx_t *ctx, const char *key,
+                                    cls_mem_key_t *out) {
+    if (!ctx || !ctx->store || !key || !out)
+        return CLS_ERR_INVALID;
 
-    strncpy(entry->key, key, CLS_MEM_KEY_MAX - 1);
-    memcpy(entry->data, data, len);
-    entry->meta.hash = hash;
-    entry->meta.created_at = cls_time_us();
-    entry->meta.accessed_at = entry->meta.created_at;
-    entry->meta.access_count = 1;
-    entry->meta.ttl_seconds = ttl_sec;
-    entry->meta.data_len = len;
+    size_t key_len;
+    uint32_t hash = cls_hash(key, &key_len);
+    if (key_len >= CLS_MEM_KEY_MAX) return CLS_ERR_OVERFLOW;
+    return cls_intern_get(&cls_get_store(ctx)->intern, key, key_len, hash, out);
+}
 
-    /* Insert at head of bucket chain */
-    entry->next = table->buckets[idx];
-    table->buckets[idx] = entry;
+cls_status_t cls_memory_store_batch(cls_memory_ctx_t *ctx, cls_mem_batch_item_t *items,
+                                     uint32_t count) {
+    if (!ctx || !ctx->store || (!items && count > 0))
+        return CLS_ERR_INVALID;
 
-    ctx->entry_count++;
-    ctx->used += sizeof(cls_mem_entry_t) + len;
+    cls_mem_store_t *store = cls_get_store(ctx);
+    cls_mem_batch_key_t keys[CLS_MEM_BATCH_CHUNK];
+    uint32_t order[CLS_MEM_BATCH_CHUNK];
+    uint64_t now = cls_store_now(store);
+    uint64_t lsn = 0;
+
+    for (uint32_t base = 0; base < count; base += CLS_MEM_BATCH_CHUNK) {
+        cls_mem_batch_item_t *chunk = items + base;
+        uint32_t n = CLS_MIN(count - base, (uint32_t)CLS_MEM_BATCH_CHUNK);
+        cls_batch_hash(store, chunk, n, keys);
+        cls_batch_order(keys, n, order);
+
+        /* One lock per run of keys in the same shard */
+        for (uint32_t r = 0; r < n; ) {
+            uint32_t shard = keys[order[r]].shard;
+            uint32_t end = r;
+            while (end < n && keys[order[end]].shard == shard) end++;
+
+            cls_mem_shard_t *sh = shard != UINT32_MAX ? &store->shards[shard] : NULL;
+            if (sh) cls_shard_lock(store, sh);
+            for (; r < end; r++) {
+                cls_mem_batch_item_t *item = &chunk[order[r]];
+                if (!sh || !item->data || item->len == 0) {
+                    item->status = CLS_ERR_INVALID;
+                    continue;
+                }
+                size_t key_len = keys[order[r]].key_len;
+                item->status = cls_store_check(store, sh, key_len, item->len);
+                if (CLS_IS_OK(item->status))
+                    item->status = cls_store_locked(ctx, sh, item->key, key_len,
+                                                    keys[order[r]].hash, item->data, item->len,
+                                                    item->ttl_sec, now, &lsn);
+            }
+            if (sh) {
+                cls_shard_sync_used(ctx, sh);
+                cls_shard_unlock(store, sh);
+            }
+        }
+    }
 
-    return CLS_OK;
+    /* The whole batch shares one log commit */
+    cls_status_t commit = lsn ? cls_wal_commit(store->wal, lsn) : CLS_OK;
+    cls_status_t status = CLS_OK;
+    for (uint32_t i = 0; i < count; i++) {
+        if (CLS_IS_OK(items[i].status)) items[i].status = commit;
+        if (CLS_IS_OK(status)) status = items[i].status;
+    }
+    return status;
 }
 
-cls_status_t cls_memory_retrieve(cls_memory_ctx_t *ctx, const char *key,
-                                  void *buf, size_t *len) {
-    if (!ctx || !key || !buf || !len)
+cls_status_t cls_memory_retrieve_batch(cls_memory_ctx_t *ctx, cls_mem_batch_item_t *items,
+                                        uint32_t count) {
+    if (!ctx || !ctx->store || (!items && count > 0))
         return CLS_ERR_INVALID;
 
-    cls_mem_table_t *table = cls_get_table(ctx);
-    uint32_t idx = cls_bucket_idx(cls_hash(key));
+    cls_mem_store_t *store = cls_get_store(ctx);
+    cls_status_t status = CLS_OK;
+
+    /* Without a reader slot every key takes the locked single-key path */
+    cls_mem_reader_t *reader = cls_epoch_enter(store);
+    if (!reader && store->concurrent) {
+        for (uint32_t i = 0; i < count; i++) {
+            items[i].status = items[i].data ?
+                cls_memory_retrieve(ctx, items[i].key, items[i].data, &items[i].len) :
+                CLS_ERR_INVALID;
+            if (CLS_IS_OK(status)) status = items[i].status;
+        }
+        return status;
+    }
 
-    cls_mem_entry_t *entry = table->buckets[idx];
-    while (entry) {
-        if (strcmp(entry->key, key) == 0) {
-            if (cls_entry_expired(entry)) {
-                ctx->miss_count++;
-                return CLS_ERR_NOT_FOUND;
+    cls_mem_batch_key_t keys[CLS_MEM_BATCH_CHUNK];
+    cls_mem_entry_t *found[CLS_MEM_BATCH_CHUNK];
+    uint64_t now = cls_store_now(store);
+
+    for (uint32_t base = 0; base < count; base += CLS_MEM_BATCH_CHUNK) {
+        cls_mem_batch_item_t *chunk = items + base;
+        uint32_t n = CLS_MIN(count - base, (uint32_t)CLS_MEM_BATCH_CHUNK);
+        cls_batch_hash(store, chunk, n, keys);
+
+        /* Resolve every key first so the value copies overlap their misses */
+        for (uint32_t i = 0; i < n; i++) {
+            cls_mem_batch_item_t *item = &chunk[i];
+            found[i] = NULL;
+            if (keys[i].shard == UINT32_MAX || !item->data) {
+                item->status = CLS_ERR_INVALID;
+                continue;
             }
 
-            if (*len < entry->meta.data_len) {
-                *len = entry->meta.data_len;
-                return CLS_ERR_OVERFLOW;
+            cls_mem_shard_t *sh = &store->shards[keys[i].shard];
+            cls_mem_entry_t *entry = cls_shard_lookup(store, sh, item->key, keys[i].key_len,
+                                                      keys[i].hash);
+            if (!entry || cls_entry_expired(entry, now)) {
+                cls_count_access(ctx, reader, sh, item->key, keys[i].key_len,
+                                 keys[i].hash, false);
+                item->status = CLS_ERR_NOT_FOUND;
+            } else if (item->len < entry->meta.data_len) {
+                item->len = entry->meta.data_len;
+                item->status = CLS_ERR_OVERFLOW;
+            } else {
+                found[i] = entry;
+                __builtin_prefetch(cls_entry_data(sh, entry));
             }
+        }
 
-            memcpy(buf, entry->data, entry->meta.data_len);
-            *len = entry->meta.data_len;
-            entry->meta.accessed_at = cls_time_us();
-            entry->meta.access_count++;
-            ctx->hit_count++;
-            return CLS_OK;
+        for (uint32_t i = 0; i < n; i++) {
+            cls_mem_entry_t *entry = found[i];
+            if (!entry) continue;
+
+            cls_mem_shard_t *sh = &store->shards[keys[i].shard];
+            chunk[i].status = cls_entry_copy(sh, entry, chunk[i].data);
+            chunk[i].len = entry->meta.data_len;
+            cls_entry_touch(entry, now);
+            cls_count_access(ctx, reader, sh, chunk[i].key, keys[i].key_len,
+                             keys[i].hash, true);
         }
-        entry = entry->next;
     }
 
-    ctx->miss_count++;
-    return CLS_ERR_NOT_FOUND;
+    if (reader) cls_epoch_leave(reader);
+    for (uint32_t i = 0; i < count && CLS_IS_OK(status); i++)
+        status = items[i].status;
+    return status;
 }
 
-bool cls_memory_exists(cls_memory_ctx_t *ctx, const char *key) {
-    if (!ctx || !key) return false;
+cls_status_t cls_memory_borrow(cls_memory_ctx_t *ctx, const char *key,
+                                cls_mem_borrow_t *out) {
+    if (!ctx || !ctx->store || !key || !out)
+        return CLS_ERR_INVALID;
 
-    cls_mem_table_t *table = cls_get_table(ctx);
-    uint32_t idx = cls_bucket_idx(cls_hash(key));
+    memset(out, 0, sizeof(*out));
+    cls_mem_store_t *store = cls_get_store(ctx);
+    size_t key_len;
+    uint32_t hash = cls_hash(key, &key_len);
+    cls_mem_shard_t *sh = cls_shard_of(store, key, key_len, hash);
+    cls_status_t status = CLS_OK;
+
+    cls_mem_reader_t *reader = cls_read_begin(store, sh);
+    cls_mem_entry_t *entry = cls_shard_lookup(store, sh, key, key_len, hash);
+    uint64_t now = cls_store_now(store);
+
+    /* A cold value is expanded under the lock before it can be pinned */
+    if (entry && !cls_entry_expired(entry, now) && cls_entry_compressed(entry)) {
+        if (reader) cls_shard_lock(store, sh);
+        entry = cls_table_lookup(sh, key, key_len, cls_hash_mix(hash));
+        if (entry && cls_entry_compressed(entry)) {
+            entry = cls_entry_thaw(store, sh, entry);
+            if (!entry) status = CLS_ERR_NOMEM;
+            cls_shard_sync_used(ctx, sh);
+        }
+        if (reader) cls_shard_unlock(store, sh);
+    }
 
-    cls_mem_entry_t *entry = table->buckets[idx];
-    while (entry) {
-        if (strcmp(entry->key, key) == 0 && !cls_entry_expired(entry))
-            return true;
-        entry = entry->next;
+    if (CLS_IS_ERR(status)) {
+        /* Arena too full to expand the value */
+    } else if (!entry || cls_entry_expired(entry, now)) {
+        cls_count_access(ctx, reader, sh, key, key_len, hash, false);
+        status = CLS_ERR_NOT_FOUND;
+    } else {
+        /* Pinned inside the read guard, so reclaim cannot have passed it */
+        CLS_ADD_RLX(&entry->pins, 1);
+        out->data = cls_entry_data(sh, entry);
+        out->len = entry->meta.data_len;
+        out->shard = (uint32_t)(sh - store->shards);
+        out->ref = cls_arena_ref(sh->arena, entry);
+        cls_entry_touch(entry, now);
+        cls_count_access(ctx, reader, sh, key, key_len, hash, true);
     }
-    return false;
+
+    cls_read_end(store, sh, reader);
+    return status;
 }
 
-cls_status_t cls_memory_delete(cls_memory_ctx_t *ctx, const char *key) {
-    if (!ctx || !key) return CLS_ERR_INVALID;
+void cls_memory_release(cls_memory_ctx_t *ctx, cls_mem_borrow_t *borrow) {
+    if (!ctx || !ctx->store || !borrow || !borrow->ref) return;
+
+    cls_mem_store_t *store = cls_get_store(ctx);
+    if (borrow->shard >= store->shard_count) return;
 
-    cls_mem_table_t *table = cls_get_table(ctx);
-    uint32_t idx = cls_bucket_idx(cls_hash(key));
+    /* Reads of the value must complete before the unpin is seen */
+    cls_mem_entry_t *entry = cls_entry_at(&store->shards[borrow->shard], borrow->ref);
+    __atomic_fetch_sub(&entry->pins, 1, __ATOMIC_RELEASE);
+    memset(borrow, 0, sizeof(*borrow));
+}
+
+bool cls_memory_exists(cls_memory_ctx_t *ctx, const char *key) {
+    if (!ctx || !ctx->store || !key) return false;
+
+    cls_mem_store_t *store = cls_get_store(ctx);
+    size_t key_len;
+    uint32_t hash = cls_hash(key, &key_len);
+    cls_mem_shard_t *sh = cls_shard_of(store, key, key_len, hash);
+
+    cls_mem_reader_t *reader = cls_read_begin(store, sh);
+    cls_mem_entry_t *entry = cls_table_lookup(sh, key, key_len, cls_hash_mix(hash));
+    bool found = entry && !cls_entry_expired(entry, cls_store_now(store));
+    cls_read_end(store, sh, reader);
+
+    return found;
+}
+
+cls_status_t cls_memory_delete(cls_memory_ctx_t *ctx, const char *key) {
+    if (!ctx || !ctx->store || !key) return CLS_ERR_INVALID;
+
+    cls_mem_store_t *store = cls_get_store(ctx);
+    size_t key_len;
+    uint32_t hash = cls_hash(key, &key_len);
+    cls_mem_shard_t *sh = cls_shard_of(store, key, key_len, hash);
+    cls_status_t status = CLS_OK;
+    uint64_t lsn = 0;
+
+    cls_shard_lock(store, sh);
+
+    cls_mem_table_t *table = cls_shard_table(sh);
+    cls_mem_tview_t v;
+    uint32_t i;
+
+    if (cls_table_find(sh, table, key, key_len, cls_hash_mix(hash), &v, &i)) {
+        lsn = cls_log_delete(store, cls_entry_at(sh, v.slots[i].entry));
+        cls_table_remove(ctx, sh, &v, i);
+        cls_table_migrate(store, sh, table, CLS_MEM_MIGRATE_STEP);
+    } else {
+        status = CLS_ERR_NOT_FOUND;
+    }
 
-    cls_mem_entry_t *prev = NULL;
-    cls_mem_entry_t *entry = table->buckets[idx];
+    cls_shard_sync_used(ctx, sh);
+    cls_shard_unlock(store, sh);
 
-    while (entry) {
-        if (strcmp(entry->key, key) == 0) {
-            if (prev)
-                prev->next = entry->next;
-            else
-                table->buckets[idx] = entry->next;
+    if (lsn) status = cls_wal_commit(store->wal, lsn);
+    return status;
+}
 
-            ctx->used -= sizeof(cls_mem_entry_t) + entry->meta.data_len;
-            ctx->entry_count--;
-            free(entry->data);
-            free(entry);
-            return CLS_OK;
+/* Query the shards of every namespace in `only` that the key prefix can
+ * reach */
+static cls_status_t cls_query_run(cls_memory_ctx_t *ctx, const cls_query_t *query,
+                                  cls_result_set_t *results, uint32_t only) {
+    results->count = 0;
+    cls_mem_store_t *store = cls_get_store(ctx);
+    char prefix[CLS_MEM_KEY_MAX];
+
+    cls_mem_query_ctx_t qc;
+    memset(&qc, 0, sizeof(qc));
+    if (!cls_pattern_parse(query->key_pattern, prefix, &qc.filter.prefix_len, &qc.filter.exact))
+        return CLS_OK;
+    qc.filter.prefix = prefix;
+    qc.filter.created_after = query->created_after;
+    qc.filter.created_before = query->created_before;
+    qc.filter.now = cls_store_now(store);
+    qc.results = results;
+    qc.store = store;
+    qc.max = query->max_results > 0 ? query->max_results : 64;
+    if (qc.max > 64) qc.max = 64;
+
+    /* A shard walks its key index from the prefix until the results are
+     * full or the prefix ends. With a time window that walk may visit no
+     * more entries than the window holds in the time log; past that it is
+     * abandoned for the log's slice, so a query costs at most twice the
+     * cheaper scan. Either way the results keep the smallest `max`
+     * matching keys. */
+    bool windowed = !qc.filter.exact &&
+                    (query->created_after > 0 || query->created_before > 0);
+    uint32_t mask = only & cls_ns_mask(store, prefix, qc.filter.prefix_len, qc.filter.exact);
+
+    for (uint32_t s = 0; s < store->shard_count; s++) {
+        cls_mem_shard_t *sh = &store->shards[s];
+        if (!(mask & (1u << sh->ns))) continue;
+        qc.shard = sh;
+
+        cls_shard_lock(store, sh);
+        qc.key_order = true;
+        qc.over = false;
+        qc.budget = windowed ? cls_tlog_count(cls_shard_tlog(sh), sh->arena,
+                                              query->created_after, query->created_before)
+                             : UINT32_MAX;
+        cls_index_scan(sh->arena, *cls_shard_index(sh), qc.filter.prefix, true,
+                       cls_query_visit, &qc);
+        if (qc.over) {
+            qc.key_order = false;
+            cls_tlog_scan(cls_shard_tlog(sh), sh->arena, query->created_after,
+                          query->created_before, cls_query_visit, &qc);
         }
-        prev = entry;
-        entry = entry->next;
+        cls_shard_sync_used(ctx, sh);
+        cls_shard_unlock(store, sh);
     }
 
-    return CLS_ERR_NOT_FOUND;
+    return CLS_OK;
 }
 
 cls_status_t cls_memory_query(cls_memory_ctx_t *ctx, const cls_query_t *query,
                                cls_result_set_t *results) {
-    if (!ctx || !query || !results)
+    if (!ctx || !ctx->store || !query || !results)
+        return CLS_ERR_INVALID;
+    return cls_query_run(ctx, query, results, UINT32_MAX);
+}
+
+cls_status_t cls_memory_ns_query(cls_memory_ctx_t *ctx, uint32_t ns,
+                                  const cls_query_t *query, cls_result_set_t *results) {
+    if (!ctx || !ctx->store || !query || !results)
         return CLS_ERR_INVALID;
+    if (ns >= cls_get_store(ctx)->ns_count) return CLS_ERR_NOT_FOUND;
+    return cls_query_run(ctx, query, results, 1u << ns);
+}
+
+void cls_memory_query_release(cls_memory_ctx_t *ctx, cls_result_set_t *results) {
+    if (!ctx || !ctx->store || !results) return;
 
+    cls_mem_store_t *store = cls_get_store(ctx);
+    for (uint32_t i = 0; i < results->count; i++) {
+        if (results->entries[i].ref && results->entries[i].shard < store->shard_count)
+            cls_cursor_unpin(store, results->entries[i].shard, results->entries[i].ref);
+    }
     results->count = 0;
-    cls_mem_table_t *table = cls_get_table(ctx);
-    uint32_t max = query->max_results > 0 ? query->max_results : 64;
-    if (max > 64) max = 64;
-
-    for (uint32_t i = 0; i < CLS_MEM_BUCKET_COUNT && results->count < max; i++) {
-        cls_mem_entry_t *entry = table->buckets[i];
-        while (entry && results->count < max) {
-            if (cls_entry_expired(entry)) {
-                entry = entry->next;
-                continue;
-            }
+}
 
-            /* Simple wildcard: NULL or "*" matches everything */
-            bool match = (!query->key_pattern || strcmp(query->key_pattern, "*") == 0);
+cls_status_t cls_memory_query_open(cls_memory_ctx_t *ctx, const cls_query_t *query,
+                                    const char *token, cls_mem_cursor_t *cursor) {
+    if (!ctx || !ctx->store || !query || !cursor)
+        return CLS_ERR_INVALID;
+    if (token && strlen(token) >= CLS_MEM_KEY_MAX)
+        return CLS_ERR_OVERFLOW;
 
-            /* Prefix match if pattern ends with '*' */
-            if (!match && query->key_pattern) {
-                size_t plen = strlen(query->key_pattern);
-                if (plen > 0 && query->key_pattern[plen - 1] == '*') {
-                    match = (strncmp(entry->key, query->key_pattern, plen - 1) == 0);
-                } else {
-                    match = (strcmp(entry->key, query->key_pattern) == 0);
-                }
-            }
+    memset(cursor, 0, offsetof(cls_mem_cursor_t, entries));
+    cursor->ctx = ctx;
+    cursor->created_after = query->created_after;
+    cursor->created_before = query->created_before;
+    cursor->batch_size = query->max_results > 0 ? query->max_results : CLS_MEMORY_BATCH_MAX;
+    if (cursor->batch_size > CLS_MEMORY_BATCH_MAX) cursor->batch_size = CLS_MEMORY_BATCH_MAX;
+
+    size_t plen;
+    if (!cls_pattern_parse(query->key_pattern, cursor->prefix, &plen, &cursor->exact)) {
+        cursor->done = true;
+        return CLS_OK;
+    }
+    cursor->prefix_len = (uint32_t)plen;
 
-            /* Time filters */
-            if (match && query->created_after > 0)
-                match = (entry->meta.created_at >= query->created_after);
-            if (match && query->created_before > 0)
-                match = (entry->meta.created_at <= query->created_before);
-
-            if (match) {
-                uint32_t ri = results->count;
-                results->entries[ri].key = entry->key;
-                results->entries[ri].data = entry->data;
-                results->entries[ri].data_len = entry->meta.data_len;
-                results->entries[ri].meta = entry->meta;
-                results->count++;
-            }
+    /* A token from before the prefix would stop the scan at once */
+    if (token && strcmp(token, cursor->prefix) >= 0) {
+        memcpy(cursor->token, token, strlen(token) + 1);
+        cursor->started = true;
+    }
+    return CLS_OK;
+}
 
-            entry = entry->next;
-        }
+cls_status_t cls_memory_query_next(cls_mem_cursor_t *cursor) {
+    if (!cursor || !cursor->ctx || !cursor->ctx->store)
+        return CLS_ERR_INVALID;
+
+    cls_memory_query_close(cursor);
+    if (cursor->done) return CLS_ERR_NOT_FOUND;
+
+    cls_mem_store_t *store = cls_get_store(cursor->ctx);
+
+    cls_mem_cursor_ctx_t cc;
+    cc.filter.prefix = cursor->prefix;
+    cc.filter.prefix_len = cursor->prefix_len;
+    cc.filter.exact = cursor->exact;
+    cc.filter.created_after = cursor->created_after;
+    cc.filter.created_before = cursor->created_before;
+    cc.filter.now = cls_store_now(store);
+    cc.cursor = cursor;
+    cc.store = store;
+
+    /* Every shard restarts strictly after the last key handed out */
+    const char *from = cursor->started ? cursor->token : cc.filter.prefix;
+    uint32_t mask = cls_ns_mask(store, cursor->prefix, cursor->prefix_len, cursor->exact);
+    for (uint32_t s = 0; s < store->shard_count; s++) {
+        cls_mem_shard_t *sh = &store->shards[s];
+        if (!(mask & (1u << sh->ns))) continue;
+        cc.shard = s;
+
+        cls_shard_lock(store, sh);
+        cls_index_scan(sh->arena, *cls_shard_index(sh), from, !cursor->started,
+                       cls_cursor_visit, &cc);
+        cls_shard_sync_used(cursor->ctx, sh);
+        cls_shard_unlock(store, sh);
+    }
+
+    /* A short batch means every shard ran out */
+    if (cursor->count < cursor->batch_size) cursor->done = true;
+    if (cursor->count == 0) return CLS_ERR_NOT_FOUND;
+
+    const char *last = cursor->entries[cursor->count - 1].key;
+    memcpy(cursor->token, last, strlen(last) + 1);
+    cursor->started = true;
+    return CLS_OK;
+}
+
+void cls_memory_query_close(cls_mem_cursor_t *cursor) {
+    if (!cursor || !cursor->ctx || !cursor->ctx->store) return;
+    cls_cursor_unpin_all(cursor);
+}
+
+cls_status_t cls_memory_snapshot_begin(cls_memory_ctx_t *ctx, cls_mem_snapshot_t *snap) {
+    if (!ctx || !ctx->store || !snap) return CLS_ERR_INVALID;
+
+    cls_mem_store_t *store = cls_get_store(ctx);
+    if (store->shm) return CLS_ERR_STATE;
+
+    uint32_t used = CLS_LOAD_RLX(&store->views_used), slot;
+    do {
+        if (used == (1u << CLS_MEM_VIEW_MAX) - 1) return CLS_ERR_BUSY;
+        slot = (uint32_t)__builtin_ctz(~used);
+    } while (!__atomic_compare_exchange_n(&store->views_used, &used, used | (1u << slot), false,
+                                          __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+    memset(snap, 0, offsetof(cls_mem_snapshot_t, entries));
+    snap->ctx = ctx;
+    snap->slot = slot;
+
+    /* The stamp only moves with every shard locked, so each shard sees
+     * the view start between the same two writes */
+    for (uint32_t s = 0; s < store->shard_count; s++)
+        cls_shard_lock(store, &store->shards[s]);
+
+    uint32_t at = store->view_seq++;
+    snap->now = cls_store_now(store);
+    for (uint32_t s = 0; s < store->shard_count; s++) {
+        cls_mem_shard_t *sh = &store->shards[s];
+        sh->views[slot].state = CLS_VIEW_PENDING;
+        sh->views[slot].at = at;
+        sh->views_open++;
     }
 
+    for (uint32_t s = store->shard_count; s-- > 0; )
+        cls_shard_unlock(store, &store->shards[s]);
     return CLS_OK;
 }
 
+cls_status_t cls_memory_snapshot_next(cls_mem_snapshot_t *snap) {
+    if (!snap || !snap->ctx || !snap->ctx->store)
+        return CLS_ERR_INVALID;
+
+    cls_view_release(snap);
+    if (snap->done) return CLS_ERR_NOT_FOUND;
+
+    cls_mem_store_t *store = cls_get_store(snap->ctx);
+    cls_status_t status = CLS_OK;
+    cls_mem_view_ctx_t vc;
+    vc.snap = snap;
+
+    /* Each shard gives its live entries, then the ones held for the view;
+     * the lock is only held for one batch's worth */
+    while (snap->count < CLS_MEMORY_BATCH_MAX && snap->shard < store->shard_count) {
+        cls_mem_shard_t *sh = &store->shards[snap->shard];
+        cls_mem_view_shard_t *vs = &sh->views[snap->slot];
+        vc.shard = sh;
+        vc.view = vs;
+        vc.full = false;
+
+        cls_shard_lock(store, sh);
+        if (vs->lost) {
+            cls_shard_unlock(store, sh);
+            status = CLS_ERR_NOMEM;
+            break;
+        }
+
+        if (vs->state == CLS_VIEW_PENDING) vs->state = CLS_VIEW_LIVE;
+        if (vs->state == CLS_VIEW_LIVE) {
+            cls_index_scan(sh->arena, *cls_shard_index(sh), vs->started ? vs->pos : NULL,
+                           false, cls_view_visit, &vc);
+            if (!vc.full) vs->state = CLS_VIEW_HELD;
+        }
+
+        /* A held entry's hold passes to the batch pin */
+        while (vs->state == CLS_VIEW_HELD && vs->held_count > 0 &&
+               snap->count < CLS_MEMORY_BATCH_MAX) {
+            cls_mem_ref_t ref = vs->held[--vs->held_count];
+            cls_mem_entry_t *entry = cls_entry_at(sh, ref);
+            if (!cls_entry_expired(entry, snap->now)) cls_view_take(snap, sh, entry);
+            cls_view_unhold(store, sh, ref);
+        }
+
+        bool finished = vs->state == CLS_VIEW_HELD && vs->held_count == 0;
+        if (finished) cls_view_close(store, sh, vs);
+        cls_shard_sync_used(snap->ctx, sh);
+        cls_shard_unlock(store, sh);
+        if (finished) snap->shard++;
+    }
+    if (snap->shard == store->shard_count) snap->done = true;
+
+    /* Pins keep the blocks in place, so cold values expand unlocked */
+    for (uint32_t i = 0; i < snap->count && CLS_IS_OK(status); i++) {
+        const cls_mem_entry_meta_t *meta = snap->entries[i].meta;
+        if (meta->stored_len >= meta->data_len) continue;
+
+        void *buf = malloc(meta->data_len);
+        if (!buf) {
+            status = CLS_ERR_NOMEM;
+            break;
+        }
+        snap->entries[i].expanded = buf;
+        status = cls_lz_decompress((const uint8_t *)snap->entries[i].data, meta->stored_len,
+                                   (uint8_t *)buf, meta->data_len);
+        snap->entries[i].data = buf;
+    }
+
+    if (CLS_IS_ERR(status)) {
+        cls_view_release(snap);
+        return status;
+    }
+    return snap->count > 0 ? CLS_OK : CLS_ERR_NOT_FOUND;
+}
+
+void cls_memory_snapshot_end(cls_mem_snapshot_t *snap) {
+    if (!snap || !snap->ctx || !snap->ctx->store) return;
+
+    cls_mem_store_t *store = cls_get_store(snap->ctx);
+    cls_view_release(snap);
+    for (uint32_t s = snap->shard; s < store->shard_count; s++) {
+        cls_mem_shard_t *sh = &store->shards[s];
+        cls_shard_lock(store, sh);
+        cls_view_close(store, sh, &sh->views[snap->slot]);
+        cls_shard_sync_used(snap->ctx, sh);
+        cls_shard_unlock(store, sh);
+    }
+
+    __atomic_fetch_and(&store->views_used, ~(1u << snap->slot), __ATOMIC_RELEASE);
+    snap->ctx = NULL;
+    snap->done = true;
+}
+
 uint32_t cls_memory_prune(cls_memory_ctx_t *ctx) {
-    if (!ctx) return 0;
+    if (!ctx || !ctx->store) return 0;
 
+    cls_mem_store_t *store = cls_get_store(ctx);
+    uint64_t now = cls_store_now(store);
     uint32_t pruned = 0;
-    cls_mem_table_t *table = cls_get_table(ctx);
-
-    for (uint32_t i = 0; i < CLS_MEM_BUCKET_COUNT; i++) {
-        cls_mem_entry_t *prev = NULL;
-        cls_mem_entry_t *entry = table->buckets[i];
-
-        while (entry) {
-            cls_mem_entry_t *next = entry->next;
-            if (cls_entry_expired(entry)) {
-                if (prev)
-                    prev->next = next;
-                else
-                    table->buckets[i] = next;
-
-                ctx->used -= sizeof(cls_mem_entry_t) + entry->meta.data_len;
-                ctx->entry_count--;
-                free(entry->data);
-                free(entry);
-                pruned++;
-            } else {
-                prev = entry;
-            }
-            entry = next;
-        }
+
+    for (uint32_t s = 0; s < store->shard_count; s++)
+        pruned += cls_shard_prune(ctx, &store->shards[s], now);
+
+    /* Periodic maintenance doubles as the log's durability point */
+    if (store->wal) {
+        if (cls_wal_size(store->wal) >= store->checkpoint_bytes)
+            cls_memory_checkpoint(ctx);
+        else if (!store->wal->sync)
+            cls_wal_flush(store->wal);
     }
+    return pruned;
+}
+
+uint32_t cls_memory_ns_prune(cls_memory_ctx_t *ctx, uint32_t ns) {
+    if (!ctx || !ctx->store) return 0;
+
+    cls_mem_store_t *store = cls_get_store(ctx);
+    if (ns >= store->ns_count) return 0;
 
+    uint64_t now = cls_store_now(store);
+    uint32_t pruned = 0;
+    const cls_mem_ns_t *n = &store->ns[ns];
+    for (uint32_t s = n->shard_first; s < n->shard_first + n->shard_count; s++)
+        pruned += cls_shard_prune(ctx, &store->shards[s], now);
     return pruned;
 }
 
+/* Snapshot header describing the store as it stands (shards locked) */
+static void cls_snap_hdr_build(cls_memory_ctx_t *ctx, cls_mem_store_t *store, uint64_t gen,
+                               uint64_t fixup_count, cls_mem_snap_hdr_t *hdr) {
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->shard_count = store->ns[0].shard_count;
+    hdr->gen = gen;
+    hdr->pool_size = ctx->pool_size;
+    hdr->store_time_us = cls_store_now(store);
+    hdr->real_time_us = cls_real_time_us();
+    hdr->fixup_count = fixup_count;
+    hdr->evict = (uint32_t)store->ns[0].evict;
+    hdr->max_entries = store->ns[0].max_entries;
+    hdr->ns_count = store->ns_count - 1;
+    hdr->view_seq = store->view_seq;
+    for (uint32_t i = 1; i < store->ns_count; i++) {
+        const cls_mem_ns_t *ns = &store->ns[i];
+        cls_mem_snap_ns_t *sn = &hdr->ns[i - 1];
+        memcpy(sn->prefix, ns->prefix, ns->prefix_len + 1);
+        sn->pool_size = ns->pool_size;
+        sn->shard_count = ns->shard_count;
+        sn->evict = (uint32_t)ns->evict;
+        sn->max_entries = ns->max_entries;
+    }
+}
+
+cls_status_t cls_memory_checkpoint(cls_memory_ctx_t *ctx) {
+    if (!ctx || !ctx->store) return CLS_ERR_INVALID;
+
+    cls_mem_store_t *store = cls_get_store(ctx);
+    if (!store->wal) return CLS_ERR_STATE;
+
+    /* Writers are shut out for the copy; lock-free readers only touch
+     * access stats, which the image may catch mid-update */
+    for (uint32_t s = 0; s < store->shard_count; s++)
+        cls_shard_lock(store, &store->shards[s]);
+
+    cls_mem_fixups_t fx;
+    memset(&fx, 0, sizeof(fx));
+    cls_fixups_collect(store, &fx);
+
+    cls_status_t status = CLS_ERR_NOMEM;
+    if (!fx.failed) {
+        cls_mem_snap_hdr_t hdr;
+        cls_snap_hdr_build(ctx, store, store->gen + 1, fx.count, &hdr);
+
+        /* Once the snapshot is in place the old log is redundant: a crash
+         * before the reset leaves a log of the previous generation, which
+         * the next init ignores */
+        status = cls_snap_write(store->snap_path, &hdr, ctx->pool, fx.items);
+        if (CLS_IS_OK(status)) {
+            store->gen = hdr.gen;
+            status = cls_wal_reset(store->wal, hdr.gen, hdr.store_time_us);
+        }
+    }
+
+    for (uint32_t s = store->shard_count; s-- > 0; )
+        cls_shard_unlock(store, &store->shards[s]);
+    free(fx.items);
+    return status;
+}
+
+cls_status_t cls_memory_image_write(cls_memory_ctx_t *ctx, int fd, uint64_t *len) {
+    if (!ctx || !ctx->store || fd < 0) return CLS_ERR_INVALID;
+
+    cls_mem_store_t *store = cls_get_store(ctx);
+    if (store->shm) return CLS_ERR_STATE;
+
+    for (uint32_t s = 0; s < store->shard_count; s++)
+        cls_shard_lock(store, &store->shards[s]);
+
+    cls_mem_fixups_t fx;
+    memset(&fx, 0, sizeof(fx));
+    cls_fixups_collect(store, &fx);
+
+    cls_status_t status = CLS_ERR_NOMEM;
+    if (!fx.failed) {
+        cls_mem_snap_hdr_t hdr;
+        cls_snap_hdr_build(ctx, store, store->gen, fx.count, &hdr);
+        status = cls_snap_emit(fd, &hdr, ctx->pool, fx.items);
+        if (CLS_IS_OK(status) && len) *len = cls_snap_size(&hdr);
+    }
+
+    for (uint32_t s = store->shard_count; s-- > 0; )
+        cls_shard_unlock(store, &store->shards[s]);
+    free(fx.items);
+    return status;
+}
+
+cls_status_t cls_memory_flush(cls_memory_ctx_t *ctx) {
+    if (!ctx || !ctx->store) return CLS_ERR_INVALID;
+
+    cls_mem_store_t *store = cls_get_store(ctx);
+    if (!store->wal) return CLS_ERR_STATE;
+    return cls_wal_flush(store->wal);
+}
+
+/* Inline and cold counters summed over a run of shards */
+static void cls_stats_layout(const cls_mem_store_t *store, uint32_t first, uint32_t count,
+                             cls_memory_stats_t *out) {
+    for (uint32_t i = first; i < first + count; i++) {
+        const cls_mem_root_t *root = cls_shard_root(&store->shards[i]);
+        out->inline_entries += CLS_LOAD_RLX(&root->inline_count);
+        out->cold_entries += CLS_LOAD_RLX(&root->cold_count);
+        out->cold_bytes += CLS_LOAD_RLX(&root->cold_bytes);
+        out->cold_stored += CLS_LOAD_RLX(&root->cold_stored);
+    }
+    out->spilled_entries = out->entries > out->inline_entries ?
+                           out->entries - out->inline_entries : 0;
+}
+
 void cls_memory_stats(const cls_memory_ctx_t *ctx,
                        size_t *used, size_t *total, uint32_t *entries) {
     if (!ctx) return;
-    if (used)    *used = ctx->used;
+    if (used)    *used = CLS_LOAD_RLX(&ctx->used);
     if (total)   *total = ctx->pool_size;
-    if (entries) *entries = ctx->entry_count;
+    if (entries) *entries = CLS_LOAD_RLX(&ctx->entry_count);
+
+    /* The context only sees this process's writes; the segment has all */
+    const cls_mem_store_t *store = cls_get_store(ctx);
+    if (!store || !store->shm) return;
+    if (used) {
+        *used = 0;
+        for (uint32_t i = 0; i < store->shard_count; i++)
+            *used += cls_shard_used(store, &store->shards[i]);
+    }
+    if (entries) {
+        *entries = 0;
+        for (uint32_t i = 0; i < store->ns_count; i++)
+            *entries += CLS_LOAD_RLX(&store->ns[i].entry_count);
+    }
+}
+
+void cls_memory_stats_ex(const cls_memory_ctx_t *ctx, cls_memory_stats_t *out) {
+    if (!ctx || !out) return;
+
+    memset(out, 0, sizeof(*out));
+    cls_memory_stats(ctx, &out->used, &out->total, &out->entries);
+    out->max_entries = ctx->max_entries;
+    out->hits = CLS_LOAD_RLX(&ctx->hit_count);
+    out->misses = CLS_LOAD_RLX(&ctx->miss_count);
+    if (out->hits + out->misses > 0)
+        out->hit_ratio = (double)out->hits / (double)(out->hits + out->misses);
+
+    const cls_mem_store_t *store = cls_get_store(ctx);
+    if (store) {
+        out->evict = store->ns[0].evict;
+        for (uint32_t i = 0; i < store->ns_count; i++) {
+            out->evictions += CLS_LOAD_RLX(&store->ns[i].evictions);
+            out->rejections += CLS_LOAD_RLX(&store->ns[i].rejections);
+        }
+        cls_stats_layout(store, 0, store->shard_count, out);
+        if (store->shm) out->lock_recoveries = CLS_LOAD_RLX(&store->shm->hdr->lock_recoveries);
+    }
+}
+
+uint32_t cls_memory_ns_find(const cls_memory_ctx_t *ctx, const char *key) {
+    if (!ctx || !ctx->store || !key) return 0;
+    return cls_ns_of(cls_get_store(ctx), key, strlen(key));
+}
+
+cls_status_t cls_memory_ns_stats(const cls_memory_ctx_t *ctx, uint32_t ns,
+                                  cls_memory_stats_t *out) {
+    if (!ctx || !ctx->store || !out) return CLS_ERR_INVALID;
+
+    const cls_mem_store_t *store = cls_get_store(ctx);
+    if (ns >= store->ns_count) return CLS_ERR_NOT_FOUND;
+
+    const cls_mem_ns_t *n = &store->ns[ns];
+    memset(out, 0, sizeof(*out));
+    for (uint32_t s = n->shard_first; s < n->shard_first + n->shard_count; s++)
+        out->used += cls_shard_used(store, &store->shards[s]);
+    out->total = n->pool_size;
+    out->entries = CLS_LOAD_RLX(&n->entry_count);
+    out->max_entries = n->max_entries;
+    out->hits = CLS_LOAD_RLX(&n->hits);
+    out->misses = CLS_LOAD_RLX(&n->misses);
+    if (out->hits + out->misses > 0)
+        out->hit_ratio = (double)out->hits / (double)(out->hits + out->misses);
+    out->evictions = CLS_LOAD_RLX(&n->evictions);
+    out->rejections = CLS_LOAD_RLX(&n->rejections);
+    out->evict = n->evict;
+    cls_stats_layout(store, n->shard_first, n->shard_count, out);
+    return CLS_OK;
+}
+
+uint32_t cls_memory_hot_keys(const cls_memory_ctx_t *ctx, cls_mem_hot_kind_t kind,
+                             bool prefixes, cls_mem_hot_entry_t *out, uint32_t max) {
+    if (!ctx || !ctx->store || !out) return 0;
+    return cls_hot_top(cls_get_store(ctx)->hot, kind, prefixes, out, max);
+}
+
+void cls_memory_hot_reset(cls_memory_ctx_t *ctx) {
+    if (!ctx || !ctx->store) return;
+    cls_hot_reset(cls_get_store(ctx)->hot);
 }
 
 void cls_memory_destroy(cls_memory_ctx_t *ctx) {
     if (!ctx || !ctx->pool) return;
 
-    cls_mem_table_t *table = cls_get_table(ctx);
-    for (uint32_t i = 0; i < CLS_MEM_BUCKET_COUNT; i++) {
-        cls_mem_entry_t *entry = table->buckets[i];
-        while (entry) {
-            cls_mem_entry_t *next = entry->next;
-            free(entry->data);
-            free(entry);
-            entry = next;
-        }
-    }
+    /* Entries, values and tables all live in the shard arenas */
+    cls_mem_store_t *store = cls_get_store(ctx);
+    if (store && store->wal) cls_memory_checkpoint(ctx);
 
-    free(table);
+    void *map = store ? store->snap_map : NULL;
+    size_t map_len = store ? store->snap_len : 0;
+    cls_mem_shm_t *shm = store ? store->shm : NULL;
+    cls_store_free(store, store ? store->shard_count : 0);
+    cls_pool_free(ctx->pool, map, map_len, shm);
     ctx->pool = NULL;
+    ctx->store = NULL;
     ctx->used = 0;
     ctx->entry_count = 0;
 }
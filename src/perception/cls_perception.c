@@ -42,6 +42,20 @@ cls_status_t cls_perception_register(cls_perception_t *p, const cls_sensor_t *se
     return CLS_OK;
 }
 
+cls_status_t cls_perception_bind(cls_perception_t *p, uint32_t sensor_id,
+                                 cls_sensor_read_fn read_fn, void *user_ctx) {
+    if (!p) return CLS_ERR_INVALID;
+
+    for (uint32_t i = 0; i < p->sensor_count; i++) {
+        if (p->sensors[i].id == sensor_id) {
+            p->sensors[i].read_fn = read_fn;
+            p->sensors[i].user_ctx = user_ctx;
+            return CLS_OK;
+        }
+    }
+    return CLS_ERR_NOT_FOUND;
+}
+
 cls_status_t cls_perception_unregister(cls_perception_t *p, uint32_t sensor_id) {
     if (!p) return CLS_ERR_INVALID;
 
@@ -89,9 +103,16 @@ cls_status_t cls_perception_process(cls_perception_t *p, const cls_frame_t *fram
 }
 
 cls_status_t cls_perception_poll(cls_perception_t *p) {
-    if (!p) return CLS_ERR_INVALID;
+    uint32_t count;
+    return cls_perception_poll_into(p, NULL, 0, &count);
+}
+
+cls_status_t cls_perception_poll_into(cls_perception_t *p, cls_percept_t *out,
+                                       uint32_t max, uint32_t *count) {
+    if (!p || !count) return CLS_ERR_INVALID;
 
     bool any_read = false;
+    *count = 0;
 
     for (uint32_t i = 0; i < p->sensor_count; i++) {
         if (!p->sensors[i].active || !p->sensors[i].read_fn)
@@ -115,6 +136,8 @@ cls_status_t cls_perception_poll(cls_perception_t *p) {
 
             cls_percept_t percept;
             cls_perception_process(p, &frame, &percept);
+            if (out && *count < max)
+                out[(*count)++] = percept;
             any_read = true;
         }
     }
@@ -87,29 +87,56 @@ cls_status_t cls_planner_generate(cls_planner_t *planner, const cls_decision_t *
     cls_plan_t *plan = &planner->plans[planner->plan_count];
     memset(plan, 0, sizeof(cls_plan_t));
 
-    plan->plan_id = (uint32_t)planner->plans_generated + 1;
-    plan->status = CLS_PLAN_PENDING;
     plan->max_tasks = decision_count * 2;  /* Room for subtasks */
     plan->tasks = (cls_task_t *)calloc(plan->max_tasks, sizeof(cls_task_t));
     if (!plan->tasks) return CLS_ERR_NOMEM;
 
+    cls_planner_reset_plan(planner, plan);
+    cls_planner_fill(planner, plan, decisions, decision_count);
+    if (plan->plan_id == 0)     /* Generated plans count even when empty */
+        plan->plan_id = (uint32_t)++planner->plans_generated;
+    planner->plan_count++;
+    *out_plan = plan;
+
+    return CLS_OK;
+}
+
+void cls_planner_reset_plan(cls_planner_t *planner, cls_plan_t *plan) {
+    if (!planner || !plan) return;
+
+    plan->plan_id = 0;
+    plan->status = CLS_PLAN_ACTIVE;
+    plan->task_count = 0;
+    plan->total_cost = 0.0f;
+    plan->total_reward = 0.0f;
+    plan->success_probability = 0.0f;
     plan->created_at = cls_plan_time_us();
+}
+
+uint32_t cls_planner_fill(cls_planner_t *planner, cls_plan_t *plan,
+                          const cls_decision_t *decisions, uint32_t decision_count) {
+    if (!planner || !plan || !decisions) return 0;
 
     /* Convert decisions to tasks, sorted by priority (descending) */
-    for (uint32_t i = 0; i < decision_count; i++) {
-        if (decisions[i].confidence < 0.1f) continue;  /* Skip low-confidence */
+    uint32_t used = 0;
+    for (; used < decision_count && plan->task_count < plan->max_tasks; used++) {
+        const cls_decision_t *d = &decisions[used];
+        if (d->confidence < 0.1f) continue;  /* Skip low-confidence */
+
+        /* A plan is only counted once it holds work */
+        if (plan->plan_id == 0)
+            plan->plan_id = (uint32_t)++planner->plans_generated;
 
         cls_task_t *task = &plan->tasks[plan->task_count];
+        memset(task, 0, sizeof(cls_task_t));
         task->task_id = plan->task_count + 1;
-        task->action_id = decisions[i].action_id;
-        task->priority = (cls_priority_t)CLS_CLAMP(decisions[i].priority / 25, 0, 3);
+        task->action_id = d->action_id;
+        task->priority = (cls_priority_t)CLS_CLAMP(d->priority / 25, 0, 3);
         task->status = CLS_PLAN_PENDING;
-        task->cost_estimate = 1.0f - decisions[i].confidence;
-        task->reward_estimate = decisions[i].confidence;
-        task->dep_count = 0;
-        task->params = decisions[i].params;
-        task->params_len = decisions[i].params_len;
-        task->deadline_us = 0;
+        task->cost_estimate = 1.0f - d->confidence;
+        task->reward_estimate = d->confidence;
+        task->params = d->params;
+        task->params_len = d->params_len;
 
         plan->total_cost += task->cost_estimate;
         plan->total_reward += task->reward_estimate;
@@ -121,12 +148,14 @@ cls_status_t cls_planner_generate(cls_planner_t *planner, const cls_decision_t *
         plan->success_probability = plan->total_reward / (float)plan->task_count;
     }
 
-    plan->status = CLS_PLAN_ACTIVE;
-    planner->plan_count++;
-    planner->plans_generated++;
-    *out_plan = plan;
+    return used;
+}
 
-    return CLS_OK;
+void cls_planner_finish_plan(cls_planner_t *planner, const cls_plan_t *plan) {
+    if (!planner || !plan || plan->task_count == 0) return;
+
+    if (plan->status == CLS_PLAN_COMPLETE) planner->plans_completed++;
+    else if (plan->status == CLS_PLAN_FAILED) planner->plans_failed++;
 }
 
 cls_status_t cls_plan_add_task(cls_plan_t *plan, const cls_task_t *task) {